@@ -0,0 +1,104 @@
+#include "adaptive_interval.h"
+#include "file_system.h"
+#include <math.h>
+
+namespace {
+const uint32_t INTERVAL_STATE_MAGIC = 0x41493031; // "AI01"
+const double METERS_PER_DEGREE = 111320.0;
+
+struct IntervalState {
+  uint32_t magic;
+  bool havePrevious;
+  bool haveCourse;
+  int32_t previousLatE7;
+  int32_t previousLonE7;
+  uint32_t previousEpoch;
+  float previousCourseDeg;  // Fix-to-fix course into the previous fix
+  uint32_t lastIntervalS;
+};
+
+RTC_DATA_ATTR IntervalState g_state;
+
+bool g_fixThisWake = false;
+unsigned long g_fixMs = 0;
+float g_speedMps = 0;
+float g_turnRateDegS = 0;
+
+IntervalState& state() {
+  if (g_state.magic != INTERVAL_STATE_MAGIC) {
+    g_state = {};
+    g_state.magic = INTERVAL_STATE_MAGIC;
+  }
+  return g_state;
+}
+} // namespace
+
+void adaptive_interval_add_fix(double lat, double lon, double speedKmh, uint32_t epoch) {
+  IntervalState& s = state();
+  g_fixThisWake = true;
+  g_fixMs = millis();
+  g_speedMps = speedKmh > 0 ? static_cast<float>(speedKmh / 3.6) : 0;
+  g_turnRateDegS = 0;
+  int32_t latE7 = static_cast<int32_t>(lround(lat * 1e7));
+  int32_t lonE7 = static_cast<int32_t>(lround(lon * 1e7));
+
+  if (s.havePrevious && epoch > s.previousEpoch) {
+    double cosLat = cos(lat * DEG_TO_RAD);
+    float dx = static_cast<float>((static_cast<int64_t>(lonE7) - s.previousLonE7) * 1e-7 * METERS_PER_DEGREE * cosLat);
+    float dy = static_cast<float>((static_cast<int64_t>(latE7) - s.previousLatE7) * 1e-7 * METERS_PER_DEGREE);
+    float leg = sqrtf(dx * dx + dy * dy);
+    if (leg >= SAMPLE_MIN_LEG_M) {
+      if (g_speedMps <= 0) {
+        // A fix taken at the first GGA has no RMC speed yet; the leg gives the average
+        g_speedMps = leg / static_cast<float>(epoch - s.previousEpoch);
+      }
+      float course = atan2f(dx, dy) * RAD_TO_DEG;
+      if (s.haveCourse) {
+        float turn = fabsf(course - s.previousCourseDeg);
+        if (turn > 180.0f) {
+          turn = 360.0f - turn;
+        }
+        g_turnRateDegS = turn / static_cast<float>(epoch - s.previousEpoch);
+      }
+      s.previousCourseDeg = course;
+      s.haveCourse = true;
+    } else {
+      s.haveCourse = false; // Standing still: the next leg starts a new course
+    }
+  } else {
+    s.haveCourse = false;
+  }
+  s.previousLatE7 = latE7;
+  s.previousLonE7 = lonE7;
+  s.previousEpoch = epoch;
+  s.havePrevious = epoch != 0;
+}
+
+uint64_t adaptive_interval_next(uint64_t nominalSeconds) {
+  if (sampleResolutionM <= 0) {
+    return nominalSeconds;
+  }
+  IntervalState& s = state();
+  float lo = static_cast<float>(sampleIntervalMinS);
+  float hi = static_cast<float>(sampleIntervalMaxS > sampleIntervalMinS ? sampleIntervalMaxS : sampleIntervalMinS);
+  float interval = static_cast<float>(nominalSeconds);
+  if (g_fixThisWake) {
+    // Fix to fix: the time spent awake since the fix (upload, ...) is already part of it
+    float elapsedS = (millis() - g_fixMs) / 1000.0f;
+    interval = hi;
+    if (g_speedMps > 0) {
+      interval = fminf(interval, sampleResolutionM / g_speedMps - elapsedS);
+    }
+    if (g_turnRateDegS > 0) {
+      interval = fminf(interval, SAMPLE_TURN_DEG / g_turnRateDegS - elapsedS);
+    }
+    if (s.lastIntervalS > 0) {
+      interval = fminf(interval, s.lastIntervalS * SAMPLE_MAX_GROWTH);
+    }
+  }
+  interval = interval < lo ? lo : (interval > hi ? hi : interval);
+  s.lastIntervalS = static_cast<uint32_t>(interval);
+  DBG_PRINTF("[SAMPLE] Next fix in %lu s (%.1f km/h, turning %.2f deg/s).\n",
+             static_cast<unsigned long>(s.lastIntervalS), g_speedMps * 3.6f, g_turnRateDegS);
+  return s.lastIntervalS;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// Adaptive sampling interval.
+//
+// With a target spatial resolution (`resolution_m`) the sleep before the next fix is
+// the time to travel that distance at the speed of this fix, shortened when the course
+// between the last fixes turns faster than SAMPLE_TURN_DEG per interval and capped at
+// SAMPLE_MAX_GROWTH times the previous interval, so a stop or a straight stretch
+// stretches it gradually. The result stays within [interval_min, interval_max]. The
+// previous fix and course live in RTC memory.
+
+// A fix was obtained in this wake; `epoch` 0 when its time is unknown
+void adaptive_interval_add_fix(double lat, double lon, double speedKmh, uint32_t epoch);
+
+// Sleep before the next fix; `nominalSeconds` (interval_gps) when the resolution is 0
+uint64_t adaptive_interval_next(uint64_t nominalSeconds);
@@ -0,0 +1,179 @@
+#include "batch_tuning.h"
+#include <math.h>
+
+namespace {
+const uint32_t BATCH_TUNING_MAGIC = 0x42543032; // "BT02"
+
+// Weight kept by older samples on every new one (~10 sample memory)
+const float REQUEST_SAMPLE_DECAY = 0.9f;
+// Weight kept by older batch outcomes on every new one (~20 batch memory)
+const float BATCH_SAMPLE_DECAY = 0.95f;
+const float MIN_LOSS_HAZARD = 1e-4f;
+
+// Priors used until measurements exist
+const float PRIOR_REQUEST_MS = 1500.0f;    // Fixed +HTTPACTION round trip incl. TLS
+const float PRIOR_BYTE_MS = 0.1f;          // Upload time per body byte
+const float PRIOR_SESSION_MS = 20000.0f;   // Power-on, registration and PDP attach
+const float PRIOR_RECORD_BYTES = 190.0f;
+const float PRIOR_EXPOSED_RECORDS = 1000.0f;
+const float PRIOR_FAILED_BATCHES = 1.0f;   // 1e-3 loss hazard per record
+
+struct BatchTuningState {
+  uint32_t magic;
+  // Decayed least-squares sums of request latency (y, ms) against body size (x, bytes)
+  float sw, sx, sy, sxx, sxy;
+  float sessionOverheadMs; // Modem-on time not spent in HTTP requests
+  float bytesPerRecord;
+  // Decayed failed batches over records exposed in all batches
+  float exposedRecords;
+  float failedBatches;
+};
+
+RTC_DATA_ATTR BatchTuningState g_state;
+
+uint32_t g_serverCap = 0;
+unsigned long g_sessionStartMs = 0;
+float g_sessionRequestMs = 0;
+bool g_sessionActive = false;
+
+BatchTuningState& state() {
+  if (g_state.magic != BATCH_TUNING_MAGIC) {
+    g_state = {};
+    g_state.magic = BATCH_TUNING_MAGIC;
+    g_state.sessionOverheadMs = PRIOR_SESSION_MS;
+    g_state.bytesPerRecord = PRIOR_RECORD_BYTES;
+    g_state.exposedRecords = PRIOR_EXPOSED_RECORDS;
+    g_state.failedBatches = PRIOR_FAILED_BATCHES;
+  }
+  return g_state;
+}
+
+float ewma(float current, float sample, float weight) {
+  return current + weight * (sample - current);
+}
+
+// Latency model: requestMs = intercept + slope * bytes
+void request_model(float& interceptMs, float& slopeMs) {
+  const BatchTuningState& s = state();
+  slopeMs = PRIOR_BYTE_MS;
+  interceptMs = PRIOR_REQUEST_MS;
+  if (s.sw < 0.5f) {
+    return;
+  }
+  float det = s.sw * s.sxx - s.sx * s.sx;
+  float meanX = s.sx / s.sw;
+  // Handshakes alone all have the same size; the slope needs some spread in body sizes
+  if (det > s.sw * s.sw * 100.0f * 100.0f) {
+    slopeMs = (s.sw * s.sxy - s.sx * s.sy) / det;
+  }
+  if (slopeMs < 0.001f) {
+    slopeMs = 0.001f;
+  }
+  interceptMs = s.sy / s.sw - slopeMs * meanX;
+  if (interceptMs < 0) {
+    interceptMs = 0;
+  }
+}
+
+// Per-record loss rate, assuming each record adds the same risk of losing its batch
+float loss_hazard() {
+  const BatchTuningState& s = state();
+  float hazard = s.failedBatches / s.exposedRecords;
+  return hazard > MIN_LOSS_HAZARD ? hazard : MIN_LOSS_HAZARD;
+}
+
+uint32_t batch_cap() {
+  uint32_t cap = static_cast<uint32_t>((SERVER_MAX_BODY_BYTES - 2) / state().bytesPerRecord);
+  if (cap > MAX_BATCH_SIZE) {
+    cap = MAX_BATCH_SIZE;
+  }
+  if (g_serverCap > 0 && g_serverCap < cap) {
+    cap = g_serverCap;
+  }
+  return cap > 0 ? cap : 1;
+}
+
+// Expected modem-on time per delivered record for batches of n records. A failed
+// batch costs its request and keeps its records for another session.
+float cost_per_record(uint32_t n, float requestMs, float recordMs, float sessionMs, float hazard) {
+  float success = expf(-hazard * n);
+  return (requestMs + recordMs * n + (1.0f - success) * sessionMs) / (n * success);
+}
+} // namespace
+
+void batch_tuning_session_begin() {
+  g_sessionStartMs = millis();
+  g_sessionRequestMs = 0;
+  g_sessionActive = true;
+}
+
+void batch_tuning_session_end() {
+  if (!g_sessionActive) {
+    return;
+  }
+  g_sessionActive = false;
+  float overhead = static_cast<float>(millis() - g_sessionStartMs) - g_sessionRequestMs;
+  if (overhead > 0) {
+    BatchTuningState& s = state();
+    s.sessionOverheadMs = ewma(s.sessionOverheadMs, overhead, 0.25f);
+    DBG_PRINTF("[BATCH] Session overhead %.0f ms (avg %.0f ms)\n", overhead, s.sessionOverheadMs);
+  }
+}
+
+void batch_tuning_record_request(size_t bodyBytes, uint32_t latencyMs) {
+  BatchTuningState& s = state();
+  float x = static_cast<float>(bodyBytes);
+  float y = static_cast<float>(latencyMs);
+  s.sw = s.sw * REQUEST_SAMPLE_DECAY + 1.0f;
+  s.sx = s.sx * REQUEST_SAMPLE_DECAY + x;
+  s.sy = s.sy * REQUEST_SAMPLE_DECAY + y;
+  s.sxx = s.sxx * REQUEST_SAMPLE_DECAY + x * x;
+  s.sxy = s.sxy * REQUEST_SAMPLE_DECAY + x * y;
+  g_sessionRequestMs += y;
+}
+
+void batch_tuning_record_batch(uint32_t records, size_t bodyBytes, bool delivered) {
+  if (records == 0) {
+    return;
+  }
+  BatchTuningState& s = state();
+  s.exposedRecords = s.exposedRecords * BATCH_SAMPLE_DECAY + records;
+  s.failedBatches = s.failedBatches * BATCH_SAMPLE_DECAY + (delivered ? 0.0f : 1.0f);
+  s.bytesPerRecord = ewma(s.bytesPerRecord, static_cast<float>(bodyBytes) / records, 0.25f);
+}
+
+void batch_tuning_set_server_cap(uint32_t cap) {
+  g_serverCap = cap;
+}
+
+uint32_t batch_tuning_batch_size() {
+  float requestMs, byteMs;
+  request_model(requestMs, byteMs);
+  const BatchTuningState& s = state();
+  float recordMs = byteMs * s.bytesPerRecord;
+  float hazard = loss_hazard();
+
+  uint32_t cap = batch_cap();
+  uint32_t best = 1;
+  float bestCost = cost_per_record(1, requestMs, recordMs, s.sessionOverheadMs, hazard);
+  for (uint32_t n = 2; n <= cap; n++) {
+    float cost = cost_per_record(n, requestMs, recordMs, s.sessionOverheadMs, hazard);
+    if (cost < bestCost) {
+      bestCost = cost;
+      best = n;
+    }
+  }
+  return best;
+}
+
+void batch_tuning_describe(JsonObject out) {
+  float requestMs, byteMs;
+  request_model(requestMs, byteMs);
+  const BatchTuningState& s = state();
+  out["size"] = batch_tuning_batch_size();
+  out["cap"] = batch_cap();
+  out["request_ms"] = lroundf(requestMs);
+  out["byte_us"] = lroundf(byteMs * 1000.0f);
+  out["session_ms"] = lroundf(s.sessionOverheadMs);
+  out["loss_ppm"] = lroundf(loss_hazard() * 1e6f);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// Adaptive upload batch sizing.
+//
+// Every modem session feeds its measured costs in here: the +HTTPDATA/+HTTPACTION
+// latency of each request against its body size, the total modem-on time and the
+// outcome of each uploaded batch. From these the module picks the number of records
+// per POST that minimizes the expected modem-on time per delivered fix. The state
+// lives in RTC memory, so it survives deep sleep and falls back to priors after a
+// power loss.
+
+// A modem session started (modem power-on)
+void batch_tuning_session_begin();
+
+// The modem session ended (modem power-off)
+void batch_tuning_session_end();
+
+// One HTTP request finished; `bodyBytes` were uploaded in `latencyMs`
+void batch_tuning_record_request(size_t bodyBytes, uint32_t latencyMs);
+
+// One upload batch finished; `delivered` is false when the server did not confirm it
+void batch_tuning_record_batch(uint32_t records, size_t bodyBytes, bool delivered);
+
+// Upper limit on records per POST sent by the server (config.max_batch), 0 = none
+void batch_tuning_set_server_cap(uint32_t cap);
+
+// Records per POST to use for the next upload
+uint32_t batch_tuning_batch_size();
+
+// Adds the current choice and the measurements behind it to a handshake payload
+void batch_tuning_describe(JsonObject out);
@@ -36,33 +36,211 @@ const uint32_t BTN_SHORT_PRESS_MS   = 500;   // Minimum duration for a short pre
 const uint32_t BTN_LONG_PRESS_MS    = 2000;  // Minimum duration for a long press (e.g., for OTA mode)
 
 // --- GPS Configuration ---
-#define GPS_BAUD_RATE           9600
+#define GPS_BAUD_RATE           9600    // L76K default after power-up
+#define GPS_FAST_BAUD_RATE      115200  // Switched to with $PCAS01 (4800..115200); = GPS_BAUD_RATE to disable
+const unsigned long GPS_CONFIG_VERIFY_MS = 3500; // Read back one full epoch after reconfiguring (1 Hz)
+const unsigned long GPS_BAUD_CHECK_MS = 1500;    // Wait for one sentence at GPS_FAST_BAUD_RATE once verified
+const unsigned long GPS_POWER_CYCLE_MS = 200;    // Rail off to reset a receiver stuck at an unreadable rate
 #define SAT_THRESHOLD           1   // Minimum satellites for a valid fix
 const unsigned long GPS_ACQUISITION_TIMEOUT_MS = 5 * 60 * 1000; // 5 minutes for GPS fix attempt
 
+// --- Fix Quality ---
+// A fix is accepted once the horizontal error estimated over the last few samples
+// (HDOP x UERE and the scatter around a constant-velocity track) meets the target.
+#define GPS_ACCURACY_TARGET_M   10  // Default accuracy target (m), server config `accuracy_m`; 0 = first valid fix
+const float GPS_UERE_M = 4.0f;                        // User range error behind 1.0 HDOP
+const uint8_t GPS_QUALITY_WINDOW = 8;                 // 1 Hz samples kept for the estimate
+const uint8_t GPS_QUALITY_MIN_SAMPLES = 4;            // Needed before scatter is trusted
+const unsigned long GPS_QUALITY_MAX_WAIT_MS = 20000;  // After the first usable sample: take the best one
+// GSA (PDOP, used satellites) and GSV (C/N0) stay in the receiver output. When the solution
+// uses enough strong satellites at a low PDOP, HDOP x UERE is trusted before the scatter is.
+#define GPS_SATELLITE_SENTENCES true          // false = GGA + RMC only, no early acceptance
+const float GPS_TRUSTED_PDOP = 2.0f;
+const uint8_t GPS_TRUSTED_MIN_SV = 6;          // Used satellites at or above GPS_TRUSTED_CN0_DBHZ
+const uint8_t GPS_TRUSTED_CN0_DBHZ = 30;
+const uint8_t GPS_TRUSTED_MIN_SAMPLES = 2;     // Instead of GPS_QUALITY_MIN_SAMPLES
+
+// --- Event-Driven GPS Reception ---
+// The UART RX-timeout callback queues whole sentences; gps_get_fix() blocks on the queue
+// and light-sleeps the CPU between 1 Hz bursts once the output is limited to the parsed sentences.
+const uint8_t GPS_SENTENCE_MAX = 96;              // Longest sentence kept (NMEA limit is 82)
+const uint8_t GPS_SENTENCE_QUEUE_LEN = 16;        // One full-output epoch at 9600 baud
+const unsigned long GPS_QUEUE_WAIT_MS = 250;      // Longest block between abort/timeout checks
+const unsigned long GPS_BURST_GAP_MS = 300;       // Quiet time that separates two bursts
+const bool GPS_LIGHT_SLEEP = true;                // Light-sleep between bursts (not while the modem task runs)
+const unsigned long GPS_WAKE_MARGIN_MS = 50;      // Wake this long before the next burst is due
+const unsigned long GPS_MIN_LIGHT_SLEEP_MS = 100; // Shorter gaps are not worth a sleep
+
+// --- GNSS Standby Between Wakes ---
+// For short sleeps the L76K stays powered in standby ($PCAS12) with GPS_POWER_PIN held
+// through deep sleep; it keeps time and ephemeris and hot-starts on the next wake.
+// Longer sleeps cut the rail (ephemeris ages out after 2-4 h and standby draws ~0.5 mA).
+// After a cut the receiver is aided with the last position and the time carried in RTC memory.
+const uint32_t GPS_STANDBY_MAX_SLEEP_S = 3600;   // Longest sleep that keeps the receiver in standby
+const float GPS_RTC_DRIFT = 0.02f;               // Worst-case drift of the RTC clock in deep sleep
+const float GPS_AID_POSITION_ACC_M = 5000.0f;    // Uncertainty given with the last known position
+
+// --- Track Compression ---
+// Fixes pass an online simplifier before they are cached: points that stay within
+// `track_tolerance_m` of a straight segment are dropped, and a stationary device
+// (within `dwell_radius_m`) is reported as one dwell record with its duration.
+// Held fixes do not count toward batch_threshold; a long stop is reported every
+// TRACK_DWELL_REPORT_S, so a parked device still uploads and sees server instructions.
+#define TRACK_TOLERANCE_M       10   // Default, server config `track_tolerance_m`; 0 = cache every fix
+#define TRACK_DWELL_RADIUS_M    25   // Default, server config `dwell_radius_m`
+const uint8_t TRACK_WINDOW_POINTS = 8;          // Fixes held back in RTC memory per segment
+const float TRACK_HEADING_CHANGE_DEG = 30.0f;   // Turn that ends a segment regardless of tolerance
+const float TRACK_DWELL_MAX_SPEED_KMH = 3.0f;   // Reported speed above this is never a dwell
+const uint32_t TRACK_DWELL_REPORT_S = 6 * 3600; // Open dwell cached at least this often
+
+// --- Adaptive Sampling Interval ---
+// With a target resolution the sleep between fixes follows the track: about one fix per
+// `resolution_m` travelled, sooner when the course turns, within [interval_min, interval_max].
+// interval_gps stays the interval after a failed fix and when the resolution is 0.
+#define SAMPLE_RESOLUTION_M     0    // Default, server config `resolution_m`; 0 = fixed interval_gps
+#define SAMPLE_INTERVAL_MIN_S   15   // Default, server config `interval_min`
+#define SAMPLE_INTERVAL_MAX_S   900  // Default, server config `interval_max`
+const float SAMPLE_TURN_DEG = 30.0f;     // Largest course change wanted between two fixes
+const float SAMPLE_MAX_GROWTH = 2.0f;    // The interval grows at most by this factor per wake
+const float SAMPLE_MIN_LEG_M = 25.0f;    // Shorter fix-to-fix legs give no usable course
+
+// --- Motion Gating (optional IMU) ---
+// With a QMI8658 on the pins below, its wake-on-motion interrupt wakes the ESP32 (ext1).
+// After MOTION_STILL_WAKES wakes without motion the GNSS stays off: the device sleeps
+// MOTION_HEARTBEAT_S and each wake only extends the open dwell record. Motion wakes it
+// at once and tracking resumes every sleepTimeSeconds. The stock T-Call board has no IMU.
+#ifndef IMU_MOTION_GATING
+#define IMU_MOTION_GATING       false
+#endif
+#define IMU_SDA_PIN             21
+#define IMU_SCL_PIN             22
+#define IMU_INT_PIN             39  // RTC GPIO, QMI8658 INT2
+const uint8_t IMU_WOM_THRESHOLD_MG = 64;        // Acceleration change counted as motion (1 mg steps)
+const uint8_t MOTION_STILL_WAKES = 2;           // GNSS wakes without motion before tracking stops
+const uint64_t MOTION_HEARTBEAT_S = 3600;       // Sleep while stationary (at least sleepTimeSeconds)
+const uint16_t MOTION_HEARTBEATS_PER_FIX = 24;  // A fix anyway after this many heartbeats
+
 // --- GPRS Configuration (Default values, can be overwritten by Preferences) ---
 #define DEFAULT_APN             "internet.t-mobile.cz"
 #define DEFAULT_GPRS_USER       "gprs"
 #define DEFAULT_GPRS_PASS       "gprs"
 
+// --- Modem UART ---
+// SerialAT is read through ModemSerial (modem_serial.h): a larger driver ring, and the bytes
+// are taken from it in blocks instead of one driver call each. Once the modem answers, the
+// link is moved to MODEM_FAST_BAUD_RATE with +IPR and checked with an AT; without an answer
+// both sides go back to MODEM_BAUD_RATE. +IPR is not stored by the module, so every boot
+// starts at MODEM_BAUD_RATE; a modem left running or in PSM keeps the rate through sleep.
+#define MODEM_BAUD_RATE         115200  // A76xx default after power-on
+#define MODEM_FAST_BAUD_RATE    921600  // = MODEM_BAUD_RATE to disable
+const size_t MODEM_UART_RX_BUFFER = 4096;       // ESP32 driver ring for SerialAT (Arduino default 256); ~44 ms at 921600
+const unsigned long MODEM_BAUD_VERIFY_MS = 500; // AT answer expected at a new rate
+
+// --- Modem Power-On ---
+// How the last session ended is kept in RTC memory. After a clean +CPOF the modem is started
+// with a short PWRKEY pulse and its boot URCs, without the AT probe and the reset pulse; after
+// a session that reached the network, init() and ATI are skipped as well (model and IMEI are
+// cached). A first boot or a failed session runs the full probing sequence.
+const unsigned long MODEM_PWRKEY_PULSE_MS = 100;   // A76xx power-on needs >= 50 ms
+const unsigned long MODEM_BOOT_TIMEOUT_MS = 12000; // URC wait before falling back to the full sequence
+const unsigned long MODEM_BOOT_SLICE_MS = 1000;    // One AT per slice while waiting for the URCs
+const unsigned long MODEM_RESUME_PROBE_MS = 300;   // AT probe when the modem was left running
+
+// --- Modem Power Saving Mode ---
+// PSM (+CPSMS) and eDRX (+CEDRXS) are requested on every modem boot, before the attach. At
+// the end of a session the granted timers are read back (+CEREG: 4); if the network granted
+// PSM the modem is not switched off but left registered with its rail held through deep
+// sleep, and the next session only wakes it with PWRKEY (no boot, attach or PDP activation).
+// Without a grant the modem is powered off as before. Timer values are 3GPP TS 24.008 bit strings.
+const bool MODEM_PSM = true;
+#define MODEM_PSM_PERIODIC_TAU  "00100001" // T3412: 1 h
+#define MODEM_PSM_ACTIVE_TIME   "00000001" // T3324: 2 s of paging before PSM
+#define MODEM_EDRX_CYCLE        "0101"     // 81.92 s (E-UTRAN) within the active time
+const unsigned long MODEM_PSM_RESUME_MS = 2000; // AT answer after the PWRKEY wake
+
+// --- Upload Transport ---
+// AT: the modem's own HTTP(S) service (+HTTPINIT/+HTTPDATA/+HTTPACTION/+HTTPREAD), one request
+// at a time. SOCKET: HTTP/1.1 written by ArduinoHttpClient into a TLS socket of TinyGsmA76xxSSL
+// (+CCHOPEN/+CCHSEND/+CCHRECV), kept alive for the GPRS session; uploads write up to
+// MODEM_HTTP_PIPELINE_DEPTH batches before reading the first answer (socket_http.h).
+// Chosen at build time, e.g. build_flags = -DMODEM_HTTP_TRANSPORT=MODEM_HTTP_TRANSPORT_SOCKET.
+// AT stays the default: in the simulator (make transport) the socket only saves ~5 % of the
+// charge while a backlog drains, nothing in steady operation, and it can resend records.
+#define MODEM_HTTP_TRANSPORT_AT     0
+#define MODEM_HTTP_TRANSPORT_SOCKET 1
+#ifndef MODEM_HTTP_TRANSPORT
+#define MODEM_HTTP_TRANSPORT MODEM_HTTP_TRANSPORT_AT
+#endif
+#if MODEM_HTTP_TRANSPORT == MODEM_HTTP_TRANSPORT_SOCKET
+#undef TINY_GSM_MODEM_A7670
+#undef TINY_GSM_MODEM_A7608
+#define TINY_GSM_MODEM_A76XXSSL // Same A76xx core (GNSS, HTTP(S), PSM), plus +CCH* TLS sockets
+#endif
+const uint8_t MODEM_HTTP_PIPELINE_DEPTH = 2;              // POSTs in flight on the socket; 1 = keep-alive only
+const size_t MODEM_HTTP_TX_CHUNK = 2048;                  // Request bytes per +CCHSEND (module maximum)
+const unsigned long MODEM_HTTP_RESPONSE_TIMEOUT_MS = 30000;
+const unsigned long MODEM_HTTP_POLL_MS = 20;              // Socket poll while a response is awaited
+
+// --- Modem Session Pipelining ---
+// When a send is due, power up the modem and attach GPRS in a background task while
+// the GPS is still acquiring; both meet at the upload stage.
+const bool PIPELINE_MODEM_WITH_GPS = true;
+const unsigned long MODEM_BRINGUP_TIMEOUT_MS = 6 * 60 * 1000; // Upper bound for init + network attach
+const unsigned long MODEM_NETWORK_SLICE_MS = 1000;            // Registration is polled in slices of this, so the lock is shared
+
+// --- Modem GNSS Assist ---
+// While the bring-up has the A7670 powered anyway, its own GNSS (A7670x-FASE/-FL) runs next
+// to the L76K and is aided by AGPS (+CAGPS) once GPRS is up. A modem fix ends an external
+// acquisition still running after MODEM_GNSS_REPLACE_AFTER_MS when it meets the accuracy target,
+// repeats within it and agrees with whatever the L76K has so far; earlier, the L76K is left to
+// finish so it keeps a fresh ephemeris for its hot start. A module without GNSS refuses
+// +CGNSSPWR once and is not asked again.
+const bool MODEM_GNSS_ASSIST = true;
+const unsigned long MODEM_GNSS_POLL_MS = 2000;     // +CGNSSINFO interval during the fix attempt
+const unsigned long MODEM_GNSS_LOCK_WAIT_MS = 1200; // Longest wait for the modem lock per poll (> MODEM_NETWORK_SLICE_MS)
+const float MODEM_GNSS_AGREE_M = 50.0f;            // Largest distance to the external estimate
+const unsigned long MODEM_GNSS_REPLACE_AFTER_MS = 40000; // Longer than a normal L76K cold start
+
 // --- Server Configuration (Default values, can be overwritten by Preferences) ---
 #define DEFAULT_SERVER_HOST     "lotr-system.xyz"
 #define DEFAULT_SERVER_PORT     443
 #define RESOURCE_POST           "/api/devices/input"
 #define RESOURCE_REGISTER       "/api/devices/register"
 #define RESOURCE_HANDSHAKE      "/api/devices/handshake"
+#define RESOURCE_SYNC           "/api/devices/sync" // Handshake + upload in one request
+const uint16_t SYNC_RETRY_SESSIONS = 48; // Sessions to stay on the two-request flow after the server lacked RESOURCE_SYNC
 #define CLIENT_TYPE             "HW"
 
 // --- File System & Preferences ---
-#define CACHE_FILE              "/gps_cache.log"
+#define CACHE_FILE              "/gps_cache.log"   // Legacy line-oriented cache, migrated into CACHE_DIR on mount
+#define CACHE_DIR               "/cache"
+#define CACHE_INDEX_FILE        "/cache/index"
 #define PREFERENCES_NAMESPACE   "gps-tracker"
 #define KEY_BATCH_SIZE          "batch_size"
 #define KEY_BATCH_THRESHOLD     "batch_threshold"
+#define KEY_ACCURACY_TARGET     "accuracy_m"
+#define KEY_TRACK_TOLERANCE     "track_tol_m"
+#define KEY_DWELL_RADIUS        "dwell_m"
+#define KEY_SAMPLE_RESOLUTION   "resolution_m"
+#define KEY_INTERVAL_MIN        "interval_min"
+#define KEY_INTERVAL_MAX        "interval_max"
+
+// --- Cache Ring Buffer ---
+// Records are appended to fixed-size segment files; acknowledged data only advances
+// the head pointer and whole segments are deleted once fully consumed.
+const size_t   CACHE_SEGMENT_BYTES = 4096; // One LittleFS block per segment
+const uint32_t CACHE_MAX_SEGMENTS  = 64;   // Ring capacity; the oldest segment is dropped beyond this
 
 // --- Batch Sending Configuration ---
 // Minimum number of cached records before attempting a modem session to send data.
 // A value of 1 means try to send every cycle.
 #define DEFAULT_BATCH_SEND_THRESHOLD 1
+// Upper bound for one upload body. Batches are streamed from the cache, so the limit
+// is set by the server (express.json body limit of 256 kB in server.js), not by RAM.
+// Kept well below it; a server still at the express default of 100 kB answers a
+// larger body with 413 and the upload falls back to smaller batches.
+const size_t SERVER_MAX_BODY_BYTES = 100 * 1024;
+const uint32_t MAX_BATCH_SIZE = 500; // Hard limit for records in one POST; server `max_batch` is clamped to it
 
 // --- Device & Sleep Configuration ---
 #define DEFAULT_DEVICE_NAME     "NEO-6M_A7670E"
@@ -2,6 +2,8 @@
 #include "ota_mode.h"
 #include "modem_control.h"
 #include "power_management.h"
+#include "gps_control.h"
+#include "batch_tuning.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
@@ -17,12 +19,17 @@ int port = DEFAULT_SERVER_PORT;
 uint64_t sleepTimeSeconds = DEFAULT_SLEEP_SECONDS;
 bool isRegistered = true; // Assume registered until told otherwise by the server
 int minSatellitesForFix = SAT_THRESHOLD;
+int fixAccuracyTargetM = GPS_ACCURACY_TARGET_M;
 String operationMode = "batch";
 int batchSizeThreshold = DEFAULT_BATCH_SEND_THRESHOLD; // Minimum records in cache to trigger sending
+int trackToleranceM = TRACK_TOLERANCE_M;
+int trackDwellRadiusM = TRACK_DWELL_RADIUS_M;
+int sampleResolutionM = SAMPLE_RESOLUTION_M;
+uint32_t sampleIntervalMinS = SAMPLE_INTERVAL_MIN_S;
+uint32_t sampleIntervalMaxS = SAMPLE_INTERVAL_MAX_S;
 
 Preferences preferences;
 
-const int MAX_BATCH_SIZE = 15; // Hard limit for the number of records sent in a single POST request
 namespace {
 SemaphoreHandle_t get_fs_mutex() {
   static portMUX_TYPE initMux = portMUX_INITIALIZER_UNLOCKED;
@@ -58,6 +65,555 @@ class FsLockGuard {
 };
 } // namespace
 
+// --- Cache ring buffer ---
+// The cache is a sequence of segment files named after a monotonically increasing
+// sequence number. Each segment holds whole CacheRecords; once the tail segment
+// is full the next sequence number is started. The head pointer (segment + byte
+// offset) marks the oldest unacknowledged record and is the only thing that
+// changes when the server confirms a batch.
+// The index also carries the pending record/byte counts so that callers never
+// have to scan the segments. An append only updates the index in RAM; it reaches
+// flash on a segment rollover, a head move and in fs_end(). After a reset the tail
+// segment is longer than the index says, and cache_open() recounts from the segments.
+// All helpers below expect the FS lock to be held by the caller.
+namespace {
+const uint32_t CACHE_INDEX_MAGIC = 0x43524247; // "GBRC"
+const uint16_t CACHE_INDEX_VERSION = 1;
+const size_t CACHE_RECORD_SIZE = sizeof(CacheRecord);
+const size_t CACHE_RECORDS_PER_SEGMENT = CACHE_SEGMENT_BYTES / CACHE_RECORD_SIZE;
+
+struct CacheIndex {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t headSeq;
+  uint32_t headOffset;
+  uint32_t tailSeq;
+  uint32_t tailBytes;    // Size of the tail segment after the last indexed append
+  uint32_t recordCount;  // Records between head and tail
+  uint32_t pendingBytes; // Bytes between head and tail
+  uint32_t checksum;
+};
+
+struct CachePosition {
+  uint32_t seq;
+  uint32_t offset;
+};
+
+CacheIndex g_cacheIndex = {};
+bool g_cacheOpen = false;
+bool g_cacheIndexDirty = false; // Appends not yet in the index file
+
+uint32_t cache_index_checksum(const CacheIndex& index) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&index);
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < offsetof(CacheIndex, checksum); ++i) {
+    hash ^= bytes[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+// CRC-16/CCITT-FALSE over everything but the trailing crc field.
+uint16_t cache_record_crc(const CacheRecord& record) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < offsetof(CacheRecord, crc); ++i) {
+    crc ^= static_cast<uint16_t>(bytes[i]) << 8;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+    }
+  }
+  return crc;
+}
+
+String cache_segment_path(uint32_t seq) {
+  char path[32];
+  snprintf(path, sizeof(path), CACHE_DIR "/%08lx.seg", static_cast<unsigned long>(seq));
+  return String(path);
+}
+
+size_t cache_segment_size(uint32_t seq) {
+  File file = LittleFS.open(cache_segment_path(seq), "r");
+  if (!file) return 0;
+  size_t size = file.size();
+  file.close();
+  return size;
+}
+
+bool cache_write_index() {
+  g_cacheIndex.magic = CACHE_INDEX_MAGIC;
+  g_cacheIndex.version = CACHE_INDEX_VERSION;
+  g_cacheIndex.checksum = cache_index_checksum(g_cacheIndex);
+  File file = LittleFS.open(CACHE_INDEX_FILE, "w");
+  if (!file) {
+    DBG_PRINTLN(F("[FS] Failed to open cache index for writing."));
+    return false;
+  }
+  bool ok = file.write(reinterpret_cast<const uint8_t*>(&g_cacheIndex), sizeof(g_cacheIndex)) == sizeof(g_cacheIndex);
+  file.close();
+  if (ok) {
+    g_cacheIndexDirty = false;
+  } else {
+    DBG_PRINTLN(F("[FS] Failed to write cache index."));
+  }
+  return ok;
+}
+
+bool cache_read_index(CacheIndex& index) {
+  File file = LittleFS.open(CACHE_INDEX_FILE, "r");
+  if (!file) return false;
+  index = {};
+  size_t read = file.read(reinterpret_cast<uint8_t*>(&index), sizeof(index));
+  file.close();
+  return read == sizeof(index) && index.magic == CACHE_INDEX_MAGIC && index.version == CACHE_INDEX_VERSION &&
+         index.checksum == cache_index_checksum(index) && index.tailSeq >= index.headSeq;
+}
+
+// Cuts a torn record (power loss in the middle of an append) off the tail segment.
+void cache_truncate_segment(uint32_t seq, size_t size) {
+  const char* tmpPath = CACHE_DIR "/tail.tmp";
+  File source = LittleFS.open(cache_segment_path(seq), "r");
+  File target = LittleFS.open(tmpPath, "w");
+  if (!source || !target) {
+    if (source) source.close();
+    if (target) target.close();
+    DBG_PRINTLN(F("[FS] Failed to truncate cache segment."));
+    return;
+  }
+  uint8_t buffer[128];
+  size_t remaining = size;
+  while (remaining > 0) {
+    size_t chunk = source.read(buffer, remaining < sizeof(buffer) ? remaining : sizeof(buffer));
+    if (chunk == 0) break;
+    target.write(buffer, chunk);
+    remaining -= chunk;
+  }
+  source.close();
+  target.close();
+  LittleFS.remove(cache_segment_path(seq));
+  LittleFS.rename(tmpPath, cache_segment_path(seq));
+}
+
+// Slow path: recomputes the counters from the segment sizes after an inconsistency was detected.
+void cache_recount() {
+  size_t tailSize = cache_segment_size(g_cacheIndex.tailSeq);
+  if (tailSize % CACHE_RECORD_SIZE != 0) {
+    tailSize -= tailSize % CACHE_RECORD_SIZE;
+    DBG_PRINTLN(F("[FS] Dropping torn record at cache tail."));
+    cache_truncate_segment(g_cacheIndex.tailSeq, tailSize);
+  }
+  g_cacheIndex.pendingBytes = 0;
+  for (uint32_t seq = g_cacheIndex.headSeq; seq <= g_cacheIndex.tailSeq; ++seq) {
+    size_t size = seq == g_cacheIndex.tailSeq ? tailSize : cache_segment_size(seq);
+    size_t offset = seq == g_cacheIndex.headSeq ? g_cacheIndex.headOffset : 0;
+    g_cacheIndex.pendingBytes += size > offset ? size - offset : 0;
+  }
+  g_cacheIndex.tailBytes = tailSize;
+  g_cacheIndex.recordCount = g_cacheIndex.pendingBytes / CACHE_RECORD_SIZE;
+  DBG_PRINTF("[FS] Cache counters recovered: %lu records, %lu bytes\n",
+             static_cast<unsigned long>(g_cacheIndex.recordCount), static_cast<unsigned long>(g_cacheIndex.pendingBytes));
+  cache_write_index();
+}
+
+void cache_drop_head_segment() {
+  size_t size = cache_segment_size(g_cacheIndex.headSeq);
+  uint32_t bytes = size > g_cacheIndex.headOffset ? size - g_cacheIndex.headOffset : 0;
+  LittleFS.remove(cache_segment_path(g_cacheIndex.headSeq));
+  g_cacheIndex.headSeq++;
+  g_cacheIndex.headOffset = 0;
+  g_cacheIndex.pendingBytes = bytes < g_cacheIndex.pendingBytes ? g_cacheIndex.pendingBytes - bytes : 0;
+  g_cacheIndex.recordCount = g_cacheIndex.pendingBytes / CACHE_RECORD_SIZE;
+}
+
+// Rebuilds the index from the segment files on disk when it is missing or corrupt.
+// The head restarts at the oldest segment, so unacknowledged data is resent rather than lost.
+void cache_rebuild_index() {
+  bool found = false;
+  uint32_t minSeq = 0;
+  uint32_t maxSeq = 0;
+  File dir = LittleFS.open(CACHE_DIR);
+  if (dir && dir.isDirectory()) {
+    File entry = dir.openNextFile();
+    while (entry) {
+      String name = entry.name();
+      entry.close();
+      int slash = name.lastIndexOf('/');
+      if (slash >= 0) {
+        name = name.substring(slash + 1);
+      }
+      if (name.endsWith(".seg")) {
+        uint32_t seq = strtoul(name.c_str(), nullptr, 16);
+        if (!found || seq < minSeq) minSeq = seq;
+        if (!found || seq > maxSeq) maxSeq = seq;
+        found = true;
+      }
+      entry = dir.openNextFile();
+    }
+  }
+  if (dir) dir.close();
+
+  g_cacheIndex = {};
+  g_cacheIndex.headSeq = minSeq;
+  g_cacheIndex.tailSeq = maxSeq;
+  DBG_PRINTF("[FS] Cache index rebuilt: segments %lu..%lu\n", static_cast<unsigned long>(minSeq),
+             static_cast<unsigned long>(maxSeq));
+  cache_recount();
+}
+
+bool cache_is_empty() {
+  return g_cacheIndex.recordCount == 0;
+}
+
+bool cache_append_record(CacheRecord record) {
+  record.crc = cache_record_crc(record);
+  if (g_cacheIndex.tailBytes + CACHE_RECORD_SIZE > CACHE_RECORDS_PER_SEGMENT * CACHE_RECORD_SIZE) {
+    g_cacheIndex.tailSeq++;
+    g_cacheIndex.tailBytes = 0;
+    if (g_cacheIndex.tailSeq - g_cacheIndex.headSeq >= CACHE_MAX_SEGMENTS) {
+      DBG_PRINTLN(F("[FS] Cache full. Dropping oldest segment."));
+      cache_drop_head_segment();
+    }
+    if (!cache_write_index()) {
+      return false;
+    }
+  }
+
+  File file = LittleFS.open(cache_segment_path(g_cacheIndex.tailSeq), "a");
+  if (!file) {
+    DBG_PRINTLN(F("[FS] Failed to open cache segment for writing."));
+    return false;
+  }
+  bool ok = file.write(reinterpret_cast<const uint8_t*>(&record), CACHE_RECORD_SIZE) == CACHE_RECORD_SIZE;
+  file.close();
+  if (!ok) {
+    return false;
+  }
+  g_cacheIndex.tailBytes += CACHE_RECORD_SIZE;
+  g_cacheIndex.recordCount++;
+  g_cacheIndex.pendingBytes += CACHE_RECORD_SIZE;
+  g_cacheIndexDirty = true;
+  return true;
+}
+
+void cache_reset_counters() {
+  g_cacheIndex.tailSeq++;
+  g_cacheIndex.headSeq = g_cacheIndex.tailSeq;
+  g_cacheIndex.headOffset = 0;
+  g_cacheIndex.tailBytes = 0;
+  g_cacheIndex.recordCount = 0;
+  g_cacheIndex.pendingBytes = 0;
+}
+
+// Moves the head to `to`, deleting every segment that is now fully consumed.
+bool cache_advance_head(CachePosition to) {
+  uint32_t consumed = 0;
+  CachePosition at = {g_cacheIndex.headSeq, g_cacheIndex.headOffset};
+  while (at.seq < to.seq) {
+    size_t size = cache_segment_size(at.seq);
+    consumed += size > at.offset ? size - at.offset : 0;
+    LittleFS.remove(cache_segment_path(at.seq));
+    at.seq++;
+    at.offset = 0;
+  }
+  consumed += to.offset > at.offset ? to.offset - at.offset : 0;
+
+  g_cacheIndex.headSeq = to.seq;
+  g_cacheIndex.headOffset = to.offset;
+  g_cacheIndex.pendingBytes = consumed < g_cacheIndex.pendingBytes ? g_cacheIndex.pendingBytes - consumed : 0;
+  g_cacheIndex.recordCount = g_cacheIndex.pendingBytes / CACHE_RECORD_SIZE;
+
+  if (cache_is_empty()) {
+    // Start a fresh segment so the drained one can be reclaimed right away.
+    LittleFS.remove(cache_segment_path(g_cacheIndex.tailSeq));
+    cache_reset_counters();
+  }
+  return cache_write_index();
+}
+
+void cache_remove_all() {
+  for (uint32_t seq = g_cacheIndex.headSeq; seq <= g_cacheIndex.tailSeq; ++seq) {
+    LittleFS.remove(cache_segment_path(seq));
+  }
+  cache_reset_counters();
+  cache_write_index();
+}
+
+// Sequential reader over the records between the head and the end of the tail segment.
+// Records failing their CRC are skipped.
+class CacheReader {
+ public:
+  explicit CacheReader(CachePosition start) : pos_(start) {}
+
+  ~CacheReader() { close(); }
+
+  void close() {
+    if (file_) file_.close();
+  }
+
+  bool next(CacheRecord& record) {
+    while (true) {
+      if (!file_) {
+        file_ = LittleFS.open(cache_segment_path(pos_.seq), "r");
+        if (file_) {
+          file_.seek(pos_.offset);
+        }
+      }
+      if (file_ && file_.available() >= static_cast<int>(CACHE_RECORD_SIZE)) {
+        size_t read = file_.read(reinterpret_cast<uint8_t*>(&record), CACHE_RECORD_SIZE);
+        pos_.offset += read;
+        if (read == CACHE_RECORD_SIZE && record.crc == cache_record_crc(record)) {
+          return true;
+        }
+        DBG_PRINTLN(F("[FS] Skipping corrupt cache record."));
+        continue;
+      }
+      if (file_) file_.close();
+      if (pos_.seq >= g_cacheIndex.tailSeq) {
+        return false;
+      }
+      pos_.seq++;
+      pos_.offset = 0;
+    }
+  }
+
+  CachePosition position() const { return pos_; }
+
+ private:
+  CachePosition pos_;
+  File file_;
+};
+
+uint32_t cache_parse_timestamp(const char* iso) {
+  int year, month, day, hour, minute, second;
+  if (!iso || sscanf(iso, "%4d-%2d-%2dT%2d:%2d:%2d", &year, &month, &day, &hour, &minute, &second) != 6) {
+    return 0;
+  }
+  return gps_utc_to_epoch(year, month, day, hour, minute, second);
+}
+
+// Converts the newline-separated JSON cache of older firmware (/gps_cache.log) into binary records.
+size_t cache_convert_json_lines(const String& path) {
+  File file = LittleFS.open(path, "r");
+  if (!file) return 0;
+  size_t converted = 0;
+  while (file.available()) {
+    String line = file.readStringUntil('\n');
+    line.trim();
+    if (line.length() == 0) continue;
+    JsonDocument doc;
+    if (deserializeJson(doc, line)) continue;
+    CacheRecord record = fs_make_cache_record(doc["latitude"] | 0.0, doc["longitude"] | 0.0, doc["speed"] | 0.0,
+                                              doc["altitude"] | 0.0, doc["accuracy"] | -1.0, doc["satellites"] | 0,
+                                              cache_parse_timestamp(doc["timestamp"] | static_cast<const char*>(nullptr)));
+    const char* powerStatus = doc["power_status"] | static_cast<const char*>(nullptr);
+    if (powerStatus) {
+      record.flags |= CACHE_RECORD_FLAG_POWER_STATUS;
+      record.powerStatus = static_cast<uint8_t>(strcmp(powerStatus, "ON") == 0    ? PowerStatus::On
+                                                : strcmp(powerStatus, "OFF") == 0 ? PowerStatus::Off
+                                                                                  : PowerStatus::Unknown);
+    }
+    if (cache_append_record(record)) {
+      converted++;
+    }
+  }
+  file.close();
+  LittleFS.remove(path);
+  return converted;
+}
+
+bool cache_open() {
+  if (g_cacheOpen) return true;
+  if (!LittleFS.exists(CACHE_DIR) && !LittleFS.mkdir(CACHE_DIR)) {
+    DBG_PRINTLN(F("[FS] Failed to create cache directory."));
+    return false;
+  }
+  CacheIndex index;
+  if (cache_read_index(index)) {
+    g_cacheIndex = index;
+    if (cache_segment_size(g_cacheIndex.tailSeq) != g_cacheIndex.tailBytes) {
+      // Appends after the last index write (reset before fs_end()), or a torn append.
+      DBG_PRINTLN(F("[FS] Cache index out of date."));
+      cache_recount();
+    }
+  } else {
+    cache_rebuild_index();
+  }
+  g_cacheOpen = true;
+  if (LittleFS.exists(CACHE_FILE)) {
+    size_t migrated = cache_convert_json_lines(CACHE_FILE);
+    DBG_PRINTF("[FS] Migrated %u records from legacy cache file.\n", static_cast<unsigned>(migrated));
+  }
+  return true;
+}
+
+// Largest JSON form of a record without the device/name prefix produced by cache_format_record().
+const size_t CACHE_JSON_RECORD_MAX = 224;
+
+// Modem sessions left before RESOURCE_SYNC is tried again on a server that lacked it
+RTC_DATA_ATTR uint16_t g_syncSkipSessions = 0;
+
+// Batches planned again in one upload after the cache changed under a planned batch
+const uint8_t CACHE_BATCH_REPLANS = 2;
+
+// Builds the `{"device":...,"name":...,` prefix shared by every record of a batch.
+String cache_json_prefix() {
+  JsonDocument doc;
+  doc["device"] = deviceID;
+  doc["name"] = deviceName;
+  String prefix;
+  serializeJson(doc, prefix);
+  prefix.remove(prefix.length() - 1); // drop the closing brace
+  prefix += ',';
+  return prefix;
+}
+
+// Formats the fields of a cached record (everything after the prefix) into `out`.
+// Fixed-point values are printed from their integer form, so the length is exact and
+// no heap is touched. Returns the number of characters written.
+size_t cache_format_record(const CacheRecord& record, char* out, size_t capacity) {
+  auto fixedPoint = [](char* buf, size_t size, int32_t value, uint32_t scale, int decimals) {
+    uint32_t magnitude = value < 0 ? static_cast<uint32_t>(-static_cast<int64_t>(value)) : value;
+    snprintf(buf, size, "%s%lu.%0*lu", value < 0 ? "-" : "", static_cast<unsigned long>(magnitude / scale),
+             decimals, static_cast<unsigned long>(magnitude % scale));
+  };
+  char latitude[16], longitude[16], speed[12], altitude[12], accuracy[12];
+  fixedPoint(latitude, sizeof(latitude), record.latitudeE7, 10000000UL, 7);
+  fixedPoint(longitude, sizeof(longitude), record.longitudeE7, 10000000UL, 7);
+  fixedPoint(speed, sizeof(speed), record.speedCentiKmh, 100, 2);
+  fixedPoint(altitude, sizeof(altitude),
+             static_cast<int32_t>(record.altitudeDm) - static_cast<int32_t>(CACHE_ALTITUDE_OFFSET_M * 10), 10, 1);
+  if (record.hdopCenti == UINT16_MAX) {
+    strcpy(accuracy, "-1");
+  } else {
+    fixedPoint(accuracy, sizeof(accuracy), record.hdopCenti, 100, 2);
+  }
+
+  int length = snprintf(out, capacity,
+                        "\"latitude\":%s,\"longitude\":%s,\"speed\":%s,\"altitude\":%s,\"accuracy\":%s,"
+                        "\"satellites\":%u",
+                        latitude, longitude, speed, altitude, accuracy, record.satellites);
+  if (record.timestamp != 0) {
+    time_t seconds = static_cast<time_t>(record.timestamp);
+    struct tm utc;
+    gmtime_r(&seconds, &utc);
+    length += strftime(out + length, capacity - length, ",\"timestamp\":\"%Y-%m-%dT%H:%M:%SZ\"", &utc);
+  }
+  if (record.flags & CACHE_RECORD_FLAG_DWELL) {
+    length += snprintf(out + length, capacity - length, ",\"dwell_s\":%lu",
+                       static_cast<unsigned long>(record.dwellSeconds));
+  }
+  if (record.flags & CACHE_RECORD_FLAG_POWER_STATUS) {
+    length += snprintf(out + length, capacity - length, ",\"power_status\":\"%s\"",
+                       power_status_to_string(static_cast<PowerStatus>(record.powerStatus)));
+  }
+  length += snprintf(out + length, capacity - length, "}");
+  return static_cast<size_t>(length);
+}
+
+// Describes one upload batch; the records are read again from the cache while the
+// body is streamed, so only the boundaries are kept in RAM.
+struct CacheBatch {
+  CachePosition start;
+  CachePosition end;
+  uint32_t recordCount;
+  size_t bodyLength;
+  bool containsPowerStatus;
+  bool bodyMismatch;   // Set by cache_write_batch() when the records read differ from the plan
+  const String* prefix;
+};
+
+CachePosition cache_head() {
+  return {g_cacheIndex.headSeq, g_cacheIndex.headOffset};
+}
+
+// Collects up to `maxRecords` records starting at `from` while the batch body stays
+// within `bodyBudget` bytes.
+CacheBatch cache_plan_batch(const String& prefix, size_t bodyBudget, uint32_t maxRecords, CachePosition from) {
+  CacheBatch batch = {};
+  batch.start = from;
+  batch.end = batch.start;
+  batch.bodyLength = 2; // []
+  batch.prefix = &prefix;
+
+  CacheReader reader(batch.start);
+  CacheRecord record;
+  char json[CACHE_JSON_RECORD_MAX];
+  while (batch.recordCount < maxRecords && reader.next(record)) {
+    size_t length = (batch.recordCount > 0 ? 1 : 0) + prefix.length() + cache_format_record(record, json, sizeof(json));
+    if (batch.recordCount > 0 && batch.bodyLength + length > bodyBudget) {
+      break;
+    }
+    batch.bodyLength += length;
+    batch.recordCount++;
+    batch.end = reader.position();
+    if (record.flags & CACHE_RECORD_FLAG_POWER_STATUS) {
+      batch.containsPowerStatus = true;
+    }
+  }
+  return batch;
+}
+
+// HttpsBodyWriter streaming a planned batch as a JSON array. The Content-Length is
+// fixed by cache_plan_batch(); if the records read back are not the planned ones (one
+// failed its CRC since the plan), the body no longer matches it and must not go out.
+bool cache_write_batch(Print& out, void* context) {
+  CacheBatch& batch = *static_cast<CacheBatch*>(context);
+  CacheReader reader(batch.start);
+  CacheRecord record;
+  char json[CACHE_JSON_RECORD_MAX];
+  size_t written = out.print('[');
+  uint32_t count = 0;
+  for (; count < batch.recordCount && reader.next(record); count++) {
+    if (count > 0) {
+      written += out.print(',');
+    }
+    written += out.print(*batch.prefix);
+    written += out.write(reinterpret_cast<const uint8_t*>(json), cache_format_record(record, json, sizeof(json)));
+  }
+  written += out.print(']');
+  CachePosition end = reader.position();
+  batch.bodyMismatch = count != batch.recordCount || end.seq != batch.end.seq || end.offset != batch.end.offset ||
+                       written != batch.bodyLength;
+  if (batch.bodyMismatch) {
+    DBG_PRINTF("[FS] Batch body is %u bytes, %u planned. Request aborted.\n", static_cast<unsigned>(written),
+               static_cast<unsigned>(batch.bodyLength));
+  }
+  return !batch.bodyMismatch;
+}
+
+// Sync request body: the handshake object with the batch appended as "records".
+struct SyncBody {
+  const String* head; // Handshake JSON without its closing brace, followed by ,"records":
+  CacheBatch* batch;
+};
+
+bool write_sync_body(Print& out, void* context) {
+  const SyncBody& body = *static_cast<const SyncBody*>(context);
+  bool complete = out.print(*body.head) == body.head->length();
+  complete = cache_write_batch(out, body.batch) && complete;
+  return out.print('}') == 1 && complete;
+}
+} // namespace
+
+CacheRecord fs_make_cache_record(double latitude, double longitude, double speedKmh, double altitudeM, double hdop,
+                                 int satellites, uint32_t timestamp) {
+  auto clampU16 = [](double value) -> uint16_t {
+    if (value < 0) return 0;
+    if (value > UINT16_MAX - 1) return UINT16_MAX - 1;
+    return static_cast<uint16_t>(lround(value));
+  };
+  CacheRecord record = {};
+  record.timestamp = timestamp;
+  record.latitudeE7 = static_cast<int32_t>(lround(latitude * 1e7));
+  record.longitudeE7 = static_cast<int32_t>(lround(longitude * 1e7));
+  record.speedCentiKmh = clampU16(speedKmh * 100.0);
+  record.altitudeDm = clampU16((altitudeM + CACHE_ALTITUDE_OFFSET_M) * 10.0);
+  record.hdopCenti = hdop < 0 ? UINT16_MAX : clampU16(hdop * 100.0);
+  record.satellites = satellites < 0 ? 0 : (satellites > UINT8_MAX ? UINT8_MAX : satellites);
+  return record;
+}
+
 bool fs_init() {
   FsLockGuard lock;
   if (!lock.isLocked()) {
@@ -71,6 +627,9 @@ bool fs_init() {
   DBG_PRINTLN(F("[FS] LittleFS mounted successfully."));
   preferences.begin(PREFERENCES_NAMESPACE, false); // false for read/write
   DBG_PRINTLN(F("[FS] Preferences initialized."));
+  if (!cache_open()) {
+    DBG_PRINTLN(F("[FS] Cache store unavailable."));
+  }
   return true;
 }
 
@@ -141,6 +700,13 @@ void fs_load_configuration() {
   } else {
     minSatellitesForFix = SAT_THRESHOLD;
   }
+  fixAccuracyTargetM = preferences.getInt(KEY_ACCURACY_TARGET, GPS_ACCURACY_TARGET_M);
+  trackToleranceM = preferences.getInt(KEY_TRACK_TOLERANCE, TRACK_TOLERANCE_M);
+  trackDwellRadiusM = preferences.getInt(KEY_DWELL_RADIUS, TRACK_DWELL_RADIUS_M);
+  sampleResolutionM = preferences.getInt(KEY_SAMPLE_RESOLUTION, SAMPLE_RESOLUTION_M);
+  sampleIntervalMinS = preferences.getUInt(KEY_INTERVAL_MIN, SAMPLE_INTERVAL_MIN_S);
+  sampleIntervalMaxS = preferences.getUInt(KEY_INTERVAL_MAX, SAMPLE_INTERVAL_MAX_S);
+  batch_tuning_set_server_cap(preferences.getUInt(KEY_BATCH_SIZE, 0));
   if (preferences.isKey(KEY_BATCH_THRESHOLD)) {
     batchSizeThreshold = preferences.getUChar(KEY_BATCH_THRESHOLD);
   } else {
@@ -162,28 +728,101 @@ void fs_end() {
     return;
   }
   preferences.end();
+  if (g_cacheOpen && g_cacheIndexDirty) {
+    cache_write_index();
+  }
+  g_cacheOpen = false;
   // The mounted() check is not available/needed. LittleFS.end() is safe to call.
   LittleFS.end();
   DBG_PRINTLN(F("[FS] Preferences and LittleFS closed."));
 }
 
-void append_to_cache(String jsonRecord) {
+void append_to_cache(const CacheRecord& record) {
   FsLockGuard lock;
   if (!lock.isLocked()) {
     DBG_PRINTLN(F("[FS] Failed to acquire FS lock while appending to cache."));
     return;
   }
-  File file = LittleFS.open(CACHE_FILE, "a"); // a = append
-  if (!file) {
-    DBG_PRINTLN(F("[FS] Failed to open cache file for writing."));
+  if (!cache_open()) {
     return;
   }
-  if (file.println(jsonRecord)) {
+  if (cache_append_record(record)) {
     DBG_PRINTLN(F("[FS] GPS data point appended to cache."));
   } else {
     DBG_PRINTLN(F("[FS] Failed to write to cache file."));
   }
-  file.close();
+}
+
+SyncResult fs_sync_with_server() {
+  FsLockGuard lock;
+  if (!lock.isLocked()) {
+    DBG_PRINTLN(F("[FS] Failed to acquire FS lock while syncing."));
+    return SyncResult::Unsupported;
+  }
+  if (!cache_open()) {
+    return SyncResult::Unsupported;
+  }
+  if (g_syncSkipSessions > 0) {
+    g_syncSkipSessions--;
+    return SyncResult::Unsupported;
+  }
+
+  JsonDocument handshakeDoc;
+  modem_build_handshake_payload(handshakeDoc);
+  String head;
+  serializeJson(handshakeDoc, head);
+  head.remove(head.length() - 1); // drop the closing brace
+  head += F(",\"records\":");
+
+  const String prefix = cache_json_prefix();
+  CacheBatch batch = cache_plan_batch(prefix, SERVER_MAX_BODY_BYTES - head.length() - 1, batch_tuning_batch_size(),
+                                      cache_head());
+  SyncBody body = {&head, &batch};
+  size_t length = head.length() + batch.bodyLength + 1;
+
+  DBG_PRINTF("[FS] Syncing with server: handshake + %lu records (%u bytes)...\n",
+             static_cast<unsigned long>(batch.recordCount), static_cast<unsigned>(length));
+  JsonDocument responseDoc;
+  DeserializationError error;
+  int httpStatus = modem_send_post_json(RESOURCE_SYNC, length, write_sync_body, &body, responseDoc, &error);
+  if (batch.bodyMismatch) {
+    // Nothing was sent; send_cached_data() plans the batch again
+    DBG_PRINTLN(F("[FS] Cache changed under the sync batch. Falling back to handshake + upload."));
+    return SyncResult::Unsupported;
+  }
+  if (httpStatus == 404 && error) {
+    // Express answers unknown routes with an HTML page; a missing device gets JSON
+    DBG_PRINTLN(F("[FS] Server has no sync endpoint. Falling back to handshake + upload."));
+    g_syncSkipSessions = SYNC_RETRY_SESSIONS;
+    return SyncResult::Unsupported;
+  }
+  if (httpStatus == 413) {
+    DBG_PRINTLN(F("[FS] Sync body too large. Falling back to handshake + upload."));
+    return SyncResult::Unsupported;
+  }
+  if (!modem_apply_handshake_response(httpStatus, responseDoc, error)) {
+    if (httpStatus <= 0 || httpStatus >= 500) {
+      batch_tuning_record_batch(batch.recordCount, batch.bodyLength, false);
+    }
+    return SyncResult::Failed;
+  }
+  if (batch.recordCount == 0 || !isRegistered) {
+    return SyncResult::Done;
+  }
+
+  bool delivered = !error && responseDoc["success"] == true;
+  batch_tuning_record_batch(batch.recordCount, batch.bodyLength, delivered);
+  if (!delivered) {
+    DBG_PRINTLN(F("[FS] Sync did not confirm the batch. Cache will be kept."));
+    return SyncResult::Done;
+  }
+  DBG_PRINTLN(F("[FS] Batch confirmed by sync. Advancing cache head."));
+  if (batch.containsPowerStatus) {
+    power_instruction_acknowledged();
+    power_status_report_acknowledged();
+  }
+  cache_advance_head(batch.end);
+  return SyncResult::Done;
 }
 
 bool send_cached_data() {
@@ -192,59 +831,95 @@ bool send_cached_data() {
     DBG_PRINTLN(F("[FS] Failed to acquire FS lock while sending cached data."));
     return false;
   }
+  if (!cache_open()) {
+    return false;
+  }
   
   bool allDataSent = true;
+  size_t bodyBudget = SERVER_MAX_BODY_BYTES;
+  const String prefix = cache_json_prefix();
+  // Batches written to the server whose response has not been handled yet, oldest first.
+  // With the socket transport the next batch is planned right after the last one in
+  // flight and goes out while the server still works on the previous one.
+  const uint8_t depth = modem_post_pipeline_depth();
+  CacheBatch inFlight[MODEM_HTTP_PIPELINE_DEPTH];
+  uint8_t first = 0;
+  uint8_t count = 0;
+  uint8_t replans = 0;
+
+  // A response that stops the run (or a 413) voids the batches behind it: their responses
+  // are read and thrown away, and the records are planned again from the head. Anything
+  // the server stored from them arrives a second time.
+  auto discardInFlight = [&]() {
+    for (; count > 0; count--) {
+      modem_post_finish();
+    }
+  };
 
   while (true) {
-    File file = LittleFS.open(CACHE_FILE, "r");
-    if (!file || file.size() == 0) {
-      if (file) file.close();
+    if (count == 0 && cache_is_empty()) {
       if (allDataSent) {
         DBG_PRINTLN(F("[FS] Cache is empty. All data sent."));
-        LittleFS.remove(CACHE_FILE); // Clean up empty file
       }
       return allDataSent;
     }
 
-    String payload = "[";
-    bool first = true;
-    int recordCount = 0;
-    long lastPosition = 0;
-    bool batchContainsPowerStatus = false;
-
-    while (file.available() && recordCount < MAX_BATCH_SIZE) {
-      String line = file.readStringUntil('\n');
-      line.trim();
-      if (line.length() > 0) {
-        if (!first) {
-          payload += ",";
+    bool replan = false;
+    while (count < depth) {
+      CachePosition from = count > 0 ? inFlight[(first + count - 1) % MODEM_HTTP_PIPELINE_DEPTH].end : cache_head();
+      CacheBatch batch = cache_plan_batch(prefix, bodyBudget, batch_tuning_batch_size(), from);
+      if (batch.recordCount == 0) {
+        if (count == 0) {
+          cache_remove_all(); // No valid records found, clear cache
+          return true;
         }
-        payload += line;
-        first = false;
-        recordCount++;
-        lastPosition = file.position();
-        if (!batchContainsPowerStatus && line.indexOf(F("\"power_status\"")) != -1) {
-          batchContainsPowerStatus = true;
+        break; // The rest of the cache is already on its way
+      }
+
+      DBG_PRINTF("[FS] Sending batch of %lu records (%u bytes)...\n", static_cast<unsigned long>(batch.recordCount),
+                 static_cast<unsigned>(batch.bodyLength));
+      if (!modem_post_begin(RESOURCE_POST, batch.bodyLength, cache_write_batch, &batch)) {
+        if (batch.bodyMismatch && replans < CACHE_BATCH_REPLANS) {
+          // Not sent; the socket transport also dropped what was in flight
+          DBG_PRINTLN(F("[FS] Cache changed under the batch. Planning again."));
+          replans++;
+          replan = true;
+          break;
         }
+        if (count == 0) {
+          DBG_PRINTLN(F("[FS] Failed to send batch data. Cache will be kept."));
+          batch_tuning_record_batch(batch.recordCount, batch.bodyLength, false);
+          return false;
+        }
+        break; // Collect what is in flight first
       }
+      inFlight[(first + count) % MODEM_HTTP_PIPELINE_DEPTH] = batch;
+      count++;
     }
-    payload += "]";
-
-    if (recordCount == 0) {
-      file.close();
-      LittleFS.remove(CACHE_FILE); // No valid records found, clear cache
-      return true;
+    if (replan) {
+      discardInFlight();
+      continue;
     }
 
-    DBG_PRINTF("[FS] Sending batch of %d records...\n", recordCount);
-    int httpStatus = 0;
-    String response = modem_send_post_request(RESOURCE_POST, payload, &httpStatus);
+    const CacheBatch batch = inFlight[first];
+    first = (first + 1) % MODEM_HTTP_PIPELINE_DEPTH;
+    count--;
+    JsonDocument serverResponseDoc;
+    DeserializationError error;
+    int httpStatus = modem_post_finish(&serverResponseDoc, &error);
+
+    if (httpStatus == 413 && batch.recordCount > 1) {
+      bodyBudget = batch.bodyLength / 2;
+      DBG_PRINTF("[FS] Server rejected batch size (413). Retrying with %u byte limit.\n",
+                 static_cast<unsigned>(bodyBudget));
+      discardInFlight();
+      continue;
+    }
 
     if (httpStatus == 404) {
       DBG_PRINTLN(F("[FS] Server returned 404 - device not registered."));
       fs_set_registered(false);
       allDataSent = false;
-      file.close();
       break;
     }
 
@@ -252,21 +927,17 @@ bool send_cached_data() {
       DBG_PRINTLN(F("[FS] Server returned 409 - device claimed by another user."));
       fs_set_registered(false);
       allDataSent = false;
-      file.close();
       break;
     }
 
     if (httpStatus >= 500) {
       DBG_PRINT(F("[FS] Server error while sending batch: "));
       DBG_PRINTLN(httpStatus);
+      batch_tuning_record_batch(batch.recordCount, batch.bodyLength, false);
       allDataSent = false;
-      file.close();
       break;
     }
 
-    JsonDocument serverResponseDoc;
-    DeserializationError error = deserializeJson(serverResponseDoc, response);
-
     if (!error && httpStatus < 400) {
       if (!serverResponseDoc["config"].isNull()) {
         fs_apply_server_config(serverResponseDoc["config"]);
@@ -281,39 +952,23 @@ bool send_cached_data() {
       }
     }
 
-    if (!error && serverResponseDoc["success"] == true && httpStatus < 400) {
-      DBG_PRINTLN(F("[FS] Batch sent successfully. Updating cache file."));
-      if (batchContainsPowerStatus) {
+    bool delivered = !error && serverResponseDoc["success"] == true && httpStatus < 400;
+    batch_tuning_record_batch(batch.recordCount, batch.bodyLength, delivered);
+
+    if (delivered) {
+      DBG_PRINTLN(F("[FS] Batch sent successfully. Advancing cache head."));
+      if (batch.containsPowerStatus) {
         power_instruction_acknowledged();
         power_status_report_acknowledged();
       }
       
-      bool moreData = file.available();
-      file.close();
-
-      if (moreData) {
-        File tempFile = LittleFS.open("/cache.tmp", "w");
-        File originalFile = LittleFS.open(CACHE_FILE, "r");
-        if (tempFile && originalFile) {
-          originalFile.seek(lastPosition);
-          while (originalFile.available()) {
-            tempFile.write(originalFile.read());
-          }
-          tempFile.close();
-          originalFile.close();
-          LittleFS.remove(CACHE_FILE);
-          LittleFS.rename("/cache.tmp", CACHE_FILE);
-        } else {
-          DBG_PRINTLN(F("[FS] Error creating temp file for cache update."));
-          if(tempFile) tempFile.close();
-          if(originalFile) originalFile.close();
-          allDataSent = false;
-          break; 
-        }
-      } else {
-        LittleFS.remove(CACHE_FILE);
+      if (!cache_advance_head(batch.end)) {
+        allDataSent = false;
+        break;
+      }
+      if (cache_is_empty()) {
         DBG_PRINTLN(F("[FS] All cached data sent."));
-        break; 
+        break;
       }
     } else {
       DBG_PRINTLN(F("[FS] Failed to send batch data. Cache will be kept."));
@@ -326,10 +981,10 @@ bool send_cached_data() {
         fs_set_registered(false);
       }
       allDataSent = false;
-      file.close();
       break; 
     }
   }
+  discardInFlight();
   return allDataSent;
 }
 
@@ -339,7 +994,8 @@ bool fs_cache_exists() {
     DBG_PRINTLN(F("[FS] Failed to acquire FS lock while checking cache."));
     return false;
   }
-  return LittleFS.exists(CACHE_FILE);
+  if (!cache_open()) return false;
+  return !cache_is_empty();
 }
 
 void fs_apply_server_config(const JsonVariantConst& config) {
@@ -368,16 +1024,23 @@ void fs_apply_server_config(const JsonVariantConst& config) {
     if (sendInterval == 0) {
       sendInterval = 1;
     }
-    // Ensure batch sending threshold is not greater than the hardcoded MAX_BATCH_SIZE
-    if (sendInterval > MAX_BATCH_SIZE) {
-      sendInterval = MAX_BATCH_SIZE;
-    }
     batchSizeThreshold = sendInterval; // Update global variable
     preferences.putUChar(KEY_BATCH_THRESHOLD, batchSizeThreshold); // Store in preferences
     DBG_PRINT(F("[FS] Server set batch send threshold to: "));
     DBG_PRINTLN(batchSizeThreshold);
   }
 
+  if (!config["max_batch"].isNull()) {
+    uint32_t maxBatch = config["max_batch"].as<uint32_t>();
+    if (maxBatch == 0 || maxBatch > MAX_BATCH_SIZE) {
+      maxBatch = MAX_BATCH_SIZE;
+    }
+    preferences.putUInt(KEY_BATCH_SIZE, maxBatch);
+    batch_tuning_set_server_cap(maxBatch);
+    DBG_PRINT(F("[FS] Server set upload batch cap to: "));
+    DBG_PRINTLN(maxBatch);
+  }
+
   if (!config["satellites"].isNull()) {
     minSatellitesForFix = config["satellites"].as<int>();
     preferences.putInt("minSats", minSatellitesForFix);
@@ -385,6 +1048,54 @@ void fs_apply_server_config(const JsonVariantConst& config) {
     DBG_PRINTLN(minSatellitesForFix);
   }
 
+  if (!config["accuracy_m"].isNull()) {
+    fixAccuracyTargetM = config["accuracy_m"].as<int>();
+    preferences.putInt(KEY_ACCURACY_TARGET, fixAccuracyTargetM);
+    DBG_PRINT(F("[FS] Server set fix accuracy target to: "));
+    DBG_PRINTLN(fixAccuracyTargetM);
+  }
+
+  if (!config["track_tolerance_m"].isNull()) {
+    trackToleranceM = config["track_tolerance_m"].as<int>();
+    preferences.putInt(KEY_TRACK_TOLERANCE, trackToleranceM);
+    DBG_PRINT(F("[FS] Server set track tolerance to: "));
+    DBG_PRINTLN(trackToleranceM);
+  }
+
+  if (!config["dwell_radius_m"].isNull()) {
+    trackDwellRadiusM = config["dwell_radius_m"].as<int>();
+    preferences.putInt(KEY_DWELL_RADIUS, trackDwellRadiusM);
+    DBG_PRINT(F("[FS] Server set dwell radius to: "));
+    DBG_PRINTLN(trackDwellRadiusM);
+  }
+
+  if (!config["resolution_m"].isNull()) {
+    sampleResolutionM = config["resolution_m"].as<int>();
+    preferences.putInt(KEY_SAMPLE_RESOLUTION, sampleResolutionM);
+    DBG_PRINT(F("[FS] Server set sampling resolution to: "));
+    DBG_PRINTLN(sampleResolutionM);
+  }
+
+  if (!config["interval_min"].isNull()) {
+    uint32_t interval = config["interval_min"].as<uint32_t>();
+    if (interval > 0) {
+      sampleIntervalMinS = interval;
+      preferences.putUInt(KEY_INTERVAL_MIN, sampleIntervalMinS);
+      DBG_PRINT(F("[FS] Server set shortest GPS interval to: "));
+      DBG_PRINTLN(sampleIntervalMinS);
+    }
+  }
+
+  if (!config["interval_max"].isNull()) {
+    uint32_t interval = config["interval_max"].as<uint32_t>();
+    if (interval > 0) {
+      sampleIntervalMaxS = interval;
+      preferences.putUInt(KEY_INTERVAL_MAX, sampleIntervalMaxS);
+      DBG_PRINT(F("[FS] Server set longest GPS interval to: "));
+      DBG_PRINTLN(sampleIntervalMaxS);
+    }
+  }
+
   if (!config["mode"].isNull()) {
     operationMode = config["mode"].as<String>();
     preferences.putString("mode", operationMode);
@@ -406,11 +1117,8 @@ void fs_set_registered(bool registered) {
 size_t fs_get_cache_size() {
   FsLockGuard lock;
   if (!lock.isLocked()) return 0;
-  if (!LittleFS.exists(CACHE_FILE)) return 0;
-  File file = LittleFS.open(CACHE_FILE, "r");
-  size_t size = file.size();
-  file.close();
-  return size;
+  if (!cache_open()) return 0;
+  return g_cacheIndex.pendingBytes;
 }
 
 size_t fs_get_cache_record_count() {
@@ -419,33 +1127,16 @@ size_t fs_get_cache_record_count() {
     DBG_PRINTLN(F("[FS] Failed to acquire FS lock while counting cache records."));
     return 0;
   }
-  if (!LittleFS.exists(CACHE_FILE)) return 0;
-
-  File file = LittleFS.open(CACHE_FILE, "r");
-  if (!file) {
-    DBG_PRINTLN(F("[FS] Failed to open cache file for counting records."));
-    return 0;
-  }
-
-  size_t count = 0;
-  while (file.available()) {
-    String line = file.readStringUntil('\n');
-    line.trim();
-    if (line.length() > 0) {
-      count++;
-    }
-  }
-  file.close();
-  return count;
+  if (!cache_open()) return 0;
+  return g_cacheIndex.recordCount;
 }
 
 void fs_clear_cache() {
   FsLockGuard lock;
   if (!lock.isLocked()) return;
-  if (LittleFS.exists(CACHE_FILE)) {
-    LittleFS.remove(CACHE_FILE);
-    DBG_PRINTLN(F("[FS] Cache file cleared manually."));
-  }
+  if (!cache_open()) return;
+  cache_remove_all();
+  DBG_PRINTLN(F("[FS] Cache cleared manually."));
 }
 
 void fs_reset_tracking_defaults() {
@@ -457,7 +1148,14 @@ void fs_reset_tracking_defaults() {
     }
     preferences.remove("sleepTime");
     preferences.remove("minSats");
+    preferences.remove(KEY_ACCURACY_TARGET);
+    preferences.remove(KEY_TRACK_TOLERANCE);
+    preferences.remove(KEY_DWELL_RADIUS);
+    preferences.remove(KEY_SAMPLE_RESOLUTION);
+    preferences.remove(KEY_INTERVAL_MIN);
+    preferences.remove(KEY_INTERVAL_MAX);
     preferences.remove(KEY_BATCH_THRESHOLD);
+    preferences.remove(KEY_BATCH_SIZE);
     preferences.remove("mode");
     DBG_PRINTLN(F("[FS] Tracking settings keys removed."));
   }
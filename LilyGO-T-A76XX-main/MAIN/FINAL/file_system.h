@@ -21,8 +21,36 @@ extern int port;
 extern uint64_t sleepTimeSeconds;
 extern bool isRegistered;
 extern int minSatellitesForFix;
+extern int fixAccuracyTargetM; // Fix accuracy target in metres, 0 = first valid fix
 extern String operationMode;
 extern int batchSizeThreshold; // Minimum number of cached records to trigger a send
+extern int trackToleranceM;    // Track simplification tolerance in metres, 0 = cache every fix
+extern int trackDwellRadiusM;  // Radius within which the device counts as stationary
+extern int sampleResolutionM;  // Target distance between fixes, 0 = fixed sleepTimeSeconds
+extern uint32_t sampleIntervalMinS;
+extern uint32_t sampleIntervalMaxS;
+
+// Fixed-width fix record as stored in the cache. JSON is only produced from it
+// when a batch is uploaded (see send_cached_data()).
+const double CACHE_ALTITUDE_OFFSET_M = 1000.0;
+const uint8_t CACHE_RECORD_FLAG_POWER_STATUS = 0x01; // powerStatus is valid and must be reported
+const uint8_t CACHE_RECORD_FLAG_DWELL = 0x02;        // Stationary for dwellSeconds up to timestamp
+
+struct __attribute__((packed)) CacheRecord {
+  uint32_t timestamp;      // UTC epoch seconds, 0 when unknown
+  uint32_t dwellSeconds;   // Time stationary before timestamp, 0 without CACHE_RECORD_FLAG_DWELL
+  int32_t latitudeE7;      // Degrees * 1e7
+  int32_t longitudeE7;     // Degrees * 1e7
+  uint16_t speedCentiKmh;  // km/h * 100
+  uint16_t altitudeDm;     // (metres + CACHE_ALTITUDE_OFFSET_M) * 10
+  uint16_t hdopCenti;      // HDOP * 100, UINT16_MAX when invalid
+  uint8_t satellites;
+  uint8_t flags;           // CACHE_RECORD_FLAG_*
+  uint8_t powerStatus;     // PowerStatus value
+  uint8_t reserved;
+  uint16_t crc;            // Filled in by append_to_cache()
+};
+static_assert(sizeof(CacheRecord) == 28, "CacheRecord layout is part of the on-flash format");
 
 // Function to initialize LittleFS and Preferences
 bool fs_init();
@@ -39,8 +67,22 @@ void fs_set_registered(bool registered);
 // Function to end LittleFS and Preferences
 void fs_end();
 
-// Function to append a JSON record to the cache file
-void append_to_cache(String jsonRecord);
+// Build a cache record from fix values (flags/powerStatus are left cleared)
+CacheRecord fs_make_cache_record(double latitude, double longitude, double speedKmh, double altitudeM, double hdop,
+                                 int satellites, uint32_t timestamp);
+
+// Function to append a record to the cache
+void append_to_cache(const CacheRecord& record);
+
+// Outcome of a combined handshake + upload request
+enum class SyncResult : uint8_t {
+  Unsupported, // Server cannot take it (no endpoint, body too large); use handshake + send_cached_data
+  Failed,      // Request or handshake part failed
+  Done,        // Handshake applied; the batch was sent along (check the cache for leftovers)
+};
+
+// Handshake and the first cached batch in one request to RESOURCE_SYNC
+SyncResult fs_sync_with_server();
 
 // Function to send cached data to the server
 bool send_cached_data();
@@ -48,6 +90,6 @@ bool fs_cache_exists();
 
 // Helper functions for OTA cache management
 size_t fs_get_cache_size();
-size_t fs_get_cache_record_count(); // New function to count records
+size_t fs_get_cache_record_count(); // Constant time, read from the cache index
 void fs_clear_cache();
 void fs_reset_tracking_defaults();
@@ -0,0 +1,129 @@
+#include "fix_quality.h"
+#include <math.h>
+
+namespace {
+const double METERS_PER_DEGREE = 111320.0;
+const float UNKNOWN_HDOP = 99.99f;
+
+// Offsets from the first sample of the attempt, in metres east/north
+struct QualitySample {
+  float t;  // seconds
+  float x;
+  float y;
+  float hdop;
+};
+
+QualitySample g_samples[GPS_QUALITY_WINDOW];
+uint8_t g_count = 0;
+uint8_t g_next = 0;
+double g_originLat = 0;
+double g_originLon = 0;
+double g_metersPerDegreeLon = METERS_PER_DEGREE;
+unsigned long g_originMs = 0;
+
+// Least-squares line through the window for one axis; returns the value at the
+// newest sample and adds the squared residuals to `ssr`
+float fit_axis(float QualitySample::*axis, const QualitySample& newest, float meanT, float stt, float& ssr) {
+  float mean = 0;
+  for (uint8_t i = 0; i < g_count; i++) {
+    mean += g_samples[i].*axis;
+  }
+  mean /= g_count;
+  float sty = 0;
+  for (uint8_t i = 0; i < g_count; i++) {
+    sty += (g_samples[i].t - meanT) * (g_samples[i].*axis - mean);
+  }
+  float slope = stt > 0 ? sty / stt : 0;
+  for (uint8_t i = 0; i < g_count; i++) {
+    float r = g_samples[i].*axis - (mean + slope * (g_samples[i].t - meanT));
+    ssr += r * r;
+  }
+  return mean + slope * (newest.t - meanT);
+}
+
+// Fitted position of the newest sample and its estimated error
+float estimate(float& x, float& y) {
+  const QualitySample& newest = g_samples[(g_next + GPS_QUALITY_WINDOW - 1) % GPS_QUALITY_WINDOW];
+  x = newest.x;
+  y = newest.y;
+  if (g_count < GPS_QUALITY_MIN_SAMPLES) {
+    return -1.0f;
+  }
+  float meanT = 0;
+  for (uint8_t i = 0; i < g_count; i++) {
+    meanT += g_samples[i].t;
+  }
+  meanT /= g_count;
+  float stt = 0;
+  for (uint8_t i = 0; i < g_count; i++) {
+    stt += (g_samples[i].t - meanT) * (g_samples[i].t - meanT);
+  }
+  float ssr = 0;
+  x = fit_axis(&QualitySample::x, newest, meanT, stt, ssr);
+  y = fit_axis(&QualitySample::y, newest, meanT, stt, ssr);
+
+  // Scatter per sample, scaled to the uncertainty of the fitted end point
+  float sigma = sqrtf(ssr / (g_count - 2));
+  float dt = newest.t - meanT;
+  float scatterError = sigma * sqrtf(1.0f / g_count + (stt > 0 ? dt * dt / stt : 0));
+  // Receiver errors are correlated over seconds, so HDOP does not average out
+  float hdop = newest.hdop >= 0 ? newest.hdop : UNKNOWN_HDOP;
+  float dopError = hdop * GPS_UERE_M;
+  return scatterError > dopError ? scatterError : dopError;
+}
+} // namespace
+
+void fix_quality_reset() {
+  g_count = 0;
+  g_next = 0;
+}
+
+void fix_quality_add(unsigned long timeMs, double lat, double lon, float hdop) {
+  if (g_count == 0) {
+    g_originLat = lat;
+    g_originLon = lon;
+    g_metersPerDegreeLon = METERS_PER_DEGREE * cos(lat * DEG_TO_RAD);
+    g_originMs = timeMs;
+  }
+  QualitySample& s = g_samples[g_next];
+  s.t = (timeMs - g_originMs) / 1000.0f;
+  s.x = static_cast<float>((lon - g_originLon) * g_metersPerDegreeLon);
+  s.y = static_cast<float>((lat - g_originLat) * METERS_PER_DEGREE);
+  s.hdop = hdop;
+  g_next = (g_next + 1) % GPS_QUALITY_WINDOW;
+  if (g_count < GPS_QUALITY_WINDOW) {
+    g_count++;
+  }
+}
+
+uint8_t fix_quality_samples() {
+  return g_count;
+}
+
+float fix_quality_error_m() {
+  if (g_count == 0) {
+    return -1.0f;
+  }
+  float x, y;
+  return estimate(x, y);
+}
+
+float fix_quality_dop_error_m() {
+  if (g_count == 0) {
+    return -1.0f;
+  }
+  const QualitySample& newest = g_samples[(g_next + GPS_QUALITY_WINDOW - 1) % GPS_QUALITY_WINDOW];
+  return newest.hdop >= 0 ? newest.hdop * GPS_UERE_M : -1.0f;
+}
+
+void fix_quality_position(double& lat, double& lon) {
+  if (g_count == 0) {
+    lat = g_originLat;
+    lon = g_originLon;
+    return;
+  }
+  float x, y;
+  estimate(x, y);
+  lat = g_originLat + y / METERS_PER_DEGREE;
+  lon = g_originLon + x / g_metersPerDegreeLon;
+}
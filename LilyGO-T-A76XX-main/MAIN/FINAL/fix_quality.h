@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// Fix quality estimate for GPS acquisition.
+//
+// gps_get_fix() feeds one position sample per receiver epoch. The module keeps the
+// last GPS_QUALITY_WINDOW samples, fits a constant-velocity track through them and
+// estimates the horizontal error of the newest point from the residual scatter and
+// the reported HDOP. Acquisition stops as soon as that estimate meets the accuracy
+// target instead of taking the first sentence that happens to be valid.
+
+// Forget all samples (start of a fix attempt)
+void fix_quality_reset();
+
+// Add one sample; `hdop` < 0 when the receiver did not report it
+void fix_quality_add(unsigned long timeMs, double lat, double lon, float hdop);
+
+// Number of samples currently in the window
+uint8_t fix_quality_samples();
+
+// Estimated horizontal error (m) of fix_quality_position(), negative until
+// GPS_QUALITY_MIN_SAMPLES samples are available
+float fix_quality_error_m();
+
+// HDOP x GPS_UERE_M of the newest sample, negative if there is none or HDOP is unknown.
+// Usable before GPS_QUALITY_MIN_SAMPLES when the satellite data says the DOP can be trusted.
+float fix_quality_dop_error_m();
+
+// Position of the newest sample on the fitted track
+void fix_quality_position(double& lat, double& lon);
@@ -1,8 +1,15 @@
 #include "gps_control.h"
 #include "config.h"
+#include "fix_quality.h"
+#include "power_management.h"
+#include "modem_control.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "driver/gpio.h"
+#include "esp_sleep.h"
 
 // Global GPS objects
-HardwareSerial SerialGPS(1);
+HardwareSerial SerialGPS(2); // UART1 is the modem (SerialAT); both run concurrently
 TinyGPSPlus gps;
 
 // Global variables (declared extern in gps_control.h and other modules)
@@ -21,72 +28,526 @@ uint8_t  gpsMinute = 0;
 uint8_t  gpsSecond = 0;
 
 bool gpsFixObtained = false;
+GnssSource gpsFixSource = GnssSource::External;
 extern int minSatellitesForFix;
+extern int fixAccuracyTargetM;
 
 namespace {
 volatile bool gpsAbortRequested = false;
 volatile bool gpsLoopActive = false;
+
+// GPS week counting starts 1980-01-06; GPS time is ahead of UTC by the leap seconds since then
+const uint32_t GPS_EPOCH_UNIX = 315964800UL;
+const uint32_t GPS_LEAP_SECONDS = 18;
+const uint32_t SECONDS_PER_WEEK = 604800UL;
+
+// $PCAS03 fields GGA, GLL, GSA, GSV, RMC, ...: the parsed sentences only
+const char* const OUTPUT_SELECTION =
+    GPS_SATELLITE_SENTENCES ? "PCAS03,1,0,1,1,1,0,0,0,0,0,,,0,0" : "PCAS03,1,0,0,0,1,0,0,0,0,0,,,0,0";
+
+// What the receiver needs for a fast start on the next wake; survives deep sleep
+struct GnssRetainedState {
+  bool railHeld;          // GPS_POWER_PIN held through deep sleep, receiver in standby
+  uint32_t receiverBaud;  // UART rate the held receiver was left at
+  bool outputFiltered;    // and whether its output was verified as the parsed sentences only
+  bool configVerified;    // configure_receiver() read back the output once since boot
+  bool fastBaudFailed;    // Nothing decoded at GPS_FAST_BAUD_RATE since boot: stay at GPS_BAUD_RATE
+  bool havePosition;
+  double lat, lon;
+  float alt;
+  double wakeEpoch;       // Estimated UTC at the scheduled timer wake, 0 if unknown
+  float wakeTimeAccS;     // Uncertainty of wakeEpoch
+};
+
+RTC_DATA_ATTR GnssRetainedState g_gnssRtc;
+
+bool g_gnssStandby = false;    // $PCAS12 sent since the rail came up
+uint32_t g_gpsBaud = GPS_BAUD_RATE; // Current UART rate of the receiver and SerialGPS
+bool g_outputFiltered = false;      // Receiver sends only the parsed sentences, so bursts are short
+
+// Sentences cut from the UART stream by the receive callback, consumed by gps_get_fix()
+struct NmeaSentence {
+  uint8_t len;  // 0 = wake-up without data (abort)
+  char text[GPS_SENTENCE_MAX];
+};
+QueueHandle_t g_sentenceQueue = nullptr;
+NmeaSentence g_rxSentence;                 // Being assembled by the callback
+unsigned long g_lastRxMs = 0;
+volatile unsigned long g_burstStartMs = 0; // Estimated first byte of the latest burst
+
+// Runs in the UART driver's event task after the line went idle (end of a burst or a gap in it)
+void on_gps_receive() {
+  unsigned long now = millis();
+  int pending = SerialGPS.available();
+  if (g_burstStartMs == 0 || now - g_lastRxMs > GPS_BURST_GAP_MS) {
+    // First data after a quiet gap: back-date the burst start by the airtime of what is buffered
+    g_burstStartMs = now - static_cast<unsigned long>(pending) * 10000UL / g_gpsBaud;
+  }
+  g_lastRxMs = now;
+  while (SerialGPS.available() > 0) {
+    char c = static_cast<char>(SerialGPS.read());
+    if (c == '$') {
+      g_rxSentence.len = 0;
+    }
+    if (g_rxSentence.len < sizeof(g_rxSentence.text)) {
+      g_rxSentence.text[g_rxSentence.len++] = c;
+    }
+    if (c == '\n') {
+      xQueueSend(g_sentenceQueue, &g_rxSentence, 0); // Queue full: dropped like an RX overrun
+      g_rxSentence.len = 0;
+    }
+  }
 }
+double g_fixEpoch = 0;         // UTC of the last fix in this wake
+unsigned long g_fixMs = 0;     // millis() at that fix
 
-void gps_power_up() {
-  pinMode(GPS_POWER_PIN, OUTPUT);
+// Best UTC estimate for now from this wake's fix or the time carried through sleep; 0 if unknown
+double estimate_utc_now(float& accS) {
+  if (g_fixEpoch > 0) {
+    accS = 1.0f;
+    return g_fixEpoch + (millis() - g_fixMs) / 1000.0;
+  }
+  // A button wake ends the sleep early, so only the timer wake matches the estimate
+  if (g_gnssRtc.wakeEpoch > 0 && esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER) {
+    accS = g_gnssRtc.wakeTimeAccS + 1.0f;
+    return g_gnssRtc.wakeEpoch + millis() / 1000.0;
+  }
+  return 0;
+}
+
+void send_pcas(const char* body) {
+  uint8_t cs = 0;
+  for (const char* p = body; *p; ++p) {
+    cs ^= static_cast<uint8_t>(*p);
+  }
+  SerialGPS.printf("$%s*%02X\r\n", body, cs);
+}
+
+// Reads NMEA for up to `timeout` ms, feeding it to TinyGPS++ as well, and reports whether
+// sentences decode at the current baud and whether a whole epoch had only GGA and RMC in it
+// (and GSA/GSV with GPS_SATELLITE_SENTENCES). With `firstSentence` it stops at the first
+// sentence that decodes.
+void read_back_output(unsigned long timeout, bool& decoded, bool& filtered, bool firstSentence = false) {
+  char line[96];
+  size_t len = 0;
+  bool sawGga = false;
+  bool sawRmc = false;
+  bool other = false;
+  decoded = false;
+  filtered = false;
+  unsigned long start = millis();
+  while (millis() - start < timeout && !filtered && !(firstSentence && decoded)) {
+    if (SerialGPS.available() <= 0) {
+      delay(5);
+      continue;
+    }
+    char c = static_cast<char>(SerialGPS.read());
+    gps.encode(c);
+    if (c == '$') {
+      len = 0;
+    }
+    if (c != '\n') {
+      if (len < sizeof(line) - 1) {
+        line[len++] = c;
+      }
+      continue;
+    }
+    line[len] = '\0';
+    len = 0;
+    // $ttXXX,...*hh with a matching checksum
+    char* star = strrchr(line, '*');
+    if (line[0] != '$' || star == nullptr || strlen(line) < 7) {
+      continue;
+    }
+    uint8_t cs = 0;
+    for (const char* p = line + 1; p < star; ++p) {
+      cs ^= static_cast<uint8_t>(*p);
+    }
+    if (strtoul(star + 1, nullptr, 16) != cs) {
+      continue;
+    }
+    decoded = true;
+    // GGA opens every epoch; judge the epoch that ends here
+    if (strncmp(line + 3, "GGA", 3) == 0) {
+      filtered = sawGga && sawRmc && !other;
+      sawGga = true;
+      sawRmc = false;
+      other = false;
+    } else if (strncmp(line + 3, "RMC", 3) == 0) {
+      sawRmc = true;
+    } else if (GPS_SATELLITE_SENTENCES &&
+               (strncmp(line + 3, "GSA", 3) == 0 || strncmp(line + 3, "GSV", 3) == 0)) {
+      // Satellite data for the early fix acceptance
+    } else {
+      other = true;
+    }
+  }
+}
+
+// Nothing decodes at GPS_FAST_BAUD_RATE. The receiver may have taken $PCAS01 on a link
+// that does not carry the rate, so it cannot be told to switch back; power-cycling it
+// restores GPS_BAUD_RATE (backup RAM keeps ephemeris and time), and the fix attempt
+// runs there with the sentence selection sent again. Later power-ups stay at the default.
+void restart_at_default_baud() {
+  digitalWrite(GPS_POWER_PIN, LOW);
+  delay(GPS_POWER_CYCLE_MS);
   digitalWrite(GPS_POWER_PIN, HIGH);
-  DBG_PRINTLN(F("[GPS] Powering GPS module ON..."));
+  SerialGPS.updateBaudRate(GPS_BAUD_RATE);
+  g_gpsBaud = GPS_BAUD_RATE;
+  g_outputFiltered = false;
+  g_gnssRtc.fastBaudFailed = true;
   delay(1000);
+  send_pcas(OUTPUT_SELECTION);
+  DBG_PRINTF("[GPS] No output at %d baud, receiver restarted at %d.\n", GPS_FAST_BAUD_RATE, GPS_BAUD_RATE);
 }
 
-void gps_power_down() {
-  digitalWrite(GPS_POWER_PIN, LOW);
-  DBG_PRINTLN(F("[GPS] GPS module powered OFF."));
+// Only RMC (date, speed), GGA (satellites, HDOP, altitude) and optionally GSA/GSV (PDOP,
+// used satellites, C/N0) are parsed; everything else is turned off and the link is moved
+// to GPS_FAST_BAUD_RATE, then checked by reading back. The receiver answers the same
+// commands the same way, so only the first power-up after boot pays for the full check;
+// later ones just wait for one sentence at the new rate.
+void configure_receiver() {
+  static const uint32_t BAUD_CODES[] = {4800, 9600, 19200, 38400, 57600, 115200}; // $PCAS01,<index>
+  send_pcas(OUTPUT_SELECTION);
+  int code = -1;
+  for (size_t i = 0; i < sizeof(BAUD_CODES) / sizeof(BAUD_CODES[0]); ++i) {
+    if (BAUD_CODES[i] == GPS_FAST_BAUD_RATE) {
+      code = static_cast<int>(i);
+    }
+  }
+  if (code >= 0 && GPS_FAST_BAUD_RATE != g_gpsBaud && !g_gnssRtc.fastBaudFailed) {
+    char cmd[16];
+    snprintf(cmd, sizeof(cmd), "PCAS01,%d", code);
+    send_pcas(cmd);
+    SerialGPS.flush();
+    SerialGPS.updateBaudRate(GPS_FAST_BAUD_RATE);
+    g_gpsBaud = GPS_FAST_BAUD_RATE;
+  }
+
+  bool decoded, filtered;
+  if (g_gnssRtc.configVerified) {
+    if (g_gpsBaud != GPS_BAUD_RATE) {
+      // Trusted, but the receiver or the wiring may have changed since the full check
+      read_back_output(GPS_BAUD_CHECK_MS, decoded, filtered, true);
+      if (!decoded) {
+        g_gnssRtc.configVerified = false;
+        restart_at_default_baud();
+        return;
+      }
+    }
+    g_outputFiltered = true;
+    return;
+  }
+
+  read_back_output(GPS_CONFIG_VERIFY_MS, decoded, filtered);
+  if (!decoded && g_gpsBaud != GPS_BAUD_RATE) {
+    restart_at_default_baud();
+    return;
+  }
+  g_outputFiltered = filtered;
+  if (!filtered) {
+    DBG_PRINTLN(F("[GPS] Receiver output not confirmed as the parsed sentences only."));
+    return;
+  }
+  g_gnssRtc.configVerified = true;
+  DBG_PRINTF("[GPS] Receiver set to RMC + GGA%s at %lu baud.\n", GPS_SATELLITE_SENTENCES ? " + GSA/GSV" : "",
+             static_cast<unsigned long>(g_gpsBaud));
 }
 
-void gps_init_serial() {
-  SerialGPS.begin(GPS_BAUD_RATE, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
-  DBG_PRINTF("[GPS] HardwareSerial for GPS initialized on pins RX:%d, TX:%d at %d baud.\n", GPS_RX_PIN, GPS_TX_PIN, GPS_BAUD_RATE);
+// CASIC AID-INI (class 0x0B, id 0x01): approximate position and time for a receiver without state
+void send_aid_ini(double epoch, float timeAccS) {
+  uint8_t payload[56] = {};
+  uint8_t flags = 0;
+  if (g_gnssRtc.havePosition) {
+    double alt = g_gnssRtc.alt;
+    float posAcc = GPS_AID_POSITION_ACC_M;
+    memcpy(payload + 0, &g_gnssRtc.lat, 8);
+    memcpy(payload + 8, &g_gnssRtc.lon, 8);
+    memcpy(payload + 16, &alt, 8);
+    memcpy(payload + 36, &posAcc, 4);
+    flags |= 0x01 | 0x20; // Position valid, given as latitude/longitude/altitude
+  }
+  if (epoch > 0) {
+    double gpsSeconds = epoch - GPS_EPOCH_UNIX + GPS_LEAP_SECONDS;
+    uint16_t week = static_cast<uint16_t>(gpsSeconds / SECONDS_PER_WEEK);
+    double tow = gpsSeconds - static_cast<double>(week) * SECONDS_PER_WEEK;
+    memcpy(payload + 24, &tow, 8);
+    memcpy(payload + 40, &timeAccS, 4);
+    memcpy(payload + 52, &week, 2);
+    flags |= 0x02; // Time valid
+  }
+  payload[55] = flags;
+
+  const uint8_t msgClass = 0x0B, msgId = 0x01;
+  const uint16_t length = sizeof(payload);
+  uint32_t checksum = (static_cast<uint32_t>(msgId) << 24) + (static_cast<uint32_t>(msgClass) << 16) + length;
+  for (size_t i = 0; i < sizeof(payload); i += 4) {
+    uint32_t word;
+    memcpy(&word, payload + i, 4);
+    checksum += word;
+  }
+  const uint8_t header[6] = {0xBA, 0xCE, static_cast<uint8_t>(length & 0xFF), static_cast<uint8_t>(length >> 8),
+                             msgClass, msgId};
+  SerialGPS.write(header, sizeof(header));
+  SerialGPS.write(payload, sizeof(payload));
+  SerialGPS.write(reinterpret_cast<const uint8_t*>(&checksum), sizeof(checksum));
 }
 
-void gps_close_serial() {
-  SerialGPS.end();
-  DBG_PRINTLN(F("[GPS] HardwareSerial for GPS closed."));
+// Recent GSA/GSV describe a low-PDOP solution from enough strong satellites, so the
+// receiver's own DOP is a fair error estimate without waiting for the track scatter
+bool satellites_trusted() {
+  if (!GPS_SATELLITE_SENTENCES || !gps.pdop.isValid() || !gps.satellitesInView.isValid()) {
+    return false;
+  }
+  if (gps.pdop.age() > 2000 || gps.satellitesInView.age() > 2000) {
+    return false; // Not from this or the previous epoch
+  }
+  return gps.pdop.dop() <= GPS_TRUSTED_PDOP &&
+         gps.satellitesInView.usedWithCn0(GPS_TRUSTED_CN0_DBHZ) >= GPS_TRUSTED_MIN_SV;
 }
 
-void gps_display_and_store_info() {
-  gpsLat = gps.location.lat();
-  gpsLon = gps.location.lng();
-  gpsSats = gps.satellites.value();
-  gpsSpd = gps.speed.kmph();
-  gpsAlt = gps.altitude.meters();
-  gpsHdop = gps.hdop.isValid() ? (gps.hdop.value() / 100.0) : -1.0;
+// Fix fields taken from TinyGPS++ at one epoch, with the position from fix_quality,
+// or from one modem GNSS reading
+struct FixSnapshot {
+  bool valid;
+  GnssSource source;
+  float errorM;
+  unsigned long atMs;
+  double lat, lon, spd, alt, hdop;
+  int sats;
+  uint16_t year;
+  uint8_t month, day, hour, minute, second;
+};
 
+FixSnapshot capture_fix(double lat, double lon, float errorM) {
+  FixSnapshot f = {};
+  f.valid = true;
+  f.source = GnssSource::External;
+  f.errorM = errorM;
+  f.atMs = millis();
+  f.lat = lat;
+  f.lon = lon;
+  f.sats = gps.satellites.value();
+  f.spd = gps.speed.kmph();
+  f.alt = gps.altitude.meters();
+  f.hdop = gps.hdop.isValid() ? (gps.hdop.value() / 100.0) : -1.0;
   if (gps.date.isValid()) {
-    gpsYear = gps.date.year();
-    gpsMonth = gps.date.month();
-    gpsDay = gps.date.day();
-  } else {
-    gpsYear = 0;
-    gpsMonth = 0;
-    gpsDay = 0;
+    f.year = gps.date.year();
+    f.month = gps.date.month();
+    f.day = gps.date.day();
   }
   if (gps.time.isValid()) {
-    gpsHour = gps.time.hour();
-    gpsMinute = gps.time.minute();
-    gpsSecond = gps.time.second();
-  } else {
-    gpsHour = 0;
-    gpsMinute = 0;
-    gpsSecond = 0;
+    f.hour = gps.time.hour();
+    f.minute = gps.time.minute();
+    f.second = gps.time.second();
+  }
+  return f;
+}
+
+// The modem reports no scatter; its error is estimated from the HDOP alone
+FixSnapshot capture_modem_fix(const ModemGnssFix& m) {
+  FixSnapshot f = {};
+  f.valid = true;
+  f.source = GnssSource::Modem;
+  f.errorM = m.hdop > 0 ? m.hdop * GPS_UERE_M : -1.0f;
+  f.atMs = millis();
+  f.lat = m.lat;
+  f.lon = m.lon;
+  f.sats = m.sats;
+  f.spd = m.speedKmh;
+  f.alt = m.altM;
+  f.hdop = m.hdop;
+  f.year = m.year;
+  f.month = m.month;
+  f.day = m.day;
+  f.hour = m.hour;
+  f.minute = m.minute;
+  f.second = m.second;
+  return f;
+}
+
+// Distance between two snapshots less what the newer one could have driven since the older
+float separation_m(const FixSnapshot& older, const FixSnapshot& newer) {
+  const double metersPerDegree = 111320.0;
+  double dy = (newer.lat - older.lat) * metersPerDegree;
+  double dx = (newer.lon - older.lon) * metersPerDegree * cos(older.lat * DEG_TO_RAD);
+  float driven = static_cast<float>(newer.spd / 3.6) * (newer.atMs - older.atMs) / 1000.0f;
+  return static_cast<float>(sqrt(dx * dx + dy * dy)) - driven;
+}
+
+// Cross-check: enough satellites and, once the L76K has a sample, close to its estimate
+bool modem_fix_agrees(const FixSnapshot& fix, const FixSnapshot& external) {
+  if (fix.sats < minSatellitesForFix) {
+    return false;
+  }
+  if (external.valid && separation_m(external, fix) > MODEM_GNSS_AGREE_M) {
+    DBG_PRINTF("[GPS] Modem GNSS fix %.0f m away from the L76K estimate, not used.\n", separation_m(external, fix));
+    return false;
+  }
+  return true;
+}
+
+// Meets the accuracy target and repeats the previous modem reading within it
+bool modem_fix_converged(const FixSnapshot& fix, const FixSnapshot& previous) {
+  if (fixAccuracyTargetM <= 0) {
+    return true;
+  }
+  return fix.errorM >= 0 && fix.errorM <= fixAccuracyTargetM && previous.valid &&
+         separation_m(previous, fix) <= fixAccuracyTargetM;
+}
+
+// The external estimate is replaced by a cross-checked modem fix with a smaller error
+void prefer_modem_fix(FixSnapshot& best, const FixSnapshot& modemFix) {
+  if (modemFix.valid && (!best.valid || (modemFix.errorM >= 0 && (best.errorM < 0 || modemFix.errorM < best.errorM)))) {
+    best = modemFix;
+  }
+}
+
+void store_fix(const FixSnapshot& f) {
+  gpsFixSource = f.source;
+  gpsLat = f.lat;
+  gpsLon = f.lon;
+  gpsSats = f.sats;
+  gpsSpd = f.spd;
+  gpsAlt = f.alt;
+  gpsHdop = f.hdop;
+  gpsYear = f.year;
+  gpsMonth = f.month;
+  gpsDay = f.day;
+  gpsHour = f.hour;
+  gpsMinute = f.minute;
+  gpsSecond = f.second;
+
+  if (gpsYear != 0) {
+    g_fixEpoch = gps_timestamp_epoch();
+    g_fixMs = f.atMs;
   }
+  g_gnssRtc.havePosition = true;
+  g_gnssRtc.lat = f.lat;
+  g_gnssRtc.lon = f.lon;
+  g_gnssRtc.alt = static_cast<float>(f.alt);
 
-  DBG_PRINTLN(F("\n*** GPS FIX OBTAINED (External) ***"));
+  DBG_PRINTLN(f.source == GnssSource::Modem ? F("\n*** GPS FIX OBTAINED (Modem GNSS) ***")
+                                             : F("\n*** GPS FIX OBTAINED (External) ***"));
   DBG_PRINTF("Lat: %.6f  Lon: %.6f\n", gpsLat, gpsLon);
   DBG_PRINTF("Speed: %.2f km/h  Altitude: %.2f m\n", gpsSpd, gpsAlt);
   DBG_PRINTF("Satellites: %d  HDOP: %.2f\n", gpsSats, gpsHdop);
+  if (f.errorM >= 0) {
+    DBG_PRINTF("Estimated error: %.1f m (%u samples)\n", f.errorM, fix_quality_samples());
+  }
   if (gpsYear != 0) {
     DBG_PRINTF("Date: %04d-%02d-%02d  Time: %02d:%02d:%02d (UTC from GPS)\n", gpsYear, gpsMonth, gpsDay, gpsHour, gpsMinute, gpsSecond);
   } else {
     DBG_PRINTLN(F("Date/Time: Not available from GPS"));
   }
 }
+}
+
+void gps_power_up() {
+  pinMode(GPS_POWER_PIN, OUTPUT);
+  digitalWrite(GPS_POWER_PIN, HIGH);
+  if (g_gnssRtc.railHeld) {
+    // Drive the pin HIGH before releasing the hold so the rail never glitches
+    gpio_hold_dis(static_cast<gpio_num_t>(GPS_POWER_PIN));
+    g_gnssStandby = true;
+    g_gpsBaud = g_gnssRtc.receiverBaud ? g_gnssRtc.receiverBaud : GPS_BAUD_RATE;
+    g_outputFiltered = g_gnssRtc.outputFiltered;
+    DBG_PRINTLN(F("[GPS] GPS module kept powered in standby through sleep."));
+    return;
+  }
+  g_gpsBaud = GPS_BAUD_RATE;
+  g_outputFiltered = false;
+  DBG_PRINTLN(F("[GPS] Powering GPS module ON..."));
+  delay(1000);
+}
+
+void gps_power_down() {
+  pinMode(GPS_POWER_PIN, OUTPUT);
+  digitalWrite(GPS_POWER_PIN, LOW);
+  gpio_hold_dis(static_cast<gpio_num_t>(GPS_POWER_PIN));
+  g_gnssRtc.railHeld = false;
+  g_gnssStandby = false;
+  DBG_PRINTLN(F("[GPS] GPS module powered OFF."));
+}
+
+void gps_start_receiver() {
+  if (g_gnssStandby) {
+    // Any UART data wakes the L76K; it resumes from its own time and ephemeris (hot start)
+    // and keeps the output settings made after power-up
+    g_gnssRtc.railHeld = false;
+    g_gnssStandby = false;
+    SerialGPS.print(F("\r\n"));
+    DBG_PRINTLN(F("[GPS] Receiver woken from standby."));
+    return;
+  }
+  configure_receiver();
+  float timeAccS = 0;
+  double epoch = estimate_utc_now(timeAccS);
+  if (!g_gnssRtc.havePosition && epoch <= 0) {
+    return; // Nothing known yet: plain cold start
+  }
+  send_aid_ini(epoch, timeAccS);
+  if (epoch > 0) {
+    DBG_PRINTF("[GPS] Aided with last position and time (+/-%.0f s).\n", timeAccS);
+  } else {
+    DBG_PRINTLN(F("[GPS] Aided with last position (time unknown)."));
+  }
+}
+
+void gps_enter_standby() {
+  // Stops navigation; the receiver keeps its RTC and ephemeris while the rail stays up.
+  // The longest duration: the next wake ends standby by sending data.
+  send_pcas("PCAS12,65535");
+  SerialGPS.flush();
+  g_gnssStandby = true;
+  DBG_PRINTLN(F("[GPS] Receiver in standby."));
+}
+
+void gps_prepare_deep_sleep(uint64_t seconds) {
+  float timeAccS = 0;
+  double epoch = estimate_utc_now(timeAccS);
+  g_gnssRtc.wakeEpoch = epoch > 0 ? epoch + static_cast<double>(seconds) : 0;
+  g_gnssRtc.wakeTimeAccS = timeAccS + static_cast<float>(seconds) * GPS_RTC_DRIFT;
+
+  if (!g_gnssStandby) {
+    // GPS not started this wake (motion gating): a receiver held from before stays for short sleeps only
+    if (g_gnssRtc.railHeld && seconds > GPS_STANDBY_MAX_SLEEP_S) {
+      gps_power_down();
+    } else if (g_gnssRtc.railHeld) {
+      // The pad returns to its default after a wake; hold it again for this sleep
+      pinMode(GPS_POWER_PIN, OUTPUT);
+      digitalWrite(GPS_POWER_PIN, HIGH);
+      gpio_hold_en(static_cast<gpio_num_t>(GPS_POWER_PIN));
+      gpio_deep_sleep_hold_en();
+    }
+    return; // Rail already off (or GPS never started this wake)
+  }
+  if (seconds > GPS_STANDBY_MAX_SLEEP_S) {
+    gps_power_down();
+    return;
+  }
+  gpio_hold_en(static_cast<gpio_num_t>(GPS_POWER_PIN));
+  gpio_deep_sleep_hold_en();
+  g_gnssRtc.railHeld = true;
+  g_gnssRtc.receiverBaud = g_gpsBaud;
+  g_gnssRtc.outputFiltered = g_outputFiltered;
+  DBG_PRINTLN(F("[GPS] Keeping GPS rail up in standby for the next wake."));
+}
+
+void gps_init_serial() {
+  SerialGPS.begin(g_gpsBaud, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
+  DBG_PRINTF("[GPS] HardwareSerial for GPS initialized on pins RX:%d, TX:%d at %lu baud.\n", GPS_RX_PIN, GPS_TX_PIN,
+             static_cast<unsigned long>(g_gpsBaud));
+}
+
+void gps_close_serial() {
+  SerialGPS.end();
+  DBG_PRINTLN(F("[GPS] HardwareSerial for GPS closed."));
+}
+
+void gps_display_and_store_info() {
+  store_fix(capture_fix(gps.location.lat(), gps.location.lng(), -1.0f));
+}
 
 bool gps_get_fix(unsigned long timeout) {
   unsigned long startTime = millis();
@@ -95,31 +556,117 @@ bool gps_get_fix(unsigned long timeout) {
   gpsAbortRequested = false;
   gpsLoopActive = true;
 
+  fix_quality_reset();
+  FixSnapshot best = {};
+  FixSnapshot modemFix = {};     // Newest modem GNSS reading that passed the cross-check
+  FixSnapshot modemLast = {};    // Newest modem GNSS reading
+  unsigned long lastModemPollMs = millis();
+  unsigned long firstSampleMs = 0;
+  uint32_t lastSampleTime = 0xFFFFFFFF;
+
+  if (g_sentenceQueue == nullptr) {
+    g_sentenceQueue = xQueueCreate(GPS_SENTENCE_QUEUE_LEN, sizeof(NmeaSentence));
+  }
+  xQueueReset(g_sentenceQueue);
+  g_rxSentence.len = 0;
+  g_burstStartMs = 0;
+  SerialGPS.onReceive(on_gps_receive, true);
+
   DBG_PRINT(F("[GPS] Attempting to get GPS fix (External)... (Timeout: "));
   DBG_PRINT(timeout / 1000);
-  DBG_PRINTLN(F("s)"));
+  DBG_PRINT(F("s, target: "));
+  DBG_PRINT(fixAccuracyTargetM);
+  DBG_PRINTLN(F(" m)"));
 
   while (millis() - startTime < timeout) {
     if (gpsAbortRequested) {
       DBG_PRINTLN(F("[GPS] Fix attempt aborted."));
       break;
     }
-    while (SerialGPS.available() > 0) {
+    NmeaSentence sentence;
+    if (xQueueReceive(g_sentenceQueue, &sentence, pdMS_TO_TICKS(GPS_QUEUE_WAIT_MS)) != pdTRUE) {
+      sentence.len = 0;
+    }
+    for (uint8_t i = 0; i < sentence.len; ++i) {
       if (gpsAbortRequested) break; // Immediate exit if requested inside the read loop
 
-      if (gps.encode(SerialGPS.read())) {
-        if (gps.location.isUpdated() && gps.location.isValid() &&
+      if (!gps.encode(sentence.text[i])) {
+        continue;
+      }
+      // One sample per receiver epoch: GGA and RMC both update the location
+      if (!(gps.location.isUpdated() && gps.location.isValid() &&
             gps.date.isValid() && gps.time.isValid() &&
-            gps.satellites.isValid() && (gps.satellites.value() >= minSatellitesForFix)) {
-          gps_display_and_store_info();
-          gpsFixObtained = true;
-          break;
-        }
+            gps.satellites.isValid() && (gps.satellites.value() >= minSatellitesForFix) &&
+            gps.time.value() != lastSampleTime)) {
+        continue;
+      }
+      lastSampleTime = gps.time.value();
+      double lat = gps.location.lat();
+      double lon = gps.location.lng();
+      if (fixAccuracyTargetM <= 0) {
+        // No accuracy target: first valid sentence, as before
+        best = capture_fix(lat, lon, -1.0f);
+        gpsFixObtained = true;
+        break;
+      }
+      unsigned long now = millis();
+      if (firstSampleMs == 0) {
+        firstSampleMs = now | 1;
+      }
+      fix_quality_add(now, lat, lon, gps.hdop.isValid() ? gps.hdop.hdop() : -1.0f);
+      float error = fix_quality_error_m();
+      if (error < 0 && fix_quality_samples() >= GPS_TRUSTED_MIN_SAMPLES && satellites_trusted()) {
+        error = fix_quality_dop_error_m();
+      }
+      if (error >= 0) {
+        fix_quality_position(lat, lon);
+      }
+      // Until the estimate is available the newest sample is the best guess
+      bool better = error >= 0 ? (best.errorM < 0 || error <= best.errorM) : best.errorM < 0;
+      if (!best.valid || better) {
+        best = capture_fix(lat, lon, error);
+      }
+      if (error >= 0 && error <= fixAccuracyTargetM) {
+        DBG_PRINTF("[GPS] Fix converged to %.1f m after %lu ms.\n", error, now - firstSampleMs);
+        gpsFixObtained = true;
+        break;
       }
     }
     if (gpsFixObtained) {
       break;
     }
+    if (modem_gnss_active() && millis() - lastModemPollMs >= MODEM_GNSS_POLL_MS) {
+      ModemGnssFix reading;
+      if (modem_gnss_read(reading)) {
+        FixSnapshot fix = capture_modem_fix(reading);
+        if (modem_fix_agrees(fix, best)) {
+          modemFix = fix;
+          if (millis() - startTime >= MODEM_GNSS_REPLACE_AFTER_MS && modem_fix_converged(fix, modemLast)) {
+            DBG_PRINTF("[GPS] Modem GNSS fix accepted (%.1f m) before the L76K converged.\n", fix.errorM);
+            best = fix;
+            gpsFixObtained = true;
+            break;
+          }
+        }
+        modemLast = fix;
+      }
+      lastModemPollMs = millis(); // From the end of the poll: it may have waited for the lock
+    }
+    if (firstSampleMs != 0 && millis() - firstSampleMs > GPS_QUALITY_MAX_WAIT_MS) {
+      prefer_modem_fix(best, modemFix);
+      DBG_PRINTF("[GPS] Accuracy target not reached, using best estimate (%.1f m).\n", best.errorM);
+      gpsFixObtained = true;
+      break;
+    }
+
+    // RMC closes the epoch: with short bursts the CPU can sleep until just before the next one
+    if (GPS_LIGHT_SLEEP && g_outputFiltered && g_burstStartMs != 0 && sentence.len > 6 &&
+        strncmp(sentence.text + 3, "RMC", 3) == 0 && uxQueueMessagesWaiting(g_sentenceQueue) == 0) {
+      long sleepMs = static_cast<long>(g_burstStartMs + 1000 - GPS_WAKE_MARGIN_MS - millis());
+      if (sleepMs >= static_cast<long>(GPS_MIN_LIGHT_SLEEP_MS) && sleepMs < 1000) {
+        power_light_sleep(static_cast<uint64_t>(sleepMs) * 1000ULL);
+      }
+    }
 
     if (millis() - lastPrintTime > 5000) {
       lastPrintTime = millis();
@@ -130,22 +677,72 @@ bool gps_get_fix(unsigned long timeout) {
       DBG_PRINT(F(", Date Valid: "));
       DBG_PRINT(gps.date.isValid());
       DBG_PRINT(F(", Time Valid: "));
-      DBG_PRINTLN(gps.time.isValid());
+      DBG_PRINT(gps.time.isValid());
+      DBG_PRINT(F(", Samples: "));
+      DBG_PRINT(fix_quality_samples());
+      if (GPS_SATELLITE_SENTENCES) {
+        DBG_PRINTF(", In view: %u, Strong used: %u, PDOP: %.1f", gps.satellitesInView.count(),
+                   gps.satellitesInView.usedWithCn0(GPS_TRUSTED_CN0_DBHZ), gps.pdop.dop());
+      }
+      DBG_PRINTLN();
     }
-    delay(1); // Yield to other tasks but return quickly
   }
+  SerialGPS.onReceive(nullptr);
+  modem_gnss_stop();
 
-  if (!gpsFixObtained) {
+  if (!gpsFixObtained && !gpsAbortRequested) {
+    prefer_modem_fix(best, modemFix);
+  }
+  if (!gpsFixObtained && best.valid && !gpsAbortRequested) {
+    // Timed out while still converging: a usable fix beats none
+    gpsFixObtained = true;
+  }
+  if (gpsFixObtained) {
+    store_fix(best);
+  } else {
     DBG_PRINTLN(F("\n[GPS] GPS fix timeout (External)."));
   }
+  if (!gpsFixObtained && !gpsAbortRequested && gps.passedChecksum() == 0) {
+    g_gnssRtc.configVerified = false; // Nothing decoded: read back again on the next power-up
+  }
   gpsLoopActive = false;
   return gpsFixObtained;
 }
 
 void gps_request_abort() {
   gpsAbortRequested = true;
+  if (g_sentenceQueue != nullptr) {
+    NmeaSentence wake = {};
+    xQueueSend(g_sentenceQueue, &wake, 0); // Unblock gps_get_fix() at once
+  }
 }
 
 bool gps_is_active() {
   return gpsLoopActive;
 }
+
+uint32_t gps_utc_to_epoch(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second) {
+  if (year < 1970 || month < 1 || month > 12 || day < 1) {
+    return 0;
+  }
+  // Days since 1970-01-01 (civil-from-days inverse, valid for the Gregorian calendar)
+  int32_t y = static_cast<int32_t>(year) - (month <= 2 ? 1 : 0);
+  int32_t era = y / 400;
+  uint32_t yoe = static_cast<uint32_t>(y - era * 400);
+  uint32_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  uint32_t days = static_cast<uint32_t>(era * 146097 + static_cast<int32_t>(doe) - 719468);
+  return days * 86400UL + hour * 3600UL + minute * 60UL + second;
+}
+
+uint32_t gps_estimated_epoch() {
+  float accS = 0;
+  return static_cast<uint32_t>(estimate_utc_now(accS));
+}
+
+uint32_t gps_timestamp_epoch() {
+  if (gpsYear == 0) {
+    return 0;
+  }
+  return gps_utc_to_epoch(gpsYear, gpsMonth, gpsDay, gpsHour, gpsMinute, gpsSecond);
+}
@@ -4,6 +4,12 @@
 #include <TinyGPSPlus.h>
 #include <HardwareSerial.h> // Include HardwareSerial for ESP32
 
+// Receiver a fix came from
+enum class GnssSource : uint8_t {
+  External, // L76K on SerialGPS
+  Modem,    // A7670's own GNSS, while the bring-up has the modem up (MODEM_GNSS_ASSIST)
+};
+
 // Global GPS objects
 extern HardwareSerial SerialGPS;
 extern TinyGPSPlus gps;
@@ -14,7 +20,9 @@ extern int gpsSats;
 extern uint16_t gpsYear;
 extern uint8_t gpsMonth, gpsDay, gpsHour, gpsMinute, gpsSecond;
 extern bool gpsFixObtained;
+extern GnssSource gpsFixSource;
 extern int minSatellitesForFix;
+extern int fixAccuracyTargetM;
 
 // Function to power up the GPS module
 void gps_power_up();
@@ -22,15 +30,40 @@ void gps_power_up();
 // Function to power down the GPS module
 void gps_power_down();
 
+// Wake a receiver left in standby (hot start). A freshly powered one is switched to
+// RMC + GGA (+ GSA/GSV, GPS_SATELLITE_SENTENCES) at GPS_FAST_BAUD_RATE (verified by reading back, 9600 baud fallback) and
+// aided with the last position and the time carried through deep sleep.
+// Call after gps_init_serial().
+void gps_start_receiver();
+
+// Put the receiver into standby ($PCAS12): navigation stops, time and ephemeris are kept.
+// Call before gps_close_serial(); gps_prepare_deep_sleep() decides whether the rail stays up.
+void gps_enter_standby();
+
+// Before deep sleep: hold the GPS rail for sleeps up to GPS_STANDBY_MAX_SLEEP_S,
+// power the receiver off otherwise, and carry the time estimate to the next wake
+void gps_prepare_deep_sleep(uint64_t seconds);
+
 // Function to initialize SoftwareSerial for GPS communication
 void gps_init_serial();
 
 // Function to close SoftwareSerial for GPS communication
 void gps_close_serial();
 
-// Function to wait for and get a GPS fix
+// Wait for a GPS fix whose estimated error meets fixAccuracyTargetM (see fix_quality.h).
+// Falls back to the best estimate GPS_QUALITY_MAX_WAIT_MS after the first usable sample.
+// While the modem GNSS runs it is polled too; a cross-checked modem fix can end the wait.
 bool gps_get_fix(unsigned long timeout);
 
+// Convert a UTC calendar time to epoch seconds (0 for years before 1970)
+uint32_t gps_utc_to_epoch(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second);
+
+// Epoch seconds of the last stored GPS fix time, 0 if no valid date was received
+uint32_t gps_timestamp_epoch();
+
+// UTC now from this wake's fix or the time carried through a timer-woken sleep, 0 if unknown
+uint32_t gps_estimated_epoch();
+
 // Function to display and store GPS information
 void gps_display_and_store_info();
 
@@ -7,6 +7,9 @@
 #include "file_system.h"
 #include "gps_control.h"
 #include "modem_control.h"
+#include "track_compress.h"
+#include "motion_gate.h"
+#include "adaptive_interval.h"
 
 // Global variables (declared extern in respective headers)
 extern String deviceID;
@@ -21,9 +24,24 @@ extern uint8_t gpsMonth, gpsDay, gpsHour, gpsMinute, gpsSecond;
 
 RTC_DATA_ATTR int cycleCounter = 0; // Counts boot cycles, survives deep sleep
 
+// Status-only records use this time when the GPS never reported one (2000-01-01T00:00:00Z)
+const uint32_t STATUS_RECORD_FALLBACK_EPOCH = 946684800UL;
+
 // Forward declaration for the main work cycle function
 void work_cycle();
 
+// Snapshot of the current GPS values as a cache record
+CacheRecord build_cache_record(bool withPowerStatus, uint32_t fallbackTimestamp) {
+  uint32_t timestamp = gps_timestamp_epoch();
+  CacheRecord record = fs_make_cache_record(gpsLat, gpsLon, gpsSpd, gpsAlt, gpsHdop, gpsSats,
+                                            timestamp != 0 ? timestamp : fallbackTimestamp);
+  if (withPowerStatus) {
+    record.flags |= CACHE_RECORD_FLAG_POWER_STATUS;
+    record.powerStatus = static_cast<uint8_t>(power_status_get());
+  }
+  return record;
+}
+
 void setup() {
   // 1. Hold power ON
   power_on();
@@ -97,6 +115,7 @@ void setup() {
     case ESP_SLEEP_WAKEUP_UNDEFINED: DBG_PRINTLN(F("[BOOT] Power-on reset or undefined wakeup cause.")); break;
     default: DBG_PRINTF("[BOOT] Wakeup cause: %d\n", wakeup_cause); break;
   }
+  motion_gate_begin(); // Moving or still, from the IMU wake-on-motion (IMU_MOTION_GATING)
 
   // Start the main work cycle
   work_cycle();
@@ -108,8 +127,9 @@ void setup() {
     return;
   }
   if (isRegistered) {
-    DBG_PRINT(F("[MAIN] Device is registered. Next update in approx. ")); DBG_PRINT(sleepTimeSeconds); DBG_PRINTLN(F(" seconds."));
-    enter_deep_sleep(sleepTimeSeconds);
+    uint64_t sleepSeconds = motion_gate_sleep_seconds(adaptive_interval_next(sleepTimeSeconds));
+    DBG_PRINT(F("[MAIN] Device is registered. Next update in approx. ")); DBG_PRINT(sleepSeconds); DBG_PRINTLN(F(" seconds."));
+    enter_deep_sleep(sleepSeconds);
   } else {
     DBG_PRINTLN(F("[MAIN] DEVICE NOT REGISTERED. Powering down permanently."));
     DBG_PRINTLN(F("[MAIN] Please use OTA mode to register the device."));
@@ -148,14 +168,24 @@ void work_cycle() {
   DBG_PRINT(F("[MAIN] Device ID (last 10 of MAC): "));
   DBG_PRINTLN(deviceID);
 
-  // 2. Get GPS Data
-  if (power_instruction_get() != PowerInstruction::TurnOff) {
+  // 2. Get GPS Data (skipped while the IMU reports the device stationary)
+  bool modemBringUpStarted = false;
+  bool gnssWanted = motion_gate_gnss_needed(gps_estimated_epoch() != 0);
+  if (power_instruction_get() != PowerInstruction::TurnOff && gnssWanted) {
+    // If this cycle will end with a send, attach to the network while the GPS acquires.
+    // A fix the simplifier may hold back is not counted on.
+    if (PIPELINE_MODEM_WITH_GPS &&
+        (fs_get_cache_record_count() + (track_compress_active() ? 0 : 1) >= static_cast<size_t>(batchSizeThreshold) ||
+         power_status_report_pending())) {
+      modemBringUpStarted = modem_bringup_start(apn, gprsUser, gprsPass);
+    }
     DBG_PRINTLN(F("[MAIN] --- Initializing External GPS ---"));
     gps_power_up();
     gps_init_serial();
+    gps_start_receiver(); // Wake from standby or aid with the last position and time
     gps_get_fix(GPS_ACQUISITION_TIMEOUT_MS); // Button presses are handled by ISR now
-    gps_close_serial(); // De-initialize serial pins before cutting power
-    gps_power_down(); // Power down GPS immediately after fix attempt
+    gps_enter_standby(); // Stop navigation at once; the rail is decided before deep sleep
+    gps_close_serial();
     if (shutdown_is_requested()) {
       DBG_PRINTLN(F("[MAIN] Shutdown requested after GPS stage. Aborting work cycle."));
       return;
@@ -166,57 +196,27 @@ void work_cycle() {
 
   bool statusAckQueued = false;
 
-  // 3. Cache the data point if a fix was obtained
+  // 3. Cache the data point if a fix was obtained (through the track simplifier)
   if (gpsFixObtained) {
-    JsonDocument jsonDoc;
-    jsonDoc["device"] = deviceID;
-    jsonDoc["name"] = deviceName;
-    jsonDoc["latitude"] = gpsLat;
-    jsonDoc["longitude"] = gpsLon;
-    jsonDoc["speed"] = gpsSpd;
-    jsonDoc["altitude"] = gpsAlt;
-    jsonDoc["accuracy"] = gpsHdop;
-    jsonDoc["satellites"] = gpsSats;
-    if (gpsYear != 0) {
-      char timestamp[25];
-      sprintf(timestamp, "%04d-%02d-%02dT%02d:%02d:%02dZ", gpsYear, gpsMonth, gpsDay, gpsHour, gpsMinute, gpsSecond);
-      jsonDoc["timestamp"] = timestamp;
-    }
-    if (power_status_report_pending()) {
-      jsonDoc["power_status"] = power_status_to_string(power_status_get());
+    bool withPowerStatus = power_status_report_pending();
+    track_compress_add(build_cache_record(withPowerStatus, 0));
+    adaptive_interval_add_fix(gpsLat, gpsLon, gpsSpd, gps_timestamp_epoch());
+    if (withPowerStatus) {
       statusAckQueued = true;
     }
-    String jsonData;
-    serializeJson(jsonDoc, jsonData);
-    append_to_cache(jsonData);
     cycleCounter++;
     DBG_PRINTF("[MAIN] Cycle %d complete. Batch size will be determined by server.\n", cycleCounter);
+  } else if (!gnssWanted && track_compress_heartbeat(gps_estimated_epoch())) {
+    cycleCounter++; // Stationary heartbeat: the open dwell now lasts until this wake
   }
 
   bool statusReportPending = power_status_report_pending();
+  // Fixes held back by the simplifier stay out of the count: an upload would not carry them
   size_t cachedRecordCount = fs_get_cache_record_count();
 
   if (!gpsFixObtained && statusReportPending) {
-    JsonDocument statusDoc;
-    statusDoc["device"] = deviceID;
-    statusDoc["name"] = deviceName;
-    statusDoc["latitude"] = gpsLat;
-    statusDoc["longitude"] = gpsLon;
-    statusDoc["speed"] = gpsSpd;
-    statusDoc["altitude"] = gpsAlt;
-    statusDoc["accuracy"] = gpsHdop;
-    statusDoc["satellites"] = gpsSats;
-    if (gpsYear != 0) {
-      char timestamp[25];
-      sprintf(timestamp, "%04d-%02d-%02dT%02d:%02d:%02dZ", gpsYear, gpsMonth, gpsDay, gpsHour, gpsMinute, gpsSecond);
-      statusDoc["timestamp"] = timestamp;
-    } else {
-      statusDoc["timestamp"] = "2000-01-01T00:00:00Z";
-    }
-    statusDoc["power_status"] = power_status_to_string(power_status_get());
-    String statusJson;
-    serializeJson(statusDoc, statusJson);
-    append_to_cache(statusJson);
+    track_compress_flush(); // Held fixes are older than the status record
+    append_to_cache(build_cache_record(true, STATUS_RECORD_FALLBACK_EPOCH));
     statusAckQueued = true;
     cachedRecordCount = fs_get_cache_record_count(); // Re-count after adding status
   }
@@ -225,16 +225,26 @@ void work_cycle() {
   // Only initiate modem session if batch threshold is met OR there's an urgent power status report to send
   if (shutdown_is_requested()) {
     DBG_PRINTLN(F("[MAIN] Shutdown requested before modem session. Skipping network operations."));
-  } else if (cachedRecordCount >= batchSizeThreshold || statusReportPending || power_instruction_get() == PowerInstruction::TurnOff) {
+  } else if (cachedRecordCount >= batchSizeThreshold || statusReportPending ||
+             power_instruction_get() == PowerInstruction::TurnOff || modemBringUpStarted) {
+    // A started bring-up is used even if the fix failed; the modem is already up
     DBG_PRINTLN(F("[MAIN] Starting modem session (handshake + optional upload)."));
     bool modemInitialized = false;
     bool gprsConnected = false;
 
-    if (modem_initialize()) {
+    if (modemBringUpStarted ? modem_bringup_wait_initialized() : modem_initialize()) {
       modemInitialized = true;
-      if (modem_connect_gprs(apn, gprsUser, gprsPass)) {
+      if (modemBringUpStarted ? modem_bringup_wait_connected() : modem_connect_gprs(apn, gprsUser, gprsPass)) {
         gprsConnected = true;
-        bool handshakeSuccess = modem_perform_handshake();
+        // One request carrying the handshake and the first batch; servers without
+        // RESOURCE_SYNC get the separate handshake followed by the upload below
+        bool handshakeSuccess;
+        SyncResult syncResult = fs_sync_with_server();
+        if (syncResult == SyncResult::Unsupported) {
+          handshakeSuccess = modem_perform_handshake();
+        } else {
+          handshakeSuccess = syncResult == SyncResult::Done;
+        }
         if (!handshakeSuccess) {
           DBG_PRINTLN(F("[MAIN] Handshake did not complete successfully."));
         } else {
@@ -258,26 +268,8 @@ void work_cycle() {
         }
 
         if (power_status_report_pending() && !statusAckQueued) {
-          JsonDocument statusDoc;
-          statusDoc["device"] = deviceID;
-          statusDoc["name"] = deviceName;
-          statusDoc["latitude"] = gpsLat;
-          statusDoc["longitude"] = gpsLon;
-          statusDoc["speed"] = gpsSpd;
-          statusDoc["altitude"] = gpsAlt;
-          statusDoc["accuracy"] = gpsHdop;
-          statusDoc["satellites"] = gpsSats;
-          if (gpsYear != 0) {
-            char timestamp[25];
-            sprintf(timestamp, "%04d-%02d-%02dT%02d:%02d:%02dZ", gpsYear, gpsMonth, gpsDay, gpsHour, gpsMinute, gpsSecond);
-            statusDoc["timestamp"] = timestamp;
-          } else {
-            statusDoc["timestamp"] = "2000-01-01T00:00:00Z";
-          }
-          statusDoc["power_status"] = power_status_to_string(power_status_get());
-          String statusJson;
-          serializeJson(statusDoc, statusJson);
-          append_to_cache(statusJson);
+          track_compress_flush();
+          append_to_cache(build_cache_record(true, STATUS_RECORD_FALLBACK_EPOCH));
           statusAckQueued = true;
         }
 
@@ -290,15 +282,13 @@ void work_cycle() {
         } else {
           DBG_PRINTLN(F("[MAIN] No data pending after handshake."));
         }
-
-        modem_disconnect_gprs();
-        gprsConnected = false;
       } else {
         DBG_PRINTLN(F("[MAIN] Failed to connect to GPRS. Data remains cached."));
       }
 
-      modem_power_off();
+      modem_park(); // PSM if granted, otherwise disconnect and power-off
       modemInitialized = false;
+      gprsConnected = false;
     } else {
       DBG_PRINTLN(F("[MAIN] Failed to initialize modem for network session."));
     }
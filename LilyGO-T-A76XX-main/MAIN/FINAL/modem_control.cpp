@@ -3,16 +3,21 @@
 #include <TinyGsmClient.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/event_groups.h"
 #include "power_management.h"
 #include "file_system.h"
+#include "batch_tuning.h"
+#include "socket_http.h"
+#include "modem_serial.h"
 
 // Global modem objects
+ModemSerial g_modemSerial(SerialAT);
 #ifdef DUMP_AT_COMMANDS
 #include <StreamDebugger.h>
-StreamDebugger debugger(SerialAT, SerialMon);
+StreamDebugger debugger(g_modemSerial, SerialMon);
 TinyGsm g_modem(debugger);
 #else
-TinyGsm g_modem(SerialAT);
+TinyGsm g_modem(g_modemSerial);
 #endif
 TinyGsmClient g_client(g_modem);
 
@@ -22,10 +27,163 @@ SemaphoreHandle_t g_modem_mutex = nullptr;
 bool g_modem_initialized = false;
 bool g_modem_gprs_connected = false;
 
+// Background bring-up (modem_bringup_start): the task reports each step through these bits
+const EventBits_t BRINGUP_INIT_DONE = BIT0;
+const EventBits_t BRINGUP_INIT_OK = BIT1;
+const EventBits_t BRINGUP_GPRS_DONE = BIT2;
+const EventBits_t BRINGUP_GPRS_OK = BIT3;
+EventGroupHandle_t g_bringup_events = nullptr;
+TaskHandle_t g_bringup_task = nullptr;
+String g_bringup_apn;
+String g_bringup_user;
+String g_bringup_pass;
+
+#if MODEM_HTTP_TRANSPORT == MODEM_HTTP_TRANSPORT_AT
+// HTTP(S) service context shared by all POSTs of one GPRS session. +HTTPINIT, the SSL
+// and content-type parameters are set up once; the URL is only re-sent when it changes.
+struct HttpSession {
+  bool open = false;
+  String url;
+};
+HttpSession g_http_session;
+#endif
+
+// POSTs written by modem_post_begin() whose response modem_post_finish() has not taken
+// yet, oldest first. The AT service answers within the request, so its status waits here
+// (the body stays in the modem until it is read with +HTTPREAD).
+struct PendingPost {
+  size_t length;
+  unsigned long startMs;
+#if MODEM_HTTP_TRANSPORT == MODEM_HTTP_TRANSPORT_AT
+  int statusCode;
+#endif
+};
+const uint8_t POST_SLOTS = MODEM_HTTP_TRANSPORT == MODEM_HTTP_TRANSPORT_SOCKET ? MODEM_HTTP_PIPELINE_DEPTH : 1;
+PendingPost g_posts[POST_SLOTS];
+uint8_t g_postFirst = 0;
+uint8_t g_postCount = 0;
+unsigned long g_lastResponseMs = 0;
+
+// Power-on bookkeeping across deep sleep, so a wake after a clean session can skip the
+// probing sequence and most of init() (modem_initialize)
+const uint32_t MODEM_RTC_MAGIC = 0x4D443033; // "MD03"
+
+enum class ModemPowerState : uint8_t {
+  Unknown, // First boot, or the last power-on/off did not complete
+  Off,     // Switched off with +CPOF
+  On,      // Still powered when the ESP32 went to sleep
+  Psm      // Registered in PSM, rail held through the sleep (modem_park)
+};
+
+struct ModemRtcState {
+  uint32_t magic;
+  ModemPowerState power;
+  bool configured;  // A full init() passed on this module
+  bool registered;  // The last network wait ended registered
+  bool netOpen;     // Parked in PSM with the socket service (+NETOPEN) still open
+  uint32_t baud;    // AT link rate while the modem stays powered (On, Psm)
+  bool fastBaudFailed; // No answer at MODEM_FAST_BAUD_RATE on this board: not tried again
+  char model[24];
+  char imei[16];
+};
+
+RTC_DATA_ATTR ModemRtcState g_modem_rtc;
+
+ModemRtcState& modem_rtc_state() {
+  if (g_modem_rtc.magic != MODEM_RTC_MAGIC) {
+    g_modem_rtc = {};
+    g_modem_rtc.magic = MODEM_RTC_MAGIC;
+  }
+  return g_modem_rtc;
+}
+
+// Modem GNSS (MODEM_GNSS_ASSIST): powered by the bring-up task, read by the GPS stage
+RTC_DATA_ATTR bool g_gnss_unsupported = false; // +CGNSSPWR refused: this module has no GNSS
+volatile bool g_gnss_wanted = false;           // The GPS stage is still waiting for a fix
+volatile bool g_gnss_on = false;
+
+void modem_gnss_begin();
+void modem_gnss_bringup_done(bool connected);
+
+void modem_bringup_task(void* parameter) {
+  (void)parameter;
+  bool initialized = modem_initialize();
+  xEventGroupSetBits(g_bringup_events, BRINGUP_INIT_DONE | (initialized ? BRINGUP_INIT_OK : 0));
+  if (initialized && g_gnss_wanted) {
+    modem_gnss_begin();
+  }
+  bool connected = initialized && modem_connect_gprs(g_bringup_apn, g_bringup_user, g_bringup_pass);
+  modem_gnss_bringup_done(connected);
+  xEventGroupSetBits(g_bringup_events, BRINGUP_GPRS_DONE | (connected ? BRINGUP_GPRS_OK : 0));
+  g_bringup_task = nullptr;
+  vTaskDelete(nullptr);
+}
+
+bool modem_bringup_wait(EventBits_t doneBit, EventBits_t okBit) {
+  if (g_bringup_events == nullptr) {
+    return false;
+  }
+  EventBits_t bits = xEventGroupWaitBits(g_bringup_events, doneBit, pdFALSE, pdTRUE,
+                                         pdMS_TO_TICKS(MODEM_BRINGUP_TIMEOUT_MS));
+  if (!(bits & doneBit)) {
+    DBG_PRINTLN(F("[MODEM] Timed out waiting for background modem bring-up."));
+    return false;
+  }
+  return (bits & okBit) != 0;
+}
+
 inline void mark_modem_offline() {
   g_modem_initialized = false;
   g_modem_gprs_connected = false;
+#if MODEM_HTTP_TRANSPORT == MODEM_HTTP_TRANSPORT_AT
+  g_http_session = HttpSession();
+#else
+  socket_http_forget();
+#endif
+  g_postCount = 0;
+  g_gnss_on = false;
+}
+
+#if MODEM_HTTP_TRANSPORT == MODEM_HTTP_TRANSPORT_AT
+
+// Caller holds the modem lock
+bool http_session_open() {
+  if (g_http_session.open) {
+    return true;
+  }
+  DBG_PRINTLN(F("[MODEM] Opening HTTPS session..."));
+  if (!g_modem.https_begin()) {
+    DBG_PRINTLN(F("[MODEM] Failed to begin HTTPS session."));
+    return false;
+  }
+  if (!g_modem.https_set_content_type("application/json")) {
+    DBG_PRINTLN(F("[MODEM] Failed to set Content-Type."));
+    g_modem.https_end();
+    return false;
+  }
+  g_http_session.open = true;
+  return true;
+}
+
+// Caller holds the modem lock
+void http_session_close() {
+  if (!g_http_session.open) {
+    return;
+  }
+  DBG_PRINTLN(F("[MODEM] End HTTPS session."));
+  g_modem.https_end();
+  g_http_session = HttpSession();
+}
+#else
+// Caller holds the modem lock
+void http_session_close() {
+  if (socket_http_outstanding() > 0 || g_postCount > 0) {
+    DBG_PRINTLN(F("[MODEM] Dropping unanswered POSTs."));
+  }
+  socket_http_close();
+  g_postCount = 0;
 }
+#endif
 
 SemaphoreHandle_t get_modem_mutex() {
   if (g_modem_mutex == nullptr) {
@@ -57,41 +215,201 @@ class ModemLockGuard {
   SemaphoreHandle_t mutex_ = nullptr;
   bool locked_ = false;
 };
-} // namespace
 
-// Global variables (declared extern in modem_control.h and other modules)
-extern String apn;
-extern String gprsUser;
-extern String gprsPass;
-extern String server;
-extern int port;
-extern String deviceID;
-extern String deviceName;
-extern bool isRegistered;
-extern uint64_t sleepTimeSeconds;
-extern int minSatellitesForFix;
+// Registration is polled in MODEM_NETWORK_SLICE_MS slices with the lock released in
+// between, so the GPS stage can read the modem GNSS while the network attach runs
+bool wait_for_network(uint32_t timeout_ms) {
+  unsigned long start = millis();
+  while (millis() - start < timeout_ms) {
+    {
+      ModemLockGuard lock;
+      if (!lock.isLocked() || shutdown_is_requested()) {
+        return false;
+      }
+      if (g_modem.waitForNetwork(MODEM_NETWORK_SLICE_MS, true)) {
+        return true;
+      }
+    }
+    delay(1); // Let a task waiting for the lock take it
+  }
+  return false;
+}
 
-bool modem_initialize() {
+// Caller holds the modem lock
+void modem_gnss_power_off() {
+  if (!g_gnss_on) {
+    return;
+  }
+  g_modem.disableGPS();
+  g_gnss_on = false;
+  DBG_PRINTLN(F("[MODEM] Modem GNSS off."));
+}
+
+void modem_gnss_begin() {
   ModemLockGuard lock;
-  if (!lock.isLocked()) {
-    DBG_PRINTLN(F("[MODEM] Unable to acquire modem lock for initialization."));
-    return false;
+  if (!lock.isLocked() || g_gnss_on) {
+    return;
   }
-  if (shutdown_is_requested()) {
-    DBG_PRINTLN(F("[MODEM] Initialization skipped due to shutdown request."));
-    return false;
+  DBG_PRINTLN(F("[MODEM] Starting modem GNSS..."));
+  if (!g_modem.enableGPS()) {
+    g_gnss_unsupported = true;
+    DBG_PRINTLN(F("[MODEM] Modem GNSS not available. Not used until the next power-on."));
+    return;
   }
-  if (g_modem_initialized) {
-    DBG_PRINTLN(F("[MODEM] Modem already initialized."));
+  g_gnss_on = true;
+}
+
+// +CGNSSINFO: <mode>,<GPS-SVs>,<BEIDOU-SVs>,<GLONASS-SVs>,<GALILEO-SVs>,<lat>,<N/S>,<lon>,<E/W>,
+// <date>,<UTC-time>,<alt>,<speed>,<course>,<PDOP>,<HDOP>,<VDOP>,... (degrees, knots)
+bool parse_gnss_info(const String& line, ModemGnssFix& fix) {
+  const size_t FIELDS = 17;
+  char buffer[160];
+  const char* field[FIELDS];
+  size_t count = 0;
+  strncpy(buffer, line.c_str(), sizeof(buffer) - 1);
+  buffer[sizeof(buffer) - 1] = '\0';
+  field[count++] = buffer;
+  for (char* p = buffer; *p && count < FIELDS; ++p) {
+    if (*p == ',') {
+      *p = '\0';
+      field[count++] = p + 1;
+    }
+  }
+  int mode = atoi(field[0]);
+  if (count < FIELDS || (mode != 2 && mode != 3) || strlen(field[9]) != 6 || strlen(field[10]) < 6) {
+    return false; // No fix yet: the fields are empty
+  }
+  fix.sats = atoi(field[1]) + atoi(field[2]) + atoi(field[3]) + atoi(field[4]);
+  fix.lat = atof(field[5]) * (field[6][0] == 'S' ? -1 : 1);
+  fix.lon = atof(field[7]) * (field[8][0] == 'W' ? -1 : 1);
+  fix.day = (field[9][0] - '0') * 10 + (field[9][1] - '0');
+  fix.month = (field[9][2] - '0') * 10 + (field[9][3] - '0');
+  fix.year = 2000 + (field[9][4] - '0') * 10 + (field[9][5] - '0');
+  fix.hour = (field[10][0] - '0') * 10 + (field[10][1] - '0');
+  fix.minute = (field[10][2] - '0') * 10 + (field[10][3] - '0');
+  fix.second = (field[10][4] - '0') * 10 + (field[10][5] - '0');
+  fix.altM = atof(field[11]);
+  fix.speedKmh = atof(field[12]) * 1.852f;
+  fix.hdop = field[15][0] ? atof(field[15]) : -1.0f;
+  return true;
+}
+
+// After the attach: AGPS while the fix is still wanted, otherwise the GNSS is switched off
+void modem_gnss_bringup_done(bool connected) {
+  ModemLockGuard lock;
+  if (!lock.isLocked() || !g_gnss_on) {
+    return;
+  }
+  if (connected && g_gnss_wanted) {
+    DBG_PRINT(F("[MODEM] Loading AGPS data..."));
+    DBG_PRINTLN(g_modem.enableAGPS() ? F(" success") : F(" fail"));
+  }
+  if (!g_gnss_wanted) {
+    modem_gnss_power_off();
+  }
+}
+
+void pulse_pwrkey() {
+  pinMode(BOARD_PWRKEY_PIN, OUTPUT);
+  digitalWrite(BOARD_PWRKEY_PIN, HIGH);
+  delay(MODEM_PWRKEY_PULSE_MS);
+  digitalWrite(BOARD_PWRKEY_PIN, LOW);
+}
+
+// Parked in PSM: registration and PDP context are kept. The PWRKEY pulse ends PSM and the
+// UART answers again without a boot.
+bool modem_resume_from_psm() {
+  DBG_PRINTLN(F("[MODEM] Waking modem from PSM..."));
+  pulse_pwrkey();
+  if (g_modem.testAT(MODEM_PSM_RESUME_MS)) {
     return true;
   }
-  DBG_PRINTLN(F("[MODEM] Initializing modem..."));
+  DBG_PRINTLN(F("[MODEM] No answer after PSM. Powering on again."));
+  return false;
+}
 
-#ifdef BOARD_POWERON_PIN
-  pinMode(BOARD_POWERON_PIN, OUTPUT);
-  digitalWrite(BOARD_POWERON_PIN, HIGH);
-#endif
+// Caller holds the modem lock. +NETOPEN? answers 1 while the socket service runs
+bool modem_socket_service_open() {
+  g_modem.sendAT(GF("+NETOPEN?"));
+  int res = g_modem.waitResponse(GF("+NETOPEN: 1"), GF("+NETOPEN: 0"));
+  g_modem.waitResponse();
+  return res == 1;
+}
+
+// Caller holds the modem lock. Sent on every boot before the attach, so the network can
+// grant the timers with it; a module that refuses +CPSMS simply ends its sessions with +CPOF
+void modem_psm_request() {
+  if (!MODEM_PSM) {
+    return;
+  }
+  g_modem.sendAT(GF("+CPSMS=1,,,\""), MODEM_PSM_PERIODIC_TAU, GF("\",\""), MODEM_PSM_ACTIVE_TIME, '"');
+  if (g_modem.waitResponse() != 1) {
+    DBG_PRINTLN(F("[MODEM] +CPSMS refused."));
+    return;
+  }
+  g_modem.sendAT(GF("+CEDRXS=1,4,\""), MODEM_EDRX_CYCLE, '"');
+  g_modem.waitResponse(); // eDRX is optional
+}
+
+// Caller holds the modem lock. +CEREG: 4,<stat>,<tac>,<ci>,<AcT>,<cause>,<reject>,"<T3324>","<T3412>":
+// the active time is only reported when the network granted PSM ("111....." = deactivated)
+bool modem_psm_granted() {
+  g_modem.sendAT(GF("+CEREG=4"));
+  if (g_modem.waitResponse() != 1) {
+    return false;
+  }
+  g_modem.sendAT(GF("+CEREG?"));
+  String reply;
+  bool granted = false;
+  if (g_modem.waitResponse(1000L, reply) == 1) {
+    int at = reply.indexOf("+CEREG:");
+    int stat = -1;
+    String activeTime;
+    for (int field = 0, from = at + 7; at >= 0 && field <= 7; ++field) {
+      int comma = reply.indexOf(',', from);
+      int end = comma < 0 ? reply.indexOf('\r', from) : comma;
+      String value = reply.substring(from, end < 0 ? reply.length() : end);
+      value.trim();
+      if (field == 1) {
+        stat = value.toInt();
+      } else if (field == 7) {
+        activeTime = value;
+      }
+      if (comma < 0) {
+        break;
+      }
+      from = comma + 1;
+    }
+    granted = (stat == 1 || stat == 5) && activeTime.length() == 10 && !activeTime.startsWith("\"111");
+  }
+  g_modem.sendAT(GF("+CEREG=0"));
+  g_modem.waitResponse();
+  return granted;
+}
 
+// Modem known to be off: a short PWRKEY pulse, then the boot is taken from the *ATREADY /
+// +CPIN: READY URCs instead of fixed delays (SMS DONE and PB DONE are not needed for data).
+// An AT per slice catches a modem that was on after all.
+bool modem_power_on_fast() {
+  DBG_PRINTLN(F("[MODEM] Modem is off. Short PWRKEY pulse..."));
+  pulse_pwrkey();
+  unsigned long start = millis();
+  while (millis() - start < MODEM_BOOT_TIMEOUT_MS) {
+    if (shutdown_is_requested()) {
+      return false;
+    }
+    g_modem.sendAT(GF(""));
+    if (g_modem.waitResponse(MODEM_BOOT_SLICE_MS, GF("*ATREADY"), GF("+CPIN: READY"), GFP(GSM_OK)) > 0) {
+      DBG_PRINTF("[MODEM] Modem up after %lu ms.\n", millis() - start);
+      return true;
+    }
+  }
+  DBG_PRINTLN(F("[MODEM] No boot URC. Falling back to the full power-on sequence."));
+  return false;
+}
+
+// State unknown (first boot, failed session): probe, reset, then PWRKEY up to twice
+bool modem_power_on_probing() {
   // Helper lambda to toggle PWRKEY
   auto togglePwrKey = []() {
     DBG_PRINTLN(F("[MODEM] Toggling PWRKEY..."));
@@ -117,64 +435,211 @@ bool modem_initialize() {
       return false;
   };
 
-  // Initialize SerialAT immediately
-  SerialAT.begin(115200, SERIAL_8N1, MODEM_RX_PIN, MODEM_TX_PIN);
+  // Check 1: Already ON? (Quick check; it may still run at the fast rate of a lost session)
+  if (g_modem.testAT(500)) {
+      DBG_PRINTLN(F("[MODEM] Modem responded to AT. It is already ON."));
+      return true;
+  }
+  if (MODEM_FAST_BAUD_RATE != MODEM_BAUD_RATE && !modem_rtc_state().fastBaudFailed) {
+    g_modemSerial.setBaud(MODEM_FAST_BAUD_RATE);
+    if (g_modem.testAT(MODEM_BAUD_VERIFY_MS)) {
+      DBG_PRINTF("[MODEM] Modem responded at %lu baud. It is already ON.\n",
+                 static_cast<unsigned long>(MODEM_FAST_BAUD_RATE));
+      return true;
+    }
+    g_modemSerial.setBaud(MODEM_BAUD_RATE);
+  }
+  DBG_PRINTLN(F("[MODEM] No response. Performing Power-On sequence (Attempt 1)..."));
+
+  #ifdef MODEM_RESET_PIN
+  DBG_PRINTLN(F("[MODEM] Resetting modem..."));
+  pinMode(MODEM_RESET_PIN, OUTPUT);
+  digitalWrite(MODEM_RESET_PIN, !MODEM_RESET_LEVEL);
   delay(100);
+  digitalWrite(MODEM_RESET_PIN, MODEM_RESET_LEVEL);
+  delay(2600);
+  digitalWrite(MODEM_RESET_PIN, !MODEM_RESET_LEVEL);
+  delay(500);
+  #endif
 
-  bool modemReady = false;
+  togglePwrKey();
 
-  // Check 1: Already ON? (Quick check)
-  if (g_modem.testAT(500)) {
-      DBG_PRINTLN(F("[MODEM] Modem responded to AT. It is already ON."));
-      modemReady = true;
-  } else {
-      DBG_PRINTLN(F("[MODEM] No response. Performing Power-On sequence (Attempt 1)..."));
-      
-      #ifdef MODEM_RESET_PIN
-      DBG_PRINTLN(F("[MODEM] Resetting modem..."));
-      pinMode(MODEM_RESET_PIN, OUTPUT);
-      digitalWrite(MODEM_RESET_PIN, !MODEM_RESET_LEVEL);
-      delay(100);
-      digitalWrite(MODEM_RESET_PIN, MODEM_RESET_LEVEL);
-      delay(2600);
-      digitalWrite(MODEM_RESET_PIN, !MODEM_RESET_LEVEL);
-      delay(500);
-      #endif
-
-      togglePwrKey();
-      
-      // Adaptive wait for boot (up to 10 seconds)
-      if (waitForModemToBoot(10000)) {
-          modemReady = true;
-      } else {
-          // Re-init serial just in case
-          SerialAT.begin(115200, SERIAL_8N1, MODEM_RX_PIN, MODEM_TX_PIN);
-          delay(500);
-
-          DBG_PRINTLN(F("\n[MODEM] Still no response. We might have turned it OFF. Toggling PWRKEY again (Attempt 2)..."));
-          togglePwrKey();
-          
-          // Adaptive wait for boot (up to 10 seconds)
-          if (waitForModemToBoot(10000)) {
-             modemReady = true;
-          }
-      }
+  // Adaptive wait for boot (up to 10 seconds)
+  if (waitForModemToBoot(10000)) {
+      return true;
+  }
+  // Re-init serial just in case
+  g_modemSerial.begin(MODEM_BAUD_RATE, MODEM_RX_PIN, MODEM_TX_PIN, MODEM_UART_RX_BUFFER);
+  delay(500);
+
+  DBG_PRINTLN(F("\n[MODEM] Still no response. We might have turned it OFF. Toggling PWRKEY again (Attempt 2)..."));
+  togglePwrKey();
+
+  // Adaptive wait for boot (up to 10 seconds)
+  return waitForModemToBoot(10000);
+}
+
+// Caller holds the modem lock. Moves the AT link to MODEM_FAST_BAUD_RATE; if the modem does
+// not answer there, both sides go back to MODEM_BAUD_RATE. False only if the link is lost.
+bool modem_raise_baud() {
+  ModemRtcState& rtc = modem_rtc_state();
+  if (MODEM_FAST_BAUD_RATE == MODEM_BAUD_RATE || g_modemSerial.baud() == MODEM_FAST_BAUD_RATE ||
+      rtc.fastBaudFailed) {
+    rtc.baud = g_modemSerial.baud();
+    return true;
   }
+  g_modem.sendAT(GF("+IPR="), MODEM_FAST_BAUD_RATE);
+  if (g_modem.waitResponse() != 1) {
+    DBG_PRINTF("[MODEM] +IPR=%lu refused. Staying at %lu baud.\n", static_cast<unsigned long>(MODEM_FAST_BAUD_RATE),
+               static_cast<unsigned long>(g_modemSerial.baud()));
+    rtc.baud = g_modemSerial.baud();
+    return true;
+  }
+  g_modemSerial.setBaud(MODEM_FAST_BAUD_RATE);
+  if (g_modem.testAT(MODEM_BAUD_VERIFY_MS)) {
+    DBG_PRINTF("[MODEM] AT link at %lu baud.\n", static_cast<unsigned long>(MODEM_FAST_BAUD_RATE));
+    rtc.baud = MODEM_FAST_BAUD_RATE;
+    return true;
+  }
+  // No answer at the new rate: the modem may still hear it, so ask it back before following
+  DBG_PRINTF("[MODEM] No answer at %lu baud. Back to %lu.\n", static_cast<unsigned long>(MODEM_FAST_BAUD_RATE),
+             static_cast<unsigned long>(MODEM_BAUD_RATE));
+  g_modem.sendAT(GF("+IPR="), MODEM_BAUD_RATE);
+  g_modem.waitResponse(MODEM_BAUD_VERIFY_MS);
+  g_modemSerial.setBaud(MODEM_BAUD_RATE);
+  rtc.baud = MODEM_BAUD_RATE;
+  rtc.fastBaudFailed = true;
+  return g_modem.testAT(MODEM_BAUD_VERIFY_MS);
+}
+
+// Last step of modem_initialize(), once the module is set up (a +CRESET in init() would
+// drop the rate again). If the link is lost, the modem is restarted at the default rate;
+// the settings of init() are kept by the module, only the echo and the PSM request are redone.
+bool modem_link_ready() {
+  if (!modem_raise_baud()) {
+    DBG_PRINTLN(F("[MODEM] AT link lost while changing the baud rate. Restarting the modem."));
+    if (!modem_power_on_probing()) {
+      modem_rtc_state().power = ModemPowerState::Unknown;
+      mark_modem_offline();
+      return false;
+    }
+    g_modem.sendAT(GF("E0"));
+    g_modem.waitResponse();
+    modem_psm_request();
+  }
+  g_modem_initialized = true;
+  return true;
+}
+
+// "Model: A7670E-LASE" / "IMEI: 8612..." out of the one-line ATI answer
+void copy_info_field(const String& info, const char* key, char* out, size_t size) {
+  int from = info.indexOf(key);
+  if (from < 0) {
+    out[0] = '\0';
+    return;
+  }
+  from += strlen(key);
+  int to = info.indexOf(' ', from);
+  String value = info.substring(from, to < 0 ? info.length() : to);
+  strncpy(out, value.c_str(), size - 1);
+  out[size - 1] = '\0';
+}
+} // namespace
+
+// Global variables (declared extern in modem_control.h and other modules)
+extern String apn;
+extern String gprsUser;
+extern String gprsPass;
+extern String server;
+extern int port;
+extern String deviceID;
+extern String deviceName;
+extern bool isRegistered;
+extern uint64_t sleepTimeSeconds;
+extern int minSatellitesForFix;
+
+bool modem_initialize() {
+  ModemLockGuard lock;
+  if (!lock.isLocked()) {
+    DBG_PRINTLN(F("[MODEM] Unable to acquire modem lock for initialization."));
+    return false;
+  }
+  if (shutdown_is_requested()) {
+    DBG_PRINTLN(F("[MODEM] Initialization skipped due to shutdown request."));
+    return false;
+  }
+  if (g_modem_initialized) {
+    DBG_PRINTLN(F("[MODEM] Modem already initialized."));
+    return true;
+  }
+  DBG_PRINTLN(F("[MODEM] Initializing modem..."));
+  batch_tuning_session_begin();
+  ModemRtcState& rtc = modem_rtc_state();
+
+#ifdef BOARD_POWERON_PIN
+  pinMode(BOARD_POWERON_PIN, OUTPUT);
+  digitalWrite(BOARD_POWERON_PIN, HIGH);
+#endif
 
+  // Initialize SerialAT immediately, at the rate a modem still powered was left at
+  bool kept = rtc.power == ModemPowerState::Psm || rtc.power == ModemPowerState::On;
+  g_modemSerial.begin(kept && rtc.baud != 0 ? rtc.baud : MODEM_BAUD_RATE, MODEM_RX_PIN, MODEM_TX_PIN,
+                      MODEM_UART_RX_BUFFER);
+
+  bool modemReady = false;
+  bool resumed = false;
+  if (rtc.power == ModemPowerState::Psm) {
+    resumed = modemReady = modem_resume_from_psm();
+  } else if (rtc.power == ModemPowerState::On && g_modem.testAT(MODEM_RESUME_PROBE_MS)) {
+    DBG_PRINTLN(F("[MODEM] Modem kept running across the sleep."));
+    modemReady = true;
+  } else if (rtc.power != ModemPowerState::Unknown) {
+    g_modemSerial.setBaud(MODEM_BAUD_RATE); // A fresh boot starts at the default rate
+    modemReady = modem_power_on_fast();
+  }
+  if (!modemReady && !shutdown_is_requested()) {
+    g_modemSerial.setBaud(MODEM_BAUD_RATE);
+    delay(100);
+    modemReady = modem_power_on_probing();
+  }
   if (!modemReady) {
       DBG_PRINTLN(F("\n[MODEM] Failed to power on modem after two attempts."));
+      rtc.power = ModemPowerState::Unknown;
       mark_modem_offline();
       return false;
   }
+  rtc.power = ModemPowerState::On;
 
   DBG_PRINTLN(F("\n[MODEM] AT command responded."));
 
+  if (!resumed) {
+    rtc.netOpen = false; // A boot closes the socket service
+  }
+  if (resumed) {
+    DBG_PRINTF("[MODEM] Resumed from PSM: %s, IMEI %s, still registered.\n", rtc.model, rtc.imei);
+    return modem_link_ready(); // The module did not reboot; all settings are still in place
+  }
+
+  // Everything init() sets up besides the echo survives a power cycle (+CTZU is kept in
+  // NVM, +CTZR is off by default), so after a good session only ATE0 is repeated
+  if (rtc.configured && rtc.registered) {
+    g_modem.sendAT(GF("E0"));
+    if (g_modem.waitResponse() == 1) {
+      DBG_PRINTF("[MODEM] Warm start: %s, IMEI %s (cached).\n", rtc.model, rtc.imei);
+      modem_psm_request();
+      return modem_link_ready();
+    }
+    DBG_PRINTLN(F("[MODEM] Warm start refused. Full init."));
+    rtc.configured = false;
+  }
+
   DBG_PRINTLN(F("[MODEM] Initializing modem with modem.init()..."));
   if (!g_modem.init()) {
     DBG_PRINTLN(F("[MODEM] Modem init failed. Trying restart..."));
     delay(1000);
     if (!g_modem.restart()) {
       DBG_PRINTLN(F("[MODEM] Modem restart also failed!"));
+      rtc.power = ModemPowerState::Unknown;
       mark_modem_offline();
       return false;
     }
@@ -189,16 +654,14 @@ bool modem_initialize() {
   if (modemInfo.indexOf("A76") == -1) {
     DBG_PRINTLN(F("[MODEM] Warning: Modem info does not look like A76XX series."));
   }
-  g_modem_initialized = true;
-  return true;
+  copy_info_field(modemInfo, "Model: ", rtc.model, sizeof(rtc.model));
+  copy_info_field(modemInfo, "IMEI: ", rtc.imei, sizeof(rtc.imei));
+  rtc.configured = true;
+  modem_psm_request();
+  return modem_link_ready();
 }
 
 bool modem_connect_gprs(const String& apn_val, const String& user_val, const String& pass_val, uint32_t timeout_ms) {
-  ModemLockGuard lock;
-  if (!lock.isLocked()) {
-    DBG_PRINTLN(F("[MODEM] Unable to acquire modem lock for GPRS connect."));
-    return false;
-  }
   if (shutdown_is_requested()) {
     DBG_PRINTLN(F("[MODEM] GPRS connect skipped due to shutdown request."));
     return false;
@@ -208,13 +671,29 @@ bool modem_connect_gprs(const String& apn_val, const String& user_val, const Str
     return false;
   }
   DBG_PRINT(F("[MODEM] Waiting for network..."));
-  if (!g_modem.waitForNetwork(timeout_ms, true)) {
+  // A failed attach makes the next power-on run the full init() again
+  modem_rtc_state().registered = wait_for_network(timeout_ms);
+  if (!modem_rtc_state().registered) {
     DBG_PRINTLN(F(" fail"));
     g_modem_gprs_connected = false;
     return false;
   }
   DBG_PRINTLN(F(" success"));
 
+  ModemLockGuard lock;
+  if (!lock.isLocked()) {
+    DBG_PRINTLN(F("[MODEM] Unable to acquire modem lock for GPRS connect."));
+    return false;
+  }
+  if (modem_rtc_state().netOpen) {
+    // gprsConnect() would close and reopen the socket service kept through PSM
+    modem_rtc_state().netOpen = false;
+    if (modem_socket_service_open()) {
+      DBG_PRINTLN(F("[MODEM] Socket service still open after PSM."));
+      g_modem_gprs_connected = true;
+      return true;
+    }
+  }
   DBG_PRINT(F("[MODEM] Connecting to GPRS: "));
   DBG_PRINT(apn_val);
   if (!g_modem.gprsConnect(apn_val.c_str(), user_val.c_str(), pass_val.c_str())) {
@@ -229,30 +708,18 @@ bool modem_connect_gprs(const String& apn_val, const String& user_val, const Str
   return true;
 }
 
-String modem_send_post_request(const char* resource, const String& payload, int* statusCodeOut) {
-  ModemLockGuard lock;
-  if (!lock.isLocked()) {
-    DBG_PRINTLN(F("[MODEM] Unable to acquire modem lock for HTTPS POST."));
-    return "";
-  }
-  if (shutdown_is_requested()) {
-    DBG_PRINTLN(F("[MODEM] HTTPS POST skipped due to shutdown request."));
-    return "";
-  }
-  if (!g_modem_initialized) {
-    DBG_PRINTLN(F("[MODEM] Cannot perform HTTPS POST: modem not initialized."));
-    return "";
-  }
-  DBG_PRINT(F("[MODEM] Performing HTTPS POST to: "));
-  DBG_PRINTLN(resource);
-  DBG_PRINT(F("[MODEM] Payload: "));
-  DBG_PRINTLN(payload);
-
-  String response_body = "";
+namespace {
+bool write_string_body(Print& out, void* context) {
+  const String& body = *static_cast<const String*>(context);
+  return out.print(body) == body.length();
+}
 
-  if (!g_modem.https_begin()) {
-    DBG_PRINTLN(F("[MODEM] Failed to begin HTTPS session."));
-    return "";
+#if MODEM_HTTP_TRANSPORT == MODEM_HTTP_TRANSPORT_AT
+// One complete exchange through the HTTP(S) service; caller holds the modem lock
+int http_service_post(const char* resource, size_t length, HttpsBodyWriter writer, void* context,
+                      PendingPost& post) {
+  if (!http_session_open()) {
+    return 0;
   }
 
   // Build full URL adaptively based on configured port
@@ -264,25 +731,66 @@ String modem_send_post_request(const char* resource, const String& payload, int*
   }
   fullUrl += resource;
 
-  DBG_PRINT(F("[MODEM] Set URL: "));
-  DBG_PRINTLN(fullUrl);
-  if (!g_modem.https_set_url(fullUrl.c_str())) {
-    DBG_PRINTLN(F("[MODEM] Failed to set URL."));
-  g_modem.https_end();
-    return "";
+  if (fullUrl != g_http_session.url) {
+    DBG_PRINT(F("[MODEM] Set URL: "));
+    DBG_PRINTLN(fullUrl);
+    if (!g_modem.https_set_url(fullUrl.c_str())) {
+      DBG_PRINTLN(F("[MODEM] Failed to set URL."));
+      http_session_close();
+      return 0;
+    }
+    g_http_session.url = fullUrl;
   }
 
-  DBG_PRINTLN(F("[MODEM] Set Content-Type header..."));
-  if (!g_modem.https_set_content_type("application/json")) {
-    DBG_PRINTLN(F("[MODEM] Failed to set Content-Type."));
-  g_modem.https_end();
-    return "";
+  post.startMs = millis();
+  int statusCode = g_modem.https_post_stream(length, writer, context);
+  if (statusCode <= 0 && statusCode != TINYGSM_HTTP_BODY_INCOMPLETE) {
+    // The HTTP service state is unknown after a failed action; start clean next time
+    http_session_close();
   }
+  return statusCode;
+}
+#endif
 
-  DBG_PRINTLN(F("[MODEM] Sending POST request..."));
-  int statusCode = g_modem.https_post(payload);
-  if (statusCodeOut != nullptr) {
-    *statusCodeOut = statusCode;
+// Takes the response of the oldest POST begun. The body is parsed into `json` straight
+// from the modem when set, otherwise copied into `text` when set, otherwise dropped.
+int post_finish(JsonDocument* json, DeserializationError* jsonError, String* text) {
+  if (jsonError != nullptr) {
+    *jsonError = DeserializationError::EmptyInput;
+  }
+  ModemLockGuard lock;
+  if (!lock.isLocked() || g_postCount == 0) {
+    return 0;
+  }
+  PendingPost& post = g_posts[g_postFirst];
+  g_postFirst = (g_postFirst + 1) % POST_SLOTS;
+  g_postCount--;
+
+#if MODEM_HTTP_TRANSPORT == MODEM_HTTP_TRANSPORT_AT
+  int statusCode = post.statusCode;
+  if (statusCode > 0 && json != nullptr) {
+    TinyGsm::HttpsBodyStream body(g_modem);
+    DeserializationError error = deserializeJson(*json, body);
+    if (jsonError != nullptr) {
+      *jsonError = error;
+    }
+  } else if (statusCode > 0 && text != nullptr) {
+    *text = g_modem.https_body();
+  }
+#else
+  int statusCode = socket_http_response(json, jsonError, text);
+  if (statusCode <= 0) {
+    g_postCount = 0; // The socket was closed: the responses behind this one are lost as well
+  }
+#endif
+  if (statusCode > 0) {
+    // Pipelined requests overlap; each is charged only for the time after the previous answer
+    unsigned long from = post.startMs;
+    if (static_cast<long>(g_lastResponseMs - from) > 0) {
+      from = g_lastResponseMs;
+    }
+    g_lastResponseMs = millis();
+    batch_tuning_record_request(post.length, g_lastResponseMs - from);
   }
 
   if (statusCode <= 0) {
@@ -291,31 +799,122 @@ String modem_send_post_request(const char* resource, const String& payload, int*
   } else {
     DBG_PRINT(F("[MODEM] Response Status Code: "));
     DBG_PRINTLN(statusCode);
-    DBG_PRINTLN(F("[MODEM] Reading response body..."));
-  response_body = g_modem.https_body();
+    if (json != nullptr) {
+      DBG_PRINTF("[MODEM] Response body parsed: %s\n", jsonError != nullptr ? jsonError->c_str() : "-");
+    } else if (text != nullptr) {
+      DBG_PRINTLN(F("[MODEM] Response Body:"));
+      DBG_PRINTLN(*text);
+    }
+  }
+  return statusCode;
+}
+
+// Checks that a single request/response exchange may start; caller holds the modem lock
+bool post_exchange_allowed(const ModemLockGuard& lock) {
+  if (!lock.isLocked()) {
+    DBG_PRINTLN(F("[MODEM] Unable to acquire modem lock for HTTPS POST."));
+    return false;
+  }
+  if (g_postCount > 0) {
+    DBG_PRINTLN(F("[MODEM] HTTPS POST skipped: pipelined responses are outstanding."));
+    return false;
   }
+  return true;
+}
+}
 
-  DBG_PRINTLN(F("[MODEM] End HTTPS session."));
-  g_modem.https_end();
+String modem_send_post_request(const char* resource, const String& payload, int* statusCodeOut) {
+  DBG_PRINT(F("[MODEM] Payload: "));
+  DBG_PRINTLN(payload);
+  return modem_send_post_stream(resource, payload.length(), write_string_body,
+                                const_cast<String*>(&payload), statusCodeOut);
+}
 
-  DBG_PRINTLN(F("[MODEM] Response Body:"));
-  DBG_PRINTLN(response_body);
-  return response_body;
+String modem_send_post_stream(const char* resource, size_t length, HttpsBodyWriter writer, void* context, int* statusCodeOut) {
+  if (statusCodeOut != nullptr) {
+    *statusCodeOut = 0;
+  }
+  ModemLockGuard lock; // Keeps the request and its response together
+  if (!post_exchange_allowed(lock) || !modem_post_begin(resource, length, writer, context)) {
+    return "";
+  }
+  String response;
+  int statusCode = post_finish(nullptr, nullptr, &response);
+  if (statusCodeOut != nullptr) {
+    *statusCodeOut = statusCode;
+  }
+  return response;
 }
 
-bool modem_perform_handshake() {
-  JsonDocument payloadDoc;
+int modem_send_post_json(const char* resource, size_t length, HttpsBodyWriter writer, void* context,
+                         JsonDocument& responseDoc, DeserializationError* parseError) {
+  if (parseError != nullptr) {
+    *parseError = DeserializationError::EmptyInput;
+  }
+  ModemLockGuard lock;
+  if (!post_exchange_allowed(lock) || !modem_post_begin(resource, length, writer, context)) {
+    return 0;
+  }
+  return post_finish(&responseDoc, parseError, nullptr);
+}
+
+bool modem_post_begin(const char* resource, size_t length, HttpsBodyWriter writer, void* context) {
+  ModemLockGuard lock;
+  if (!lock.isLocked()) {
+    DBG_PRINTLN(F("[MODEM] Unable to acquire modem lock for HTTPS POST."));
+    return false;
+  }
+  if (shutdown_is_requested()) {
+    DBG_PRINTLN(F("[MODEM] HTTPS POST skipped due to shutdown request."));
+    return false;
+  }
+  if (!g_modem_initialized) {
+    DBG_PRINTLN(F("[MODEM] Cannot perform HTTPS POST: modem not initialized."));
+    return false;
+  }
+  if (g_postCount >= POST_SLOTS) {
+    DBG_PRINTLN(F("[MODEM] HTTPS POST skipped: pipeline full."));
+    return false;
+  }
+  DBG_PRINT(F("[MODEM] Performing HTTPS POST to: "));
+  DBG_PRINTLN(resource);
+  DBG_PRINTF("[MODEM] Sending POST request (%u bytes)...\n", static_cast<unsigned>(length));
+
+  PendingPost& post = g_posts[(g_postFirst + g_postCount) % POST_SLOTS];
+  post.length = length;
+  post.startMs = millis();
+#if MODEM_HTTP_TRANSPORT == MODEM_HTTP_TRANSPORT_AT
+  post.statusCode = http_service_post(resource, length, writer, context, post);
+  if (post.statusCode == TINYGSM_HTTP_BODY_INCOMPLETE) {
+    DBG_PRINTLN(F("[MODEM] Request body did not match its length. Not sent."));
+    return false;
+  }
+#else
+  if (!socket_http_post(server, port, resource, length, writer, context)) {
+    DBG_PRINTLN(F("[MODEM] Failed to write POST request."));
+    return false;
+  }
+#endif
+  g_postCount++;
+  return true;
+}
+
+int modem_post_finish(JsonDocument* responseDoc, DeserializationError* parseError) {
+  return post_finish(responseDoc, parseError, nullptr);
+}
+
+uint8_t modem_post_pipeline_depth() {
+  return POST_SLOTS;
+}
+
+void modem_build_handshake_payload(JsonDocument& payloadDoc) {
   payloadDoc["device_id"] = deviceID;
   payloadDoc["client_type"] = CLIENT_TYPE;
   payloadDoc["power_status"] = power_status_to_string(power_status_get());
+  batch_tuning_describe(payloadDoc["batch"].to<JsonObject>());
+}
 
-  String payload;
-  serializeJson(payloadDoc, payload);
-
-  DBG_PRINTLN(F("[MODEM] Performing device handshake..."));
-  int statusCode = 0;
-  String response = modem_send_post_request(RESOURCE_HANDSHAKE, payload, &statusCode);
-
+bool modem_apply_handshake_response(int statusCode, const JsonDocument& responseDoc, DeserializationError error) {
   if (statusCode == 404) {
     DBG_PRINTLN(F("[MODEM] Handshake responded 404 - device not registered."));
     fs_set_registered(false);
@@ -335,13 +934,11 @@ bool modem_perform_handshake() {
     return false;
   }
 
-  if (statusCode <= 0 && response.isEmpty()) {
+  if (statusCode <= 0) {
     DBG_PRINTLN(F("[MODEM] Handshake failed: no response from server."));
     return false;
   }
 
-  JsonDocument responseDoc;
-  DeserializationError error = deserializeJson(responseDoc, response);
   if (statusCode >= 400) {
     DBG_PRINT(F("[MODEM] Handshake HTTP error: "));
     DBG_PRINTLN(statusCode);
@@ -383,6 +980,23 @@ bool modem_perform_handshake() {
   return true;
 }
 
+bool modem_perform_handshake() {
+  JsonDocument payloadDoc;
+  modem_build_handshake_payload(payloadDoc);
+
+  String payload;
+  serializeJson(payloadDoc, payload);
+
+  DBG_PRINTLN(F("[MODEM] Performing device handshake..."));
+  DBG_PRINT(F("[MODEM] Payload: "));
+  DBG_PRINTLN(payload);
+  JsonDocument responseDoc;
+  DeserializationError error;
+  int statusCode = modem_send_post_json(RESOURCE_HANDSHAKE, payload.length(), write_string_body,
+                                        &payload, responseDoc, &error);
+  return modem_apply_handshake_response(statusCode, responseDoc, error);
+}
+
 void modem_disconnect_gprs() {
   ModemLockGuard lock(pdMS_TO_TICKS(3000));
   if (!lock.isLocked()) {
@@ -393,6 +1007,7 @@ void modem_disconnect_gprs() {
     DBG_PRINTLN(F("[MODEM] GPRS disconnect skipped (not connected)."));
     return;
   }
+  http_session_close();
   DBG_PRINT(F("[MODEM] Disconnecting GPRS..."));
   if (g_modem.gprsDisconnect()) {
     DBG_PRINTLN(F(" success"));
@@ -435,12 +1050,87 @@ bool modem_test_server_connection(const String& host, int port) {
   return false;
 }
 
+bool modem_bringup_start(const String& apn_val, const String& user_val, const String& pass_val) {
+  if (g_bringup_task != nullptr) {
+    DBG_PRINTLN(F("[MODEM] Background bring-up already running."));
+    return false;
+  }
+  if (g_bringup_events == nullptr) {
+    g_bringup_events = xEventGroupCreate();
+    if (g_bringup_events == nullptr) {
+      return false;
+    }
+  }
+  xEventGroupClearBits(g_bringup_events, BRINGUP_INIT_DONE | BRINGUP_INIT_OK | BRINGUP_GPRS_DONE | BRINGUP_GPRS_OK);
+  g_gnss_wanted = MODEM_GNSS_ASSIST && !g_gnss_unsupported;
+  g_bringup_apn = apn_val;
+  g_bringup_user = user_val;
+  g_bringup_pass = pass_val;
+  if (xTaskCreatePinnedToCore(modem_bringup_task, "ModemBringUp", 8192, NULL, 1, &g_bringup_task, 0) != pdPASS) {
+    DBG_PRINTLN(F("[MODEM] Failed to create background bring-up task."));
+    g_bringup_task = nullptr;
+    return false;
+  }
+  DBG_PRINTLN(F("[MODEM] Background modem bring-up started."));
+  return true;
+}
+
+bool modem_bringup_wait_initialized() {
+  return modem_bringup_wait(BRINGUP_INIT_DONE, BRINGUP_INIT_OK);
+}
+
+bool modem_bringup_wait_connected() {
+  return modem_bringup_wait(BRINGUP_GPRS_DONE, BRINGUP_GPRS_OK);
+}
+
+bool modem_bringup_running() {
+  return g_bringup_task != nullptr;
+}
+
+bool modem_gnss_active() {
+  return g_gnss_on;
+}
+
+bool modem_gnss_read(ModemGnssFix& fix) {
+  if (!g_gnss_on) {
+    return false;
+  }
+  ModemLockGuard lock(pdMS_TO_TICKS(MODEM_GNSS_LOCK_WAIT_MS));
+  if (!lock.isLocked() || !g_gnss_on) {
+    return false; // Busy with the attach or AGPS; next poll
+  }
+  // getGPS_Ex() takes the N/S and E/W flags with a read() that does not wait for the
+  // byte and reads the DOP fields one position late; the raw line is parsed here instead
+  return parse_gnss_info(g_modem.getGPSraw(), fix);
+}
+
+void modem_gnss_stop() {
+  g_gnss_wanted = false;
+  if (!g_gnss_on) {
+    return;
+  }
+  ModemLockGuard lock(0);
+  if (lock.isLocked()) {
+    modem_gnss_power_off();
+  } // Otherwise the bring-up task switches it off when the attach is done
+}
+
 void modem_power_off() {
   ModemLockGuard lock(pdMS_TO_TICKS(3000));
   if (!lock.isLocked()) {
     DBG_PRINTLN(F("[MODEM] Power-off skipped (modem busy)."));
     return;
   }
+  if (!g_modem_initialized && modem_rtc_state().power == ModemPowerState::Psm) {
+#ifdef BOARD_POWERON_PIN
+    // Parked in PSM since an earlier wake: nothing runs in the module, the rail is cut
+    DBG_PRINTLN(F("[MODEM] Cutting the rail of the parked modem."));
+    gpio_hold_dis(static_cast<gpio_num_t>(BOARD_POWERON_PIN));
+    digitalWrite(BOARD_POWERON_PIN, LOW);
+    modem_rtc_state().power = ModemPowerState::Off;
+#endif
+    return;
+  }
   if (!g_modem_initialized) {
     DBG_PRINTLN(F("[MODEM] Power-off skipped (modem not initialized)."));
     return;
@@ -448,10 +1138,46 @@ void modem_power_off() {
   DBG_PRINTLN(F("[MODEM] Powering off modem..."));
   if (!g_modem.poweroff()) {
     DBG_PRINTLN(F("[MODEM] modem.poweroff() failed or not supported."));
+    modem_rtc_state().power = ModemPowerState::Unknown;
   } else {
     DBG_PRINTLN(F("[MODEM] Modem powered off via TinyGSM."));
+    modem_rtc_state().power = ModemPowerState::Off;
   }
   delay(1000);
-  g_modem_initialized = false;
-  g_modem_gprs_connected = false;
+  mark_modem_offline();
+  batch_tuning_session_end();
+}
+
+void modem_park() {
+  if (MODEM_PSM && !shutdown_is_requested()) {
+    ModemLockGuard lock(pdMS_TO_TICKS(3000));
+    if (lock.isLocked() && g_modem_initialized) {
+      modem_gnss_power_off();
+      if (modem_psm_granted()) {
+        DBG_PRINTLN(F("[MODEM] PSM granted. Modem stays registered through the sleep."));
+        // No +NETCLOSE: the PDP context survives PSM, so the next session skips +NETOPEN
+        http_session_close();
+        modem_rtc_state().netOpen = g_modem_gprs_connected;
+        modem_rtc_state().power = ModemPowerState::Psm;
+        mark_modem_offline();
+        batch_tuning_session_end();
+        return;
+      }
+      DBG_PRINTLN(F("[MODEM] PSM not granted by the network."));
+    }
+  }
+  modem_disconnect_gprs();
+  modem_power_off();
+}
+
+void modem_prepare_deep_sleep() {
+#ifdef BOARD_POWERON_PIN
+  if (modem_rtc_state().power != ModemPowerState::Psm) {
+    gpio_hold_dis(static_cast<gpio_num_t>(BOARD_POWERON_PIN));
+    return; // Rail released: an unparked modem is off or loses power now
+  }
+  gpio_hold_en(static_cast<gpio_num_t>(BOARD_POWERON_PIN));
+  gpio_deep_sleep_hold_en();
+  DBG_PRINTLN(F("[MODEM] Keeping modem rail up for PSM."));
+#endif
 }
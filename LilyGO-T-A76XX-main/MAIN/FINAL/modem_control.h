@@ -3,6 +3,7 @@
 #include <Arduino.h>
 #include "config.h"
 #include <TinyGsmClient.h>
+#include <ArduinoJson.h>
 
 // Global modem objects
 extern TinyGsm g_modem;
@@ -26,17 +27,81 @@ bool modem_initialize();
 // Function to connect to GPRS
 bool modem_connect_gprs(const String& apn_val, const String& user_val, const String& pass_val, uint32_t timeout_ms = 240000L);
 
+// Starts modem_initialize() + modem_connect_gprs() in a background task, so the
+// network attach can run while the main task waits for a GPS fix
+bool modem_bringup_start(const String& apn_val, const String& user_val, const String& pass_val);
+
+// Block until the background bring-up finished the respective step; true on success
+bool modem_bringup_wait_initialized();
+bool modem_bringup_wait_connected();
+
+// True while the background bring-up task is still working
+bool modem_bringup_running();
+
+// Position from the modem's own GNSS (MODEM_GNSS_ASSIST)
+struct ModemGnssFix {
+  double lat, lon;
+  float speedKmh, altM;
+  float hdop;  // -1 if not reported
+  int sats;    // All constellations
+  uint16_t year;
+  uint8_t month, day, hour, minute, second;
+};
+
+// True once the bring-up task has the modem GNSS running (modules without GNSS never)
+bool modem_gnss_active();
+
+// Current modem GNSS fix; false without a fix or while the modem stays busy for
+// MODEM_GNSS_LOCK_WAIT_MS (then it is simply asked again at the next poll)
+bool modem_gnss_read(ModemGnssFix& fix);
+
+// End of the GPS stage: the modem GNSS is switched off now or when the bring-up is done
+void modem_gnss_stop();
+
 // Function to send a POST request to the server
 String modem_send_post_request(const char* resource, const String& payload, int* statusCodeOut = nullptr);
 
+// Same as modem_send_post_request, but the body of exactly `length` bytes is produced
+// by `writer` directly into the modem UART instead of being buffered in RAM
+String modem_send_post_stream(const char* resource, size_t length, HttpsBodyWriter writer, void* context, int* statusCodeOut = nullptr);
+
+// Same as modem_send_post_stream, but the response body is parsed into `responseDoc`
+// while it is read from the modem, without a copy in RAM. Returns the HTTP status
+// (<= 0 on a transport error); `parseError` gets the result of deserializeJson.
+int modem_send_post_json(const char* resource, size_t length, HttpsBodyWriter writer, void* context,
+                         JsonDocument& responseDoc, DeserializationError* parseError = nullptr);
+
+// Split form of modem_send_post_json for pipelining: modem_post_begin() writes the
+// request (false if it could not, or if `writer` did not produce exactly `length` bytes;
+// such a request is not sent), modem_post_finish() takes the response of the oldest
+// request begun and returns its status; the body is parsed into `responseDoc`, or
+// skipped without one. Up to modem_post_pipeline_depth() requests may be outstanding;
+// the AT transport answers inside modem_post_begin() and allows only one.
+bool modem_post_begin(const char* resource, size_t length, HttpsBodyWriter writer, void* context);
+int modem_post_finish(JsonDocument* responseDoc = nullptr, DeserializationError* parseError = nullptr);
+uint8_t modem_post_pipeline_depth();
+
 // Perform handshake with backend to sync config and power instructions
 bool modem_perform_handshake();
 
-// Function to disconnect from GPRS
+// Fills the handshake request fields (device_id, client_type, power_status, batch)
+void modem_build_handshake_payload(JsonDocument& payloadDoc);
+
+// Applies a handshake-style response (registered, config, power_instruction); false on error
+bool modem_apply_handshake_response(int statusCode, const JsonDocument& responseDoc, DeserializationError error);
+
+// Function to disconnect from GPRS (also ends the HTTP(S) session shared by the POSTs)
 void modem_disconnect_gprs();
 
 // Function to power off the modem
 void modem_power_off();
 
+// End of a session: leaves the modem registered in PSM if the network granted it
+// (MODEM_PSM) with the socket service still open, otherwise disconnects and powers it off
+void modem_park();
+
+// Before deep sleep: hold the modem rail while it is parked in PSM, release it otherwise
+void modem_prepare_deep_sleep();
+
 // Simple TCP connectivity test against the configured server/port
 bool modem_test_server_connection(const String& host, int port);
@@ -0,0 +1,48 @@
+#include "modem_serial.h"
+
+void ModemSerial::begin(uint32_t baud, int8_t rxPin, int8_t txPin, size_t rxBufferSize) {
+  if (!begun_) {
+    // The ESP32 driver ring can only be resized before the UART is started
+    serial_.setRxBufferSize(rxBufferSize);
+    begun_ = true;
+  }
+  serial_.begin(baud, SERIAL_8N1, rxPin, txPin);
+  baud_ = baud;
+  pos_ = len_ = 0;
+}
+
+void ModemSerial::setBaud(uint32_t baud) {
+  serial_.flush();
+  serial_.updateBaudRate(baud);
+  baud_ = baud;
+  pos_ = len_ = 0;
+  while (serial_.available() > 0) {
+    serial_.read();
+  }
+}
+
+bool ModemSerial::refill() {
+  pos_ = len_ = 0;
+  int ready = serial_.available();
+  if (ready <= 0) {
+    return false;
+  }
+  len_ = serial_.read(block_, ready < static_cast<int>(sizeof(block_)) ? ready : sizeof(block_));
+  return len_ > 0;
+}
+
+size_t ModemSerial::readBytes(char* buffer, size_t length) {
+  size_t done = 0;
+  if (pos_ < len_) {
+    size_t buffered = len_ - pos_;
+    done = buffered < length ? buffered : length;
+    memcpy(buffer, block_ + pos_, done);
+    pos_ += done;
+  }
+  if (done == length) {
+    return done;
+  }
+  // The rest comes straight from the driver ring; the driver waits for it without polling
+  serial_.setTimeout(_timeout);
+  return done + serial_.readBytes(buffer + done, length - done);
+}
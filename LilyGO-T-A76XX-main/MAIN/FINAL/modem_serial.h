@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Receive side of the modem UART (SerialAT) as TinyGSM sees it.
+//
+// TinyGSM parses AT responses with an available() and a read() per byte, and on the ESP32
+// each of those is a locked call into the UART driver. ModemSerial takes whatever the
+// driver ring holds with one read() into a small block and serves the per-byte calls from
+// there; readBytes() leaves the copy and the wait to the driver. The driver ring itself is
+// set up larger than the Arduino default, so a fast baud rate survives the time the modem
+// task is not reading (GPS task, flash writes).
+class ModemSerial : public Stream {
+ public:
+  explicit ModemSerial(HardwareSerial& serial) : serial_(serial) {}
+
+  // Starts (or restarts) the UART. The driver ring size only takes effect on the first call.
+  void begin(uint32_t baud, int8_t rxPin, int8_t txPin, size_t rxBufferSize);
+
+  // Switches the line rate once the modem answered at the old one; unread bytes are dropped
+  void setBaud(uint32_t baud);
+  uint32_t baud() const { return baud_; }
+
+  int available() override { return pos_ < len_ ? len_ - pos_ : serial_.available(); }
+  int read() override {
+    if (pos_ == len_ && !refill()) {
+      return -1;
+    }
+    return block_[pos_++];
+  }
+  int peek() override {
+    if (pos_ == len_ && !refill()) {
+      return -1;
+    }
+    return block_[pos_];
+  }
+  size_t readBytes(char* buffer, size_t length) override;
+  size_t readBytes(uint8_t* buffer, size_t length) {
+    return readBytes(reinterpret_cast<char*>(buffer), length);
+  }
+
+  size_t write(uint8_t c) override { return serial_.write(c); }
+  size_t write(const uint8_t* buffer, size_t size) override { return serial_.write(buffer, size); }
+  using Print::write;
+  void flush() override { serial_.flush(); }
+
+ private:
+  bool refill();
+
+  HardwareSerial& serial_;
+  uint32_t baud_ = 0;
+  bool begun_ = false;
+  uint8_t block_[128]; // One hardware FIFO worth
+  uint16_t pos_ = 0;
+  uint16_t len_ = 0;
+};
@@ -0,0 +1,96 @@
+#include "motion_gate.h"
+#if IMU_MOTION_GATING
+#include <Wire.h>
+#include <SensorQMI8658.hpp>
+#endif
+
+namespace {
+const uint32_t MOTION_STATE_MAGIC = 0x4D473031; // "MG01"
+
+struct MotionState {
+  uint32_t magic;
+  uint8_t stillWakes;   // Consecutive wakes without motion
+  uint16_t heartbeats;  // Wakes without GNSS since the last fix attempt
+};
+
+RTC_DATA_ATTR MotionState g_motion;
+
+bool g_imuReady = false; // Wake-on-motion armed in this wake
+bool g_motionThisWake = true;
+
+#if IMU_MOTION_GATING
+SensorQMI8658 g_imu;
+#endif
+
+MotionState& state() {
+  if (g_motion.magic != MOTION_STATE_MAGIC) {
+    g_motion = {};
+    g_motion.magic = MOTION_STATE_MAGIC;
+  }
+  return g_motion;
+}
+} // namespace
+
+void motion_gate_begin() {
+  MotionState& s = state();
+  esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+  // Only the timer says nothing about motion; ext1 is the IMU, ext0 the button, anything else a reset
+  g_motionThisWake = cause != ESP_SLEEP_WAKEUP_TIMER;
+#if IMU_MOTION_GATING
+  // begin() resets the sensor, so wake-on-motion is set up again for the rest of this wake
+  g_imuReady = g_imu.begin(Wire, QMI8658_L_SLAVE_ADDRESS, IMU_SDA_PIN, IMU_SCL_PIN) &&
+               g_imu.configWakeOnMotion(IMU_WOM_THRESHOLD_MG, SensorQMI8658::ACC_ODR_LOWPOWER_21Hz,
+                                        SensorQMI8658::INTERRUPT_PIN_2) == DEV_WIRE_NONE;
+  if (!g_imuReady) {
+    DBG_PRINTLN(F("[MOTION] IMU not answering. Tracking on every wake."));
+  }
+#endif
+  if (!g_imuReady) {
+    g_motionThisWake = true;
+  }
+  if (g_motionThisWake) {
+    s.stillWakes = 0;
+  } else if (s.stillWakes < UINT8_MAX) {
+    s.stillWakes++;
+  }
+  DBG_PRINTF("[MOTION] %s wake (%u still in a row).\n", g_motionThisWake ? "Moving" : "Still", s.stillWakes);
+}
+
+bool motion_gate_gnss_needed(bool timeKnown) {
+  MotionState& s = state();
+  bool needed = !g_imuReady || s.stillWakes <= MOTION_STILL_WAKES || !timeKnown ||
+                s.heartbeats >= MOTION_HEARTBEATS_PER_FIX;
+  if (needed) {
+    s.heartbeats = 0;
+  } else {
+    s.heartbeats++;
+    DBG_PRINTLN(F("[MOTION] Stationary: heartbeat only, GNSS stays off."));
+  }
+  return needed;
+}
+
+uint64_t motion_gate_sleep_seconds(uint64_t trackingSeconds) {
+#if IMU_MOTION_GATING
+  if (g_imuReady && (g_imu.update() & SensorQMI8658::STATUS1_WOM_MOTION)) {
+    state().stillWakes = 0; // Started moving while awake: keep tracking
+  }
+#endif
+  if (!g_imuReady || state().stillWakes < MOTION_STILL_WAKES) {
+    return trackingSeconds;
+  }
+  return MOTION_HEARTBEAT_S > trackingSeconds ? MOTION_HEARTBEAT_S : trackingSeconds;
+}
+
+void motion_gate_prepare_deep_sleep() {
+  // Only a still device waits for motion; while moving, wake-on-motion fires every blanking
+  // time and would end each sleep at once, so the tracking interval is left to the timer
+  if (!g_imuReady || state().stillWakes == 0) {
+    return;
+  }
+#if IMU_MOTION_GATING
+  // The interrupt line toggles on every event; wake on the level it is not at now
+  pinMode(IMU_INT_PIN, INPUT);
+  esp_sleep_enable_ext1_wakeup(1ULL << IMU_INT_PIN,
+                               digitalRead(IMU_INT_PIN) ? ESP_EXT1_WAKEUP_ALL_LOW : ESP_EXT1_WAKEUP_ANY_HIGH);
+#endif
+}
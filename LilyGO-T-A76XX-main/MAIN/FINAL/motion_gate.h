@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// Motion-gated wake scheduling (IMU_MOTION_GATING).
+//
+// A QMI8658 in wake-on-motion mode keeps watching while the ESP32 sleeps; its
+// interrupt pin is an ext1 wake source. Every wake is classified as moving (motion
+// interrupt, motion seen while awake, button or power-on) or still. Tracking with the
+// GNSS continues for MOTION_STILL_WAKES still wakes so the parking position is fixed
+// and a dwell is open; after that the GNSS stays off, the device sleeps
+// MOTION_HEARTBEAT_S and each wake only extends the dwell (track_compress_heartbeat()).
+// Without the IMU (or when it does not answer) every wake is a moving one.
+
+// Classify this wake; call once after power_init()
+void motion_gate_begin();
+
+// Whether this wake should run the GNSS. `timeKnown`: a heartbeat can be timestamped.
+bool motion_gate_gnss_needed(bool timeKnown);
+
+// Sleep before the next wake given the configured tracking interval; motion seen
+// while awake keeps the tracking interval
+uint64_t motion_gate_sleep_seconds(uint64_t trackingSeconds);
+
+// Before deep sleep: arm the ext1 wake on the IMU interrupt pin
+void motion_gate_prepare_deep_sleep();
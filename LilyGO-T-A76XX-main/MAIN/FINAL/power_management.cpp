@@ -132,6 +132,7 @@ void graceful_shutdown() {
   }
   gps_close_serial();      // Defined in gps_control.cpp
   gps_power_down();        // Defined in gps_control.cpp
+  track_compress_flush();  // Held fixes live in RTC memory, which is lost with power
   fs_end();                // Defined in file_system.cpp
 
   // Finally, cut power to the ESP32
@@ -152,6 +153,13 @@ void enter_deep_sleep(uint64_t seconds) {
   // Detach interrupt before sleeping to prevent issues on wake
   detachInterrupt(digitalPinToInterrupt(PIN_BTN));
 
+  // Keep the GPS in standby for short sleeps, power it off for long ones
+  gps_prepare_deep_sleep(seconds);
+  // Wake early when the IMU sees motion (IMU_MOTION_GATING)
+  motion_gate_prepare_deep_sleep();
+  // A modem parked in PSM keeps its rail
+  modem_prepare_deep_sleep();
+
   // Enable wakeup by timer
   esp_sleep_enable_timer_wakeup(seconds * 1000000ULL); // microseconds
   // Enable wakeup by button (on LOW level)
@@ -162,6 +170,20 @@ void enter_deep_sleep(uint64_t seconds) {
   esp_deep_sleep_start();
 }
 
+bool power_light_sleep(uint64_t microseconds) {
+  if (g_shutdown_requested || modem_bringup_running()) {
+    return false; // The bring-up task and its UART traffic must keep running
+  }
+  DBG_FLUSH();
+  esp_sleep_enable_timer_wakeup(microseconds);
+  esp_light_sleep_start();
+  // The button's edge interrupt is not seen while the CPU sleeps; a held button still is
+  if (digitalRead(PIN_BTN) == LOW && shutdownTaskHandle != nullptr) {
+    xTaskNotifyGive(shutdownTaskHandle);
+  }
+  return true;
+}
+
 bool shutdown_is_requested() {
   return g_shutdown_requested;
 }
@@ -10,11 +10,16 @@
 // These will be called during graceful shutdown
 void modem_disconnect_gprs();
 void modem_power_off();
+void modem_prepare_deep_sleep();
 void gps_power_down();
+void gps_prepare_deep_sleep(uint64_t seconds);
 void gps_close_serial();
 void gps_request_abort();
 bool gps_is_active();
 void fs_end();
+void track_compress_flush();
+void motion_gate_prepare_deep_sleep();
+bool modem_bringup_running();
 
 enum class PowerStatus : uint8_t {
 	Unknown = 0,
@@ -61,6 +66,10 @@ void graceful_shutdown();
 // Function to enter deep sleep mode
 void enter_deep_sleep(uint64_t seconds);
 
+// Light-sleep the CPU for up to `microseconds` while waiting for a peripheral.
+// Returns false without sleeping while the modem bring-up task needs the CPU.
+bool power_light_sleep(uint64_t microseconds);
+
 // ISR for button press (only notifies the FreeRTOS task)
 void IRAM_ATTR on_button_isr();
 
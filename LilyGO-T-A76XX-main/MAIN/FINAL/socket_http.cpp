@@ -0,0 +1,258 @@
+#include "socket_http.h"
+#if MODEM_HTTP_TRANSPORT == MODEM_HTTP_TRANSPORT_SOCKET
+#include <HttpClient.h>
+#include "modem_control.h"
+
+namespace {
+const uint8_t SOCKET_HTTP_MUX = 1; // Session 0 belongs to g_client (modem_test_server_connection)
+
+TinyGsmClientSecure g_tls;
+bool g_tlsBound = false;
+bool g_reconnect = true; // Socket state unknown (first use, modem restarted): connect before writing
+String g_host;
+uint16_t g_port = 0;
+
+// HttpClient prints the request line, every header and the body in small pieces; each
+// write on the TinyGSM client would be a +CCHSEND round trip of its own.
+class SocketTxBuffer : public Client {
+ public:
+  int connect(IPAddress ip, uint16_t port) override {
+    used_ = 0;
+    return g_tls.connect(ip, port);
+  }
+  int connect(const char* host, uint16_t port) override {
+    used_ = 0;
+    return g_tls.connect(host, port);
+  }
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t* buf, size_t size) override {
+    size_t written = 0;
+    while (written < size) {
+      if (used_ == sizeof(buffer_) && !send()) {
+        break;
+      }
+      size_t n = size - written;
+      if (n > sizeof(buffer_) - used_) {
+        n = sizeof(buffer_) - used_;
+      }
+      memcpy(buffer_ + used_, buf + written, n);
+      used_ += n;
+      written += n;
+    }
+    return written;
+  }
+  void flush() override { send(); }
+  int available() override { return g_tls.available(); }
+  int read() override { return g_tls.read(); }
+  int read(uint8_t* buf, size_t size) override { return g_tls.read(buf, size); }
+  int peek() override { return g_tls.peek(); }
+  void stop() override {
+    used_ = 0;
+    g_tls.stop(0); // Unread response bytes are dropped, not drained
+  }
+  uint8_t connected() override { return g_tls.connected(); }
+  operator bool() override { return g_tls.connected(); }
+
+  // True if a +CCHSEND failed since the last call
+  bool takeError() {
+    bool failed = failed_;
+    failed_ = false;
+    return failed;
+  }
+
+ private:
+  bool send() {
+    if (used_ == 0) {
+      return !failed_;
+    }
+    if (g_tls.write(buffer_, used_) != used_) {
+      failed_ = true;
+    }
+    used_ = 0;
+    return !failed_;
+  }
+
+  uint8_t buffer_[MODEM_HTTP_TX_CHUNK];
+  size_t used_ = 0;
+  bool failed_ = false;
+};
+
+SocketTxBuffer g_tx;
+
+// HttpClient::startRequest() empties the socket before a new request, which would throw
+// away the responses still queued behind it; a pipelined request only resets the parser.
+class PipelinedHttpClient : public HttpClient {
+ public:
+  PipelinedHttpClient() : HttpClient(g_tx, "", 443) { connectionKeepAlive(); }
+
+  void target(const char* host, uint16_t port) {
+    iServerName = host;
+    iServerPort = port;
+  }
+
+  void beginPipelined() {
+    resetState();
+    beginRequest();
+    setHttpResponseTimeout(MODEM_HTTP_RESPONSE_TIMEOUT_MS);
+  }
+
+  // Drops the rest of a body with a Content-Length in blocks, never reading past its end.
+  // False if the connection closes or nothing arrives within the response timeout.
+  bool skipBody() {
+    uint8_t scrap[64];
+    unsigned long start = millis();
+    while (iBodyLengthConsumed < iContentLength) {
+      size_t n = iContentLength - iBodyLengthConsumed;
+      if (n > sizeof(scrap)) {
+        n = sizeof(scrap);
+      }
+      if (read(scrap, n) > 0) {
+        start = millis();
+      } else if (!iClient->connected() || millis() - start >= iHttpResponseTimeout) {
+        return false;
+      } else {
+        delay(MODEM_HTTP_POLL_MS);
+      }
+    }
+    return true;
+  }
+};
+
+// One parser per request in flight, used round-robin; responses arrive in request order
+PipelinedHttpClient g_requests[MODEM_HTTP_PIPELINE_DEPTH];
+uint8_t g_first = 0;
+uint8_t g_outstanding = 0;
+
+int fail_connection(const __FlashStringHelper* why) {
+  DBG_PRINT(F("[HTTP] "));
+  DBG_PRINTLN(why);
+  socket_http_close();
+  return HTTP_ERROR_TIMED_OUT;
+}
+} // namespace
+
+bool socket_http_post(const String& host, uint16_t port, const char* resource, size_t length,
+                      HttpsBodyWriter writer, void* context) {
+  if (g_outstanding >= MODEM_HTTP_PIPELINE_DEPTH) {
+    return false;
+  }
+  if (!g_tlsBound) {
+    g_tls.init(&g_modem, SOCKET_HTTP_MUX);
+    g_tlsBound = true;
+  }
+  if (host != g_host || port != g_port) {
+    if (g_outstanding > 0) {
+      return false;
+    }
+    g_host = host;
+    g_port = port;
+    for (PipelinedHttpClient& request : g_requests) {
+      request.target(g_host.c_str(), g_port);
+    }
+    g_reconnect = true;
+  }
+  if (g_outstanding == 0 && (g_reconnect || !g_tls.connected())) {
+    DBG_PRINTF("[HTTP] Connecting to %s:%u...\n", g_host.c_str(), g_port);
+    if (!g_tx.connect(g_host.c_str(), g_port)) {
+      fail_connection(F("Connection failed."));
+      return false;
+    }
+    g_reconnect = false;
+  } else if (g_outstanding > 0 && !g_tls.connected()) {
+    fail_connection(F("Connection lost with responses outstanding."));
+    return false;
+  }
+
+  PipelinedHttpClient& request = g_requests[(g_first + g_outstanding) % MODEM_HTTP_PIPELINE_DEPTH];
+  request.beginPipelined();
+  if (request.post(resource) != HTTP_SUCCESS) {
+    fail_connection(F("Request not started."));
+    return false;
+  }
+  request.sendHeader(HTTP_HEADER_CONTENT_TYPE, "application/json");
+  request.sendHeader(HTTP_HEADER_CONTENT_LENGTH, static_cast<int>(length));
+  request.beginBody();
+  if (!writer(request, context)) {
+    // Content-Length is on the wire already: the server would wait for the missing
+    // bytes or take the extra ones as the next request
+    fail_connection(F("Request body did not match its length."));
+    return false;
+  }
+  g_tx.flush();
+  if (g_tx.takeError()) {
+    fail_connection(F("+CCHSEND failed."));
+    return false;
+  }
+  g_outstanding++;
+  return true;
+}
+
+int socket_http_response(JsonDocument* json, DeserializationError* jsonError, String* text) {
+  if (g_outstanding == 0) {
+    return HTTP_ERROR_API;
+  }
+  PipelinedHttpClient& request = g_requests[g_first];
+  g_first = (g_first + 1) % MODEM_HTTP_PIPELINE_DEPTH;
+  g_outstanding--;
+
+  // HttpClient polls an empty socket in 1 s steps; the first bytes are awaited here
+  unsigned long start = millis();
+  while (!g_tls.available()) {
+    if (!g_tls.connected()) {
+      return fail_connection(F("Connection closed before the response."));
+    }
+    if (millis() - start >= MODEM_HTTP_RESPONSE_TIMEOUT_MS) {
+      return fail_connection(F("Response timed out."));
+    }
+    delay(MODEM_HTTP_POLL_MS);
+  }
+  int statusCode = request.responseStatusCode();
+  if (statusCode <= 0 || request.skipResponseHeaders() != HTTP_SUCCESS) {
+    return fail_connection(F("Malformed response."));
+  }
+  int contentLength = request.contentLength();
+  if (text != nullptr) {
+    *text = request.responseBody();
+  } else if (json != nullptr) {
+    DeserializationError error = deserializeJson(*json, request);
+    if (jsonError != nullptr) {
+      *jsonError = error;
+    }
+  }
+  // Whatever was not consumed (an HTML error page, trailing whitespace) would be taken for
+  // the start of the next response. With a length the rest is skipped in blocks up to its
+  // end; without one, HttpClient's stream reads go past the body, so one byte at a time
+  // until nothing more arrives, as in responseBody().
+  if (contentLength >= 0) {
+    if (!request.skipBody()) {
+      return fail_connection(F("Response body incomplete."));
+    }
+  } else {
+    char scrap;
+    while (!request.endOfBodyReached() && request.readBytes(&scrap, 1) == 1) {
+    }
+  }
+  if (contentLength < 0 && !request.isResponseChunked()) {
+    socket_http_close(); // The body ended with the connection
+  }
+  return statusCode;
+}
+
+uint8_t socket_http_outstanding() {
+  return g_outstanding;
+}
+
+void socket_http_close() {
+  g_outstanding = 0;
+  g_reconnect = true;
+  if (g_tlsBound) {
+    g_tx.stop();
+  }
+}
+
+void socket_http_forget() {
+  g_outstanding = 0;
+  g_reconnect = true;
+}
+
+#endif
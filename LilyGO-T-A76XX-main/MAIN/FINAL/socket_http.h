@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include <TinyGsmClient.h>
+#include <ArduinoJson.h>
+
+// HTTP/1.1 over a modem TLS socket (MODEM_HTTP_TRANSPORT_SOCKET).
+//
+// Instead of the modem's HTTP(S) service, ArduinoHttpClient writes the requests into a
+// +CCHOPEN session of TinyGsmA76xxSSL. The connection stays open for the whole GPRS
+// session (keep-alive), and up to MODEM_HTTP_PIPELINE_DEPTH POSTs may be written before
+// the first response is read; the server answers them in request order. Request bytes
+// are collected into MODEM_HTTP_TX_CHUNK blocks, one +CCHSEND each.
+// Callers hold the modem lock (modem_control.cpp).
+
+// Writes one POST. Connects first when no response is outstanding and the socket is
+// closed; false if the request could not be written, or if `writer` reports a body
+// that does not match `length` (the socket is closed then).
+bool socket_http_post(const String& host, uint16_t port, const char* resource, size_t length,
+                      HttpsBodyWriter writer, void* context);
+
+// Response to the oldest outstanding POST: the HTTP status, or <= 0 after a transport
+// error. A transport error closes the socket and loses every outstanding response.
+// The body is parsed from the socket into `json` if set, else copied into `text` if set,
+// else skipped; `jsonError` gets the result of deserializeJson.
+int socket_http_response(JsonDocument* json, DeserializationError* jsonError, String* text);
+
+// POSTs written whose response has not been read yet
+uint8_t socket_http_outstanding();
+
+// Closes the socket (end of the GPRS session)
+void socket_http_close();
+
+// The modem went away: forget the socket without talking to it
+void socket_http_forget();
@@ -0,0 +1,196 @@
+#include "track_compress.h"
+#include <math.h>
+
+namespace {
+const uint32_t TRACK_STATE_MAGIC = 0x54433033; // "TC03"
+const double METERS_PER_DEGREE = 111320.0;
+
+struct TrackState {
+  uint32_t magic;
+  bool hasAnchor;
+  bool dwelling;
+  bool dwellPending;  // dwellLast has not been cached yet
+  uint8_t count;      // Fixes held in window
+  uint32_t dwellSince;
+  CacheRecord anchor; // Last cached point of the track
+  CacheRecord dwellLast;
+  CacheRecord window[TRACK_WINDOW_POINTS];
+};
+
+RTC_DATA_ATTR TrackState g_state;
+
+// Offset of `to` from `from` in metres east/north
+struct Offset {
+  float x;
+  float y;
+};
+
+TrackState& state() {
+  if (g_state.magic != TRACK_STATE_MAGIC) {
+    g_state = {};
+    g_state.magic = TRACK_STATE_MAGIC;
+  }
+  return g_state;
+}
+
+Offset offset(const CacheRecord& from, const CacheRecord& to) {
+  double cosLat = cos(from.latitudeE7 * 1e-7 * DEG_TO_RAD);
+  Offset o;
+  o.x = static_cast<float>((static_cast<int64_t>(to.longitudeE7) - from.longitudeE7) * 1e-7 * METERS_PER_DEGREE * cosLat);
+  o.y = static_cast<float>((static_cast<int64_t>(to.latitudeE7) - from.latitudeE7) * 1e-7 * METERS_PER_DEGREE);
+  return o;
+}
+
+float length(const Offset& o) {
+  return sqrtf(o.x * o.x + o.y * o.y);
+}
+
+// Distance of `p` from the segment between the origin and `end`
+float segment_distance(const Offset& p, const Offset& end) {
+  float len2 = end.x * end.x + end.y * end.y;
+  float t = len2 > 0 ? (p.x * end.x + p.y * end.y) / len2 : 0;
+  t = t < 0 ? 0 : (t > 1 ? 1 : t);
+  Offset d = {p.x - t * end.x, p.y - t * end.y};
+  return length(d);
+}
+
+bool is_slow(const CacheRecord& fix) {
+  return fix.speedCentiKmh <= TRACK_DWELL_MAX_SPEED_KMH * 100.0f;
+}
+
+// True while the held fixes plus `fix` still fit one straight segment from the anchor
+bool segment_holds(const TrackState& s, const CacheRecord& fix) {
+  const float tolerance = static_cast<float>(trackToleranceM);
+  Offset end = offset(s.anchor, fix);
+  for (uint8_t i = 0; i < s.count; i++) {
+    if (segment_distance(offset(s.anchor, s.window[i]), end) > tolerance) {
+      return false;
+    }
+  }
+  if (s.count > 0) {
+    // Turn at the newest held fix; both legs must be longer than the noise to count
+    Offset before = offset(s.anchor, s.window[s.count - 1]);
+    Offset after = {end.x - before.x, end.y - before.y};
+    if (length(before) > tolerance && length(after) > tolerance) {
+      float turn = fabsf(atan2f(after.y, after.x) - atan2f(before.y, before.x)) * RAD_TO_DEG;
+      if (turn > 180.0f) {
+        turn = 360.0f - turn;
+      }
+      if (turn > TRACK_HEADING_CHANGE_DEG) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void keep(TrackState& s, const CacheRecord& record) {
+  append_to_cache(record);
+  s.anchor = record;
+  s.anchor.flags = 0;
+  s.hasAnchor = true;
+}
+
+// Caches the newest held fix; it becomes the anchor of the next segment
+void keep_window_end(TrackState& s) {
+  if (s.count == 0) {
+    return;
+  }
+  keep(s, s.window[s.count - 1]);
+  s.count = 0;
+}
+
+// Caches the last stationary fix with the time spent since the dwell started or was last reported
+void report_dwell(TrackState& s) {
+  if (!s.dwellPending) {
+    return;
+  }
+  CacheRecord record = s.dwellLast;
+  uint32_t seconds = 0;
+  if (s.dwellSince != 0 && record.timestamp > s.dwellSince) {
+    seconds = record.timestamp - s.dwellSince;
+  }
+  record.flags |= CACHE_RECORD_FLAG_DWELL;
+  record.dwellSeconds = seconds;
+  DBG_PRINTF("[TRACK] Dwell of %lu s reported.\n", static_cast<unsigned long>(seconds));
+  keep(s, record);
+  s.dwellSince = record.timestamp;
+  s.dwellPending = false;
+}
+} // namespace
+
+void track_compress_add(const CacheRecord& fix) {
+  TrackState& s = state();
+  if ((fix.flags & CACHE_RECORD_FLAG_POWER_STATUS) || trackToleranceM <= 0 || !s.hasAnchor) {
+    track_compress_flush();
+    s.dwelling = false;
+    keep(s, fix);
+    return;
+  }
+
+  if (s.dwelling) {
+    if (is_slow(fix) && length(offset(s.anchor, fix)) <= trackDwellRadiusM) {
+      if (fix.timestamp > s.dwellSince + TRACK_DWELL_REPORT_S) {
+        report_dwell(s);
+      }
+      s.dwellLast = fix;
+      s.dwellPending = true;
+      return;
+    }
+    report_dwell(s);
+    s.dwelling = false;
+    DBG_PRINTLN(F("[TRACK] Moving again."));
+  } else {
+    const CacheRecord& last = s.count > 0 ? s.window[s.count - 1] : s.anchor;
+    if (is_slow(fix) && length(offset(last, fix)) <= trackDwellRadiusM) {
+      // The stop starts at the newest held fix (the arrival), which is cached as is
+      keep_window_end(s);
+      s.dwelling = true;
+      s.dwellSince = s.anchor.timestamp;
+      s.dwellLast = fix;
+      s.dwellPending = true;
+      DBG_PRINTLN(F("[TRACK] Stationary, holding fixes as a dwell."));
+      return;
+    }
+  }
+
+  if (s.count == TRACK_WINDOW_POINTS || !segment_holds(s, fix)) {
+    keep_window_end(s);
+  }
+  s.window[s.count++] = fix;
+  DBG_PRINTF("[TRACK] Fix held (%u in segment).\n", s.count);
+}
+
+bool track_compress_heartbeat(uint32_t timestamp) {
+  TrackState& s = state();
+  if (!s.hasAnchor || timestamp == 0) {
+    return false;
+  }
+  if (!s.dwelling) {
+    keep_window_end(s);
+    s.dwelling = true;
+    s.dwellSince = s.anchor.timestamp;
+    s.dwellPending = false;
+  }
+  if (s.dwellPending && timestamp > s.dwellSince + TRACK_DWELL_REPORT_S) {
+    report_dwell(s);
+  }
+  if (!s.dwellPending) {
+    s.dwellLast = s.anchor;
+  }
+  s.dwellLast.timestamp = timestamp;
+  s.dwellLast.speedCentiKmh = 0;
+  s.dwellPending = true;
+  DBG_PRINTLN(F("[TRACK] Heartbeat extends the dwell."));
+  return true;
+}
+
+void track_compress_flush() {
+  TrackState& s = state();
+  keep_window_end(s);
+  report_dwell(s);
+}
+
+bool track_compress_active() {
+  return trackToleranceM > 0 && state().hasAnchor;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "file_system.h"
+
+// Online trajectory compression in front of the cache.
+//
+// Each fix is passed through here instead of straight to append_to_cache(). While the
+// device moves, fixes are held in a small RTC-resident window behind the last kept
+// point; as long as every held fix stays within `trackToleranceM` of the chord from
+// that point to the newest fix (and the track does not turn by more than
+// TRACK_HEADING_CHANGE_DEG), the window only grows. When a fix breaks the segment,
+// the window is full or the data is flushed, the newest held fix is cached and the
+// rest are dropped. Fixes within `trackDwellRadiusM` of the arrival point are a
+// dwell: nothing is cached until the device leaves, TRACK_DWELL_REPORT_S passes or
+// the data is flushed, then one record carries the last stationary fix and the time
+// spent there (CACHE_RECORD_FLAG_DWELL). Records with a power status bypass the
+// simplifier.
+//
+// The window stays open across uploads: an upload carries the kept points and the
+// finished dwells only. The window lives in RTC memory, so a power loss drops the
+// fixes held in it (at most TRACK_WINDOW_POINTS) and the open part of a dwell; the
+// points around them are cached already.
+
+// Hand over one fix; caches zero, one or two records
+void track_compress_add(const CacheRecord& fix);
+
+// A wake without a fix while the device is known to stand still (motion_gate): extends the
+// open dwell at the last cached position up to `timestamp`. False if nothing is cached yet.
+bool track_compress_heartbeat(uint32_t timestamp);
+
+// Cache everything held back (before a status record, before power-off)
+void track_compress_flush();
+
+// True if the next fix may be held back instead of cached
+bool track_compress_active();
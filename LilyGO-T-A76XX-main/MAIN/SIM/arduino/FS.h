@@ -0,0 +1,76 @@
+#pragma once
+
+#include <memory>
+#include "Arduino.h"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class FileImpl;
+typedef std::shared_ptr<FileImpl> FileImplPtr;
+
+class File : public Stream {
+ public:
+  File(FileImplPtr p = FileImplPtr()) : p_(p) { _timeout = 0; }
+
+  size_t write(uint8_t) override;
+  size_t write(const uint8_t* buf, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  void flush() override;
+  size_t read(uint8_t* buf, size_t size);
+  size_t readBytes(char* buffer, size_t length) override {
+    return read(reinterpret_cast<uint8_t*>(buffer), length);
+  }
+  size_t readBytes(uint8_t* buffer, size_t length) override { return read(buffer, length); }
+  bool seek(uint32_t pos, SeekMode mode);
+  bool seek(uint32_t pos) { return seek(pos, SeekSet); }
+  size_t position() const;
+  size_t size() const;
+  bool setBufferSize(size_t size) { (void)size; return true; }
+  void close();
+  operator bool() const;
+  const char* path() const;
+  const char* name() const;
+  bool isDirectory() const;
+  File openNextFile(const char* mode = "r");
+  void rewindDirectory();
+
+ private:
+  FileImplPtr p_;
+};
+
+class FS {
+ public:
+  explicit FS(const char* label) : label_(label) {}
+  File open(const char* path, const char* mode = "r", const bool create = false);
+  File open(const String& path, const char* mode = "r", const bool create = false) {
+    return open(path.c_str(), mode, create);
+  }
+  bool exists(const char* path);
+  bool exists(const String& path) { return exists(path.c_str()); }
+  bool remove(const char* path);
+  bool remove(const String& path) { return remove(path.c_str()); }
+  bool rename(const char* pathFrom, const char* pathTo);
+  bool rename(const String& pathFrom, const String& pathTo) { return rename(pathFrom.c_str(), pathTo.c_str()); }
+  bool mkdir(const char* path);
+  bool mkdir(const String& path) { return mkdir(path.c_str()); }
+  bool rmdir(const char* path);
+  bool rmdir(const String& path) { return rmdir(path.c_str()); }
+
+ protected:
+  const char* label_;
+  bool mounted_ = false;
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekMode;
+using fs::SeekSet;
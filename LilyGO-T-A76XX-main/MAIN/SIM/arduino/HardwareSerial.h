@@ -0,0 +1,61 @@
+#pragma once
+
+#include <functional>
+#include "Stream.h"
+
+#define SERIAL_8N1 0x800001c
+
+class SimUartDevice;
+
+// UART stand-in. The peer device (console, A7670 emulator, NMEA source) is
+// chosen from the RX pin passed to begin(), so two HardwareSerial objects
+// that share a UART number behave like they do on the ESP32: they are the
+// same peripheral re-routed to other pins.
+class HardwareSerial : public Stream {
+ public:
+  explicit HardwareSerial(int uart_nr) : uart_nr_(uart_nr) {}
+
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1,
+             bool invert = false, unsigned long timeout_ms = 20000UL, uint8_t rxfifo_full_thrhd = 112);
+  void end(bool fullyTerminate = true);
+  void updateBaudRate(unsigned long baud);
+  uint32_t baudRate();
+  size_t setRxBufferSize(size_t new_size);
+  size_t setTxBufferSize(size_t new_size);
+  bool setRxFIFOFull(uint8_t fifoBytes);
+  bool setRxTimeout(uint8_t symbols_timeout);
+  void onReceive(std::function<void(void)> function, bool onlyOnTimeout = false);
+
+  int available() override;
+  int availableForWrite() override { return 128; }
+  int peek() override;
+  int read() override;
+  size_t read(uint8_t* buffer, size_t size);
+  size_t read(char* buffer, size_t size) { return read(reinterpret_cast<uint8_t*>(buffer), size); }
+  size_t readBytes(char* buffer, size_t length) override;
+  size_t readBytes(uint8_t* buffer, size_t length) override {
+    return readBytes(reinterpret_cast<char*>(buffer), length);
+  }
+  void flush() override;
+  size_t write(uint8_t) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  operator bool() const { return true; }
+
+  int uartNumber() const { return uart_nr_; }
+  // Invoked by the simulator when bytes arrive for an onReceive() listener.
+  void simNotifyReceive(bool lineIdle);
+
+ private:
+  int uart_nr_;
+  unsigned long baud_ = 0;
+  SimUartDevice* device_ = nullptr;
+  size_t rxBufferSize_ = 256;
+  uint8_t rxTimeoutSymbols_ = 2;
+  std::function<void(void)> onReceive_;
+  bool onReceiveOnlyOnTimeout_ = false;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
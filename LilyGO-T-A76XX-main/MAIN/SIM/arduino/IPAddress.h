@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+#include "Print.h"
+
+class IPAddress : public Printable {
+ public:
+  IPAddress() : IPAddress(0, 0, 0, 0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) { bytes_[0] = a; bytes_[1] = b; bytes_[2] = c; bytes_[3] = d; }
+  explicit IPAddress(uint32_t address) { memcpy(bytes_, &address, 4); }
+  uint8_t operator[](int index) const { return bytes_[index]; }
+  uint8_t& operator[](int index) { return bytes_[index]; }
+  operator uint32_t() const { uint32_t v; memcpy(&v, bytes_, 4); return v; }
+  uint8_t* raw_address() { return bytes_; }
+  String toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", bytes_[0], bytes_[1], bytes_[2], bytes_[3]);
+    return String(buf);
+  }
+  size_t printTo(Print& p) const override { return p.print(toString()); }
+
+ private:
+  uint8_t bytes_[4];
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "FS.h"
+
+namespace fs {
+
+// Backed by a directory under the simulator state dir (see sim_fs.cpp).
+class LittleFSFS : public FS {
+ public:
+  LittleFSFS() : FS("littlefs") {}
+  bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+             const char* partitionLabel = "spiffs");
+  bool format();
+  size_t totalBytes();
+  size_t usedBytes();
+  void end();
+};
+
+}  // namespace fs
+
+extern fs::LittleFSFS LittleFS;
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Arduino.h"
+
+// NVS stand-in: one file per namespace under the simulator state dir.
+class Preferences {
+ public:
+  Preferences() {}
+  ~Preferences() { end(); }
+
+  bool begin(const char* name, bool readOnly = false, const char* partition_label = NULL);
+  void end();
+
+  bool clear();
+  bool remove(const char* key);
+  bool isKey(const char* key);
+
+  size_t putChar(const char* key, int8_t value) { return putRaw(key, &value, sizeof(value)); }
+  size_t putUChar(const char* key, uint8_t value) { return putRaw(key, &value, sizeof(value)); }
+  size_t putShort(const char* key, int16_t value) { return putRaw(key, &value, sizeof(value)); }
+  size_t putUShort(const char* key, uint16_t value) { return putRaw(key, &value, sizeof(value)); }
+  size_t putInt(const char* key, int32_t value) { return putRaw(key, &value, sizeof(value)); }
+  size_t putUInt(const char* key, uint32_t value) { return putRaw(key, &value, sizeof(value)); }
+  size_t putLong(const char* key, int32_t value) { return putRaw(key, &value, sizeof(value)); }
+  size_t putULong(const char* key, uint32_t value) { return putRaw(key, &value, sizeof(value)); }
+  size_t putLong64(const char* key, int64_t value) { return putRaw(key, &value, sizeof(value)); }
+  size_t putULong64(const char* key, uint64_t value) { return putRaw(key, &value, sizeof(value)); }
+  size_t putFloat(const char* key, float value) { return putRaw(key, &value, sizeof(value)); }
+  size_t putDouble(const char* key, double value) { return putRaw(key, &value, sizeof(value)); }
+  size_t putBool(const char* key, bool value) { uint8_t v = value ? 1 : 0; return putRaw(key, &v, 1); }
+  size_t putString(const char* key, const char* value);
+  size_t putString(const char* key, const String& value) { return putString(key, value.c_str()); }
+  size_t putBytes(const char* key, const void* value, size_t len) { return putRaw(key, value, len); }
+
+  int8_t getChar(const char* key, int8_t defaultValue = 0) { return getPod(key, defaultValue); }
+  uint8_t getUChar(const char* key, uint8_t defaultValue = 0) { return getPod(key, defaultValue); }
+  int16_t getShort(const char* key, int16_t defaultValue = 0) { return getPod(key, defaultValue); }
+  uint16_t getUShort(const char* key, uint16_t defaultValue = 0) { return getPod(key, defaultValue); }
+  int32_t getInt(const char* key, int32_t defaultValue = 0) { return getPod(key, defaultValue); }
+  uint32_t getUInt(const char* key, uint32_t defaultValue = 0) { return getPod(key, defaultValue); }
+  int32_t getLong(const char* key, int32_t defaultValue = 0) { return getPod(key, defaultValue); }
+  uint32_t getULong(const char* key, uint32_t defaultValue = 0) { return getPod(key, defaultValue); }
+  int64_t getLong64(const char* key, int64_t defaultValue = 0) { return getPod(key, defaultValue); }
+  uint64_t getULong64(const char* key, uint64_t defaultValue = 0) { return getPod(key, defaultValue); }
+  float getFloat(const char* key, float defaultValue = NAN) { return getPod(key, defaultValue); }
+  double getDouble(const char* key, double defaultValue = NAN) { return getPod(key, defaultValue); }
+  bool getBool(const char* key, bool defaultValue = false) { return getPod<uint8_t>(key, defaultValue ? 1 : 0) != 0; }
+  String getString(const char* key, String defaultValue = String());
+  size_t getString(const char* key, char* value, size_t maxLen);
+  size_t getBytesLength(const char* key);
+  size_t getBytes(const char* key, void* buf, size_t maxLen);
+
+ private:
+  size_t putRaw(const char* key, const void* value, size_t len);
+  bool getRaw(const char* key, void* out, size_t len);
+  template <typename T>
+  T getPod(const char* key, T defaultValue) {
+    T v;
+    return getRaw(key, &v, sizeof(v)) ? v : defaultValue;
+  }
+
+  String name_;
+  bool started_ = false;
+  bool readOnly_ = false;
+};
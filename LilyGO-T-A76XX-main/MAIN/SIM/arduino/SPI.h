@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Arduino.h"
+
+// Only what SensorLib needs to compile; nothing on the simulated board is on SPI.
+#define SPI_MSBFIRST 1
+#define SPI_LSBFIRST 0
+#define SPI_MODE0 0
+#define SPI_MODE1 1
+#define SPI_MODE2 2
+#define SPI_MODE3 3
+
+class SPISettings {
+ public:
+  SPISettings() {}
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) { (void)clock; (void)bitOrder; (void)dataMode; }
+};
+
+class SPIClass {
+ public:
+  void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) { (void)sck; (void)miso; (void)mosi; (void)ss; }
+  void end() {}
+  void beginTransaction(SPISettings settings) { (void)settings; }
+  void endTransaction() {}
+  uint8_t transfer(uint8_t data) { (void)data; return 0xFF; }
+  void transfer(void* data, uint32_t size) { memset(data, 0xFF, size); }
+  void transferBytes(const uint8_t* data, uint8_t* out, uint32_t size) {
+    (void)data;
+    if (out) memset(out, 0xFF, size);
+  }
+};
+
+extern SPIClass SPI;
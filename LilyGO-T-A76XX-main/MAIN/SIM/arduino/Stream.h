@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Print.h"
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+  unsigned long getTimeout() const { return _timeout; }
+
+  bool find(const char* target) { return findUntil(target, strlen(target), NULL, 0); }
+  bool find(const char* target, size_t length) { return findUntil(target, length, NULL, 0); }
+  bool find(char target) { return find(&target, 1); }
+  bool findUntil(const char* target, size_t targetLen, const char* terminate, size_t termLen);
+
+  long parseInt() { return parseInt(NO_SKIP_CHAR); }
+  long parseInt(char skipChar);
+  float parseFloat();
+
+  virtual size_t readBytes(char* buffer, size_t length);
+  virtual size_t readBytes(uint8_t* buffer, size_t length) {
+    return readBytes(reinterpret_cast<char*>(buffer), length);
+  }
+  size_t readBytesUntil(char terminator, char* buffer, size_t length);
+  size_t readBytesUntil(char terminator, uint8_t* buffer, size_t length) {
+    return readBytesUntil(terminator, reinterpret_cast<char*>(buffer), length);
+  }
+  String readString();
+  String readStringUntil(char terminator);
+
+ protected:
+  static const char NO_SKIP_CHAR = 1;
+  unsigned long _timeout = 1000;
+  int timedRead();
+  int timedPeek();
+  int peekNextDigit();
+};
@@ -0,0 +1,4 @@
+#pragma once
+
+// Declaration-only stand-in: the simulation build does not compile ota_mode.cpp.
+#include "Arduino.h"
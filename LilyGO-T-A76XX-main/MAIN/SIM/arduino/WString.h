@@ -0,0 +1,135 @@
+#pragma once
+
+// Arduino String stand-in backed by std::string. Mirrors the behaviour of the
+// ESP32 core closely enough for the firmware, TinyGSM and ArduinoJson.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+class __FlashStringHelper;
+
+class String {
+ public:
+  String(const char* cstr = "") { if (cstr) s_ = cstr; }
+  String(const char* cstr, unsigned int length) { if (cstr) s_.assign(cstr, length); }
+  String(const String& str) = default;
+  String(String&& str) = default;
+  String(const __FlashStringHelper* str) : String(reinterpret_cast<const char*>(str)) {}
+  explicit String(char c) : s_(1, c) {}
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(long long value, unsigned char base = 10);
+  explicit String(unsigned long long value, unsigned char base = 10);
+  explicit String(float value, unsigned int decimalPlaces = 2);
+  explicit String(double value, unsigned int decimalPlaces = 2);
+
+  String& operator=(const String& rhs) = default;
+  String& operator=(String&& rhs) = default;
+  String& operator=(const char* cstr) { s_ = cstr ? cstr : ""; return *this; }
+  String& operator=(const __FlashStringHelper* str) { return *this = reinterpret_cast<const char*>(str); }
+
+  bool reserve(unsigned int size) { s_.reserve(size); return true; }
+  unsigned int length() const { return static_cast<unsigned int>(s_.size()); }
+  bool isEmpty() const { return s_.empty(); }
+  void clear() { s_.clear(); }
+
+  bool concat(const String& str) { s_ += str.s_; return true; }
+  bool concat(const char* cstr) { if (!cstr) return false; s_ += cstr; return true; }
+  bool concat(const char* cstr, unsigned int length) { if (!cstr) return false; s_.append(cstr, length); return true; }
+  bool concat(const uint8_t* cstr, unsigned int length) { return concat(reinterpret_cast<const char*>(cstr), length); }
+  bool concat(char c) { s_ += c; return true; }
+  bool concat(unsigned char num) { return concat(String(num)); }
+  bool concat(int num) { return concat(String(num)); }
+  bool concat(unsigned int num) { return concat(String(num)); }
+  bool concat(long num) { return concat(String(num)); }
+  bool concat(unsigned long num) { return concat(String(num)); }
+  bool concat(long long num) { return concat(String(num)); }
+  bool concat(unsigned long long num) { return concat(String(num)); }
+  bool concat(float num) { return concat(String(num)); }
+  bool concat(double num) { return concat(String(num)); }
+  bool concat(const __FlashStringHelper* str) { return concat(reinterpret_cast<const char*>(str)); }
+
+  template <typename T>
+  String& operator+=(const T& rhs) { concat(rhs); return *this; }
+  String& operator+=(const char* rhs) { concat(rhs); return *this; }
+
+  explicit operator bool() const { return true; }
+
+  int compareTo(const String& s) const { return s_.compare(s.s_); }
+  bool equals(const String& s) const { return s_ == s.s_; }
+  bool equals(const char* cstr) const { return s_ == (cstr ? cstr : ""); }
+  bool equalsIgnoreCase(const String& s) const;
+  bool operator==(const String& rhs) const { return equals(rhs); }
+  bool operator==(const char* cstr) const { return equals(cstr); }
+  bool operator==(const __FlashStringHelper* str) const { return equals(reinterpret_cast<const char*>(str)); }
+  bool operator!=(const String& rhs) const { return !equals(rhs); }
+  bool operator!=(const char* cstr) const { return !equals(cstr); }
+  bool operator<(const String& rhs) const { return s_ < rhs.s_; }
+  bool operator>(const String& rhs) const { return s_ > rhs.s_; }
+
+  bool startsWith(const String& prefix) const { return startsWith(prefix, 0); }
+  bool startsWith(const String& prefix, unsigned int offset) const;
+  bool endsWith(const String& suffix) const { return endsWith(suffix.c_str(), suffix.length()); }
+  bool endsWith(const char* suffix) const { return suffix && endsWith(suffix, strlen(suffix)); }
+  bool endsWith(const char* suffix, size_t n) const {
+    return s_.size() >= n && s_.compare(s_.size() - n, n, suffix, n) == 0;
+  }
+
+  char charAt(unsigned int index) const { return index < s_.size() ? s_[index] : 0; }
+  void setCharAt(unsigned int index, char c) { if (index < s_.size()) s_[index] = c; }
+  char operator[](unsigned int index) const { return charAt(index); }
+  char& operator[](unsigned int index) { return s_[index]; }
+  void getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index = 0) const;
+  void toCharArray(char* buf, unsigned int bufsize, unsigned int index = 0) const {
+    getBytes(reinterpret_cast<unsigned char*>(buf), bufsize, index);
+  }
+  const char* c_str() const { return s_.c_str(); }
+  char* begin() { return &s_[0]; }
+  char* end() { return &s_[0] + s_.size(); }
+  const char* begin() const { return s_.c_str(); }
+  const char* end() const { return s_.c_str() + s_.size(); }
+
+  int indexOf(char ch, unsigned int fromIndex = 0) const;
+  int indexOf(const String& str, unsigned int fromIndex = 0) const;
+  int indexOf(const char* str, unsigned int fromIndex = 0) const { return indexOf(String(str), fromIndex); }
+  int indexOf(const __FlashStringHelper* str, unsigned int fromIndex = 0) const {
+    return indexOf(reinterpret_cast<const char*>(str), fromIndex);
+  }
+  int lastIndexOf(char ch) const;
+  int lastIndexOf(const String& str) const;
+  String substring(unsigned int beginIndex) const { return substring(beginIndex, length()); }
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+  void replace(char find, char replace);
+  void replace(const String& find, const String& replace);
+  void replace(const char* find, const char* replace) { this->replace(String(find), String(replace)); }
+  void remove(unsigned int index) { if (index < s_.size()) s_.erase(index); }
+  void remove(unsigned int index, unsigned int count) { if (index < s_.size()) s_.erase(index, count); }
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+
+  long toInt() const { return atol(s_.c_str()); }
+  float toFloat() const { return static_cast<float>(atof(s_.c_str())); }
+  double toDouble() const { return atof(s_.c_str()); }
+
+  const std::string& std() const { return s_; }
+
+ private:
+  std::string s_;
+};
+
+String operator+(const String& lhs, const String& rhs);
+String operator+(const String& lhs, const char* rhs);
+String operator+(const char* lhs, const String& rhs);
+String operator+(const String& lhs, char rhs);
+String operator+(const String& lhs, int rhs);
+String operator+(const String& lhs, unsigned int rhs);
+String operator+(const String& lhs, long rhs);
+String operator+(const String& lhs, unsigned long rhs);
+String operator+(const String& lhs, double rhs);
+String operator+(const String& lhs, const __FlashStringHelper* rhs);
@@ -0,0 +1,9 @@
+#pragma once
+
+// Declaration-only stand-in: the simulation build does not compile ota_mode.cpp.
+#include "Arduino.h"
+
+class WebServer {
+ public:
+  explicit WebServer(int port = 80) { (void)port; }
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+typedef enum { WIFI_OFF = 0, WIFI_STA, WIFI_AP, WIFI_AP_STA } wifi_mode_t;
+
+class WiFiClass {
+ public:
+  String macAddress();
+  bool mode(wifi_mode_t m) { (void)m; return true; }
+  bool disconnect(bool wifioff = false) { (void)wifioff; return true; }
+  bool softAP(const char* ssid, const char* passphrase = nullptr) { (void)ssid; (void)passphrase; return true; }
+  IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+};
+extern WiFiClass WiFi;
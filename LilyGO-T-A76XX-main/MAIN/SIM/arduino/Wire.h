@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Arduino.h"
+
+#define SDA 21
+#define SCL 22
+
+// I2C master stand-in. Transactions go to the emulated device at the address
+// (sim_i2c_device()); an address nobody answers on is NACKed like on the bus.
+class TwoWire : public Stream {
+ public:
+  explicit TwoWire(int bus_num) : bus_num_(bus_num) {}
+
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+  bool end() { return true; }
+  bool setClock(uint32_t frequency) { (void)frequency; return true; }
+  size_t setBufferSize(size_t size) { return size <= sizeof(rx_) ? size : 0; }
+
+  void beginTransmission(uint8_t address);
+  uint8_t endTransmission(bool sendStop = true);
+  size_t requestFrom(uint8_t address, size_t size, bool sendStop = true);
+
+  size_t write(uint8_t data) override;
+  size_t write(const uint8_t* data, size_t size) override;
+  using Print::write;
+  int available() override { return static_cast<int>(rxLen_ - rxPos_); }
+  int read() override { return rxPos_ < rxLen_ ? rx_[rxPos_++] : -1; }
+  int peek() override { return rxPos_ < rxLen_ ? rx_[rxPos_] : -1; }
+  size_t readBytes(char* buffer, size_t length) override;
+  size_t readBytes(uint8_t* buffer, size_t length) override {
+    return readBytes(reinterpret_cast<char*>(buffer), length);
+  }
+  void flush() override {}
+
+ private:
+  int bus_num_;
+  uint8_t address_ = 0;
+  uint8_t tx_[128];
+  size_t txLen_ = 0;
+  uint8_t rx_[128];
+  size_t rxLen_ = 0;
+  size_t rxPos_ = 0;
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
@@ -0,0 +1,4 @@
+#pragma once
+
+// GPIO hold functions live in esp_sleep.h in this stand-in.
+#include "esp_sleep.h"
@@ -0,0 +1,39 @@
+#pragma once
+
+// FreeRTOS stand-in built on std::thread; one tick is one virtual millisecond.
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define errQUEUE_EMPTY ((BaseType_t)0)
+#define errQUEUE_FULL ((BaseType_t)0)
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t)(xTimeInMs))
+#define configMAX_PRIORITIES 25
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+struct SimCriticalSection;
+typedef struct {
+  SimCriticalSection* impl;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {nullptr}
+
+void sim_port_enter_critical(portMUX_TYPE* mux);
+void sim_port_exit_critical(portMUX_TYPE* mux);
+#define portENTER_CRITICAL(mux) sim_port_enter_critical(mux)
+#define portEXIT_CRITICAL(mux) sim_port_exit_critical(mux)
+#define portENTER_CRITICAL_ISR(mux) sim_port_enter_critical(mux)
+#define portEXIT_CRITICAL_ISR(mux) sim_port_exit_critical(mux)
+#define portYIELD_FROM_ISR(...) ((void)0)
+#define portYIELD() ((void)0)
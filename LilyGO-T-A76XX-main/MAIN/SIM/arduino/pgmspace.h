@@ -0,0 +1,4 @@
+#pragma once
+
+// PROGMEM helpers live in Arduino.h for the simulation build.
+#include "Arduino.h"
@@ -0,0 +1,254 @@
+// Host benchmark of the modem UART receive path (MAIN/FINAL/modem_serial.h).
+//
+// A bulk download (+CCHRECV / +CIPRXGET payload) is pushed over a modeled ESP32
+// UART in virtual time and consumed
+//   - the previous way: TinyGSM's per-byte available()/read() on SerialAT,
+//     with the Arduino default 256 B driver ring
+//   - through ModemSerial: 64 B readBytes() blocks, ring of MODEM_UART_RX_BUFFER
+// at 115200 and 921600 baud. The consumer task is periodically descheduled
+// (GPS task, flash writes); whatever does not fit the 128 B hardware FIFO plus
+// the driver ring during that time is lost. Printed: payload bytes/second,
+// lost bytes and the share of the time spent in UART driver calls.
+//
+//   make bench            (from MAIN/SIM)
+//   ./bench/at_uart_bench [payload bytes]
+//
+// The per-call costs below are estimates for Arduino-ESP32 at 240 MHz (every
+// driver call takes the UART mutex and goes through the IDF ring buffer), not
+// measurements; the comparison depends on their ratio to the byte time
+// (86.8 us at 115200, 10.85 us at 921600), not on their exact values.
+
+#include <Arduino.h>
+#include <HardwareSerial.h>
+
+#include "modem_serial.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+
+namespace {
+
+// Modeled costs, nanoseconds
+const uint64_t COST_AVAILABLE_NS = 2000;  // HardwareSerial::available()
+const uint64_t COST_READ_NS = 6000;       // HardwareSerial::read(), one byte
+const uint64_t COST_BULK_CALL_NS = 8000;  // HardwareSerial::read(buf, n)
+const uint64_t COST_BULK_BYTE_NS = 20;    //   + per byte copied
+const uint64_t COST_PUT_BYTE_NS = 300;    // Loop overhead + rx FIFO put, per byte
+const uint64_t COST_BLOCK_PUT_NS = 40;    // rx.put(block, n), per byte
+const uint64_t COST_YIELD_NS = 1000;      // delay(0) / TINY_GSM_YIELD() while waiting
+
+// Consumer task descheduled for STALL_NS every STALL_PERIOD_NS
+const uint64_t STALL_PERIOD_NS = 250000000;
+const uint64_t STALL_NS = 20000000;
+
+const size_t HW_FIFO = 128;
+const size_t RX_RING = 4096;  // MODEM_UART_RX_BUFFER (config.h)
+
+struct Line {
+  uint64_t now = 0;         // Consumer time
+  uint64_t byteNs = 0;      // One 8N1 character on the line
+  uint64_t nextArrival = 0;
+  size_t toSend = 0;
+  size_t sent = 0;
+  size_t lost = 0;
+  size_t ringSize = 256;
+  std::deque<uint8_t> rx;   // Hardware FIFO + driver ring
+  uint64_t busy = 0;        // Time spent in driver calls
+
+  // Delivers everything that arrived up to the consumer time
+  void receive() {
+    while (sent < toSend && nextArrival <= now) {
+      if (rx.size() < ringSize + HW_FIFO) {
+        rx.push_back(static_cast<uint8_t>(sent));
+      } else {
+        lost++;
+      }
+      sent++;
+      nextArrival += byteNs;
+    }
+  }
+
+  // Consumer runs for ns; a stall window it runs into is skipped
+  void spend(uint64_t ns, bool driver) {
+    now += ns;
+    if (driver) {
+      busy += ns;
+    }
+    uint64_t phase = now % STALL_PERIOD_NS;
+    if (phase < STALL_NS) {
+      now += STALL_NS - phase;
+    }
+    receive();
+  }
+
+  // Consumer waits for the next byte
+  void idle() {
+    if (sent < toSend && nextArrival > now + COST_YIELD_NS) {
+      now = nextArrival - COST_YIELD_NS;
+    }
+    spend(COST_YIELD_NS, false);
+  }
+
+  bool finished() const { return sent == toSend && rx.empty(); }
+};
+
+Line g_line;
+
+}  // namespace
+
+// Arduino runtime the bench links against instead of the simulator
+unsigned long millis() { return g_line.now / 1000000; }
+unsigned long micros() { return g_line.now / 1000; }
+void delay(uint32_t ms) {
+  if (ms == 0) {
+    g_line.idle();
+  } else {
+    g_line.spend(uint64_t(ms) * 1000000, false);
+  }
+}
+void yield() { g_line.idle(); }
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) { return 0; }
+
+HardwareSerial Serial1(1);
+
+void HardwareSerial::begin(unsigned long baud, uint32_t, int8_t, int8_t, bool, unsigned long, uint8_t) {
+  baud_ = baud;
+  g_line.byteNs = 10000000000ULL / baud;
+}
+void HardwareSerial::updateBaudRate(unsigned long baud) { begin(baud); }
+size_t HardwareSerial::setRxBufferSize(size_t new_size) {
+  g_line.ringSize = new_size;
+  return new_size;
+}
+int HardwareSerial::available() {
+  g_line.spend(COST_AVAILABLE_NS, true);
+  return static_cast<int>(g_line.rx.size());
+}
+int HardwareSerial::peek() { return g_line.rx.empty() ? -1 : g_line.rx.front(); }
+int HardwareSerial::read() {
+  g_line.spend(COST_READ_NS, true);
+  if (g_line.rx.empty()) {
+    return -1;
+  }
+  int c = g_line.rx.front();
+  g_line.rx.pop_front();
+  return c;
+}
+size_t HardwareSerial::read(uint8_t* buffer, size_t size) {
+  size_t n = size < g_line.rx.size() ? size : g_line.rx.size();
+  g_line.spend(COST_BULK_CALL_NS + n * COST_BULK_BYTE_NS, true);
+  for (size_t i = 0; i < n; i++) {
+    buffer[i] = g_line.rx.front();
+    g_line.rx.pop_front();
+  }
+  return n;
+}
+// uartReadBytes(): the task blocks in the driver until length bytes or the timeout
+size_t HardwareSerial::readBytes(char* buffer, size_t length) {
+  uint64_t deadline = g_line.now + uint64_t(_timeout) * 1000000;
+  while (g_line.rx.size() < length && g_line.sent < g_line.toSend && g_line.now < deadline) {
+    g_line.idle();
+  }
+  return read(reinterpret_cast<uint8_t*>(buffer), length);
+}
+void HardwareSerial::flush() {}
+size_t HardwareSerial::write(uint8_t) { return 1; }
+size_t HardwareSerial::write(const uint8_t*, size_t size) { return size; }
+
+namespace {
+
+struct Result {
+  double bytesPerSecond;
+  size_t lost;
+  double busyShare;
+};
+
+void start_line(size_t payload) {
+  g_line.now = 0;
+  g_line.nextArrival = g_line.byteNs;
+  g_line.toSend = payload;
+  g_line.sent = 0;
+  g_line.lost = 0;
+  g_line.rx.clear();
+  g_line.busy = 0;
+}
+
+// end: consumer time when the last byte was taken
+Result finish_line(size_t received, uint64_t end) {
+  Result r;
+  r.bytesPerSecond = received * 1e9 / end;
+  r.lost = g_line.lost;
+  r.busyShare = 100.0 * g_line.busy / end;
+  return r;
+}
+
+// TinyGSM modemRead() before: while (!available()) yield; put(read());
+Result run_per_byte(unsigned long baud, size_t payload) {
+  Serial1.setRxBufferSize(256);
+  Serial1.begin(baud);
+  start_line(payload);
+  size_t received = 0;
+  uint64_t end = 0;
+  while (!g_line.finished()) {
+    while (!g_line.finished() && !Serial1.available()) {
+      yield();
+    }
+    if (g_line.finished()) {
+      break;
+    }
+    Serial1.read();
+    g_line.spend(COST_PUT_BYTE_NS, false);
+    received++;
+    end = g_line.now;
+  }
+  return finish_line(received, end);
+}
+
+// TinyGSM modemRead() now: readBytes() into a 64 B block, one put per block
+Result run_modem_serial(unsigned long baud, size_t payload) {
+  ModemSerial serial(Serial1);
+  serial.begin(baud, -1, -1, RX_RING);
+  serial.setTimeout(20);
+  start_line(payload);
+  size_t received = 0;
+  uint64_t end = 0;
+  uint8_t block[64];
+  while (!g_line.finished()) {
+    size_t n = serial.readBytes(block, sizeof(block));
+    g_line.spend(n * COST_BLOCK_PUT_NS, false);
+    received += n;
+    if (n > 0) {
+      end = g_line.now;
+    }
+  }
+  return finish_line(received, end);
+}
+
+void print_row(const char* name, unsigned long baud, const Result& r) {
+  printf("  %-36s %7lu  %9.0f B/s  %6.1f%% of line  lost %6zu B  driver calls %5.1f%%\n", name, baud,
+         r.bytesPerSecond, 100.0 * r.bytesPerSecond / (baud / 10.0), r.lost, r.busyShare);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t payload = argc > 1 ? strtoul(argv[1], nullptr, 10) : 256 * 1024;
+  printf("Bulk receive of %zu B, consumer stalled %llu ms every %llu ms\n", payload,
+         (unsigned long long)(STALL_NS / 1000000), (unsigned long long)(STALL_PERIOD_NS / 1000000));
+  print_row("per-byte read(), 256 B ring", 115200, run_per_byte(115200, payload));
+  print_row("per-byte read(), 256 B ring", 921600, run_per_byte(921600, payload));
+  print_row("ModemSerial readBytes(), 4096 B ring", 115200, run_modem_serial(115200, payload));
+  print_row("ModemSerial readBytes(), 4096 B ring", 921600, run_modem_serial(921600, payload));
+  return 0;
+}
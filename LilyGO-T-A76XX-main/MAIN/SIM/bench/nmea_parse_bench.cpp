@@ -0,0 +1,167 @@
+// Host benchmark of the TinyGPS++ NMEA parser (lib/TinyGPSPlus).
+//
+// Builds the library twice, with and without _GPS_FAST_PARSER, and feeds
+// both the same NMEA logs byte by byte: once as recorded (every sentence the
+// L76K sends by default) and once reduced to GGA + RMC, as configured by
+// $PCAS03. GSA/GSV are decoded into satellitesInView, and a few
+// TinyGPSCustom elements (GSA, GSV) are registered so the custom-term
+// dispatch is exercised too. Both parsers must agree on every decoded
+// value and statistic; then the throughput in bytes/second is printed.
+//
+//   make bench               (from MAIN/SIM)
+//   ./bench/nmea_parse_bench [repetitions] [log.nmea ...]
+//
+// Without a log argument bench/nmea/l76k_full_output.nmea is used: 90 s of
+// default L76K output (cold start to fix, then driving), including an
+// antenna TXT message and one sentence with a corrupted byte.
+
+#include <Arduino.h>
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// The parser only stamps commit times; the sim core is not linked in
+unsigned long millis() { return 0; }
+
+namespace legacy {
+#define _GPS_FAST_PARSER 0
+#include <TinyGPS++.cpp>
+}  // namespace legacy
+
+#undef _GPS_FAST_PARSER
+#undef _GPS_ATOL
+#undef __TinyGPSPlus_h
+
+namespace fast {
+#define _GPS_FAST_PARSER 1
+#include <TinyGPS++.cpp>
+}  // namespace fast
+
+namespace {
+
+std::string read_file(const char* path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+// Keeps only the sentences left after $PCAS03,1,0,0,0,1,...
+std::string gga_rmc_only(const std::string& log) {
+  std::string out;
+  std::istringstream in(log);
+  for (std::string line; std::getline(in, line);) {
+    if (line.size() > 6 && (line.compare(3, 3, "GGA") == 0 || line.compare(3, 3, "RMC") == 0)) {
+      out += line + "\n";
+    }
+  }
+  return out;
+}
+
+template <class Gps, class Custom>
+struct Parser {
+  Gps gps;
+  Custom gsaPdop, gsaSystem, gpsInView, bdsInView;
+
+  Parser() {
+    gsaPdop.begin(gps, "GNGSA", 15);
+    gsaSystem.begin(gps, "GNGSA", 18);
+    gpsInView.begin(gps, "GPGSV", 3);
+    bdsInView.begin(gps, "BDGSV", 3);
+  }
+
+  // Decodes the log and folds every updated value into a checksum
+  uint64_t feed(const std::string& log) {
+    uint64_t sum = 0;
+    for (char c : log) {
+      if (!gps.encode(c)) continue;
+      if (gps.location.isUpdated()) {
+        sum = sum * 31 + gps.location.rawLat().billionths + gps.location.rawLng().deg;
+      }
+      if (gps.time.isUpdated()) sum = sum * 31 + gps.time.value();
+      if (gps.date.isUpdated()) sum = sum * 31 + gps.date.value();
+      if (gps.satellites.isUpdated()) sum = sum * 31 + gps.satellites.value();
+      if (gps.hdop.isUpdated()) sum = sum * 31 + static_cast<uint32_t>(gps.hdop.value());
+      if (gps.speed.isUpdated()) sum = sum * 31 + static_cast<uint32_t>(gps.speed.value());
+      if (gps.altitude.isUpdated()) sum = sum * 31 + static_cast<uint32_t>(gps.altitude.value());
+      if (gps.pdop.isUpdated()) sum = sum * 31 + static_cast<uint32_t>(gps.pdop.value() + gps.vdop.value());
+      if (gps.satellitesInView.isUpdated()) {
+        auto& sky = gps.satellitesInView;
+        sum = sum * 31 + sky.count() + 100u * sky.usedWithCn0(30) + 10000u * sky.meanUsedCn0();
+      }
+      for (Custom* e : {&gsaPdop, &gsaSystem, &gpsInView, &bdsInView}) {
+        if (e->isUpdated()) sum = sum * 31 + strtoul(e->value(), nullptr, 10) + 7;
+      }
+    }
+    sum = sum * 31 + gps.passedChecksum();
+    sum = sum * 31 + gps.failedChecksum();
+    return sum * 31 + gps.sentencesWithFix();
+  }
+};
+
+using LegacyParser = Parser<legacy::TinyGPSPlus, legacy::TinyGPSCustom>;
+using FastParser = Parser<fast::TinyGPSPlus, fast::TinyGPSCustom>;
+
+template <class P>
+double bytes_per_second(const std::string& log, int reps, uint64_t& sink) {
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < reps; r++) {
+    P parser;
+    sink += parser.feed(log);
+  }
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return static_cast<double>(log.size()) * reps / s;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int reps = argc > 1 ? atoi(argv[1]) : 1000;
+  std::vector<std::string> paths;
+  for (int i = 2; i < argc; i++) paths.push_back(argv[i]);
+  if (paths.empty()) paths.push_back("bench/nmea/l76k_full_output.nmea");
+
+  std::string full;
+  for (const std::string& path : paths) {
+    std::string log = read_file(path.c_str());
+    if (log.empty()) {
+      printf("cannot read %s\n", path.c_str());
+      return 1;
+    }
+    full += log;
+  }
+  struct Input {
+    const char* name;
+    std::string log;
+  } inputs[] = {{"full output", full}, {"GGA + RMC", gga_rmc_only(full)}};
+
+  int status = 0;
+  for (const Input& in : inputs) {
+    LegacyParser a;
+    FastParser b;
+    uint64_t ca = a.feed(in.log), cb = b.feed(in.log);
+    if (ca != cb || a.gps.passedChecksum() != b.gps.passedChecksum()) {
+      printf("%-12s mismatch: legacy %016llx, fast %016llx\n", in.name,
+             static_cast<unsigned long long>(ca), static_cast<unsigned long long>(cb));
+      status = 1;
+      continue;
+    }
+    uint64_t sink = 0;
+    double legacyRate = bytes_per_second<LegacyParser>(in.log, reps, sink);
+    double fastRate = bytes_per_second<FastParser>(in.log, reps, sink);
+    printf("%-12s %7zu B, %4u sentences (%u bad): legacy %6.1f MB/s, fast %6.1f MB/s, x%.2f  (%llx)\n",
+           in.name, in.log.size(), static_cast<unsigned>(a.gps.passedChecksum() + a.gps.failedChecksum()),
+           static_cast<unsigned>(a.gps.failedChecksum()), legacyRate / 1e6, fastRate / 1e6,
+           fastRate / legacyRate, static_cast<unsigned long long>(sink & 0xffff));
+  }
+  return status;
+}
@@ -0,0 +1,240 @@
+// Host check of waitResponse() with URCs arriving in the middle of a response
+// (TinyGsmClientA7670.h, TinyGsmClientA76xxSSL.h).
+//
+// A scripted modem answers each command with a fixed transcript in which URCs
+// are interleaved with the awaited response. Every exchange must report the
+// expected pattern index with nothing the modem sent left unread or unmatched.
+// +CIPEVENT on the A7670 makes the driver check the data connection; that takes
+// commands of its own, which must go out from maintain() once the caller has
+// read its response, not from inside the wait: the matcher is shared by all
+// waits, and the check would eat the rest of the response. A failed action that
+// reports a negative body length (-9999) must fail instead of leaving a huge
+// unsigned length for the body read.
+//
+//   make check            (from MAIN/SIM; builds it for both modem classes)
+//   ./bench/urc_check_a7670
+//   ./bench/urc_check_a76xxssl
+
+#include <Arduino.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined URC_CHECK_A76XXSSL
+#include <TinyGsmClientA76xxSSL.h>
+typedef TinyGsmA76xxSSL ModemBase;
+#else
+#include <TinyGsmClientA7670.h>
+typedef TinyGsmA7670 ModemBase;
+#endif
+
+// Reads the fields after a matched response, as the driver's own commands do
+class Modem : public ModemBase {
+ public:
+  using ModemBase::ModemBase;
+  using ModemBase::streamGetIntBefore;
+  using ModemBase::streamSkipUntil;
+};
+
+// Arduino runtime the check links against instead of the simulator
+namespace {
+const auto g_start = std::chrono::steady_clock::now();
+}
+unsigned long millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - g_start).count();
+}
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void yield() {}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+size_t Print::print(unsigned long n, int base) {
+  char text[24];
+  snprintf(text, sizeof(text), base == 16 ? "%lX" : "%lu", n);
+  return write(reinterpret_cast<const uint8_t*>(text), strlen(text));
+}
+
+void String::trim() {
+  size_t begin = s_.find_first_not_of(" \t\r\n");
+  size_t end = s_.find_last_not_of(" \t\r\n");
+  s_ = begin == std::string::npos ? std::string() : s_.substr(begin, end - begin + 1);
+}
+void String::replace(const String& find, const String& replace) {
+  for (size_t pos = 0; !find.s_.empty() && (pos = s_.find(find.s_, pos)) != std::string::npos;
+       pos += replace.s_.size()) {
+    s_.replace(pos, find.s_.size(), replace.s_);
+  }
+}
+
+// Everything the script holds is in the buffer already: no waiting
+int Stream::timedRead() { return read(); }
+int Stream::timedPeek() { return peek(); }
+size_t Stream::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  for (int c; count < length && (c = timedRead()) >= 0; count++) {
+    buffer[count] = static_cast<char>(c);
+  }
+  return count;
+}
+size_t Stream::readBytesUntil(char terminator, char* buffer, size_t length) {
+  size_t count = 0;
+  for (int c; count < length && (c = timedRead()) >= 0 && c != terminator; count++) {
+    buffer[count] = static_cast<char>(c);
+  }
+  return count;
+}
+long Stream::parseInt(char skipChar) {
+  int c;
+  while ((c = timedPeek()) >= 0 && c != '-' && !isdigit(c)) read();
+  bool negative = c == '-';
+  if (negative) read();
+  long value = 0;
+  while ((c = timedPeek()) >= 0 && (isdigit(c) || c == skipChar)) {
+    if (c != skipChar) value = value * 10 + (c - '0');
+    read();
+  }
+  return negative ? -value : value;
+}
+
+namespace {
+
+// Answers every command line written to it with the reply scripted for it, and
+// anything off the script with ERROR
+class ScriptedModem : public Stream {
+ public:
+  struct Reply {
+    std::string command;  // Without "AT" and the line end
+    std::string bytes;
+  };
+
+  void script(const std::vector<Reply>& replies) {
+    replies_ = replies;
+    next_ = 0;
+    rx_.clear();
+    pos_ = 0;
+    sent_.clear();
+    line_.clear();
+  }
+
+  int available() override { return static_cast<int>(rx_.size() - pos_); }
+  int read() override { return pos_ < rx_.size() ? static_cast<uint8_t>(rx_[pos_++]) : -1; }
+  int peek() override { return pos_ < rx_.size() ? static_cast<uint8_t>(rx_[pos_]) : -1; }
+  size_t write(uint8_t c) override {
+    line_ += static_cast<char>(c);
+    if (c == '\n') {
+      std::string command = line_.substr(2, line_.size() - 4);  // "AT" ... "\r\n"
+      sent_.push_back(command);
+      if (next_ < replies_.size() && replies_[next_].command == command) {
+        rx_ += replies_[next_++].bytes;
+      } else {
+        rx_ += "\r\nERROR\r\n";
+      }
+      line_.clear();
+    }
+    return 1;
+  }
+
+  bool allRead() const { return pos_ == rx_.size() && next_ == replies_.size(); }
+  const std::vector<std::string>& sent() const { return sent_; }
+
+ private:
+  std::vector<Reply> replies_;
+  size_t next_ = 0;
+  std::string rx_;
+  size_t pos_ = 0;
+  std::string line_;
+  std::vector<std::string> sent_;
+};
+
+ScriptedModem g_line;
+Modem g_modem(g_line);
+int g_failures = 0;
+
+void expect(const char* name, bool ok, const char* detail) {
+  printf("  %-52s %s\n", name, ok ? "ok" : "FAILED");
+  if (!ok) {
+    printf("    %s\n", detail);
+    g_failures++;
+  }
+}
+
+void print_sent() {
+  for (const std::string& command : g_line.sent()) {
+    printf("    sent AT%s\n", command.c_str());
+  }
+}
+
+// AT+HTTPACTION: OK first, the result line later; a URC lands in between
+void check_action(const char* name, const char* urc) {
+  g_line.script({{"+HTTPACTION=1", std::string("\r\nOK\r\n\r\n") + urc + "\r\n\r\n+HTTPACTION: 1,200,57\r\n"}});
+  g_modem.sendAT(GF("+HTTPACTION=1"));
+  int8_t res = g_modem.waitResponse(2000L, GF("+HTTPACTION:"));
+  int status = res == 1 ? g_modem.streamGetIntBefore(',') : -1;
+  g_modem.streamSkipUntil('\n');
+  bool ok = res == 1 && status == 1 && g_line.allRead();
+  char detail[96];
+  snprintf(detail, sizeof(detail), "waitResponse() = %d, method %d, %s", res, status,
+           g_line.allRead() ? "all read" : "reply left unread");
+  expect(name, ok, detail);
+  if (!ok) print_sent();
+}
+
+// A plain command after the URC handling: the matcher must wait for OK again
+void check_following_command() {
+  g_line.script({{"+CSQ", "\r\n+CSQ: 21,99\r\n\r\nOK\r\n"}});
+  g_modem.sendAT(GF("+CSQ"));
+  int8_t res = g_modem.waitResponse(2000L, GF(GSM_NL "+CSQ:"));
+  int rssi = res == 1 ? g_modem.streamGetIntBefore(',') : -1;
+  g_modem.streamSkipUntil('\n');
+  bool ok = res == 1 && rssi == 21 && g_modem.waitResponse() == 1 && g_line.allRead();
+  expect("next command matches its own patterns", ok, "+CSQ exchange not matched");
+}
+
+// +HTTPACTION with the modem's failure length: the action fails, no body is read
+void check_negative_length() {
+  g_line.script({{"+HTTPACTION=0", "\r\nOK\r\n\r\n+HTTPACTION: 0,706,-9999\r\n"}});
+  int status = g_modem.https_get();
+  g_modem.streamSkipUntil('\n');
+  bool ok = status == -1 && g_modem.https_body_length() == 0 && g_line.allRead();
+  char detail[96];
+  snprintf(detail, sizeof(detail), "status %d, body length %lu", status,
+           static_cast<unsigned long>(g_modem.https_body_length()));
+  expect("+HTTPACTION length -9999 fails the action", ok, detail);
+}
+
+}  // namespace
+
+int main() {
+#if defined URC_CHECK_A76XXSSL
+  printf("TinyGsmA76xxSSL: URCs inside a response\n");
+  check_action("+CCHEVENT between OK and +HTTPACTION:", "+CCHEVENT: 1,RECV EVENT");
+  check_action("+CCH_PEER_CLOSED between OK and +HTTPACTION:", "+CCH_PEER_CLOSED: 1");
+  check_action("SMS DONE between OK and +HTTPACTION:", "SMS DONE");
+#else
+  printf("TinyGsmA7670: URCs inside a response\n");
+  check_action("+IPCLOSE between OK and +HTTPACTION:", "+IPCLOSE: 1,1");
+  check_action("+CIPEVENT between OK and +HTTPACTION:", "+CIPEVENT: NETWORK CLOSED UNEXPECTEDLY");
+  expect("nothing sent from inside the wait", g_line.sent().size() == 1, "the URC branch sent a command");
+  // The next maintain() finds the data connection gone and releases it
+  g_line.script({{"+CGATT?", "\r\n+CGATT: 0\r\n\r\nOK\r\n"}, {"+NETCLOSE", "\r\nOK\r\n\r\n+NETCLOSE: 0\r\n"}});
+  g_modem.maintain();
+  bool closed = g_line.sent() == std::vector<std::string>{"+CGATT?", "+NETCLOSE"};
+  expect("maintain() checks and closes the socket service", closed, "check not run, or not exactly once");
+  if (!closed) print_sent();
+#endif
+  check_following_command();
+  check_negative_length();
+  if (g_failures) {
+    printf("%d check(s) failed\n", g_failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,143 @@
+// Host benchmark of the waitResponse() matching loop (TinyGsmClientA7670.h).
+//
+// Replays a recorded-style A7670 AT transcript byte by byte through
+//   - the previous loop: append to a String, endsWith() against every pattern
+//   - TinyGsmResponseMatcher: one automaton step per byte
+// checks that both report the same pattern at the same byte, and prints the
+// cost per byte and the heap allocations of each.
+//
+//   make bench            (from MAIN/SIM)
+//   ./bench/wait_response_bench [repetitions]
+
+#include <Arduino.h>
+#include <TinyGsmResponseMatcher.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+static size_t g_allocations = 0;
+
+void* operator new(size_t size) {
+  g_allocations++;
+  void* p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+namespace {
+
+#define GSM_NL "\r\n"
+const char GSM_OK[] = "OK" GSM_NL;
+const char GSM_ERROR[] = "ERROR" GSM_NL;
+const char GSM_CME_ERROR[] = GSM_NL "+CME ERROR:";
+const char GSM_CMS_ERROR[] = GSM_NL "+CMS ERROR:";
+const char URC_CIPRXGET[] = GSM_NL "+CIPRXGET:";
+const char URC_RECEIVE[] = GSM_NL "+RECEIVE:";
+const char URC_IPCLOSE[] = "+IPCLOSE:";
+const char URC_CIPEVENT[] = "+CIPEVENT:";
+
+// One waitResponse() call: what arrives on the UART and the r1 it waits for
+struct Exchange {
+  std::string input;
+  const char* r1;
+};
+
+std::vector<Exchange> build_transcript() {
+  std::vector<Exchange> t;
+  auto ok = [&](const std::string& s) { t.push_back({s, GSM_OK}); };
+  ok("AT\r\r\nOK\r\n");
+  ok("AT+CSQ\r\r\n+CSQ: 21,99\r\n\r\nOK\r\n");
+  ok("AT+CEREG?\r\r\n+CEREG: 0,1\r\n\r\nOK\r\n");
+  ok("AT+HTTPINIT\r\r\nOK\r\n");
+  ok("AT+HTTPPARA=\"URL\",\"https://lotr-system.xyz/api/devices/input\"\r\r\nOK\r\n");
+  t.push_back({"AT+HTTPDATA=5641,10000\r\r\nDOWNLOAD\r\n", "DOWNLOAD"});
+  ok("\r\nOK\r\n");
+  t.push_back({"AT+HTTPACTION=1\r\r\nOK\r\n\r\n+HTTPACTION: 1,200,57\r\n", "+HTTPACTION:"});
+  // +HTTPREAD of a larger response body, the long tail where endsWith() hurts most
+  std::string body = "{\"success\":true,\"config\":{";
+  while (body.size() < 4000) body += "\"interval_gps\":60,\"interval_send\":10,";
+  body += "\"ok\":1}}";
+  ok("AT+HTTPREAD=0,4096\r\r\nOK\r\n\r\n+HTTPREAD: 4096\r\n" + body + "\r\n+HTTPREAD: 0\r\n\r\nOK\r\n");
+  ok("AT+HTTPTERM\r\r\nERROR\r\n");
+  ok("AT+CGPADDR=1\r\r\n+CGPADDR: 1,10.64.12.7\r\n\r\nOK\r\n");
+  return t;
+}
+
+// The loop as it was: String append + endsWith() per pattern per byte
+uint8_t legacy_wait(const std::string& in, size_t& consumed, const char* const* p, size_t count) {
+  String data;
+  data.reserve(64);
+  for (consumed = 0; consumed < in.size();) {
+    data += in[consumed++];
+    for (size_t i = 0; i < count; i++) {
+      if (p[i] && data.endsWith(p[i])) return static_cast<uint8_t>(i + 1);
+    }
+  }
+  return 0;
+}
+
+template <class Matcher>
+uint8_t matcher_wait(Matcher& m, const std::string& in, size_t& consumed, const char* const* p, size_t count) {
+  m.compile(reinterpret_cast<const GsmConstStr*>(p), static_cast<uint8_t>(count));
+  for (consumed = 0; consumed < in.size();) {
+    uint8_t hit = m.feed(in[consumed++]);
+    if (hit) return hit;
+  }
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int reps = argc > 1 ? atoi(argv[1]) : 2000;
+  std::vector<Exchange> transcript = build_transcript();
+  std::vector<std::vector<const char*>> patterns;
+  size_t bytes = 0;
+  for (const Exchange& e : transcript) {
+    patterns.push_back({e.r1, GSM_ERROR, GSM_CME_ERROR, GSM_CMS_ERROR, nullptr,
+                        URC_CIPRXGET, URC_RECEIVE, URC_IPCLOSE, URC_CIPEVENT});
+    bytes += e.input.size();
+  }
+
+  static TinyGsmResponseMatcher<9, 200> matcher;
+  for (size_t i = 0; i < transcript.size(); i++) {
+    size_t usedOld, usedNew;
+    uint8_t a = legacy_wait(transcript[i].input, usedOld, patterns[i].data(), 9);
+    uint8_t b = matcher_wait(matcher, transcript[i].input, usedNew, patterns[i].data(), 9);
+    if (a != b || usedOld != usedNew) {
+      printf("mismatch in exchange %zu: legacy %u@%zu, matcher %u@%zu\n", i, a, usedOld, b, usedNew);
+      return 1;
+    }
+  }
+
+  auto run = [&](const char* name, auto&& wait) {
+    size_t allocsBefore = g_allocations;
+    auto start = std::chrono::steady_clock::now();
+    unsigned sink = 0;
+    for (int r = 0; r < reps; r++) {
+      for (size_t i = 0; i < transcript.size(); i++) {
+        size_t used;
+        sink += wait(transcript[i].input, used, patterns[i].data());
+      }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    double total = static_cast<double>(bytes) * reps;
+    printf("%-10s %8.2f ns/byte  %8.3f allocations/byte  (checksum %u)\n", name, ns / total,
+           (g_allocations - allocsBefore) / total, sink);
+  };
+
+  printf("%zu exchanges, %zu bytes per pass, %d passes\n", transcript.size(), bytes, reps);
+  run("endsWith", [&](const std::string& in, size_t& used, const char* const* p) {
+    return legacy_wait(in, used, p, 9);
+  });
+  run("automaton", [&](const std::string& in, size_t& used, const char* const* p) {
+    return matcher_wait(matcher, in, used, p, 9);
+  });
+  return 0;
+}
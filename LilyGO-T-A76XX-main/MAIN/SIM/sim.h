@@ -0,0 +1,313 @@
+#pragma once
+
+// Internal interfaces of the MAIN/FINAL host simulation. Nothing in here is
+// visible to the firmware; it only sees the Arduino/ESP-IDF stand-ins.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+// --- Virtual clock -----------------------------------------------------------
+// Virtual time runs `scale` times faster than wall-clock time so multi-minute
+// timeouts finish quickly while concurrent tasks still overlap naturally.
+uint64_t sim_now_us();
+void sim_sleep_us(uint64_t virtualMicros);
+double sim_time_scale();
+void sim_clock_init(double scale);
+// UTC epoch (seconds) of the simulated world at the current instant.
+double sim_epoch_now();
+
+// --- UART peers --------------------------------------------------------------
+class HardwareSerial;
+
+class SimUartDevice {
+ public:
+  virtual ~SimUartDevice() {}
+  virtual const char* name() const = 0;
+  virtual void attach(unsigned long baud) { baud_ = baud; }
+  virtual void detach() {}
+  virtual void setRxCapacity(size_t bytes) { (void)bytes; }
+  virtual void setListener(HardwareSerial* listener) { (void)listener; }
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual size_t readBulk(uint8_t* buffer, size_t size);
+  virtual size_t write(const uint8_t* data, size_t len) = 0;
+  virtual void flushTx() {}
+  unsigned long hostBaud() const { return baud_; }
+
+ protected:
+  unsigned long baud_ = 0;
+};
+
+// Byte-accurate UART peer: bytes emitted by the device arrive paced by the
+// line rate and land in a bounded RX ring like the ESP32 UART driver's, so a
+// slow reader loses data exactly where the real driver would.
+class SimTimedUart : public SimUartDevice {
+ public:
+  SimTimedUart();
+  ~SimTimedUart() override;
+  void attach(unsigned long baud) override;
+  void detach() override;
+  void setRxCapacity(size_t bytes) override;
+  void setListener(HardwareSerial* listener) override;
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t readBulk(uint8_t* buffer, size_t size) override;
+  size_t write(const uint8_t* data, size_t len) override;
+  void flushTx() override;
+
+  uint32_t rxBytesDelivered() const { return rxDelivered_; }
+  uint32_t rxBytesLost() const { return rxLost_; }
+
+ protected:
+  // Device side: queue bytes for the MCU no earlier than `startUs`.
+  void emit(const std::string& bytes, uint64_t startUs);
+  void emitNow(const std::string& bytes);
+  // Drops everything not yet read by the MCU (device reset, power loss).
+  void purgeRx();
+  // Device baud rate; when it differs from the host's the MCU sees garbage.
+  unsigned long deviceBaud_ = 115200;
+  // Highest rate the wiring carries (0 = any); above it neither side decodes the other.
+  unsigned long lineMaxBaud_ = 0;
+  // Called with the UART lock held before the MCU observes the line, so the
+  // device can produce time-driven output (NMEA ticks, URCs) up to `nowUs`.
+  virtual void advance(uint64_t nowUs) { (void)nowUs; }
+  // Bytes written by the MCU, in order, once they have left the TX FIFO.
+  virtual void onHostBytes(const uint8_t* data, size_t len, uint64_t atUs) = 0;
+  uint64_t usPerByte() const;
+  uint64_t txIdleAt() const { return txBusyUntil_; }
+  struct Impl;
+  Impl* impl_;
+
+ private:
+  void pumpLocked(uint64_t nowUs);
+  void listenerLoop();
+  size_t rxCapacity_ = 256 + 128;
+  uint64_t lastEmitAt_ = 0;
+  uint64_t txBusyUntil_ = 0;
+  uint32_t rxDelivered_ = 0;
+  uint32_t rxLost_ = 0;
+};
+
+SimUartDevice* sim_uart_device_for_pins(int uartNr, int rxPin, int txPin);
+
+// --- I2C peers ---------------------------------------------------------------
+class SimI2cDevice {
+ public:
+  virtual ~SimI2cDevice() {}
+  // One write transaction (register address first); false is a NACK.
+  virtual bool i2cWrite(const uint8_t* data, size_t len) = 0;
+  // One read transaction; returns the bytes the device clocked out.
+  virtual size_t i2cRead(uint8_t* buffer, size_t len) = 0;
+};
+
+// Device answering at a 7-bit address, or nullptr (NACK).
+SimI2cDevice* sim_i2c_device(uint8_t address);
+
+// --- Energy model ------------------------------------------------------------
+enum SimRail : uint8_t {
+  RAIL_MCU = 0,
+  RAIL_GNSS,
+  RAIL_MODEM,
+  RAIL_MODEM_GNSS,  // A7670's own GNSS, counted with the modem
+  RAIL_COUNT,
+};
+
+// Set the current draw of a component from now on.
+void sim_energy_set(SimRail rail, double milliAmps, const char* state);
+// Same, but takes effect at a future virtual instant. A later sim_energy_set()
+// on the rail cancels transitions that have not happened yet.
+void sim_energy_schedule(SimRail rail, double milliAmps, const char* state, uint64_t atUs);
+double sim_energy_rail_ma(SimRail rail);
+
+// --- Scenario knobs (sim_main.cpp parses them from the command line/script) --
+struct SimScenario {
+  double timeScale = 200.0;
+  int cycles = 5;
+  bool quiet = false;
+  std::string stateDir = "sim_state";
+  std::string nmeaFile;
+
+  // GNSS receiver (L76K class)
+  double gnssColdTtffS = 32.0;
+  double gnssWarmTtffS = 12.0;
+  double gnssHotTtffS = 2.0;
+  double gnssAcqMa = 27.0;
+  double gnssTrackMa = 22.0;
+  double gnssBackupMa = 0.015;
+  double gnssStandbyMa = 0.45;   // $PCAS12 standby with the rail up
+  double gnssAidFactor = 0.8;    // Cold TTFF scale with position/time aiding but no ephemeris
+  int gnssMaxBaud = 0;           // Highest NMEA link rate the wiring carries, 0 = any
+  double startLat = 50.0755;
+  double startLon = 14.4378;
+  double speedKmh = 0.0;
+  double headingDeg = 90.0;
+  double motionChangeS = 300.0;  // A scripted speed/heading change happens this far into the preceding sleep
+
+  // Modem (A7670 class, LTE Cat-1)
+  double modemBootS = 6.5;
+  double modemRegS = 9.0;
+  double modemAttachS = 1.8;
+  double modemRttMs = 450.0;
+  double modemTlsMs = 2200.0;
+  double serverKeepAliveS = 15.0;  // Idle time before the front end closes a kept-alive connection
+  double modemUplinkBps = 12000.0;
+  double modemLossPerKb = 0.0;  // Probability an HTTP request is lost per kB of body
+  double modemDownlinkBps = 40000.0;
+  double modemIdleMa = 22.0;
+  double modemSearchMa = 95.0;
+  double modemTxMa = 180.0;
+  double modemPsmMa = 0.009;
+  int modemMaxBaud = 921600;     // Highest AT link rate the board carries; +IPR above it loses the link
+  bool modemHasGnss = false;     // A7670x-FASE/-FL; the stock -LASE refuses +CGNSSPWR
+  double modemGnssTtffS = 35.0;  // Module powered off between sessions: no ephemeris
+  double modemAgpsS = 2.5;       // +CAGPS download
+  double modemAgpsTtffS = 6.0;   // After AGPS data was loaded
+  double modemGnssMa = 30.0;
+  bool psmGranted = true;
+  bool serverSupportsSync = true;
+  int serverMaxBatch = 0;  // 0 = unlimited
+  size_t serverMaxBodyBytes = 100 * 1024;  // express.json() default limit
+  double serverProcessMs = 40.0;
+  int serverIntervalGps = 60;
+  int serverIntervalSend = 1;
+  int serverSatellites = 7;
+  int serverAccuracyM = -1;  // config.accuracy_m, -1 = not sent
+  int serverResolutionM = -1;  // config.resolution_m, -1 = not sent
+  int serverTrackToleranceM = -1;  // config.track_tolerance_m, -1 = not sent
+  int serverIntervalMin = -1;  // config.interval_min, -1 = not sent
+  int serverIntervalMax = -1;  // config.interval_max, -1 = not sent
+
+  // IMU (QMI8658, only built with IMU=1)
+  bool imuPresent = true;
+
+  // MCU
+  double mcuActiveMa = 46.0;
+  double mcuLowClockMa = 22.0;
+  double mcuLightSleepMa = 1.2;
+  double mcuDeepSleepMa = 0.012;
+  double batteryVolts = 3.8;
+};
+
+extern SimScenario g_sim;
+
+// --- Cross-cycle world state -------------------------------------------------
+// Lives in shared memory owned by the parent process so it survives the fork
+// used to model each deep-sleep wake.
+struct SimTrackLeg {
+  double fromEpoch;
+  double lat;
+  double lon;
+  double speedKmh;
+  double headingDeg;
+};
+
+struct SimWorld {
+  uint32_t cycle;
+  double epochAtBoot;   // UTC when the simulated device was first powered
+  double epochAtWake;   // UTC at the start of the current wake cycle
+  double sleepRequestedS;
+  int wakeCause;
+  int nextWakeCause;    // Set when something other than the timer ends the sleep
+  uint64_t ext1WakeStatus;
+  // Motion model: straight legs, a new one on every scripted speed/heading change
+  SimTrackLeg legs[64];
+  uint32_t legCount;
+  // Modem
+  bool modemPowered;
+  bool modemRegistered;
+  bool modemPsm;
+  bool modemEchoOff;        // Run-time settings kept while the modem stays powered
+  bool modemPsmRequested;
+  double modemPsmActiveS;
+  bool modemNetOpen;        // Socket service open when the modem entered PSM
+  uint32_t modemPsmResumes;
+  uint32_t modemPsmNetopens;  // Resumed sessions that sent +NETOPEN again (check)
+  double modemRegisteredSinceEpoch;
+  unsigned long modemBaud;
+  // GNSS
+  double gnssLastFixEpoch;
+  double gnssLastPowerOffEpoch;
+  bool gnssBackupKept;
+  bool gnssPowered;     // rail held through deep sleep
+  bool gnssStandby;
+  unsigned long gnssBaud;
+  uint32_t gnssSentenceMask;
+  double trackLat;
+  double trackLon;
+  // IMU: powered from the battery rail, so its registers survive deep sleep
+  bool imuPowered;
+  uint8_t imuRegs[128];
+  bool imuWomArmed;
+  int imuIntLevel;
+  uint32_t imuWomEvents;
+  // Server side view
+  uint32_t serverRecordsReceived;
+  uint32_t serverDuplicateRecords;
+  uint32_t serverRequests;
+  double serverLastTimestamp;
+  double serverErrorSumSq;    // squared horizontal error of delivered fixes, m^2
+  double serverErrorMax;
+  uint32_t serverErrorCount;
+  uint32_t serverSeen[4096];  // open-addressed hashes of delivered records
+};
+
+struct SimCycleStats {
+  double awakeS;
+  double mcuMas;
+  double gnssMas;
+  double modemMas;
+  double gnssOnS;
+  double modemOnS;
+  uint32_t fsBytesWritten;
+  uint32_t fsBytesRead;
+  uint32_t nvsWrites;
+  uint32_t atCommands;
+  uint32_t httpRequests;
+  uint32_t uplinkBytes;
+  uint32_t downlinkBytes;
+  uint32_t recordsDelivered;
+  uint32_t nmeaBytes;
+  uint32_t uartRxLost;
+  double sleepS;
+  double sleepMas;
+  bool deepSleep;
+  bool shutdown;
+  bool hung;
+};
+
+SimWorld& sim_world();
+SimCycleStats& sim_stats();
+
+// --- Devices -----------------------------------------------------------------
+SimUartDevice* sim_modem_device();
+SimUartDevice* sim_gnss_device();
+SimUartDevice* sim_console_device();
+void sim_modem_on_pin(int pin, int level);
+// True when gpio_hold_en() keeps the pin's level through deep sleep.
+bool sim_gpio_held(int pin);
+void sim_gnss_on_pin(int pin, int level);
+void sim_board_on_pin(int pin, int level);
+// Prepare for deep sleep; returns the average current drawn over `sleepS` of MCU sleep.
+double sim_modem_prepare_sleep(double sleepS);
+// Emulated backend; returns the HTTP status and fills the response body.
+int sim_server_handle(const std::string& method, const std::string& url, const std::string& body,
+                      std::string& response);
+double sim_gnss_prepare_sleep();
+// Level the IMU drives on its interrupt pin, or -1 for any other pin.
+int sim_imu_pin_level(int pin);
+// Deep sleep of `sleepUs` with the vehicle moving from `motionFromUs` to `motionUntilUs`
+// (relative to the start of the sleep): returns when the ext1 wake on the IMU interrupt
+// pin ends it, or `sleepUs` if nothing does.
+uint64_t sim_imu_deep_sleep(uint64_t sleepUs, uint64_t motionFromUs, uint64_t motionUntilUs, uint64_t ext1Mask,
+                            int ext1Mode);
+// True position of the simulated vehicle at a UTC instant (motion model only;
+// false while an NMEA capture is replayed).
+bool sim_track_position(double epoch, double& lat, double& lon);
+
+// Ends the current wake cycle (deep sleep or power cut). Never returns.
+[[noreturn]] void sim_end_cycle(bool deepSleep, uint64_t sleepUs);
+
+void sim_log(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
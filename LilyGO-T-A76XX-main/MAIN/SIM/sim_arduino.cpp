@@ -0,0 +1,546 @@
+// Arduino core stand-ins: String, Print, Stream, HardwareSerial, Wire, GPIO, time.
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <WiFi.h>
+#include <Wire.h>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <thread>
+#include "sim.h"
+
+// --- String ------------------------------------------------------------------
+
+namespace {
+std::string to_base(unsigned long long value, unsigned char base) {
+  if (base < 2 || base > 36) base = 10;
+  if (value == 0) return "0";
+  std::string out;
+  while (value) {
+    unsigned digit = static_cast<unsigned>(value % base);
+    out.insert(out.begin(), static_cast<char>(digit < 10 ? '0' + digit : 'a' + digit - 10));
+    value /= base;
+  }
+  return out;
+}
+
+std::string signed_to_base(long long value, unsigned char base) {
+  if (value < 0 && base == 10) return "-" + to_base(static_cast<unsigned long long>(-value), base);
+  return to_base(static_cast<unsigned long long>(value), base);
+}
+
+std::string float_to_string(double value, unsigned int decimals) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+  return buf;
+}
+}  // namespace
+
+String::String(unsigned char value, unsigned char base) : s_(to_base(value, base)) {}
+String::String(int value, unsigned char base) : s_(signed_to_base(value, base)) {}
+String::String(unsigned int value, unsigned char base) : s_(to_base(value, base)) {}
+String::String(long value, unsigned char base) : s_(signed_to_base(value, base)) {}
+String::String(unsigned long value, unsigned char base) : s_(to_base(value, base)) {}
+String::String(long long value, unsigned char base) : s_(signed_to_base(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : s_(to_base(value, base)) {}
+String::String(float value, unsigned int decimalPlaces) : s_(float_to_string(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces) : s_(float_to_string(value, decimalPlaces)) {}
+
+bool String::equalsIgnoreCase(const String& s) const {
+  if (s_.size() != s.s_.size()) return false;
+  for (size_t i = 0; i < s_.size(); ++i) {
+    if (tolower(static_cast<unsigned char>(s_[i])) != tolower(static_cast<unsigned char>(s.s_[i]))) return false;
+  }
+  return true;
+}
+
+bool String::startsWith(const String& prefix, unsigned int offset) const {
+  if (offset > s_.size() || prefix.s_.size() > s_.size() - offset) return false;
+  return s_.compare(offset, prefix.s_.size(), prefix.s_) == 0;
+}
+
+void String::getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index) const {
+  if (!bufsize || !buf) return;
+  if (index >= s_.size()) {
+    buf[0] = 0;
+    return;
+  }
+  unsigned int n = std::min<unsigned int>(bufsize - 1, static_cast<unsigned int>(s_.size()) - index);
+  memcpy(buf, s_.data() + index, n);
+  buf[n] = 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+  size_t pos = s_.find(ch, fromIndex);
+  return pos == std::string::npos ? -1 : static_cast<int>(pos);
+}
+
+int String::indexOf(const String& str, unsigned int fromIndex) const {
+  if (fromIndex > s_.size()) return -1;
+  size_t pos = s_.find(str.s_, fromIndex);
+  return pos == std::string::npos ? -1 : static_cast<int>(pos);
+}
+
+int String::lastIndexOf(char ch) const {
+  size_t pos = s_.rfind(ch);
+  return pos == std::string::npos ? -1 : static_cast<int>(pos);
+}
+
+int String::lastIndexOf(const String& str) const {
+  size_t pos = s_.rfind(str.s_);
+  return pos == std::string::npos ? -1 : static_cast<int>(pos);
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+  if (beginIndex > endIndex) std::swap(beginIndex, endIndex);
+  if (beginIndex >= s_.size()) return String();
+  endIndex = std::min<unsigned int>(endIndex, static_cast<unsigned int>(s_.size()));
+  return String(s_.c_str() + beginIndex, endIndex - beginIndex);
+}
+
+void String::replace(char find, char replace) {
+  for (auto& c : s_) {
+    if (c == find) c = replace;
+  }
+}
+
+void String::replace(const String& find, const String& replace) {
+  if (find.s_.empty()) return;
+  size_t pos = 0;
+  while ((pos = s_.find(find.s_, pos)) != std::string::npos) {
+    s_.replace(pos, find.s_.size(), replace.s_);
+    pos += replace.s_.size();
+  }
+}
+
+void String::toLowerCase() {
+  for (auto& c : s_) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+}
+
+void String::toUpperCase() {
+  for (auto& c : s_) c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+}
+
+void String::trim() {
+  size_t b = 0;
+  while (b < s_.size() && isspace(static_cast<unsigned char>(s_[b]))) ++b;
+  size_t e = s_.size();
+  while (e > b && isspace(static_cast<unsigned char>(s_[e - 1]))) --e;
+  s_ = s_.substr(b, e - b);
+}
+
+String operator+(const String& lhs, const String& rhs) { String r(lhs); r.concat(rhs); return r; }
+String operator+(const String& lhs, const char* rhs) { String r(lhs); r.concat(rhs); return r; }
+String operator+(const char* lhs, const String& rhs) { String r(lhs); r.concat(rhs); return r; }
+String operator+(const String& lhs, char rhs) { String r(lhs); r.concat(rhs); return r; }
+String operator+(const String& lhs, int rhs) { String r(lhs); r.concat(rhs); return r; }
+String operator+(const String& lhs, unsigned int rhs) { String r(lhs); r.concat(rhs); return r; }
+String operator+(const String& lhs, long rhs) { String r(lhs); r.concat(rhs); return r; }
+String operator+(const String& lhs, unsigned long rhs) { String r(lhs); r.concat(rhs); return r; }
+String operator+(const String& lhs, double rhs) { String r(lhs); r.concat(rhs); return r; }
+String operator+(const String& lhs, const __FlashStringHelper* rhs) { String r(lhs); r.concat(rhs); return r; }
+
+// --- Print -------------------------------------------------------------------
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (write(*buffer++)) n++;
+    else break;
+  }
+  return n;
+}
+
+size_t Print::printf(const char* format, ...) {
+  char stackBuf[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(stackBuf, sizeof(stackBuf), format, args);
+  va_end(args);
+  if (len < 0) return 0;
+  if (static_cast<size_t>(len) < sizeof(stackBuf)) return write(stackBuf, len);
+  std::string big(len + 1, '\0');
+  va_start(args, format);
+  vsnprintf(&big[0], big.size(), format, args);
+  va_end(args);
+  return write(big.c_str(), len);
+}
+
+size_t Print::print(long n, int base) { return print(String(n, static_cast<unsigned char>(base))); }
+size_t Print::print(unsigned long n, int base) { return print(String(n, static_cast<unsigned char>(base))); }
+size_t Print::print(long long n, int base) { return print(String(n, static_cast<unsigned char>(base))); }
+size_t Print::print(unsigned long long n, int base) { return print(String(n, static_cast<unsigned char>(base))); }
+size_t Print::print(double n, int digits) { return print(String(n, static_cast<unsigned int>(digits))); }
+
+// --- Stream ------------------------------------------------------------------
+
+int Stream::timedRead() {
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if (c >= 0) return c;
+    delay(0);
+  } while (millis() - start < _timeout);
+  return -1;
+}
+
+int Stream::timedPeek() {
+  unsigned long start = millis();
+  do {
+    int c = peek();
+    if (c >= 0) return c;
+    delay(0);
+  } while (millis() - start < _timeout);
+  return -1;
+}
+
+int Stream::peekNextDigit() {
+  while (true) {
+    int c = timedPeek();
+    if (c < 0 || c == '-' || (c >= '0' && c <= '9')) return c;
+    read();
+  }
+}
+
+bool Stream::findUntil(const char* target, size_t targetLen, const char* terminate, size_t termLen) {
+  size_t index = 0;
+  size_t termIndex = 0;
+  if (targetLen == 0) return true;
+  int c;
+  while ((c = timedRead()) > 0) {
+    if (c == target[index]) {
+      if (++index >= targetLen) return true;
+    } else {
+      index = (c == target[0]) ? 1 : 0;
+    }
+    if (termLen > 0 && c == terminate[termIndex]) {
+      if (++termIndex >= termLen) return false;
+    } else {
+      termIndex = 0;
+    }
+  }
+  return false;
+}
+
+long Stream::parseInt(char skipChar) {
+  bool isNegative = false;
+  long value = 0;
+  int c = peekNextDigit();
+  if (c < 0) return 0;
+  do {
+    if (c == skipChar) {
+    } else if (c == '-') {
+      isNegative = true;
+    } else if (c >= '0' && c <= '9') {
+      value = value * 10 + c - '0';
+    }
+    read();
+    c = timedPeek();
+  } while ((c >= '0' && c <= '9') || c == skipChar);
+  return isNegative ? -value : value;
+}
+
+float Stream::parseFloat() {
+  String digits;
+  int c = peekNextDigit();
+  if (c < 0) return 0;
+  while ((c >= '0' && c <= '9') || c == '-' || c == '.') {
+    digits += static_cast<char>(c);
+    read();
+    c = timedPeek();
+  }
+  return digits.toFloat();
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0) break;
+    *buffer++ = static_cast<char>(c);
+    count++;
+  }
+  return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char* buffer, size_t length) {
+  size_t index = 0;
+  while (index < length) {
+    int c = timedRead();
+    if (c < 0 || c == terminator) break;
+    *buffer++ = static_cast<char>(c);
+    index++;
+  }
+  return index;
+}
+
+String Stream::readString() {
+  String ret;
+  int c = timedRead();
+  while (c >= 0) {
+    ret += static_cast<char>(c);
+    c = timedRead();
+  }
+  return ret;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String ret;
+  int c = timedRead();
+  while (c >= 0 && c != terminator) {
+    ret += static_cast<char>(c);
+    c = timedRead();
+  }
+  return ret;
+}
+
+// --- HardwareSerial ----------------------------------------------------------
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+
+namespace {
+// Peer currently routed to each UART peripheral. Several HardwareSerial
+// objects may name the same UART; like on the chip they share this routing.
+SimUartDevice* g_uart_device[3];
+}  // namespace
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin, bool invert,
+                           unsigned long timeout_ms, uint8_t rxfifo_full_thrhd) {
+  (void)config;
+  (void)invert;
+  (void)timeout_ms;
+  (void)rxfifo_full_thrhd;
+  SimUartDevice*& dev = g_uart_device[uart_nr_];
+  if (dev) dev->detach();
+  baud_ = baud;
+  dev = sim_uart_device_for_pins(uart_nr_, rxPin, txPin);
+  device_ = dev;
+  if (dev) {
+    dev->setRxCapacity(rxBufferSize_);
+    dev->attach(baud);
+  }
+}
+
+void HardwareSerial::end(bool fullyTerminate) {
+  (void)fullyTerminate;
+  SimUartDevice*& dev = g_uart_device[uart_nr_];
+  if (dev) dev->detach();
+  dev = nullptr;
+  device_ = nullptr;
+  onReceive_ = nullptr;
+}
+
+void HardwareSerial::updateBaudRate(unsigned long baud) {
+  baud_ = baud;
+  if (g_uart_device[uart_nr_]) g_uart_device[uart_nr_]->attach(baud);
+}
+
+uint32_t HardwareSerial::baudRate() { return static_cast<uint32_t>(baud_); }
+
+size_t HardwareSerial::setRxBufferSize(size_t new_size) {
+  rxBufferSize_ = new_size;
+  return new_size;
+}
+
+size_t HardwareSerial::setTxBufferSize(size_t new_size) { return new_size; }
+bool HardwareSerial::setRxFIFOFull(uint8_t fifoBytes) { (void)fifoBytes; return true; }
+
+bool HardwareSerial::setRxTimeout(uint8_t symbols_timeout) {
+  rxTimeoutSymbols_ = symbols_timeout;
+  return true;
+}
+
+void HardwareSerial::onReceive(std::function<void(void)> function, bool onlyOnTimeout) {
+  onReceive_ = function;
+  onReceiveOnlyOnTimeout_ = onlyOnTimeout;
+  if (g_uart_device[uart_nr_]) g_uart_device[uart_nr_]->setListener(onReceive_ ? this : nullptr);
+}
+
+void HardwareSerial::simNotifyReceive(bool lineIdle) {
+  if (onReceive_ && (lineIdle || !onReceiveOnlyOnTimeout_)) onReceive_();
+}
+
+int HardwareSerial::available() {
+  SimUartDevice* dev = g_uart_device[uart_nr_];
+  return dev ? dev->available() : 0;
+}
+
+int HardwareSerial::peek() {
+  SimUartDevice* dev = g_uart_device[uart_nr_];
+  return dev ? dev->peek() : -1;
+}
+
+int HardwareSerial::read() {
+  SimUartDevice* dev = g_uart_device[uart_nr_];
+  return dev ? dev->read() : -1;
+}
+
+size_t HardwareSerial::read(uint8_t* buffer, size_t size) {
+  SimUartDevice* dev = g_uart_device[uart_nr_];
+  return dev ? dev->readBulk(buffer, size) : 0;
+}
+
+size_t HardwareSerial::readBytes(char* buffer, size_t length) { return Stream::readBytes(buffer, length); }
+
+void HardwareSerial::flush() {
+  SimUartDevice* dev = g_uart_device[uart_nr_];
+  if (dev) dev->flushTx();
+}
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  SimUartDevice*& dev = g_uart_device[uart_nr_];
+  if (uart_nr_ == 0 && !dev) dev = sim_console_device();
+  return dev ? dev->write(buffer, size) : size;
+}
+
+// --- I2C ---------------------------------------------------------------------
+
+TwoWire Wire(0);
+TwoWire Wire1(1);
+SPIClass SPI;
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+  (void)sda;
+  (void)scl;
+  (void)frequency;
+  return true;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  address_ = address;
+  txLen_ = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (txLen_ >= sizeof(tx_)) return 0;
+  tx_[txLen_++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t size) {
+  size_t n = 0;
+  while (n < size && write(data[n])) ++n;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  (void)sendStop;
+  SimI2cDevice* dev = sim_i2c_device(address_);
+  size_t len = txLen_;
+  txLen_ = 0;
+  if (!dev) return 2;  // Address NACK
+  return dev->i2cWrite(tx_, len) ? 0 : 3;
+}
+
+size_t TwoWire::requestFrom(uint8_t address, size_t size, bool sendStop) {
+  (void)sendStop;
+  rxPos_ = rxLen_ = 0;
+  SimI2cDevice* dev = sim_i2c_device(address);
+  if (!dev) return 0;
+  if (size > sizeof(rx_)) size = sizeof(rx_);
+  rxLen_ = dev->i2cRead(rx_, size);
+  return rxLen_;
+}
+
+size_t TwoWire::readBytes(char* buffer, size_t length) {
+  size_t n = 0;
+  while (n < length && rxPos_ < rxLen_) buffer[n++] = static_cast<char>(rx_[rxPos_++]);
+  return n;
+}
+
+// --- Time --------------------------------------------------------------------
+
+unsigned long millis() { return static_cast<unsigned long>(sim_now_us() / 1000ULL); }
+unsigned long micros() { return static_cast<unsigned long>(sim_now_us()); }
+int64_t esp_timer_get_time(void) { return static_cast<int64_t>(sim_now_us()); }
+
+void delay(uint32_t ms) {
+  if (ms == 0) {
+    std::this_thread::yield();
+    return;
+  }
+  sim_sleep_us(static_cast<uint64_t>(ms) * 1000ULL);
+}
+
+void delayMicroseconds(uint32_t us) { sim_sleep_us(us); }
+void yield() { std::this_thread::yield(); }
+
+// --- GPIO --------------------------------------------------------------------
+
+namespace {
+std::mutex g_pin_mutex;
+int g_pin_level[64];
+int g_pin_mode[64];
+void (*g_pin_isr[64])(void);
+std::atomic<uint32_t> g_cpu_mhz{240};
+}  // namespace
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= 64) return;
+  std::lock_guard<std::mutex> lock(g_pin_mutex);
+  g_pin_mode[pin] = mode;
+  if (mode == INPUT_PULLUP) g_pin_level[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin >= 64) return;
+  {
+    std::lock_guard<std::mutex> lock(g_pin_mutex);
+    g_pin_level[pin] = val ? HIGH : LOW;
+  }
+  sim_modem_on_pin(pin, val ? HIGH : LOW);
+  sim_gnss_on_pin(pin, val ? HIGH : LOW);
+  sim_board_on_pin(pin, val ? HIGH : LOW);
+}
+
+int digitalRead(uint8_t pin) {
+  if (pin >= 64) return LOW;
+  int driven = sim_imu_pin_level(pin);
+  if (driven >= 0) return driven;
+  std::lock_guard<std::mutex> lock(g_pin_mutex);
+  return g_pin_level[pin];
+}
+
+uint16_t analogRead(uint8_t pin) { (void)pin; return 2048; }
+uint32_t analogReadMilliVolts(uint8_t pin) { (void)pin; return 1900; }
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {
+  (void)mode;
+  if (pin < 64) g_pin_isr[pin] = handler;
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (pin < 64) g_pin_isr[pin] = nullptr;
+}
+
+bool setCpuFrequencyMhz(uint32_t cpu_freq_mhz) {
+  g_cpu_mhz = cpu_freq_mhz;
+  sim_energy_set(RAIL_MCU, cpu_freq_mhz >= 160 ? g_sim.mcuActiveMa : g_sim.mcuLowClockMa,
+                 cpu_freq_mhz >= 160 ? "active" : "low-clock");
+  return true;
+}
+
+uint32_t getCpuFrequencyMhz() { return g_cpu_mhz; }
+
+// --- Misc --------------------------------------------------------------------
+
+namespace {
+std::mt19937 g_rng(12345);
+}
+
+long random(long max) { return max > 0 ? static_cast<long>(g_rng() % static_cast<unsigned long>(max)) : 0; }
+long random(long min, long max) { return max > min ? min + random(max - min) : min; }
+void randomSeed(unsigned long seed) { g_rng.seed(seed); }
+
+EspClass ESP;
+uint32_t EspClass::getFreeHeap() { return 180000; }
+uint32_t EspClass::getMinFreeHeap() { return 150000; }
+void EspClass::restart() { sim_end_cycle(false, 0); }
+
+WiFiClass WiFi;
+String WiFiClass::macAddress() { return String("24:6F:28:A1:B2:C3"); }
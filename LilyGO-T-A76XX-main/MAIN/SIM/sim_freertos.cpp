@@ -0,0 +1,378 @@
+// FreeRTOS stand-ins: tasks are detached std::threads, all blocking calls
+// wait on condition variables with timeouts converted to virtual time.
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "sim.h"
+
+namespace {
+
+std::chrono::microseconds real_timeout(TickType_t ticks) {
+  double us = static_cast<double>(ticks) * 1000.0 / sim_time_scale();
+  return std::chrono::microseconds(static_cast<int64_t>(us) + 1);
+}
+
+// Waits on `cv` until `pred` holds or `ticks` virtual ms elapse.
+template <typename Pred>
+bool wait_ticks(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, TickType_t ticks, Pred pred) {
+  if (ticks == portMAX_DELAY) {
+    cv.wait(lock, pred);
+    return true;
+  }
+  return cv.wait_for(lock, real_timeout(ticks), pred);
+}
+
+std::mutex g_critical_mutex;
+
+}  // namespace
+
+struct SimTask {
+  std::mutex m;
+  std::condition_variable cv;
+  uint32_t notifyValue = 0;
+  bool notifyPending = false;
+  bool deleted = false;
+  const char* name = "";
+};
+
+namespace {
+thread_local SimTask* t_current_task = nullptr;
+
+SimTask* current_task() {
+  if (!t_current_task) {
+    t_current_task = new SimTask();
+    t_current_task->name = "main";
+  }
+  return t_current_task;
+}
+}  // namespace
+
+void sim_port_enter_critical(portMUX_TYPE* mux) {
+  (void)mux;
+  g_critical_mutex.lock();
+}
+
+void sim_port_exit_critical(portMUX_TYPE* mux) {
+  (void)mux;
+  g_critical_mutex.unlock();
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth,
+                                   void* pvParameters, UBaseType_t uxPriority, TaskHandle_t* pvCreatedTask,
+                                   BaseType_t xCoreID) {
+  (void)usStackDepth;
+  (void)uxPriority;
+  (void)xCoreID;
+  SimTask* task = new SimTask();
+  task->name = pcName;
+  if (pvCreatedTask) *pvCreatedTask = task;
+  std::thread([task, pvTaskCode, pvParameters]() {
+    t_current_task = task;
+    pvTaskCode(pvParameters);
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth, void* pvParameters,
+                       UBaseType_t uxPriority, TaskHandle_t* pvCreatedTask) {
+  return xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pvCreatedTask,
+                                 tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t xTask) {
+  SimTask* task = xTask ? xTask : current_task();
+  {
+    std::lock_guard<std::mutex> lock(task->m);
+    task->deleted = true;
+  }
+  if (task == t_current_task) {
+    // A FreeRTOS task never returns from vTaskDelete(NULL); park the thread.
+    for (;;) std::this_thread::sleep_for(std::chrono::hours(1));
+  }
+}
+
+void vTaskDelay(TickType_t xTicksToDelay) { sim_sleep_us(static_cast<uint64_t>(xTicksToDelay) * 1000ULL); }
+
+TickType_t xTaskGetTickCount(void) { return static_cast<TickType_t>(sim_now_us() / 1000ULL); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return current_task(); }
+
+eTaskState eTaskGetState(TaskHandle_t xTask) {
+  if (!xTask) return eInvalid;
+  std::lock_guard<std::mutex> lock(xTask->m);
+  return xTask->deleted ? eDeleted : eBlocked;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait) {
+  SimTask* task = current_task();
+  std::unique_lock<std::mutex> lock(task->m);
+  wait_ticks(task->cv, lock, xTicksToWait, [task] { return task->notifyValue != 0; });
+  uint32_t value = task->notifyValue;
+  if (value) task->notifyValue = xClearCountOnExit ? 0 : value - 1;
+  return value;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction) {
+  if (!xTaskToNotify) return pdFAIL;
+  std::lock_guard<std::mutex> lock(xTaskToNotify->m);
+  switch (eAction) {
+    case eSetBits: xTaskToNotify->notifyValue |= ulValue; break;
+    case eIncrement: xTaskToNotify->notifyValue++; break;
+    case eSetValueWithOverwrite: xTaskToNotify->notifyValue = ulValue; break;
+    case eSetValueWithoutOverwrite:
+      if (xTaskToNotify->notifyPending) return pdFAIL;
+      xTaskToNotify->notifyValue = ulValue;
+      break;
+    case eNoAction: break;
+  }
+  xTaskToNotify->notifyPending = true;
+  xTaskToNotify->cv.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) { return xTaskNotify(xTaskToNotify, 0, eIncrement); }
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t* pxHigherPriorityTaskWoken) {
+  xTaskNotifyGive(xTaskToNotify);
+  if (pxHigherPriorityTaskWoken) *pxHigherPriorityTaskWoken = pdFALSE;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction,
+                              BaseType_t* pxHigherPriorityTaskWoken) {
+  if (pxHigherPriorityTaskWoken) *pxHigherPriorityTaskWoken = pdFALSE;
+  return xTaskNotify(xTaskToNotify, ulValue, eAction);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry, uint32_t ulBitsToClearOnExit, uint32_t* pulNotificationValue,
+                           TickType_t xTicksToWait) {
+  SimTask* task = current_task();
+  std::unique_lock<std::mutex> lock(task->m);
+  if (!task->notifyPending) task->notifyValue &= ~ulBitsToClearOnEntry;
+  bool got = wait_ticks(task->cv, lock, xTicksToWait, [task] { return task->notifyPending; });
+  if (pulNotificationValue) *pulNotificationValue = task->notifyValue;
+  if (!got) return pdFALSE;
+  task->notifyPending = false;
+  task->notifyValue &= ~ulBitsToClearOnExit;
+  return pdTRUE;
+}
+
+// --- Semaphores --------------------------------------------------------------
+
+struct SimSemaphore {
+  enum Kind { Mutex, Recursive, Counting } kind;
+  std::mutex m;
+  std::condition_variable cv;
+  UBaseType_t count = 0;
+  UBaseType_t maxCount = 1;
+  std::thread::id owner;
+  UBaseType_t depth = 0;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  SimSemaphore* s = new SimSemaphore();
+  s->kind = SimSemaphore::Mutex;
+  return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void) {
+  SimSemaphore* s = new SimSemaphore();
+  s->kind = SimSemaphore::Recursive;
+  return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) { return xSemaphoreCreateCounting(1, 0); }
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount) {
+  SimSemaphore* s = new SimSemaphore();
+  s->kind = SimSemaphore::Counting;
+  s->maxCount = uxMaxCount;
+  s->count = uxInitialCount;
+  return s;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore) { delete xSemaphore; }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t xTicksToWait) {
+  if (!s) return pdFALSE;
+  std::unique_lock<std::mutex> lock(s->m);
+  if (s->kind == SimSemaphore::Counting) {
+    if (!wait_ticks(s->cv, lock, xTicksToWait, [s] { return s->count > 0; })) return pdFALSE;
+    s->count--;
+    return pdTRUE;
+  }
+  if (!wait_ticks(s->cv, lock, xTicksToWait, [s] { return s->depth == 0; })) return pdFALSE;
+  s->owner = std::this_thread::get_id();
+  s->depth = 1;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+  if (!s) return pdFALSE;
+  std::lock_guard<std::mutex> lock(s->m);
+  if (s->kind == SimSemaphore::Counting) {
+    if (s->count >= s->maxCount) return pdFALSE;
+    s->count++;
+  } else {
+    if (s->depth == 0) return pdFALSE;
+    s->depth = 0;
+  }
+  s->cv.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t s, BaseType_t* pxHigherPriorityTaskWoken) {
+  if (pxHigherPriorityTaskWoken) *pxHigherPriorityTaskWoken = pdFALSE;
+  return xSemaphoreGive(s);
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t s, TickType_t xTicksToWait) {
+  if (!s) return pdFALSE;
+  std::unique_lock<std::mutex> lock(s->m);
+  auto self = std::this_thread::get_id();
+  if (s->depth > 0 && s->owner == self) {
+    s->depth++;
+    return pdTRUE;
+  }
+  if (!wait_ticks(s->cv, lock, xTicksToWait, [s] { return s->depth == 0; })) return pdFALSE;
+  s->owner = self;
+  s->depth = 1;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t s) {
+  if (!s) return pdFALSE;
+  std::lock_guard<std::mutex> lock(s->m);
+  if (s->depth == 0 || s->owner != std::this_thread::get_id()) return pdFALSE;
+  if (--s->depth == 0) s->cv.notify_all();
+  return pdTRUE;
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t s) {
+  if (!s) return 0;
+  std::lock_guard<std::mutex> lock(s->m);
+  return s->kind == SimSemaphore::Counting ? s->count : (s->depth == 0 ? 1 : 0);
+}
+
+// --- Queues ------------------------------------------------------------------
+
+struct SimQueue {
+  std::mutex m;
+  std::condition_variable cv;
+  std::deque<std::vector<uint8_t>> items;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize) {
+  SimQueue* q = new SimQueue();
+  q->length = uxQueueLength;
+  q->itemSize = uxItemSize;
+  return q;
+}
+
+void vQueueDelete(QueueHandle_t xQueue) { delete xQueue; }
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t xTicksToWait) {
+  if (!q) return pdFAIL;
+  std::unique_lock<std::mutex> lock(q->m);
+  if (!wait_ticks(q->cv, lock, xTicksToWait, [q] { return q->items.size() < q->length; })) return errQUEUE_FULL;
+  const uint8_t* p = static_cast<const uint8_t*>(item);
+  q->items.emplace_back(p, p + q->itemSize);
+  q->cv.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t q, const void* item, TickType_t xTicksToWait) {
+  return xQueueSend(q, item, xTicksToWait);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void* item, BaseType_t* pxHigherPriorityTaskWoken) {
+  if (pxHigherPriorityTaskWoken) *pxHigherPriorityTaskWoken = pdFALSE;
+  return xQueueSend(q, item, 0);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t q, const void* item) {
+  if (!q) return pdFAIL;
+  std::lock_guard<std::mutex> lock(q->m);
+  q->items.clear();
+  const uint8_t* p = static_cast<const uint8_t*>(item);
+  q->items.emplace_back(p, p + q->itemSize);
+  q->cv.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* buffer, TickType_t xTicksToWait) {
+  if (!q) return pdFAIL;
+  std::unique_lock<std::mutex> lock(q->m);
+  if (!wait_ticks(q->cv, lock, xTicksToWait, [q] { return !q->items.empty(); })) return errQUEUE_EMPTY;
+  memcpy(buffer, q->items.front().data(), q->itemSize);
+  q->items.pop_front();
+  q->cv.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xQueueReset(QueueHandle_t q) {
+  if (!q) return pdFAIL;
+  std::lock_guard<std::mutex> lock(q->m);
+  q->items.clear();
+  q->cv.notify_all();
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  if (!q) return 0;
+  std::lock_guard<std::mutex> lock(q->m);
+  return static_cast<UBaseType_t>(q->items.size());
+}
+
+// --- Event groups ------------------------------------------------------------
+
+struct SimEventGroup {
+  std::mutex m;
+  std::condition_variable cv;
+  EventBits_t bits = 0;
+};
+
+EventGroupHandle_t xEventGroupCreate(void) { return new SimEventGroup(); }
+void vEventGroupDelete(EventGroupHandle_t g) { delete g; }
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t g, EventBits_t bits) {
+  std::lock_guard<std::mutex> lock(g->m);
+  g->bits |= bits;
+  g->cv.notify_all();
+  return g->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t g, EventBits_t bits) {
+  std::lock_guard<std::mutex> lock(g->m);
+  EventBits_t before = g->bits;
+  g->bits &= ~bits;
+  return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t g) {
+  std::lock_guard<std::mutex> lock(g->m);
+  return g->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t g, EventBits_t wanted, BaseType_t clearOnExit, BaseType_t waitAll,
+                                TickType_t xTicksToWait) {
+  std::unique_lock<std::mutex> lock(g->m);
+  auto satisfied = [g, wanted, waitAll] {
+    return waitAll ? ((g->bits & wanted) == wanted) : ((g->bits & wanted) != 0);
+  };
+  bool ok = wait_ticks(g->cv, lock, xTicksToWait, satisfied);
+  EventBits_t result = g->bits;
+  if (ok && clearOnExit) g->bits &= ~wanted;
+  return result;
+}
@@ -0,0 +1,386 @@
+// LittleFS and NVS (Preferences) stand-ins backed by the host file system
+// under the simulator state directory, with flash access costs charged to
+// the virtual clock.
+
+#include <FS.h>
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "sim.h"
+
+namespace {
+
+// Rough LittleFS-on-SPI-flash costs (ESP32, 80 MHz QIO, 4 KiB sectors).
+constexpr uint64_t kOpenUs = 900;
+constexpr uint64_t kMetaUs = 4000;  // remove/rename/mkdir: metadata pair commit
+constexpr double kReadUsPerByte = 0.25;
+constexpr double kWriteUsPerByte = 6.0;
+constexpr size_t kFsCapacity = 1408 * 1024;  // default littlefs partition on 4 MB boards
+
+std::string fs_root() { return g_sim.stateDir + "/littlefs"; }
+
+std::string host_path(const char* path) {
+  std::string p = path ? path : "/";
+  if (p.empty() || p[0] != '/') p = "/" + p;
+  return fs_root() + p;
+}
+
+size_t dir_usage(const std::string& dir) {
+  size_t total = 0;
+  DIR* d = opendir(dir.c_str());
+  if (!d) return 0;
+  while (dirent* e = readdir(d)) {
+    std::string name = e->d_name;
+    if (name == "." || name == "..") continue;
+    std::string full = dir + "/" + name;
+    struct stat st;
+    if (stat(full.c_str(), &st) != 0) continue;
+    // littlefs allocates whole 4 KiB blocks per file
+    total += S_ISDIR(st.st_mode) ? dir_usage(full) + 4096 : ((st.st_size + 4095) / 4096 + 1) * 4096;
+  }
+  closedir(d);
+  return total;
+}
+
+}  // namespace
+
+namespace fs {
+
+class FileImpl {
+ public:
+  FILE* fp = nullptr;
+  std::string path;
+  std::string host;
+  bool dir = false;
+  std::vector<std::string> entries;
+  size_t nextEntry = 0;
+
+  ~FileImpl() {
+    if (fp) fclose(fp);
+  }
+};
+
+size_t File::write(uint8_t c) { return write(&c, 1); }
+
+size_t File::write(const uint8_t* buf, size_t size) {
+  if (!p_ || !p_->fp) return 0;
+  size_t n = fwrite(buf, 1, size, p_->fp);
+  sim_stats().fsBytesWritten += static_cast<uint32_t>(n);
+  sim_sleep_us(static_cast<uint64_t>(n * kWriteUsPerByte));
+  return n;
+}
+
+int File::available() {
+  if (!p_ || !p_->fp) return 0;
+  long pos = ftell(p_->fp);
+  fseek(p_->fp, 0, SEEK_END);
+  long end = ftell(p_->fp);
+  fseek(p_->fp, pos, SEEK_SET);
+  return static_cast<int>(end - pos);
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+  if (!p_ || !p_->fp) return -1;
+  int c = fgetc(p_->fp);
+  if (c != EOF) ungetc(c, p_->fp);
+  return c == EOF ? -1 : c;
+}
+
+void File::flush() {
+  if (p_ && p_->fp) fflush(p_->fp);
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+  if (!p_ || !p_->fp) return 0;
+  size_t n = fread(buf, 1, size, p_->fp);
+  sim_stats().fsBytesRead += static_cast<uint32_t>(n);
+  sim_sleep_us(static_cast<uint64_t>(n * kReadUsPerByte));
+  return n;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  if (!p_ || !p_->fp) return false;
+  int whence = mode == SeekSet ? SEEK_SET : (mode == SeekCur ? SEEK_CUR : SEEK_END);
+  return fseek(p_->fp, static_cast<long>(pos), whence) == 0;
+}
+
+size_t File::position() const {
+  if (!p_ || !p_->fp) return 0;
+  return static_cast<size_t>(ftell(p_->fp));
+}
+
+size_t File::size() const {
+  if (!p_ || !p_->fp) return 0;
+  fflush(p_->fp);
+  struct stat st;
+  return fstat(fileno(p_->fp), &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+}
+
+void File::close() {
+  if (p_ && p_->fp) {
+    fclose(p_->fp);
+    p_->fp = nullptr;
+  }
+  p_.reset();
+}
+
+File::operator bool() const { return p_ && (p_->fp || p_->dir); }
+
+const char* File::path() const { return p_ ? p_->path.c_str() : ""; }
+
+const char* File::name() const {
+  if (!p_) return "";
+  size_t slash = p_->path.find_last_of('/');
+  return p_->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+bool File::isDirectory() const { return p_ && p_->dir; }
+
+File File::openNextFile(const char* mode) {
+  if (!p_ || !p_->dir || p_->nextEntry >= p_->entries.size()) return File();
+  std::string child = p_->path;
+  if (child.empty() || child.back() != '/') child += "/";
+  child += p_->entries[p_->nextEntry++];
+  return LittleFS.open(child.c_str(), mode);
+}
+
+void File::rewindDirectory() {
+  if (p_) p_->nextEntry = 0;
+}
+
+File FS::open(const char* path, const char* mode, const bool create) {
+  (void)create;
+  if (!mounted_) return File();
+  sim_sleep_us(kOpenUs);
+  std::string host = host_path(path);
+  struct stat st;
+  if (stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+    auto impl = std::make_shared<FileImpl>();
+    impl->dir = true;
+    impl->path = path;
+    impl->host = host;
+    if (DIR* d = opendir(host.c_str())) {
+      while (dirent* e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name != "." && name != "..") impl->entries.push_back(name);
+      }
+      closedir(d);
+    }
+    std::sort(impl->entries.begin(), impl->entries.end());
+    return File(impl);
+  }
+  std::string m = mode ? mode : "r";
+  if (m.find('b') == std::string::npos) m += "b";
+  FILE* fp = fopen(host.c_str(), m.c_str());
+  if (!fp) return File();
+  auto impl = std::make_shared<FileImpl>();
+  impl->fp = fp;
+  impl->path = path;
+  impl->host = host;
+  return File(impl);
+}
+
+bool FS::exists(const char* path) {
+  if (!mounted_) return false;
+  sim_sleep_us(kOpenUs / 2);
+  struct stat st;
+  return stat(host_path(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) {
+  if (!mounted_) return false;
+  sim_sleep_us(kMetaUs);
+  return ::unlink(host_path(path).c_str()) == 0;
+}
+
+bool FS::rename(const char* pathFrom, const char* pathTo) {
+  if (!mounted_) return false;
+  sim_sleep_us(kMetaUs);
+  return ::rename(host_path(pathFrom).c_str(), host_path(pathTo).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+  if (!mounted_) return false;
+  sim_sleep_us(kMetaUs);
+  return ::mkdir(host_path(path).c_str(), 0755) == 0;
+}
+
+bool FS::rmdir(const char* path) {
+  if (!mounted_) return false;
+  sim_sleep_us(kMetaUs);
+  return ::rmdir(host_path(path).c_str()) == 0;
+}
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel) {
+  (void)formatOnFail;
+  (void)basePath;
+  (void)maxOpenFiles;
+  (void)partitionLabel;
+  ::mkdir(g_sim.stateDir.c_str(), 0755);
+  ::mkdir(fs_root().c_str(), 0755);
+  sim_sleep_us(12000);  // mount walks the superblock and metadata pairs
+  mounted_ = true;
+  return true;
+}
+
+bool LittleFSFS::format() {
+  std::string cmd = "rm -rf '" + fs_root() + "'";
+  if (system(cmd.c_str()) != 0) return false;
+  ::mkdir(fs_root().c_str(), 0755);
+  return true;
+}
+
+size_t LittleFSFS::totalBytes() { return kFsCapacity; }
+size_t LittleFSFS::usedBytes() { return dir_usage(fs_root()); }
+void LittleFSFS::end() { mounted_ = false; }
+
+}  // namespace fs
+
+fs::LittleFSFS LittleFS;
+
+// --- Preferences -------------------------------------------------------------
+
+namespace {
+
+typedef std::map<std::string, std::string> NvsNamespace;
+
+std::string nvs_path(const String& name) { return g_sim.stateDir + "/nvs_" + name.c_str() + ".bin"; }
+
+NvsNamespace nvs_load(const String& name) {
+  NvsNamespace ns;
+  FILE* fp = fopen(nvs_path(name).c_str(), "rb");
+  if (!fp) return ns;
+  for (;;) {
+    uint8_t klen;
+    uint32_t vlen;
+    if (fread(&klen, 1, 1, fp) != 1) break;
+    std::string key(klen, '\0');
+    if (fread(&key[0], 1, klen, fp) != klen || fread(&vlen, 4, 1, fp) != 1) break;
+    std::string value(vlen, '\0');
+    if (vlen && fread(&value[0], 1, vlen, fp) != vlen) break;
+    ns[key] = value;
+  }
+  fclose(fp);
+  return ns;
+}
+
+void nvs_store(const String& name, const NvsNamespace& ns) {
+  ::mkdir(g_sim.stateDir.c_str(), 0755);
+  FILE* fp = fopen(nvs_path(name).c_str(), "wb");
+  if (!fp) return;
+  for (const auto& kv : ns) {
+    uint8_t klen = static_cast<uint8_t>(kv.first.size());
+    uint32_t vlen = static_cast<uint32_t>(kv.second.size());
+    fwrite(&klen, 1, 1, fp);
+    fwrite(kv.first.data(), 1, klen, fp);
+    fwrite(&vlen, 4, 1, fp);
+    fwrite(kv.second.data(), 1, vlen, fp);
+  }
+  fclose(fp);
+}
+
+}  // namespace
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partition_label) {
+  (void)partition_label;
+  if (!name || strlen(name) > 15) return false;
+  name_ = name;
+  readOnly_ = readOnly;
+  started_ = true;
+  sim_sleep_us(2000);
+  return true;
+}
+
+void Preferences::end() { started_ = false; }
+
+bool Preferences::clear() {
+  if (!started_ || readOnly_) return false;
+  nvs_store(name_, NvsNamespace());
+  sim_stats().nvsWrites++;
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  if (!started_ || readOnly_) return false;
+  NvsNamespace ns = nvs_load(name_);
+  if (!ns.erase(key)) return false;
+  nvs_store(name_, ns);
+  sim_stats().nvsWrites++;
+  sim_sleep_us(3000);
+  return true;
+}
+
+bool Preferences::isKey(const char* key) {
+  if (!started_) return false;
+  NvsNamespace ns = nvs_load(name_);
+  return ns.count(key) != 0;
+}
+
+size_t Preferences::putRaw(const char* key, const void* value, size_t len) {
+  if (!started_ || readOnly_ || !key || strlen(key) > 15) return 0;
+  NvsNamespace ns = nvs_load(name_);
+  std::string v(static_cast<const char*>(value), len);
+  auto it = ns.find(key);
+  // NVS skips the flash write when the stored value is identical.
+  if (it != ns.end() && it->second == v) return len;
+  ns[key] = v;
+  nvs_store(name_, ns);
+  sim_stats().nvsWrites++;
+  sim_sleep_us(3000 + len * 20);
+  return len;
+}
+
+bool Preferences::getRaw(const char* key, void* out, size_t len) {
+  if (!started_) return false;
+  NvsNamespace ns = nvs_load(name_);
+  auto it = ns.find(key);
+  if (it == ns.end() || it->second.size() != len) return false;
+  memcpy(out, it->second.data(), len);
+  return true;
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+  return putRaw(key, value, strlen(value) + 1);
+}
+
+String Preferences::getString(const char* key, String defaultValue) {
+  if (!started_) return defaultValue;
+  NvsNamespace ns = nvs_load(name_);
+  auto it = ns.find(key);
+  if (it == ns.end()) return defaultValue;
+  return String(it->second.c_str());
+}
+
+size_t Preferences::getString(const char* key, char* value, size_t maxLen) {
+  String s = getString(key, String());
+  if (!value || maxLen == 0) return s.length() + 1;
+  strncpy(value, s.c_str(), maxLen - 1);
+  value[maxLen - 1] = '\0';
+  return s.length() + 1;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  if (!started_) return 0;
+  NvsNamespace ns = nvs_load(name_);
+  auto it = ns.find(key);
+  return it == ns.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  if (!started_) return 0;
+  NvsNamespace ns = nvs_load(name_);
+  auto it = ns.find(key);
+  if (it == ns.end() || it->second.size() > maxLen) return 0;
+  memcpy(buf, it->second.data(), it->second.size());
+  return it->second.size();
+}
@@ -0,0 +1,525 @@
+// L76K-class GNSS receiver emulator: power pin, cold/warm/hot TTFF model,
+// $PCAS01 baud, $PCAS03 sentence selection, $PCAS12 standby, CASIC AID-INI
+// aiding, 1 Hz NMEA output (generated from a simple motion model or replayed
+// from a capture file) paced at the configured UART rate.
+
+#include <Arduino.h>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+#include "sim.h"
+
+namespace {
+
+constexpr int kGnssPowerPin = 5;  // GPS_POWER_PIN in MAIN/FINAL/config.h
+constexpr uint64_t kS = 1000000ULL;
+constexpr double kEarthRadiusM = 6371000.0;
+constexpr double kEphemerisValidS = 4.0 * 3600.0;
+constexpr uint32_t kAllSentences = 0xFFFFFFFFu;
+constexpr double kConvergedAfterS = 30.0;  // tracking time after which the geometry model is settled
+
+std::string with_checksum(const std::string& body) {
+  uint8_t cs = 0;
+  for (char c : body) cs ^= static_cast<uint8_t>(c);
+  char tail[8];
+  snprintf(tail, sizeof(tail), "*%02X\r\n", cs);
+  return "$" + body + tail;
+}
+
+std::string nmea_coord(double deg, bool lat) {
+  double a = fabs(deg);
+  int d = static_cast<int>(a);
+  double m = (a - d) * 60.0;
+  char buf[32];
+  if (lat) {
+    snprintf(buf, sizeof(buf), "%02d%08.5f,%c", d, m, deg >= 0 ? 'N' : 'S');
+  } else {
+    snprintf(buf, sizeof(buf), "%03d%08.5f,%c", d, m, deg >= 0 ? 'E' : 'W');
+  }
+  return buf;
+}
+
+struct SkySat {
+  const char* talker;
+  int prn;
+  int elevation;
+  int azimuth;
+  int snr;
+};
+
+class SimGnss : public SimTimedUart {
+ public:
+  SimGnss() { deviceBaud_ = 9600; }
+  const char* name() const override { return "L76K"; }
+
+  // Rail held through deep sleep: the receiver is still on (normally in standby).
+  void restoreFromWorld() {
+    SimWorld& w = sim_world();
+    if (!w.gnssPowered) return;
+    powered_ = true;
+    standby_ = w.gnssStandby;
+    backupKept_ = true;
+    geometryHeadStartS_ = kConvergedAfterS;
+    deviceBaud_ = w.gnssBaud ? w.gnssBaud : 9600;
+    lineMaxBaud_ = g_sim.gnssMaxBaud > 0 ? g_sim.gnssMaxBaud : 0;
+    sentenceMask_ = w.gnssSentenceMask;
+    uint64_t now = sim_now_us();
+    poweredAt_ = now;
+    timeKnownAt_ = now;
+    fixAt_ = now;
+    nextTickAt_ = now + kS;
+    rng_.seed(0x9e3779b9u ^ w.cycle);
+    loadReplay();
+    if (standby_) {
+      sim_energy_set(RAIL_GNSS, g_sim.gnssStandbyMa, "standby");
+    } else {
+      sim_energy_set(RAIL_GNSS, g_sim.gnssTrackMa, "track");
+    }
+  }
+
+  void onPin(int pin, int level) {
+    if (pin != kGnssPowerPin) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (level == HIGH && !powered_) {
+      powerUp();
+    } else if (level == LOW && powered_) {
+      powerDown();
+    }
+  }
+
+  double prepareSleep(bool railHeld) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SimWorld& w = sim_world();
+    if (powered_ && !railHeld) powerDown();
+    w.gnssBaud = deviceBaud_;
+    w.gnssSentenceMask = sentenceMask_;
+    w.gnssPowered = powered_;
+    w.gnssStandby = powered_ && standby_;
+    if (powered_) {
+      // A receiver left navigating keeps its fix, and its current, until the next wake.
+      w.gnssBackupKept = true;
+      sim_log("gnss: rail held through sleep (%s)", standby_ ? "standby" : "navigating");
+      return standby_ ? g_sim.gnssStandbyMa : g_sim.gnssTrackMa;
+    }
+    return w.gnssBackupKept ? g_sim.gnssBackupMa : 0.0;
+  }
+
+ protected:
+  void advance(uint64_t nowUs) override {
+    if (!powered_ || standby_) return;
+    while (nextTickAt_ <= nowUs) {
+      emitEpoch(nextTickAt_);
+      nextTickAt_ += kS;
+    }
+  }
+
+  void onHostBytes(const uint8_t* data, size_t len, uint64_t atUs) override {
+    if (!powered_) return;
+    if (standby_) {
+      // Any UART activity ends standby; the wake-up bytes themselves are lost.
+      wake(atUs);
+      return;
+    }
+    for (size_t i = 0; i < len; ++i) {
+      input_ += static_cast<char>(data[i]);
+      parseInput();
+    }
+  }
+
+  // NMEA-style commands ($PCAS..) end with CR LF; binary CASIC frames start with BA CE.
+  void parseInput() {
+    while (!input_.empty()) {
+      uint8_t first = static_cast<uint8_t>(input_[0]);
+      if (first == 0xBA) {
+        if (input_.size() < 6) return;
+        if (static_cast<uint8_t>(input_[1]) != 0xCE) {
+          input_.erase(0, 1);
+          continue;
+        }
+        size_t len = static_cast<uint8_t>(input_[2]) | (static_cast<uint8_t>(input_[3]) << 8);
+        if (input_.size() < 6 + len + 4) return;
+        handleCasic(static_cast<uint8_t>(input_[4]), static_cast<uint8_t>(input_[5]),
+                    reinterpret_cast<const uint8_t*>(input_.data() + 6), len);
+        input_.erase(0, 6 + len + 4);
+      } else if (first == '$') {
+        size_t end = input_.find('\n');
+        if (end == std::string::npos) return;
+        std::string line = input_.substr(0, end);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        input_.erase(0, end + 1);
+        handleCommand(line);
+      } else {
+        input_.erase(0, 1);  // blank lines and noise between messages
+      }
+    }
+  }
+
+  void handleCommand(const std::string& line) {
+    if (line.compare(0, 8, "$PCAS01,") == 0) {
+      static const unsigned long kRates[] = {4800, 9600, 19200, 38400, 57600, 115200};
+      int code = atoi(line.c_str() + 8);
+      if (code >= 0 && code < 6) {
+        deviceBaud_ = kRates[code];
+        sim_log("gnss: baud %lu", deviceBaud_);
+      }
+    } else if (line.compare(0, 8, "$PCAS03,") == 0) {
+      // Fields in order: GGA, GLL, GSA, GSV, RMC, VTG, ZDA, ANT, ...; empty = unchanged
+      size_t pos = 8;
+      for (int bit = 0; bit < 32 && pos <= line.size(); ++bit) {
+        size_t end = line.find_first_of(",*", pos);
+        if (end == std::string::npos) end = line.size();
+        if (end > pos) {
+          if (atoi(line.c_str() + pos) > 0) {
+            sentenceMask_ |= 1u << bit;
+          } else {
+            sentenceMask_ &= ~(1u << bit);
+          }
+        }
+        if (end >= line.size() || line[end] == '*') break;
+        pos = end + 1;
+      }
+      sim_log("gnss: sentence mask %08x", sentenceMask_);
+    } else if (line.compare(0, 7, "$PCAS12") == 0) {
+      standby_ = true;
+      sim_energy_set(RAIL_GNSS, g_sim.gnssStandbyMa, "standby");
+      sim_log("gnss: standby");
+    }
+  }
+
+  void handleCasic(uint8_t cls, uint8_t id, const uint8_t* payload, size_t len) {
+    uint32_t expect = (static_cast<uint32_t>(id) << 24) + (static_cast<uint32_t>(cls) << 16) + len;
+    for (size_t i = 0; i + 4 <= len; i += 4) {
+      uint32_t word;
+      memcpy(&word, payload + i, 4);
+      expect += word;
+    }
+    uint32_t checksum;
+    memcpy(&checksum, payload + len, 4);
+    if (checksum != expect || cls != 0x0B || id != 0x01 || len != 56) {
+      sim_log("gnss: CASIC %02X/%02X len %zu ignored (checksum %s)", cls, id, len,
+              checksum == expect ? "ok" : "bad");
+      return;
+    }
+    // AID-INI: lat, lon, alt (R8), tow (R8), ..., pAcc, tAcc (R4), week (U2), flags (U1)
+    double lat, lon, tow;
+    float tAcc;
+    uint16_t week;
+    memcpy(&lat, payload + 0, 8);
+    memcpy(&lon, payload + 8, 8);
+    memcpy(&tow, payload + 24, 8);
+    memcpy(&tAcc, payload + 40, 4);
+    memcpy(&week, payload + 52, 2);
+    uint8_t flags = payload[55];
+    bool posValid = (flags & 0x01) && (flags & 0x20);
+    bool timeValid = flags & 0x02;
+    double timeError = 0;
+    if (timeValid) {
+      double epoch = 315964800.0 + week * 604800.0 + tow - 18.0;
+      timeError = epoch - sim_epoch_now();
+      if (fabs(timeError) > tAcc) timeValid = false;  // wrong aiding is worse than none
+    }
+    double trueLat, trueLon;
+    double posError = 0;
+    if (posValid && sim_track_position(sim_epoch_now(), trueLat, trueLon)) {
+      double dn = (lat - trueLat) * DEG_TO_RAD * kEarthRadiusM;
+      double de = (lon - trueLon) * DEG_TO_RAD * kEarthRadiusM * cos(trueLat * DEG_TO_RAD);
+      posError = sqrt(dn * dn + de * de);
+    }
+    sim_log("gnss: AID-INI position %s (%.0f m off), time %s (%+.1f s, tAcc %.0f s)", posValid ? "yes" : "no",
+            posError, timeValid ? "used" : "no", timeError, tAcc);
+    uint64_t now = sim_now_us();
+    if (posValid && timeValid && !backupKept_ && fixAt_ > now) {
+      fixAt_ = now + static_cast<uint64_t>((fixAt_ - now) * g_sim.gnssAidFactor);
+      timeKnownAt_ = std::min(timeKnownAt_, now);
+      sim_energy_set(RAIL_GNSS, g_sim.gnssAcqMa, "acquire");
+      sim_energy_schedule(RAIL_GNSS, g_sim.gnssTrackMa, "track", fixAt_);
+    }
+  }
+
+ private:
+  // End of standby: time and ephemeris were kept, so this is a hot start
+  // unless the ephemeris has aged out meanwhile.
+  void wake(uint64_t at) {
+    SimWorld& w = sim_world();
+    standby_ = false;
+    double age = w.gnssLastFixEpoch > 0 ? sim_epoch_now() - w.gnssLastFixEpoch : 1e12;
+    bool hot = age < kEphemerisValidS;
+    std::uniform_real_distribution<double> jitter(0.85, 1.25);
+    double ttff = (hot ? g_sim.gnssHotTtffS : g_sim.gnssWarmTtffS) * jitter(rng_);
+    poweredAt_ = at;
+    timeKnownAt_ = at;
+    fixAt_ = at + static_cast<uint64_t>(ttff * 1e6);
+    nextTickAt_ = at + kS;
+    backupKept_ = true;
+    geometryHeadStartS_ = hot ? kConvergedAfterS : 0.0;
+    sim_energy_set(RAIL_GNSS, g_sim.gnssAcqMa, "acquire");
+    sim_energy_schedule(RAIL_GNSS, g_sim.gnssTrackMa, "track", fixAt_);
+    sim_log("gnss: woken from standby, %s start, TTFF %.1fs", hot ? "hot" : "warm", ttff);
+  }
+
+  void powerUp() {
+    SimWorld& w = sim_world();
+    uint64_t now = sim_now_us();
+    powered_ = true;
+    deviceBaud_ = 9600;  // the L76K does not persist PCAS01/PCAS03 without power
+    lineMaxBaud_ = g_sim.gnssMaxBaud > 0 ? g_sim.gnssMaxBaud : 0;
+    sentenceMask_ = kAllSentences;
+    rng_.seed(0x9e3779b9u ^ w.cycle);
+    double epoch = sim_epoch_now();
+    double age = w.gnssLastFixEpoch > 0 ? epoch - w.gnssLastFixEpoch : 1e12;
+    double ttff;
+    const char* mode;
+    backupKept_ = w.gnssBackupKept;
+    geometryHeadStartS_ = 0.0;
+    if (w.gnssBackupKept && age < kEphemerisValidS) {
+      ttff = g_sim.gnssHotTtffS;
+      mode = "hot";
+      geometryHeadStartS_ = kConvergedAfterS;
+    } else if (w.gnssBackupKept) {
+      ttff = g_sim.gnssWarmTtffS;
+      mode = "warm";
+    } else {
+      ttff = g_sim.gnssColdTtffS;
+      mode = "cold";
+    }
+    std::uniform_real_distribution<double> jitter(0.85, 1.25);
+    ttff *= jitter(rng_);
+    poweredAt_ = now;
+    timeKnownAt_ = now + static_cast<uint64_t>(std::min(ttff * 0.4, 6.0) * 1e6);
+    fixAt_ = now + static_cast<uint64_t>(ttff * 1e6);
+    // First sentences roughly one second after power is applied.
+    nextTickAt_ = now + kS;
+    loadReplay();
+    sim_energy_set(RAIL_GNSS, g_sim.gnssAcqMa, "acquire");
+    sim_energy_schedule(RAIL_GNSS, g_sim.gnssTrackMa, "track", fixAt_);
+    sim_log("gnss: power on, %s start, TTFF %.1fs", mode, ttff);
+  }
+
+  void powerDown() {
+    SimWorld& w = sim_world();
+    powered_ = false;
+    standby_ = false;
+    input_.clear();
+    purgeRx();
+    w.gnssLastPowerOffEpoch = sim_epoch_now();
+    w.gnssBackupKept = false;
+    sim_energy_set(RAIL_GNSS, 0.0, "off");
+    sim_log("gnss: power off");
+  }
+
+  void loadReplay() {
+    replay_.clear();
+    replayPos_ = 0;
+    if (g_sim.nmeaFile.empty()) return;
+    std::ifstream in(g_sim.nmeaFile);
+    std::string line;
+    while (std::getline(in, line)) {
+      if (!line.empty() && line.back() == '\r') line.pop_back();
+      if (!line.empty() && line[0] == '$') replay_.push_back(line + "\r\n");
+    }
+  }
+
+  // One second of replayed capture: everything up to and including the next RMC.
+  void emitReplay(uint64_t at) {
+    std::string burst;
+    while (!replay_.empty()) {
+      const std::string& line = replay_[replayPos_ % replay_.size()];
+      replayPos_++;
+      burst += line;
+      if (line.compare(3, 3, "RMC") == 0) break;
+    }
+    sim_stats().nmeaBytes += static_cast<uint32_t>(burst.size());
+    emit(burst, at);
+  }
+
+  void emitEpoch(uint64_t at) {
+    if (!replay_.empty()) return emitReplay(at);
+
+    double secondsOn = static_cast<double>(at - poweredAt_) / 1e6;
+    double epoch = sim_epoch_now() - static_cast<double>(sim_now_us() - at) / 1e6;
+    bool timeValid = at >= timeKnownAt_;
+    bool fix = at >= fixAt_;
+    double sinceFix = fix ? static_cast<double>(at - fixAt_) / 1e6 + geometryHeadStartS_ : 0.0;
+
+    // Geometry converges after the first fix: more satellites, lower DOP. With
+    // ephemeris kept from before, every visible satellite is usable at once.
+    int tracked = fix ? std::min(12, 5 + static_cast<int>(sinceFix / 3.0))
+                      : std::min(4, static_cast<int>(secondsOn / 6.0));
+    double hdop = fix ? 0.8 + 2.2 * exp(-sinceFix / 12.0) : 99.99;
+    double pdop = hdop * 1.6;
+    double vdop = hdop * 1.3;
+
+    // Receivers report the position at the whole second of the fix time
+    double lat, lon;
+    sim_track_position(std::floor(epoch), lat, lon);
+    if (fix) {
+      std::normal_distribution<double> noise(0.0, hdop * 2.5);
+      lat += noise(rng_) / kEarthRadiusM * RAD_TO_DEG;
+      lon += noise(rng_) / (kEarthRadiusM * cos(lat * DEG_TO_RAD)) * RAD_TO_DEG;
+      sim_world().gnssLastFixEpoch = epoch;
+    }
+
+    time_t whole = static_cast<time_t>(epoch);
+    struct tm tmv;
+    gmtime_r(&whole, &tmv);
+    char hms[16] = "";
+    char dmy[32] = "";  // Sized for any int, not just a valid date
+    if (timeValid) {
+      snprintf(hms, sizeof(hms), "%02d%02d%02d.000", tmv.tm_hour, tmv.tm_min, tmv.tm_sec);
+      snprintf(dmy, sizeof(dmy), "%02d%02d%02d", tmv.tm_mday, tmv.tm_mon + 1, tmv.tm_year % 100);
+    }
+
+    double knots = g_sim.speedKmh / 1.852;
+    char buf[200];
+    std::string out;
+    std::string latStr = fix ? nmea_coord(lat, true) : ",";
+    std::string lonStr = fix ? nmea_coord(lon, false) : ",";
+
+    snprintf(buf, sizeof(buf), "GNGGA,%s,%s,%s,%d,%02d,%.1f,%s,M,45.2,M,,", hms, latStr.c_str(), lonStr.c_str(),
+             fix ? 1 : 0, tracked, fix ? hdop : 99.99, fix ? "251.3" : "");
+    if (enabled(kGga)) out += with_checksum(buf);
+    snprintf(buf, sizeof(buf), "GNGLL,%s,%s,%s,%c,%c", latStr.c_str(), lonStr.c_str(), hms, fix ? 'A' : 'V',
+             fix ? 'A' : 'N');
+    if (enabled(kGll)) out += with_checksum(buf);
+
+    std::vector<SkySat> sky = skyView(tracked);
+    if (enabled(kGsa)) {
+      out += gsa("GNGSA", sky, "GP", fix, pdop, hdop, vdop, 1);
+      out += gsa("GNGSA", sky, "BD", fix, pdop, hdop, vdop, 4);
+    }
+    if (enabled(kGsv)) {
+      out += gsv("GPGSV", sky, "GP");
+      out += gsv("BDGSV", sky, "BD");
+    }
+
+    snprintf(buf, sizeof(buf), "GNRMC,%s,%c,%s,%s,%.3f,%.2f,%s,,,%c,V", hms, fix ? 'A' : 'V', latStr.c_str(),
+             lonStr.c_str(), fix ? knots : 0.0, fix ? g_sim.headingDeg : 0.0, dmy, fix ? 'A' : 'N');
+    if (enabled(kRmc)) out += with_checksum(buf);
+    snprintf(buf, sizeof(buf), "GNVTG,%.2f,T,,M,%.3f,N,%.3f,K,%c", fix ? g_sim.headingDeg : 0.0,
+             fix ? knots : 0.0, fix ? g_sim.speedKmh : 0.0, fix ? 'A' : 'N');
+    if (enabled(kVtg)) out += with_checksum(buf);
+    if (timeValid) {
+      snprintf(buf, sizeof(buf), "GNZDA,%s,%02d,%02d,%04d,00,00", hms, tmv.tm_mday, tmv.tm_mon + 1,
+               tmv.tm_year + 1900);
+    } else {
+      snprintf(buf, sizeof(buf), "GNZDA,,,,,00,00");
+    }
+    if (enabled(kZda)) out += with_checksum(buf);
+    if (enabled(kAnt)) out += with_checksum("GPTXT,01,01,01,ANTENNA OK");
+
+    sim_stats().nmeaBytes += static_cast<uint32_t>(out.size());
+    emit(out, at);
+  }
+
+  // $PCAS03 field order
+  enum Sentence { kGga = 0, kGll, kGsa, kGsv, kRmc, kVtg, kZda, kAnt };
+  bool enabled(Sentence s) const { return sentenceMask_ & (1u << s); }
+
+  std::vector<SkySat> skyView(int tracked) const {
+    static const SkySat kSky[] = {
+        {"GP", 2, 64, 310, 44}, {"GP", 5, 41, 72, 41},   {"GP", 12, 27, 198, 37}, {"GP", 15, 55, 251, 43},
+        {"GP", 18, 12, 145, 30}, {"GP", 24, 33, 284, 38}, {"GP", 25, 71, 128, 46}, {"GP", 29, 8, 23, 26},
+        {"BD", 6, 48, 121, 40},  {"BD", 9, 36, 214, 37},  {"BD", 16, 59, 166, 42}, {"BD", 23, 17, 302, 31},
+    };
+    std::vector<SkySat> sky(std::begin(kSky), std::end(kSky));
+    // Strongest satellites are tracked first.
+    std::vector<size_t> order(sky.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&sky](size_t a, size_t b) { return sky[a].snr > sky[b].snr; });
+    for (size_t i = 0; i < order.size(); ++i) {
+      if (static_cast<int>(i) >= tracked) sky[order[i]].snr = 0;
+    }
+    return sky;
+  }
+
+  static std::string gsa(const char* tag, const std::vector<SkySat>& sky, const char* talker, bool fix, double pdop,
+                         double hdop, double vdop, int systemId) {
+    std::string body = std::string(tag) + ",A," + (fix ? "3" : "1");
+    int slots = 0;
+    char buf[16];
+    for (const SkySat& s : sky) {
+      if (strcmp(s.talker, talker) != 0 || s.snr == 0 || slots == 12) continue;
+      snprintf(buf, sizeof(buf), ",%02d", s.prn);
+      body += buf;
+      slots++;
+    }
+    for (; slots < 12; ++slots) body += ",";
+    char tail[64];
+    snprintf(tail, sizeof(tail), ",%.1f,%.1f,%.1f,%d", fix ? pdop : 99.99, fix ? hdop : 99.99, fix ? vdop : 99.99,
+             systemId);
+    return with_checksum(body + tail);
+  }
+
+  static std::string gsv(const char* tag, const std::vector<SkySat>& sky, const char* talker) {
+    std::vector<SkySat> mine;
+    for (const SkySat& s : sky) {
+      if (strcmp(s.talker, talker) == 0) mine.push_back(s);
+    }
+    int total = static_cast<int>((mine.size() + 3) / 4);
+    std::string out;
+    char buf[48];
+    for (int msg = 0; msg < total; ++msg) {
+      snprintf(buf, sizeof(buf), "%s,%d,%d,%02zu", tag, total, msg + 1, mine.size());
+      std::string body = buf;
+      for (size_t i = msg * 4; i < mine.size() && i < static_cast<size_t>(msg * 4 + 4); ++i) {
+        if (mine[i].snr > 0) {
+          snprintf(buf, sizeof(buf), ",%02d,%02d,%03d,%02d", mine[i].prn, mine[i].elevation, mine[i].azimuth,
+                   mine[i].snr);
+        } else {
+          snprintf(buf, sizeof(buf), ",%02d,%02d,%03d,", mine[i].prn, mine[i].elevation, mine[i].azimuth);
+        }
+        body += buf;
+      }
+      body += ",0";
+      out += with_checksum(body);
+    }
+    return out;
+  }
+
+  std::mutex mutex_;
+  bool powered_ = false;
+  bool standby_ = false;
+  uint32_t sentenceMask_ = kAllSentences;
+  bool backupKept_ = false;
+  double geometryHeadStartS_ = 0.0;
+  uint64_t poweredAt_ = 0;
+  uint64_t timeKnownAt_ = 0;
+  uint64_t fixAt_ = 0;
+  uint64_t nextTickAt_ = 0;
+  std::mt19937 rng_;
+  std::string input_;
+  std::vector<std::string> replay_;
+  size_t replayPos_ = 0;
+};
+
+SimGnss* g_gnss_dev = nullptr;
+
+SimGnss& gnss() {
+  if (!g_gnss_dev) {
+    g_gnss_dev = new SimGnss();
+    g_gnss_dev->restoreFromWorld();
+  }
+  return *g_gnss_dev;
+}
+
+}  // namespace
+
+SimUartDevice* sim_gnss_device() { return &gnss(); }
+
+void sim_gnss_on_pin(int pin, int level) { gnss().onPin(pin, level); }
+
+double sim_gnss_prepare_sleep() { return gnss().prepareSleep(sim_gpio_held(kGnssPowerPin)); }
+
+bool sim_track_position(double epoch, double& lat, double& lon) {
+  const SimWorld& w = sim_world();
+  uint32_t i = w.legCount ? w.legCount - 1 : 0;
+  while (i > 0 && w.legs[i].fromEpoch > epoch) --i;
+  const SimTrackLeg& leg = w.legs[i];
+  double dist = leg.speedKmh / 3.6 * (epoch - leg.fromEpoch);
+  double hdg = leg.headingDeg * DEG_TO_RAD;
+  lat = leg.lat + (dist * cos(hdg) / kEarthRadiusM) * RAD_TO_DEG;
+  lon = leg.lon + (dist * sin(hdg) / (kEarthRadiusM * cos(leg.lat * DEG_TO_RAD))) * RAD_TO_DEG;
+  return g_sim.nmeaFile.empty();
+}
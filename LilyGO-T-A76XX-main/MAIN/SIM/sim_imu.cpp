@@ -0,0 +1,192 @@
+// QMI8658 IMU emulator on I2C: the register file SensorLib touches (WHOAMI,
+// soft reset with its done flag, CTRL9 command handshake, accelerometer enable,
+// interrupt enable) and wake-on-motion. While the vehicle moves, an armed WoM
+// raises STATUS1.WoM and toggles the interrupt pin once per blanking time; the
+// pin can end a deep sleep through ext1.
+
+#include <Arduino.h>
+#include <mutex>
+#include "sim.h"
+
+namespace {
+
+constexpr uint8_t kAddress = 0x6B;   // QMI8658_L_SLAVE_ADDRESS
+constexpr int kIntPin = 39;          // IMU_INT_PIN in MAIN/FINAL/config.h (INT2)
+constexpr uint64_t kResetUs = 15000; // Soft reset takes up to 15 ms
+constexpr uint64_t kWomEventUs = 1500000;  // 32 blanking samples at 21 Hz low-power ODR
+
+enum Reg : uint8_t {
+  kWhoAmI = 0x00,
+  kRevision = 0x01,
+  kCtrl1 = 0x02,
+  kCtrl7 = 0x08,
+  kCtrl9 = 0x0A,
+  kCal1L = 0x0B,
+  kCal1H = 0x0C,
+  kStatusInt = 0x2D,
+  kStatus1 = 0x2F,
+  kResetDone = 0x4D,
+  kReset = 0x60,
+};
+
+constexpr uint8_t kCmdAck = 0x00;
+constexpr uint8_t kCmdWriteWom = 0x08;
+
+class SimImu : public SimI2cDevice {
+ public:
+  SimImu() {
+    if (!sim_world().imuPowered) {
+      sim_world().imuPowered = true;
+      reset();
+    }
+  }
+
+  bool i2cWrite(const uint8_t* data, size_t len) override {
+    std::lock_guard<std::mutex> lock(m_);
+    advance(sim_now_us());
+    if (len == 0) return true;
+    pointer_ = data[0] & 0x7F;
+    for (size_t i = 1; i < len; ++i) {
+      writeRegister(pointer_, data[i]);
+      pointer_ = (pointer_ + 1) & 0x7F;
+    }
+    return true;
+  }
+
+  size_t i2cRead(uint8_t* buffer, size_t len) override {
+    std::lock_guard<std::mutex> lock(m_);
+    uint64_t now = sim_now_us();
+    advance(now);
+    uint8_t* r = sim_world().imuRegs;
+    for (size_t i = 0; i < len; ++i) {
+      uint8_t reg = pointer_;
+      buffer[i] = reg == kResetDone && now < resetDoneAt_ ? 0 : r[reg];
+      if (reg == kStatus1) r[kStatus1] &= ~0x04;  // WoM flag clears on read
+      pointer_ = (pointer_ + 1) & 0x7F;
+    }
+    return len;
+  }
+
+  int intLevel() {
+    std::lock_guard<std::mutex> lock(m_);
+    advance(sim_now_us());
+    return sim_world().imuIntLevel;
+  }
+
+  uint64_t deepSleep(uint64_t sleepUs, uint64_t motionFromUs, uint64_t motionUntilUs, uint64_t ext1Mask,
+                     int ext1Mode) {
+    std::lock_guard<std::mutex> lock(m_);
+    SimWorld& w = sim_world();
+    if (!w.imuWomArmed || motionUntilUs <= motionFromUs) return sleepUs;
+    bool watched = (ext1Mask >> kIntPin) & 1;
+    int wakeLevel = ext1Mode == ESP_EXT1_WAKEUP_ANY_HIGH ? HIGH : LOW;
+    uint64_t end = motionUntilUs < sleepUs ? motionUntilUs : sleepUs;
+    for (uint64_t at = motionFromUs + kWomEventUs; at < end; at += kWomEventUs) {
+      toggle();
+      if (watched && w.imuIntLevel == wakeLevel) {
+        w.ext1WakeStatus = 1ULL << kIntPin;
+        return at;
+      }
+    }
+    return sleepUs;
+  }
+
+ private:
+  void reset() {
+    SimWorld& w = sim_world();
+    memset(w.imuRegs, 0, sizeof(w.imuRegs));
+    w.imuRegs[kWhoAmI] = 0x05;
+    w.imuRegs[kRevision] = 0x7C;
+    w.imuRegs[kResetDone] = 0x80;
+    w.imuWomArmed = false;
+    w.imuIntLevel = LOW;
+    resetDoneAt_ = sim_now_us() + kResetUs;
+    lastEventAt_ = 0;
+  }
+
+  void writeRegister(uint8_t reg, uint8_t value) {
+    SimWorld& w = sim_world();
+    switch (reg) {
+      case kWhoAmI:
+      case kRevision:
+      case kStatusInt:
+      case kStatus1:
+      case kResetDone:
+        return;  // Read-only
+      case kReset:
+        if (value == 0xB0) reset();
+        return;
+      case kCtrl9:
+        w.imuRegs[kCtrl9] = value;
+        if (value == kCmdAck) {
+          w.imuRegs[kStatusInt] &= ~0x80;
+          return;
+        }
+        if (value == kCmdWriteWom) {
+          // CAL1_H: bit 7 initial pin level, bit 6 INT2, bits 5..0 blanking samples
+          w.imuWomArmed = w.imuRegs[kCal1L] != 0;
+          w.imuIntLevel = (w.imuRegs[kCal1H] & 0x80) ? HIGH : LOW;
+          lastEventAt_ = sim_now_us();
+        }
+        w.imuRegs[kStatusInt] |= 0x80;  // CTRL9 command done
+        return;
+      default:
+        w.imuRegs[reg] = value;
+    }
+  }
+
+  bool womActive() const {
+    const SimWorld& w = sim_world();
+    // WoM needs the accelerometer on (CTRL7.0) and INT2 enabled (CTRL1.4)
+    return w.imuWomArmed && (w.imuRegs[kCtrl7] & 0x01) && (w.imuRegs[kCtrl1] & 0x10);
+  }
+
+  void toggle() {
+    SimWorld& w = sim_world();
+    w.imuIntLevel = w.imuIntLevel == HIGH ? LOW : HIGH;
+    w.imuRegs[kStatus1] |= 0x04;
+    w.imuWomEvents++;
+  }
+
+  // Awake: the vehicle moves at the current scenario speed
+  void advance(uint64_t nowUs) {
+    if (!womActive() || g_sim.speedKmh <= 0.0) {
+      lastEventAt_ = nowUs;
+      return;
+    }
+    while (nowUs >= lastEventAt_ + kWomEventUs) {
+      lastEventAt_ += kWomEventUs;
+      toggle();
+    }
+  }
+
+  std::mutex m_;
+  uint8_t pointer_ = 0;
+  uint64_t resetDoneAt_ = 0;
+  uint64_t lastEventAt_ = 0;
+};
+
+SimImu* g_imu_dev = nullptr;
+
+SimImu& imu() {
+  if (!g_imu_dev) g_imu_dev = new SimImu();
+  return *g_imu_dev;
+}
+
+}  // namespace
+
+SimI2cDevice* sim_i2c_device(uint8_t address) {
+  if (address == kAddress && g_sim.imuPresent) return &imu();
+  return nullptr;
+}
+
+int sim_imu_pin_level(int pin) {
+  if (pin != kIntPin || !g_sim.imuPresent || !sim_world().imuPowered) return -1;
+  return imu().intLevel();
+}
+
+uint64_t sim_imu_deep_sleep(uint64_t sleepUs, uint64_t motionFromUs, uint64_t motionUntilUs, uint64_t ext1Mask,
+                            int ext1Mode) {
+  if (!g_sim.imuPresent || !sim_world().imuPowered) return sleepUs;
+  return imu().deepSleep(sleepUs, motionFromUs, motionUntilUs, ext1Mask, ext1Mode);
+}
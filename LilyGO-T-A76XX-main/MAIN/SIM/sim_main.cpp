@@ -0,0 +1,682 @@
+// Simulation driver: virtual clock, energy bookkeeping, ESP-IDF sleep/GPIO
+// stand-ins and the wake-cycle loop. Every wake runs in a forked child so the
+// firmware starts from pristine globals exactly like after a deep sleep,
+// while RTC_DATA_ATTR variables are carried over through shared memory.
+
+#include <Arduino.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "sim.h"
+
+void setup();
+void loop();
+
+// Linker-provided bounds of the RTC_DATA_ATTR section.
+extern "C" char __start_sim_rtc_data[];
+extern "C" char __stop_sim_rtc_data[];
+// Guarantees the section exists even if the firmware has no RTC variables.
+RTC_DATA_ATTR static uint32_t g_rtc_anchor = 0x52544321;
+
+SimScenario g_sim;
+
+namespace {
+
+// MAIN/FINAL board wiring the driver itself cares about
+constexpr int kPinEn = 23;
+constexpr int kPinButton = 32;
+constexpr int kModemRxPin = 25;
+constexpr int kGnssRxPin = 34;
+constexpr size_t kRtcCapacity = 8192;
+constexpr double kHangLimitS = 30.0 * 60.0;
+
+struct Shared {
+  SimWorld world;
+  SimCycleStats stats;
+  size_t rtcSize;
+  uint8_t rtc[kRtcCapacity];
+};
+
+Shared* g_shared = nullptr;
+
+// --- Clock -------------------------------------------------------------------
+
+std::chrono::steady_clock::time_point g_clock_origin;
+double g_scale = 200.0;
+
+// --- Energy ------------------------------------------------------------------
+
+struct EnergyEvent {
+  uint64_t at;
+  double ma;
+  const char* state;
+};
+
+std::mutex g_energy_mutex;
+std::vector<EnergyEvent> g_energy[RAIL_COUNT];
+
+double integrate_rail(SimRail rail, uint64_t endUs, double* onSeconds) {
+  std::vector<EnergyEvent> ev = g_energy[rail];
+  std::stable_sort(ev.begin(), ev.end(), [](const EnergyEvent& a, const EnergyEvent& b) { return a.at < b.at; });
+  double mas = 0.0;
+  double on = 0.0;
+  double ma = 0.0;
+  uint64_t t = 0;
+  for (const EnergyEvent& e : ev) {
+    uint64_t at = std::min(e.at, endUs);
+    if (at > t) {
+      double dt = static_cast<double>(at - t) / 1e6;
+      mas += ma * dt;
+      if (ma > 0.5) on += dt;
+      t = at;
+    }
+    if (e.at > endUs) break;
+    ma = e.ma;
+  }
+  if (endUs > t) {
+    double dt = static_cast<double>(endUs - t) / 1e6;
+    mas += ma * dt;
+    if (ma > 0.5) on += dt;
+  }
+  if (onSeconds) *onSeconds = on;
+  return mas;
+}
+
+// --- GPIO hold / sleep config -------------------------------------------------
+
+std::mutex g_hold_mutex;
+bool g_gpio_held[64];
+uint64_t g_timer_wakeup_us = 0;
+bool g_uart_wakeup = false;
+uint64_t g_ext1_mask = 0;
+int g_ext1_mode = ESP_EXT1_WAKEUP_ALL_LOW;
+std::atomic<bool> g_cycle_ending{false};
+
+// --- Console -------------------------------------------------------------------
+
+class SimConsole : public SimUartDevice {
+ public:
+  const char* name() const override { return "console"; }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  size_t write(const uint8_t* data, size_t len) override {
+    std::lock_guard<std::mutex> lock(m_);
+    for (size_t i = 0; i < len; ++i) {
+      char c = static_cast<char>(data[i]);
+      if (c == '\r') continue;
+      if (c == '\n') {
+        flushLine();
+      } else {
+        line_ += c;
+      }
+    }
+    return len;
+  }
+  void flushLine() {
+    if (!g_sim.quiet) {
+      fprintf(stdout, "[%4u %9.3f] %s\n", sim_world().cycle, sim_now_us() / 1e6, line_.c_str());
+      fflush(stdout);
+    }
+    line_.clear();
+  }
+
+ private:
+  std::mutex m_;
+  std::string line_;
+};
+
+SimConsole g_console;
+
+// --- Scenario parsing -----------------------------------------------------------
+
+struct Knob {
+  const char* name;
+  char kind;  // d = double, i = int, b = bool, s = string, z = size_t
+  void* ptr;
+};
+
+std::vector<Knob> knobs() {
+  SimScenario& s = g_sim;
+  return {
+      {"timeScale", 'd', &s.timeScale},
+      {"cycles", 'i', &s.cycles},
+      {"quiet", 'b', &s.quiet},
+      {"stateDir", 's', &s.stateDir},
+      {"nmeaFile", 's', &s.nmeaFile},
+      {"gnssColdTtffS", 'd', &s.gnssColdTtffS},
+      {"gnssWarmTtffS", 'd', &s.gnssWarmTtffS},
+      {"gnssHotTtffS", 'd', &s.gnssHotTtffS},
+      {"gnssAcqMa", 'd', &s.gnssAcqMa},
+      {"gnssTrackMa", 'd', &s.gnssTrackMa},
+      {"gnssBackupMa", 'd', &s.gnssBackupMa},
+      {"gnssStandbyMa", 'd', &s.gnssStandbyMa},
+      {"gnssAidFactor", 'd', &s.gnssAidFactor},
+      {"gnssMaxBaud", 'i', &s.gnssMaxBaud},
+      {"startLat", 'd', &s.startLat},
+      {"startLon", 'd', &s.startLon},
+      {"speedKmh", 'd', &s.speedKmh},
+      {"headingDeg", 'd', &s.headingDeg},
+      {"motionChangeS", 'd', &s.motionChangeS},
+      {"modemBootS", 'd', &s.modemBootS},
+      {"modemRegS", 'd', &s.modemRegS},
+      {"modemAttachS", 'd', &s.modemAttachS},
+      {"modemRttMs", 'd', &s.modemRttMs},
+      {"modemTlsMs", 'd', &s.modemTlsMs},
+      {"serverKeepAliveS", 'd', &s.serverKeepAliveS},
+      {"modemUplinkBps", 'd', &s.modemUplinkBps},
+      {"modemLossPerKb", 'd', &s.modemLossPerKb},
+      {"modemDownlinkBps", 'd', &s.modemDownlinkBps},
+      {"modemIdleMa", 'd', &s.modemIdleMa},
+      {"modemSearchMa", 'd', &s.modemSearchMa},
+      {"modemTxMa", 'd', &s.modemTxMa},
+      {"modemPsmMa", 'd', &s.modemPsmMa},
+      {"modemMaxBaud", 'i', &s.modemMaxBaud},
+      {"modemHasGnss", 'b', &s.modemHasGnss},
+      {"modemGnssTtffS", 'd', &s.modemGnssTtffS},
+      {"modemAgpsS", 'd', &s.modemAgpsS},
+      {"modemAgpsTtffS", 'd', &s.modemAgpsTtffS},
+      {"modemGnssMa", 'd', &s.modemGnssMa},
+      {"psmGranted", 'b', &s.psmGranted},
+      {"serverSupportsSync", 'b', &s.serverSupportsSync},
+      {"serverMaxBatch", 'i', &s.serverMaxBatch},
+      {"serverMaxBodyBytes", 'z', &s.serverMaxBodyBytes},
+      {"serverProcessMs", 'd', &s.serverProcessMs},
+      {"serverIntervalGps", 'i', &s.serverIntervalGps},
+      {"serverIntervalSend", 'i', &s.serverIntervalSend},
+      {"serverSatellites", 'i', &s.serverSatellites},
+      {"serverAccuracyM", 'i', &s.serverAccuracyM},
+      {"serverResolutionM", 'i', &s.serverResolutionM},
+      {"serverTrackToleranceM", 'i', &s.serverTrackToleranceM},
+      {"serverIntervalMin", 'i', &s.serverIntervalMin},
+      {"serverIntervalMax", 'i', &s.serverIntervalMax},
+      {"imuPresent", 'b', &s.imuPresent},
+      {"mcuActiveMa", 'd', &s.mcuActiveMa},
+      {"mcuLowClockMa", 'd', &s.mcuLowClockMa},
+      {"mcuLightSleepMa", 'd', &s.mcuLightSleepMa},
+      {"mcuDeepSleepMa", 'd', &s.mcuDeepSleepMa},
+      {"batteryVolts", 'd', &s.batteryVolts},
+  };
+}
+
+bool apply_knob(const std::string& assignment) {
+  size_t eq = assignment.find('=');
+  if (eq == std::string::npos) return false;
+  std::string key = assignment.substr(0, eq);
+  std::string value = assignment.substr(eq + 1);
+  for (const Knob& k : knobs()) {
+    if (key != k.name) continue;
+    switch (k.kind) {
+      case 'd': *static_cast<double*>(k.ptr) = atof(value.c_str()); break;
+      case 'i': *static_cast<int*>(k.ptr) = atoi(value.c_str()); break;
+      case 'z': *static_cast<size_t*>(k.ptr) = strtoul(value.c_str(), nullptr, 10); break;
+      case 'b': *static_cast<bool*>(k.ptr) = value == "1" || value == "true" || value == "yes"; break;
+      case 's': *static_cast<std::string*>(k.ptr) = value; break;
+    }
+    return true;
+  }
+  fprintf(stderr, "sim: unknown setting '%s'\n", key.c_str());
+  return false;
+}
+
+// Scenario scripts hold one `key=value` per line; `@N key=value` applies from
+// wake cycle N onwards, which is how outages or route changes are scripted.
+std::multimap<uint32_t, std::string> g_script;
+
+bool load_script(const char* path) {
+  std::ifstream in(path);
+  if (!in) {
+    fprintf(stderr, "sim: cannot read scenario %s\n", path);
+    return false;
+  }
+  std::string line;
+  while (std::getline(in, line)) {
+    size_t hash = line.find('#');
+    if (hash != std::string::npos) line.resize(hash);
+    std::istringstream words(line);
+    std::string word;
+    uint32_t fromCycle = 0;
+    while (words >> word) {
+      if (word[0] == '@') {
+        fromCycle = static_cast<uint32_t>(atoi(word.c_str() + 1));
+        continue;
+      }
+      if (fromCycle == 0) {
+        if (!apply_knob(word)) return false;
+      } else {
+        g_script.emplace(fromCycle, word);
+      }
+    }
+  }
+  return true;
+}
+
+void apply_script_for_cycle(uint32_t cycle) {
+  auto range = g_script.equal_range(cycle);
+  for (auto it = range.first; it != range.second; ++it) apply_knob(it->second);
+}
+
+// Speed from wake cycle `cycle` on, as the script will set it
+double scripted_speed(uint32_t cycle) {
+  double speed = g_sim.speedKmh;
+  auto range = g_script.equal_range(cycle);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second.compare(0, 9, "speedKmh=") == 0) speed = atof(it->second.c_str() + 9);
+  }
+  return speed;
+}
+
+// A scripted speed/heading change starts a new leg motionChangeS into the sleep before the cycle
+void update_track(SimWorld& w, double sleepStartEpoch, double sleepS) {
+  SimTrackLeg& last = w.legs[w.legCount - 1];
+  if (last.speedKmh == g_sim.speedKmh && last.headingDeg == g_sim.headingDeg) return;
+  double at = sleepStartEpoch + std::min(sleepS, g_sim.motionChangeS);
+  double lat, lon;
+  sim_track_position(at, lat, lon);
+  if (w.legCount == sizeof(w.legs) / sizeof(w.legs[0])) {
+    memmove(&w.legs[0], &w.legs[1], sizeof(w.legs) - sizeof(w.legs[0]));
+    w.legCount--;
+  }
+  w.legs[w.legCount++] = {at, lat, lon, g_sim.speedKmh, g_sim.headingDeg};
+}
+
+// --- Cycle handling -------------------------------------------------------------
+
+void save_rtc() {
+  size_t size = static_cast<size_t>(__stop_sim_rtc_data - __start_sim_rtc_data);
+  if (size > kRtcCapacity) size = kRtcCapacity;
+  memcpy(g_shared->rtc, __start_sim_rtc_data, size);
+  g_shared->rtcSize = size;
+}
+
+void restore_rtc() {
+  size_t size = static_cast<size_t>(__stop_sim_rtc_data - __start_sim_rtc_data);
+  if (g_shared->rtcSize == size) memcpy(__start_sim_rtc_data, g_shared->rtc, size);
+}
+
+void run_child(bool coldBoot) {
+  if (!coldBoot) restore_rtc();
+  (void)g_rtc_anchor;
+  g_clock_origin = std::chrono::steady_clock::now();
+  memset(&g_shared->stats, 0, sizeof(g_shared->stats));
+  sim_energy_set(RAIL_MCU, g_sim.mcuActiveMa, "active");
+  sim_energy_set(RAIL_GNSS, 0.0, "off");
+  sim_energy_set(RAIL_MODEM, 0.0, "off");
+  sim_energy_set(RAIL_MODEM_GNSS, 0.0, "off");
+  // Instantiate the modem so a module left powered in the previous cycle keeps
+  // drawing current even if this cycle never talks to it.
+  sim_modem_device();
+
+  std::thread([] {
+    for (;;) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      if (sim_now_us() / 1e6 > kHangLimitS && !g_cycle_ending) {
+        sim_log("cycle exceeded %.0f s awake, treating as hung", kHangLimitS);
+        g_shared->stats.hung = true;
+        sim_end_cycle(false, 0);
+      }
+    }
+  }).detach();
+
+  setup();
+  for (;;) {
+    loop();
+    delay(1);
+  }
+}
+
+void print_cycle(const SimWorld& w, const SimCycleStats& s) {
+  double total = s.mcuMas + s.gnssMas + s.modemMas;
+  printf(
+      "cycle %3u  awake %7.1fs  gnss %6.1fs  modem %6.1fs  E_awake %7.3f mAh  E_sleep %7.4f mAh  "
+      "http %2u  up %6u B  rec %3u  AT %4u  fs w/r %6u/%6u B  nvs %2u  nmea %6u B  rx-lost %u%s%s\n",
+      w.cycle, s.awakeS, s.gnssOnS, s.modemOnS, total / 3600.0, s.sleepMas / 3600.0, s.httpRequests, s.uplinkBytes,
+      s.recordsDelivered, s.atCommands, s.fsBytesWritten, s.fsBytesRead, s.nvsWrites, s.nmeaBytes, s.uartRxLost,
+      s.hung ? "  HUNG" : "", s.shutdown ? "  SHUTDOWN" : "");
+  fflush(stdout);
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: gps_sim [--cycles N] [--scale X] [--state DIR] [--nmea FILE] [--scenario FILE]\n"
+          "               [--set key=value]... [--fresh] [--quiet]\n");
+}
+
+}  // namespace
+
+// --- Public sim API ------------------------------------------------------------
+
+uint64_t sim_now_us() {
+  auto real = std::chrono::steady_clock::now() - g_clock_origin;
+  double us = std::chrono::duration<double, std::micro>(real).count() * g_scale;
+  return static_cast<uint64_t>(us);
+}
+
+void sim_sleep_us(uint64_t virtualMicros) {
+  if (virtualMicros == 0) {
+    std::this_thread::yield();
+    return;
+  }
+  std::this_thread::sleep_for(std::chrono::duration<double, std::micro>(virtualMicros / g_scale));
+}
+
+double sim_time_scale() { return g_scale; }
+
+void sim_clock_init(double scale) { g_scale = scale > 0 ? scale : 1.0; }
+
+double sim_epoch_now() { return sim_world().epochAtWake + sim_now_us() / 1e6; }
+
+SimWorld& sim_world() { return g_shared->world; }
+SimCycleStats& sim_stats() { return g_shared->stats; }
+
+void sim_energy_set(SimRail rail, double milliAmps, const char* state) {
+  std::lock_guard<std::mutex> lock(g_energy_mutex);
+  uint64_t now = sim_now_us();
+  std::vector<EnergyEvent>& ev = g_energy[rail];
+  ev.erase(std::remove_if(ev.begin(), ev.end(), [now](const EnergyEvent& e) { return e.at > now; }), ev.end());
+  ev.push_back({now, milliAmps, state});
+}
+
+void sim_energy_schedule(SimRail rail, double milliAmps, const char* state, uint64_t atUs) {
+  std::lock_guard<std::mutex> lock(g_energy_mutex);
+  g_energy[rail].push_back({atUs, milliAmps, state});
+}
+
+double sim_energy_rail_ma(SimRail rail) {
+  std::lock_guard<std::mutex> lock(g_energy_mutex);
+  uint64_t now = sim_now_us();
+  double ma = 0.0;
+  uint64_t best = 0;
+  for (const EnergyEvent& e : g_energy[rail]) {
+    if (e.at <= now && e.at >= best) {
+      best = e.at;
+      ma = e.ma;
+    }
+  }
+  return ma;
+}
+
+SimUartDevice* sim_console_device() { return &g_console; }
+
+SimUartDevice* sim_uart_device_for_pins(int uartNr, int rxPin, int txPin) {
+  (void)txPin;
+  if (rxPin == kModemRxPin) return sim_modem_device();
+  if (rxPin == kGnssRxPin) return sim_gnss_device();
+  if (uartNr == 0) return &g_console;
+  return nullptr;
+}
+
+bool sim_gpio_held(int pin) {
+  std::lock_guard<std::mutex> lock(g_hold_mutex);
+  return pin >= 0 && pin < 64 && g_gpio_held[pin];
+}
+
+void sim_board_on_pin(int pin, int level) {
+  // Releasing the EN latch removes power from the whole board.
+  if (pin == kPinEn && level == LOW && !g_cycle_ending) {
+    sim_log("power latch released, board off");
+    sim_end_cycle(false, 0);
+  }
+}
+
+void sim_log(const char* fmt, ...) {
+  if (g_sim.quiet) return;
+  char buf[512];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  fprintf(stdout, "[%4u %9.3f] ~sim~ %s\n", g_shared ? g_shared->world.cycle : 0, sim_now_us() / 1e6, buf);
+  fflush(stdout);
+}
+
+[[noreturn]] void sim_end_cycle(bool deepSleep, uint64_t sleepUs) {
+  static std::mutex endMutex;
+  endMutex.lock();  // never released: the process exits below
+  g_cycle_ending = true;
+  g_console.flushLine();
+  uint64_t now = sim_now_us();
+  SimCycleStats& s = g_shared->stats;
+
+  if (deepSleep) {
+    // Vehicle motion during the sleep, for the IMU wake-on-motion
+    double nextSpeed = scripted_speed(g_shared->world.cycle + 1);
+    uint64_t change = static_cast<uint64_t>(g_sim.motionChangeS * 1e6);
+    uint64_t from = g_sim.speedKmh > 0 ? 0 : nextSpeed > 0 ? change : UINT64_MAX;
+    uint64_t until = nextSpeed > 0 ? UINT64_MAX : g_sim.speedKmh > 0 ? change : 0;
+    uint64_t wakeAt = sim_imu_deep_sleep(sleepUs, from, until, g_ext1_mask, g_ext1_mode);
+    if (wakeAt < sleepUs) {
+      sim_log("IMU interrupt ends the sleep after %.1f s", wakeAt / 1e6);
+      sleepUs = wakeAt;
+      g_shared->world.nextWakeCause = ESP_SLEEP_WAKEUP_EXT1;
+    }
+  }
+
+  double modemSleepMa = sim_modem_prepare_sleep(deepSleep ? sleepUs / 1e6 : 0.0);
+  double gnssSleepMa = sim_gnss_prepare_sleep();
+
+  s.awakeS = now / 1e6;
+  s.mcuMas = integrate_rail(RAIL_MCU, now, nullptr);
+  s.gnssMas = integrate_rail(RAIL_GNSS, now, &s.gnssOnS);
+  s.modemMas = integrate_rail(RAIL_MODEM, now, &s.modemOnS) + integrate_rail(RAIL_MODEM_GNSS, now, nullptr);
+  s.uartRxLost = static_cast<SimTimedUart*>(sim_modem_device())->rxBytesLost() +
+                 static_cast<SimTimedUart*>(sim_gnss_device())->rxBytesLost();
+  s.deepSleep = deepSleep;
+  s.shutdown = !deepSleep && !s.hung;
+  s.sleepS = deepSleep ? sleepUs / 1e6 : 0.0;
+  s.sleepMas = s.sleepS * (g_sim.mcuDeepSleepMa + modemSleepMa + gnssSleepMa);
+  if (deepSleep) {
+    if (modemSleepMa > 0 && !g_shared->world.modemPsm) s.modemOnS += s.sleepS;
+    save_rtc();
+  }
+  fflush(stdout);
+  _exit(0);
+}
+
+// --- ESP-IDF stand-ins ----------------------------------------------------------
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void) {
+  return static_cast<esp_sleep_wakeup_cause_t>(sim_world().wakeCause);
+}
+
+uint64_t esp_sleep_get_ext1_wakeup_status(void) {
+  return sim_world().wakeCause == ESP_SLEEP_WAKEUP_EXT1 ? sim_world().ext1WakeStatus : 0;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+  g_timer_wakeup_us = time_in_us;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t gpio_num, int level) {
+  (void)gpio_num;
+  (void)level;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_ext1_wakeup(uint64_t mask, esp_sleep_ext1_wakeup_mode_t mode) {
+  g_ext1_mask = mask;
+  g_ext1_mode = mode;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_uart_wakeup(int uart_num) {
+  (void)uart_num;
+  g_uart_wakeup = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t source) {
+  if (source == ESP_SLEEP_WAKEUP_TIMER || source == ESP_SLEEP_WAKEUP_ALL) g_timer_wakeup_us = 0;
+  if (source == ESP_SLEEP_WAKEUP_UART || source == ESP_SLEEP_WAKEUP_ALL) g_uart_wakeup = false;
+  if (source == ESP_SLEEP_WAKEUP_EXT1 || source == ESP_SLEEP_WAKEUP_ALL) g_ext1_mask = 0;
+  return ESP_OK;
+}
+
+esp_err_t esp_light_sleep_start(void) {
+  // Light sleep: the CPU halts until the timer fires or, with UART wakeup
+  // armed, until the GNSS receiver starts talking again.
+  sim_energy_set(RAIL_MCU, g_sim.mcuLightSleepMa, "light-sleep");
+  uint64_t start = sim_now_us();
+  uint64_t deadline = g_timer_wakeup_us ? start + g_timer_wakeup_us : UINT64_MAX;
+  while (sim_now_us() < deadline) {
+    if (g_uart_wakeup && sim_gnss_device()->available() > 0) break;
+    sim_sleep_us(1000);
+  }
+  sim_energy_set(RAIL_MCU, getCpuFrequencyMhz() >= 160 ? g_sim.mcuActiveMa : g_sim.mcuLowClockMa, "active");
+  return ESP_OK;
+}
+
+void esp_deep_sleep_start(void) { sim_end_cycle(true, g_timer_wakeup_us ? g_timer_wakeup_us : 0); }
+
+esp_err_t gpio_hold_en(gpio_num_t gpio_num) {
+  std::lock_guard<std::mutex> lock(g_hold_mutex);
+  if (gpio_num >= 0 && gpio_num < 64) g_gpio_held[gpio_num] = true;
+  return ESP_OK;
+}
+
+esp_err_t gpio_hold_dis(gpio_num_t gpio_num) {
+  std::lock_guard<std::mutex> lock(g_hold_mutex);
+  if (gpio_num >= 0 && gpio_num < 64) g_gpio_held[gpio_num] = false;
+  return ESP_OK;
+}
+
+void gpio_deep_sleep_hold_en(void) {}
+void gpio_deep_sleep_hold_dis(void) {}
+
+// --- Entry point ----------------------------------------------------------------
+
+int main(int argc, char** argv) {
+  bool fresh = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto next = [&](const char* what) -> const char* {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "sim: %s needs a value\n", what);
+        exit(2);
+      }
+      return argv[++i];
+    };
+    if (arg == "--cycles") {
+      g_sim.cycles = atoi(next("--cycles"));
+    } else if (arg == "--scale") {
+      g_sim.timeScale = atof(next("--scale"));
+    } else if (arg == "--state") {
+      g_sim.stateDir = next("--state");
+    } else if (arg == "--nmea") {
+      g_sim.nmeaFile = next("--nmea");
+    } else if (arg == "--scenario") {
+      if (!load_script(next("--scenario"))) return 2;
+    } else if (arg == "--set") {
+      if (!apply_knob(next("--set"))) return 2;
+    } else if (arg == "--fresh") {
+      fresh = true;
+    } else if (arg == "--quiet") {
+      g_sim.quiet = true;
+    } else {
+      usage();
+      return 2;
+    }
+  }
+
+  if (fresh) {
+    std::string cmd = "rm -rf '" + g_sim.stateDir + "'";
+    if (system(cmd.c_str()) != 0) return 1;
+  }
+  mkdir(g_sim.stateDir.c_str(), 0755);
+  sim_clock_init(g_sim.timeScale);
+
+  void* mem = mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    perror("mmap");
+    return 1;
+  }
+  g_shared = static_cast<Shared*>(mem);
+  memset(g_shared, 0, sizeof(Shared));
+  SimWorld& w = g_shared->world;
+  w.epochAtBoot = 1767261600.0;  // 2026-01-01 10:00:00 UTC
+  w.epochAtWake = w.epochAtBoot;
+  w.modemBaud = 115200;
+  w.gnssBaud = 9600;
+  w.legs[0] = {w.epochAtBoot, g_sim.startLat, g_sim.startLon, g_sim.speedKmh, g_sim.headingDeg};
+  w.legCount = 1;
+
+  double totalAwake = 0, totalSleep = 0, totalMas = 0, totalSleepMas = 0;
+  uint32_t totalHttp = 0, totalUp = 0;
+  double lastSleepS = 0;
+  auto wallStart = std::chrono::steady_clock::now();
+
+  for (int c = 0; c < g_sim.cycles; ++c) {
+    w.cycle = static_cast<uint32_t>(c);
+    w.wakeCause = c == 0 ? ESP_SLEEP_WAKEUP_UNDEFINED
+                         : w.nextWakeCause ? w.nextWakeCause : ESP_SLEEP_WAKEUP_TIMER;
+    w.nextWakeCause = 0;
+    apply_script_for_cycle(w.cycle);
+    if (c > 0) update_track(w, w.epochAtWake - lastSleepS, lastSleepS);
+    sim_clock_init(g_sim.timeScale);
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      return 1;
+    }
+    if (pid == 0) run_child(c == 0);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status)) {
+      fprintf(stderr, "sim: cycle %d crashed (status %d)\n", c, status);
+      return 1;
+    }
+
+    const SimCycleStats& s = g_shared->stats;
+    print_cycle(w, s);
+    totalAwake += s.awakeS;
+    totalSleep += s.sleepS;
+    totalMas += s.mcuMas + s.gnssMas + s.modemMas;
+    totalSleepMas += s.sleepMas;
+    totalHttp += s.httpRequests;
+    totalUp += s.uplinkBytes;
+    w.epochAtWake += s.awakeS + s.sleepS;
+    lastSleepS = s.sleepS;
+    if (!s.deepSleep) break;  // powered off or hung: nothing wakes it again
+  }
+
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  double span = totalAwake + totalSleep;
+  double mah = (totalMas + totalSleepMas) / 3600.0;
+  printf("\n== summary ==\n");
+  printf("simulated span      %.1f s (awake %.1f s, %.1f%%)\n", span, totalAwake,
+         span > 0 ? 100.0 * totalAwake / span : 0.0);
+  printf("charge              %.3f mAh (awake %.3f, sleep %.3f), %.2f mWh\n", mah, totalMas / 3600.0,
+         totalSleepMas / 3600.0, mah * g_sim.batteryVolts);
+  printf("average current     %.3f mA\n", span > 0 ? mah * 3600.0 / span : 0.0);
+  printf("records at server   %u (+%u duplicates) in %u requests, %u B uplink\n", w.serverRecordsReceived,
+         w.serverDuplicateRecords, totalHttp, totalUp);
+  if (w.serverRecordsReceived) {
+    printf("charge per record   %.4f mAh\n", mah / w.serverRecordsReceived);
+  }
+  if (w.serverErrorCount) {
+    printf("position error      %.1f m RMS, %.1f m max (%u fixes)\n", sqrt(w.serverErrorSumSq / w.serverErrorCount),
+           w.serverErrorMax, w.serverErrorCount);
+  }
+  if (w.modemPsmResumes) {
+    printf("PSM resumes         %u (%u reopened the socket service)\n", w.modemPsmResumes, w.modemPsmNetopens);
+  }
+  printf("host wall clock     %.2f s (x%.0f virtual time)\n", wall, g_sim.timeScale);
+  if (w.modemPsmNetopens) {
+    fprintf(stderr, "sim: check failed: %u sessions resumed from PSM sent +NETOPEN again\n", w.modemPsmNetopens);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,827 @@
+// Scripted SIMCom A7670 emulator: PWRKEY/RESET/rail behaviour, boot and
+// network registration timing, the TCP/IP, HTTP(S) and SSL socket (+CCH*) AT
+// command sets the firmware uses, the optional GNSS (+CGNSSPWR/+CAGPS/
+// +CGNSSINFO), and radio current draw for the energy model.
+
+#include <Arduino.h>
+#include <cmath>
+#include <map>
+#include <random>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "sim.h"
+
+namespace {
+
+// LilyGO T-Call A7670 V1.0 wiring (see MAIN/FINAL/utilities.h)
+constexpr int kPwrKeyPin = 4;
+constexpr int kRailPin = 12;
+constexpr int kResetPin = 27;
+
+constexpr uint64_t kMs = 1000ULL;
+constexpr uint64_t kS = 1000000ULL;
+
+uint64_t seconds_to_us(double s) { return static_cast<uint64_t>(s * 1e6); }
+
+class SimModem : public SimTimedUart {
+ public:
+  const char* name() const override { return "A7670"; }
+
+  void restoreFromWorld() {
+    SimWorld& w = sim_world();
+    deviceBaud_ = w.modemBaud ? w.modemBaud : 115200;
+    lineMaxBaud_ = g_sim.modemMaxBaud > 0 ? g_sim.modemMaxBaud : 0;
+    if (w.modemPowered) {
+      powered_ = true;
+      echo_ = !w.modemEchoOff;
+      psmRequested_ = w.modemPsmRequested;
+      psmActiveS_ = w.modemPsmActiveS;
+      bootDoneAt_ = 0;
+      registeredAt_ = w.modemRegistered ? 0 : seconds_to_us(g_sim.modemRegS);
+      if (w.modemPsm) {
+        // Still in PSM: the UE keeps its registration and PDP context, but the
+        // UART stays dark until PWRKEY ends PSM.
+        inPsm_ = true;
+        pdpActive_ = true;
+        netOpen_ = w.modemNetOpen;
+        registeredAt_ = 0;
+        sim_energy_set(RAIL_MODEM, g_sim.modemPsmMa, "psm");
+        return;
+      }
+      sim_energy_set(RAIL_MODEM, registeredAt_ <= sim_now_us() ? g_sim.modemIdleMa : g_sim.modemSearchMa,
+                     "resume");
+      if (registeredAt_ > sim_now_us()) sim_energy_schedule(RAIL_MODEM, g_sim.modemIdleMa, "idle", registeredAt_);
+    }
+  }
+
+  void onPin(int pin, int level) {
+    std::lock_guard<std::mutex> lock(pinMutex_);
+    uint64_t now = sim_now_us();
+    if (pin == kRailPin) {
+      if (level == LOW && railOn_) {
+        railOn_ = false;
+        powerDown("rail cut");
+      } else if (level == HIGH) {
+        railOn_ = true;
+      }
+    } else if (pin == kPwrKeyPin) {
+      // The ESP drives PWRKEY through an inverting transistor: HIGH = pressed.
+      if (level == HIGH && !pwrKeyPressed_) {
+        pwrKeyPressed_ = true;
+        pwrKeyAt_ = now;
+      } else if (level == LOW && pwrKeyPressed_) {
+        pwrKeyPressed_ = false;
+        uint64_t held = now - pwrKeyAt_;
+        if (inPsm_ && held < 2500 * kMs) {
+          resumeFromPsm();
+        } else if (!powered_ && held >= 50 * kMs) {
+          powerUp();
+        } else if (powered_ && held >= 2500 * kMs) {
+          powerDown("PWRKEY");
+        }
+      }
+    } else if (pin == kResetPin) {
+      if (level == LOW && !resetAsserted_) {
+        resetAsserted_ = true;
+        resetAt_ = now;
+      } else if (level == HIGH && resetAsserted_) {
+        resetAsserted_ = false;
+        if (powered_ && now - resetAt_ >= 2000 * kMs) {
+          powerDown("reset");
+          powerUp();
+        }
+      }
+    }
+  }
+
+  double prepareSleep(bool railHeld, double sleepS) {
+    SimWorld& w = sim_world();
+    uint64_t now = sim_now_us();
+    advance(now);
+    if (pendingPowerOffAt_) {
+      // +CPOF still in progress when the MCU went to sleep; it completes anyway.
+      pendingPowerOffAt_ = 0;
+      powerDown("+CPOF", false);
+    }
+    if (!railHeld && powered_) powerDown("rail released in deep sleep");
+    // PSM is entered after the granted active time (T3324) of idle paging
+    bool enteringPsm = powered_ && !inPsm_ && psmRequested_ && g_sim.psmGranted && registered(now);
+    w.modemPowered = powered_;
+    w.modemRegistered = powered_ && registeredAt_ <= now;
+    w.modemPsm = inPsm_ || enteringPsm;
+    w.modemEchoOff = !echo_;
+    w.modemPsmRequested = psmRequested_;
+    w.modemPsmActiveS = psmActiveS_;
+    w.modemNetOpen = w.modemPsm && netOpen_;
+    w.modemBaud = deviceBaud_;
+    if (!powered_) return 0.0;
+    if (inPsm_) return g_sim.modemPsmMa;
+    if (!enteringPsm) return g_sim.modemIdleMa;
+    if (sleepS <= 0) return g_sim.modemPsmMa;
+    double active = std::min(psmActiveS_, sleepS);
+    return (active * g_sim.modemIdleMa + (sleepS - active) * g_sim.modemPsmMa) / sleepS;
+  }
+
+ protected:
+  void advance(uint64_t nowUs) override {
+    if (pendingPowerOffAt_ && nowUs >= pendingPowerOffAt_) {
+      pendingPowerOffAt_ = 0;
+      powerDown("+CPOF", false);
+    }
+    // Boot URCs are queued only once due; queued ahead they would hold back every
+    // reply behind them in the FIFO.
+    while (!bootUrcs_.empty() && bootUrcs_.front().first <= nowUs) {
+      emit(bootUrcs_.front().second, bootUrcs_.front().first);
+      bootUrcs_.erase(bootUrcs_.begin());
+    }
+    // Same for data arriving on the SSL sockets
+    for (int mux = 0; mux < kCchSessions; ++mux) {
+      CchSession& s = cch_[mux];
+      while (s.open && !s.arrivals.empty() && s.arrivals.front().at <= nowUs) {
+        CchArrival arrival = s.arrivals.front();
+        s.arrivals.erase(s.arrivals.begin());
+        if (arrival.close) {
+          cchPeerClosed(mux, arrival.at);
+          break;
+        }
+        s.cache += arrival.bytes;
+        s.idleSince = arrival.at;
+        emit("\r\n+CCHEVENT: " + std::to_string(mux) + ",RECV EVENT\r\n", arrival.at);
+      }
+      uint64_t idleEnd = s.idleSince + static_cast<uint64_t>(g_sim.serverKeepAliveS * 1e6);
+      if (s.open && s.arrivals.empty() && s.request.empty() && nowUs >= idleEnd) cchPeerClosed(mux, idleEnd);
+    }
+  }
+
+  void onHostBytes(const uint8_t* data, size_t len, uint64_t atUs) override {
+    if (!powered_ || inPsm_ || atUs < bootDoneAt_) return;  // UART not up yet
+    for (size_t i = 0; i < len; ++i) {
+      char c = static_cast<char>(data[i]);
+      if (dataRemaining_ > 0) {
+        std::string& data = cchSendMux_ >= 0 ? cchData_ : httpData_;
+        // The LF that ends the +HTTPDATA/+CCHSEND command line is not payload.
+        if (c == '\n' && data.empty() && lastWasCr_) {
+          lastWasCr_ = false;
+          continue;
+        }
+        lastWasCr_ = false;
+        data += c;
+        if (--dataRemaining_ == 0) {
+          if (cchSendMux_ >= 0) {
+            cchSent(atUs);
+          } else {
+            reply("\r\nOK\r\n", atUs, 5);
+          }
+        }
+        continue;
+      }
+      if (echo_) echoBuf_ += c;
+      lastWasCr_ = c == '\r';
+      if (c == '\r') {
+        if (echo_) {
+          emit(echoBuf_, atUs);
+          echoBuf_.clear();
+        }
+        std::string cmd = line_;
+        line_.clear();
+        if (!cmd.empty()) handle(cmd, atUs);
+      } else if (c != '\n') {
+        line_ += c;
+      }
+    }
+  }
+
+ private:
+  void powerUp() {
+    uint64_t now = sim_now_us();
+    powered_ = true;
+    echo_ = true;
+    deviceBaud_ = 115200;  // +IPR is not stored; every boot starts at the default rate
+    psmRequested_ = false;
+    cregMode_ = 0;
+    netOpen_ = false;
+    pdpActive_ = false;
+    gnssOn_ = false;
+    connUrlBase_.clear();
+    httpInit_ = false;
+    cchReset();
+    dataRemaining_ = 0;
+    line_.clear();
+    bootDoneAt_ = now + seconds_to_us(g_sim.modemBootS);
+    registeredAt_ = bootDoneAt_ + seconds_to_us(g_sim.modemRegS);
+    purgeRx();
+    bootUrcs_ = {{bootDoneAt_, "\r\n*ATREADY: 1\r\n"},
+                 {bootDoneAt_ + 400 * kMs, "\r\n+CPIN: READY\r\n"},
+                 {bootDoneAt_ + 2 * kS, "\r\nSMS DONE\r\n\r\nPB DONE\r\n"}};
+    sim_energy_set(RAIL_MODEM, g_sim.modemSearchMa, "boot");
+    sim_energy_schedule(RAIL_MODEM, g_sim.modemIdleMa, "idle", registeredAt_);
+    sim_log("modem: power on (ready in %.1fs)", g_sim.modemBootS);
+  }
+
+  void powerDown(const char* why, bool updateRail = true) {
+    if (!powered_) return;
+    powered_ = false;
+    inPsm_ = false;
+    resumedFromPsm_ = false;
+    bootUrcs_.clear();
+    netOpen_ = false;
+    pdpActive_ = false;
+    connUrlBase_.clear();
+    httpInit_ = false;
+    cchReset();
+    purgeRx();
+    if (gnssOn_) {
+      gnssOn_ = false;
+      sim_energy_set(RAIL_MODEM_GNSS, 0.0, "off");
+    }
+    if (updateRail) sim_energy_set(RAIL_MODEM, 0.0, "off");
+    sim_log("modem: power off (%s)", why);
+  }
+
+  void resumeFromPsm() {
+    inPsm_ = false;
+    resumedFromPsm_ = true;
+    sim_world().modemPsmResumes++;
+    bootDoneAt_ = sim_now_us() + 300 * kMs;
+    sim_energy_set(RAIL_MODEM, g_sim.modemIdleMa, "resume");
+    sim_log("modem: PSM ended by PWRKEY");
+  }
+
+  // 3GPP TS 24.008 GPRS timer 3 (T3324): unit in bits 8-6, value in bits 5-1
+  static double t3324_seconds(const std::string& bits) {
+    if (bits.size() != 8) return 0.0;
+    int unit = std::stoi(bits.substr(0, 3), nullptr, 2);
+    int value = std::stoi(bits.substr(3), nullptr, 2);
+    static const double kUnitS[] = {2.0, 60.0, 360.0};
+    return unit < 3 ? value * kUnitS[unit] : 0.0;
+  }
+
+  bool registered(uint64_t at) const { return powered_ && at >= registeredAt_; }
+
+  void reply(const std::string& text, uint64_t atUs, uint64_t delayMs) { emit(text, atUs + delayMs * kMs); }
+  void ok(uint64_t atUs, uint64_t delayMs = 8) { reply("\r\nOK\r\n", atUs, delayMs); }
+  void error(uint64_t atUs) { reply("\r\nERROR\r\n", atUs, 8); }
+
+  static bool starts(const std::string& s, const char* prefix) { return s.compare(0, strlen(prefix), prefix) == 0; }
+
+  static std::string quoted_arg(const std::string& cmd, size_t index) {
+    size_t pos = 0;
+    for (size_t i = 0; i <= index; ++i) {
+      size_t open = cmd.find('"', pos);
+      if (open == std::string::npos) return "";
+      size_t close = cmd.find('"', open + 1);
+      if (close == std::string::npos) return "";
+      if (i == index) return cmd.substr(open + 1, close - open - 1);
+      pos = close + 1;
+    }
+    return "";
+  }
+
+  void handle(const std::string& raw, uint64_t at) {
+    sim_stats().atCommands++;
+    if (getenv("SIM_TRACE_AT")) sim_log("AT< %s", raw.c_str());
+    std::string cmd = raw;
+    if (!starts(cmd, "AT") && !starts(cmd, "at")) return;
+    std::string body = cmd.substr(2);
+
+    if (body.empty()) return ok(at, 3);
+    if (body == "E0") { echo_ = false; return ok(at); }
+    if (body == "E1") { echo_ = true; return ok(at); }
+    if (body == "I") {
+      return reply("\r\nManufacturer: INCORPORATED\r\nModel: A7670E-LASE\r\nRevision: A7670M7_V1.11.1\r\n"
+                   "IMEI: 861234050123456\r\n\r\nOK\r\n", at, 10);
+    }
+    if (body == "+CGMI") return reply("\r\nINCORPORATED\r\n\r\nOK\r\n", at, 5);
+    if (body == "+GMM" || body == "+CGMM") return reply("\r\nA7670E-LASE\r\n\r\nOK\r\n", at, 5);
+    if (body == "+CPIN?") return reply("\r\n+CPIN: READY\r\n\r\nOK\r\n", at, 10);
+    if (body == "+CSQ") return reply("\r\n+CSQ: 19,99\r\n\r\nOK\r\n", at, 10);
+    if (body == "+CEREG?" && cregMode_ == 4) {
+      std::string line = std::string("\r\n+CEREG: 4,") + (registered(at) ? "1" : "2") + ",\"2F1A\",\"0130C5E2\",7";
+      if (registered(at) && psmRequested_ && g_sim.psmGranted) line += ",,,\"" + psmActiveBits_ + "\",\"" + psmTauBits_ + "\"";
+      return reply(line + "\r\n\r\nOK\r\n", at, 10);
+    }
+    if (body == "+CEREG?" || body == "+CGREG?" || body == "+CREG?") {
+      std::string tag = body.substr(0, body.size() - 1);
+      return reply("\r\n" + tag + ": 0," + (registered(at) ? "1" : "2") + "\r\n\r\nOK\r\n", at, 10);
+    }
+    if (starts(body, "+CEREG=")) {
+      cregMode_ = atoi(body.c_str() + 7);
+      return ok(at);
+    }
+    if (starts(body, "+CPSMS=")) {
+      psmRequested_ = body.compare(7, 1, "1") == 0;
+      psmTauBits_ = quoted_arg(body, 0);
+      psmActiveBits_ = quoted_arg(body, 1);
+      psmActiveS_ = t3324_seconds(psmActiveBits_);
+      return ok(at);
+    }
+    if (starts(body, "+IPR=")) {
+      unsigned long baud = strtoul(body.c_str() + 5, nullptr, 10);
+      ok(at);
+      if (baud) deviceBaud_ = baud;  // takes effect after the OK
+      return;
+    }
+    if (body == "+IPR?") return reply("\r\n+IPR: " + std::to_string(deviceBaud_) + "\r\n\r\nOK\r\n", at, 5);
+    if (body == "+CPOF") {
+      ok(at, 20);
+      pendingPowerOffAt_ = at + 2 * kS;
+      sim_energy_schedule(RAIL_MODEM, 0.0, "off", pendingPowerOffAt_);
+      return;
+    }
+    if (body == "+CRESET") {
+      ok(at, 20);
+      powerDown("+CRESET");
+      powerUp();
+      return;
+    }
+
+    // --- GNSS (A7670x-FASE/-FL; the -LASE has none) ---------------------------
+    if (starts(body, "+CGNSSPWR=")) {
+      if (!g_sim.modemHasGnss) return error(at);
+      bool on = body.compare(10, 1, "1") == 0;
+      if (on && !gnssOn_) {
+        gnssOn_ = true;
+        std::uniform_real_distribution<double> jitter(0.85, 1.25);
+        gnssFixAt_ = at + seconds_to_us(g_sim.modemGnssTtffS * jitter(gnssRng_));
+        sim_energy_set(RAIL_MODEM_GNSS, g_sim.modemGnssMa, "gnss");
+        sim_log("modem: GNSS on (fix in %.1fs)", (gnssFixAt_ - at) / 1e6);
+        ok(at);
+        return reply("\r\n+CGNSSPWR: READY!\r\n", at, 1500);
+      }
+      if (!on && gnssOn_) {
+        gnssOn_ = false;
+        sim_energy_set(RAIL_MODEM_GNSS, 0.0, "off");
+        sim_log("modem: GNSS off");
+      }
+      return ok(at);
+    }
+    if (body == "+CGNSSPWR?") {
+      if (!g_sim.modemHasGnss) return error(at);
+      return reply(std::string("\r\n+CGNSSPWR: ") + (gnssOn_ ? "1" : "0") + ",1,0\r\n\r\nOK\r\n", at, 5);
+    }
+    if (body == "+CGPSHOT" || body == "+CGPSWARM" || body == "+CGPSCOLD") {
+      return g_sim.modemHasGnss ? ok(at, 50) : error(at);
+    }
+    if (body == "+CAGPS") {
+      if (!gnssOn_) return error(at);
+      if (!pdpActive_) return reply("\r\nOK\r\n\r\n+AGPS: download fail.\r\n", at, 200);
+      uint64_t done = at + seconds_to_us(g_sim.modemAgpsS);
+      gnssFixAt_ = std::min(gnssFixAt_, done + seconds_to_us(g_sim.modemAgpsTtffS));
+      sim_stats().downlinkBytes += 8 * 1024;  // Ephemeris/almanac file
+      sim_energy_set(RAIL_MODEM, g_sim.modemTxMa, "agps");
+      sim_energy_schedule(RAIL_MODEM, g_sim.modemIdleMa, "idle", done);
+      sim_log("modem: AGPS download (fix at %.1fs)", gnssFixAt_ / 1e6);
+      ok(at);
+      return reply("\r\n+AGPS: success.\r\n", done, 0);
+    }
+    if (body == "+CGNSSINFO") {
+      if (!g_sim.modemHasGnss) return error(at);
+      return reply("\r\n+CGNSSINFO: " + gnssInfo(at) + "\r\n\r\nOK\r\n", at, 20);
+    }
+
+    // --- Packet data -----------------------------------------------------------
+    if (starts(body, "+CGACT=1")) {
+      if (!registered(at)) return error(at);
+      pdpActive_ = true;
+      return ok(at, static_cast<uint64_t>(g_sim.modemAttachS * 500.0));
+    }
+    if (starts(body, "+CGACT=0")) {
+      pdpActive_ = false;
+      connUrlBase_.clear();
+      cchReset();
+      netOpen_ = false;
+      return ok(at, 300);
+    }
+    if (body == "+NETOPEN") {
+      if (resumedFromPsm_) {
+        // The PDN connection and socket service are kept through PSM
+        resumedFromPsm_ = false;
+        sim_world().modemPsmNetopens++;
+        sim_log("modem: CHECK +NETOPEN sent again after PSM");
+      }
+      if (netOpen_) return reply("\r\n+IP ERROR: Network is already opened\r\n\r\nERROR\r\n", at, 10);
+      if (!registered(at)) {
+        return reply("\r\nOK\r\n\r\n+NETOPEN: 1\r\n", at, 10);
+      }
+      // A PDN connection kept through PSM only needs the socket service started
+      uint64_t delayMs = pdpActive_ ? 60 : static_cast<uint64_t>(g_sim.modemAttachS * 500.0);
+      netOpen_ = true;
+      pdpActive_ = true;
+      ok(at, 10);
+      return reply("\r\n+NETOPEN: 0\r\n", at, delayMs);
+    }
+    if (body == "+NETOPEN?") {
+      return reply(std::string("\r\n+NETOPEN: ") + (netOpen_ ? "1" : "0") + "\r\n\r\nOK\r\n", at, 5);
+    }
+    if (body == "+NETCLOSE") {
+      if (!netOpen_) return reply("\r\n+NETCLOSE: 2\r\n\r\nERROR\r\n", at, 10);
+      netOpen_ = false;
+      ok(at, 10);
+      return reply("\r\n+NETCLOSE: 0\r\n", at, 150);
+    }
+    if (body == "+IPADDR") {
+      if (!netOpen_) return error(at);
+      return reply("\r\n+IPADDR: 10.64.12.7\r\n\r\nOK\r\n", at, 5);
+    }
+    if (body == "+CGPADDR=1") return reply("\r\n+CGPADDR: 1,10.64.12.7\r\n\r\nOK\r\n", at, 5);
+
+    // --- HTTP(S) service -------------------------------------------------------
+    if (body == "+HTTPINIT") {
+      if (httpInit_ || !pdpActive_) return error(at);
+      httpInit_ = true;
+      httpParams_.clear();
+      return ok(at, 60);
+    }
+    if (body == "+HTTPTERM") {
+      if (!httpInit_) return error(at);
+      httpInit_ = false;
+      connUrlBase_.clear();
+      return ok(at, 40);
+    }
+    if (starts(body, "+HTTPPARA=")) {
+      if (!httpInit_) return error(at);
+      httpParams_[quoted_arg(body, 0)] = quoted_arg(body, 1);
+      return ok(at, 5);
+    }
+    if (starts(body, "+HTTPDATA=")) {
+      if (!httpInit_) return error(at);
+      dataRemaining_ = strtoul(body.c_str() + 10, nullptr, 10);
+      httpData_.clear();
+      reply("\r\nDOWNLOAD\r\n", at, 10);
+      if (dataRemaining_ == 0) ok(at, 12);
+      return;
+    }
+    if (starts(body, "+HTTPACTION=")) {
+      if (!httpInit_) return error(at);
+      return httpAction(atoi(body.c_str() + 12), at);
+    }
+    if (body == "+HTTPREAD?") {
+      return reply("\r\n+HTTPREAD: LEN," + std::to_string(httpBody_.size()) + "\r\n\r\nOK\r\n", at, 5);
+    }
+    if (starts(body, "+HTTPREAD=")) {
+      size_t offset = 0, len = 0;
+      sscanf(body.c_str() + 10, "%zu,%zu", &offset, &len);
+      if (offset > httpBody_.size()) return error(at);
+      std::string chunk = httpBody_.substr(offset, len);
+      return reply("\r\nOK\r\n\r\n+HTTPREAD: " + std::to_string(chunk.size()) + "\r\n" + chunk +
+                       "\r\n+HTTPREAD: 0\r\n",
+                   at, 15);
+    }
+    if (body == "+HTTPHEAD") {
+      std::string head = "HTTP/1.1 " + std::to_string(httpStatus_) + "\r\nContent-Type: application/json\r\n\r\n";
+      return reply("\r\n+HTTPHEAD: " + std::to_string(head.size()) + "\r\n" + head + "\r\nOK\r\n", at, 10);
+    }
+
+    // --- SSL sockets (TinyGsmA76xxSSL) ------------------------------------------
+    if (body == "+CCHSTART") {
+      if (cchStarted_ || !pdpActive_) return error(at);
+      cchStarted_ = true;
+      ok(at, 20);
+      return reply("\r\n+CCHSTART: 0\r\n", at, 60);
+    }
+    if (body == "+CCHSTOP") {
+      if (!cchStarted_) return error(at);
+      cchReset();
+      ok(at, 20);
+      return reply("\r\n+CCHSTOP: 0\r\n", at, 40);
+    }
+    if (starts(body, "+CCHOPEN=")) {
+      int mux = atoi(body.c_str() + 9);
+      if (!cchStarted_ || mux < 0 || mux >= kCchSessions || cch_[mux].open) return error(at);
+      return cchOpen(mux, body, at);
+    }
+    if (body == "+CCHOPEN?") {
+      std::string out = "\r\n";
+      for (int mux = 0; mux < kCchSessions; ++mux) {
+        const CchSession& s = cch_[mux];
+        out += "+CCHOPEN: " + std::to_string(mux) + "," +
+               (s.open ? "\"" + s.host + "\"," + std::to_string(s.port) + ",2," + std::to_string(50321 + mux) : "\"\",,,") +
+               "\r\n";
+      }
+      return reply(out + "\r\nOK\r\n", at, 5);
+    }
+    if (starts(body, "+CCHSEND=")) {
+      int mux = atoi(body.c_str() + 9);
+      size_t len = strtoul(body.c_str() + body.find(',') + 1, nullptr, 10);
+      if (mux < 0 || mux >= kCchSessions || !cch_[mux].open || len == 0 || len > kCchSendMax) return error(at);
+      cchSendMux_ = mux;
+      cchData_.clear();
+      dataRemaining_ = len;
+      return reply("\r\n>", at, 5);
+    }
+    if (body == "+CCHRECV?") {
+      return reply("\r\n+CCHRECV: LEN," + std::to_string(cch_[0].cache.size()) + "," +
+                       std::to_string(cch_[1].cache.size()) + "\r\n\r\nOK\r\n",
+                   at, 5);
+    }
+    if (starts(body, "+CCHRECV=")) {
+      int mux = atoi(body.c_str() + 9);
+      size_t size = strtoul(body.c_str() + body.find(',') + 1, nullptr, 10);
+      if (mux < 0 || mux >= kCchSessions || cch_[mux].cache.empty()) return error(at);
+      CchSession& s = cch_[mux];
+      std::string chunk = s.cache.substr(0, size);
+      s.cache.erase(0, chunk.size());
+      return reply("\r\nOK\r\n\r\n+CCHRECV: DATA," + std::to_string(mux) + "," + std::to_string(chunk.size()) +
+                       "\r\n" + chunk + "\r\n+CCHRECV: " + std::to_string(mux) + ",0\r\n",
+                   at, 10);
+    }
+    if (starts(body, "+CCHCLOSE=")) {
+      int mux = atoi(body.c_str() + 10);
+      if (mux < 0 || mux >= kCchSessions || !cch_[mux].open) return error(at);
+      cch_[mux] = CchSession();
+      ok(at, 10);
+      return reply("\r\n+CCHCLOSE: " + std::to_string(mux) + ",0\r\n", at, 60);
+    }
+
+    // Configuration commands the firmware issues and does not inspect further
+    static const char* const kAccepted[] = {"+CMEE=", "+CTZR=", "+CTZU=", "+CGAUTH=", "+CGDCONT=", "+CIPMODE=",
+                                            "+CIPSENDMODE=", "+CIPCCFG=", "+CIPTIMEOUT=", "+CSSLCFG=", "+CSCLK=",
+                                            "&W", "+IFC=", "+ICF=", "+CFUN=", "&F", "+CEDRXS=", "+CCHSET=",
+                                            "+CCHSSLCFG="};
+    for (const char* prefix : kAccepted) {
+      if (starts(body, prefix)) return ok(at);
+    }
+    error(at);
+  }
+
+  // A7670M7 firmware format: decimal degrees and a trailing comma (TinyGSM's
+  // getGPS_Ex() relies on it to end the last DOP field)
+  std::string gnssInfo(uint64_t at) {
+    double epoch = sim_epoch_now();
+    double lat, lon;
+    if (!gnssOn_ || at < gnssFixAt_ || !sim_track_position(epoch, lat, lon)) return ",,,,,,,,,,,,,,,,";
+    std::normal_distribution<double> noise(0.0, 3.0);
+    lat += noise(gnssRng_) / 6371000.0 * RAD_TO_DEG;
+    lon += noise(gnssRng_) / (6371000.0 * cos(lat * DEG_TO_RAD)) * RAD_TO_DEG;
+    time_t whole = static_cast<time_t>(epoch);
+    struct tm tmv;
+    gmtime_r(&whole, &tmv);
+    char buf[160];
+    snprintf(buf, sizeof(buf), "3,08,06,00,00,%.6f,%c,%.6f,%c,%02d%02d%02d,%02d%02d%02d.00,%.1f,%.3f,,1.6,0.9,1.3,",
+             fabs(lat), lat >= 0 ? 'N' : 'S', fabs(lon), lon >= 0 ? 'E' : 'W', tmv.tm_mday, tmv.tm_mon + 1,
+             tmv.tm_year % 100, tmv.tm_hour, tmv.tm_min, tmv.tm_sec, 240.0, g_sim.speedKmh / 1.852);
+    return buf;
+  }
+
+  void httpAction(int method, uint64_t at) {
+    static const char* const kMethods[] = {"GET", "POST", "HEAD", "DELETE", "PUT", "PATCH"};
+    const char* methodName = (method >= 0 && method <= 5) ? kMethods[method] : "GET";
+    ok(at, 10);
+
+    std::string url = httpParams_["URL"];
+    bool tls = starts(url, "https://");
+    std::string response;
+    int status;
+    double loss = 1.0 - std::pow(1.0 - g_sim.modemLossPerKb, httpData_.size() / 1024.0);
+    // Processes are forked per cycle, so seed from the cycle and request number
+    std::mt19937 lossRng(0x5eed0000u ^ (sim_world().cycle * 7919u) ^ sim_stats().httpRequests);
+    if (loss > 0 && std::uniform_real_distribution<double>(0.0, 1.0)(lossRng) < loss) {
+      status = 706;  // A76xx: network error, server never saw the request
+    } else {
+      status = sim_server_handle(methodName, url, httpData_, response);
+    }
+
+    size_t requestBytes = 180 + url.size() + httpData_.size();  // request line + headers + body
+    size_t responseBytes = 220 + response.size();
+    // The HTTP service keeps the connection of its +HTTPINIT context open between
+    // actions to the same host until the front end's keep-alive timeout closes it
+    std::string urlBase = url.substr(0, url.find('/', url.find("//") + 2));
+    bool reuse = urlBase == connUrlBase_ && at <= connIdleUntil_;
+    double ms = 0;
+    if (!reuse) {
+      ms += g_sim.modemRttMs * 2.0;  // DNS + TCP handshake
+      if (tls) {
+        ms += g_sim.modemTlsMs;
+        requestBytes += 2200;  // ClientHello, key exchange, Finished
+        responseBytes += 4200; // certificate chain
+      }
+    }
+    ms += requestBytes * 1000.0 / g_sim.modemUplinkBps;
+    ms += g_sim.modemRttMs + g_sim.serverProcessMs;
+    ms += responseBytes * 1000.0 / g_sim.modemDownlinkBps;
+
+    uint64_t done = at + static_cast<uint64_t>(ms * 1000.0);
+    if (status >= 700) {
+      connUrlBase_.clear();
+    } else {
+      connUrlBase_ = urlBase;
+      connIdleUntil_ = done + static_cast<uint64_t>(g_sim.serverKeepAliveS * 1e6);
+    }
+    httpStatus_ = status;
+    httpBody_ = response;
+    reply("\r\n+HTTPACTION: " + std::to_string(method) + "," + std::to_string(status) + "," +
+              std::to_string(response.size()) + "\r\n",
+          done, 0);
+
+    SimCycleStats& st = sim_stats();
+    st.httpRequests++;
+    st.uplinkBytes += static_cast<uint32_t>(requestBytes);
+    st.downlinkBytes += static_cast<uint32_t>(responseBytes);
+    sim_energy_set(RAIL_MODEM, g_sim.modemTxMa, "http");
+    sim_energy_schedule(RAIL_MODEM, g_sim.modemIdleMa, "idle", done);
+    sim_log("modem: %s %s -> %d (%zu B up, %.0f ms%s)", methodName, url.c_str(), status, httpData_.size(), ms,
+            reuse ? ", reused" : "");
+  }
+
+  // --- SSL sockets -------------------------------------------------------------
+  // The requests written into a session share the uplink one after the other, the
+  // server answers them in order, and each response lands in the session's receive
+  // cache (announced by +CCHEVENT) once it has come down the downlink.
+  void cchOpen(int mux, const std::string& cmd, uint64_t at) {
+    CchSession& s = cch_[mux];
+    s = CchSession();
+    s.host = quoted_arg(cmd, 0);
+    size_t portAt = cmd.find("\",", cmd.find('"') + 1);
+    s.port = portAt == std::string::npos ? 0 : atoi(cmd.c_str() + portAt + 2);
+    bool tls = cmd.back() == '2' || s.port == 443;
+    double ms = g_sim.modemRttMs * 2.0;  // DNS + TCP handshake
+    if (tls) ms += g_sim.modemTlsMs;
+    uint64_t done = at + static_cast<uint64_t>(ms * 1000.0);
+    s.open = true;
+    s.idleSince = done;
+    ok(at, 10);
+    reply("\r\n+CCHOPEN: " + std::to_string(mux) + ",0\r\n", done, 0);
+
+    SimCycleStats& st = sim_stats();
+    st.uplinkBytes += tls ? 2200 : 0;    // ClientHello, key exchange, Finished
+    st.downlinkBytes += tls ? 4200 : 0;  // certificate chain
+    cchRadioBusy(done, "connect");
+    sim_log("modem: socket %d open to %s:%d (%.0f ms)", mux, s.host.c_str(), s.port, ms);
+  }
+
+  // One +CCHSEND payload has been written
+  void cchSent(uint64_t at) {
+    int mux = cchSendMux_;
+    cchSendMux_ = -1;
+    CchSession& s = cch_[mux];
+    reply("\r\nOK\r\n\r\n+CCHSEND: " + std::to_string(mux) + ",0\r\n", at, 10);
+    upFreeAt_ = std::max(at, upFreeAt_) + static_cast<uint64_t>(cchData_.size() * 1e6 / g_sim.modemUplinkBps);
+    sim_stats().uplinkBytes += static_cast<uint32_t>(cchData_.size());
+    s.request += cchData_;
+    s.idleSince = at;
+    cchData_.clear();
+    std::string method, path, body;
+    while (cchTakeRequest(s.request, method, path, body)) cchServe(mux, method, path, body, at);
+    cchRadioBusy(upFreeAt_, "send");
+  }
+
+  // Splits one complete HTTP/1.1 request off the front of `stream`
+  static bool cchTakeRequest(std::string& stream, std::string& method, std::string& path, std::string& body) {
+    size_t headEnd = stream.find("\r\n\r\n");
+    if (headEnd == std::string::npos) return false;
+    size_t length = 0;
+    for (size_t line = stream.find("\r\n"); line < headEnd; line = stream.find("\r\n", line + 2)) {
+      std::string header = stream.substr(line + 2, stream.find("\r\n", line + 2) - line - 2);
+      if (strncasecmp(header.c_str(), "Content-Length:", 15) == 0) length = strtoul(header.c_str() + 15, nullptr, 10);
+    }
+    if (stream.size() < headEnd + 4 + length) return false;
+    size_t sp1 = stream.find(' ');
+    size_t sp2 = stream.find(' ', sp1 + 1);
+    method = stream.substr(0, sp1);
+    path = stream.substr(sp1 + 1, sp2 - sp1 - 1);
+    body = stream.substr(headEnd + 4, length);
+    stream.erase(0, headEnd + 4 + length);
+    return true;
+  }
+
+  void cchServe(int mux, const std::string& method, const std::string& path, const std::string& body, uint64_t at) {
+    CchSession& s = cch_[mux];
+    SimCycleStats& st = sim_stats();
+    double loss = 1.0 - std::pow(1.0 - g_sim.modemLossPerKb, body.size() / 1024.0);
+    std::mt19937 lossRng(0x5eed0000u ^ (sim_world().cycle * 7919u) ^ st.httpRequests);
+    st.httpRequests++;
+    uint64_t halfRtt = static_cast<uint64_t>(g_sim.modemRttMs * 500.0);
+    uint64_t arrival = upFreeAt_ + halfRtt;
+    std::string url = "https://" + s.host + path;
+    if (loss > 0 && std::uniform_real_distribution<double>(0.0, 1.0)(lossRng) < loss) {
+      // The connection breaks; the server never sees this request or the ones behind it
+      s.arrivals.push_back({arrival, std::string(), true});
+      sim_log("modem: %s %s lost (%zu B up)", method.c_str(), url.c_str(), body.size());
+      return;
+    }
+    std::string response;
+    int status = sim_server_handle(method, url, body, response);
+    serverFreeAt_ = std::max(arrival, serverFreeAt_) + static_cast<uint64_t>(g_sim.serverProcessMs * 1000.0);
+    std::string bytes = http_response(status, response);
+    downFreeAt_ = std::max(serverFreeAt_ + halfRtt, downFreeAt_) +
+                  static_cast<uint64_t>(bytes.size() * 1e6 / g_sim.modemDownlinkBps);
+    s.arrivals.push_back({downFreeAt_, bytes, false});
+    st.downlinkBytes += static_cast<uint32_t>(bytes.size());
+    cchRadioBusy(downFreeAt_, "http");
+    sim_log("modem: %s %s -> %d (%zu B up, answered %.0f ms after the last byte)", method.c_str(), url.c_str(),
+            status, body.size(), (downFreeAt_ - at) / 1000.0);
+  }
+
+  // Express-style response head (~220 B, as assumed for the HTTP(S) service)
+  static std::string http_response(int status, const std::string& body) {
+    const char* reason = status == 200 ? "OK" : status == 400 ? "Bad Request" : status == 404 ? "Not Found"
+                       : status == 409 ? "Conflict" : status == 413 ? "Payload Too Large" : "Internal Server Error";
+    bool html = !body.empty() && body[0] == '<';
+    return "HTTP/1.1 " + std::to_string(status) + " " + reason + "\r\nX-Powered-By: Express\r\nContent-Type: " +
+           (html ? "text/html" : "application/json") + "; charset=utf-8\r\nContent-Length: " +
+           std::to_string(body.size()) + "\r\nETag: W/\"" + std::to_string(body.size()) +
+           "-q2Yb3gJZ8nGqGfl1kU4nE2hI8Xo\"\r\nDate: Sat, 17 Oct 2026 08:00:00 GMT\r\nConnection: keep-alive\r\n"
+           "Keep-Alive: timeout=" + std::to_string(static_cast<int>(g_sim.serverKeepAliveS)) + "\r\n\r\n" + body;
+  }
+
+  void cchPeerClosed(int mux, uint64_t at) {
+    cch_[mux] = CchSession();
+    emit("\r\n+CCH_PEER_CLOSED: " + std::to_string(mux) + "\r\n", at);
+    sim_log("modem: socket %d closed by the server", mux);
+  }
+
+  void cchReset() {
+    cchStarted_ = false;
+    for (CchSession& s : cch_) s = CchSession();
+    cchSendMux_ = -1;
+  }
+
+  void cchRadioBusy(uint64_t until, const char* state) {
+    cchRadioUntil_ = std::max(cchRadioUntil_, until);
+    sim_energy_set(RAIL_MODEM, g_sim.modemTxMa, state);
+    sim_energy_schedule(RAIL_MODEM, g_sim.modemIdleMa, "idle", cchRadioUntil_);
+  }
+
+  std::mutex pinMutex_;
+  bool railOn_ = true;
+  bool pwrKeyPressed_ = false;
+  uint64_t pwrKeyAt_ = 0;
+  bool resetAsserted_ = false;
+  uint64_t resetAt_ = 0;
+
+  bool powered_ = false;
+  bool echo_ = true;
+  uint64_t bootDoneAt_ = 0;
+  uint64_t registeredAt_ = 0;
+  uint64_t pendingPowerOffAt_ = 0;
+  std::vector<std::pair<uint64_t, std::string>> bootUrcs_;
+  bool inPsm_ = false;
+  bool psmRequested_ = false;  // +CPSMS=1 since power-on
+  std::string psmTauBits_ = "00100001";
+  std::string psmActiveBits_ = "00000001";
+  double psmActiveS_ = 2.0;
+  int cregMode_ = 0;
+  bool pdpActive_ = false;
+  bool netOpen_ = false;
+  bool resumedFromPsm_ = false;
+  bool gnssOn_ = false;
+  uint64_t gnssFixAt_ = 0;
+  std::mt19937 gnssRng_{0x67a5u ^ sim_world().cycle};
+
+  std::string line_;
+  std::string echoBuf_;
+  bool httpInit_ = false;
+  std::string connUrlBase_;  // Scheme and host of the open connection, empty if none
+  uint64_t connIdleUntil_ = 0;
+  std::map<std::string, std::string> httpParams_;
+  size_t dataRemaining_ = 0;
+  std::string httpData_;
+  bool lastWasCr_ = false;
+  int httpStatus_ = 0;
+  std::string httpBody_;
+
+  static constexpr int kCchSessions = 2;
+  static constexpr size_t kCchSendMax = 2048;  // Per +CCHSEND
+  struct CchArrival {
+    uint64_t at;
+    std::string bytes;
+    bool close;  // Lost request: the connection is dropped instead
+  };
+  struct CchSession {
+    bool open = false;
+    std::string host;
+    int port = 0;
+    std::string request;  // Written bytes not yet forming a complete request
+    std::string cache;    // Received, not yet taken by +CCHRECV
+    std::vector<CchArrival> arrivals;
+    uint64_t idleSince = 0;
+  };
+  bool cchStarted_ = false;
+  CchSession cch_[kCchSessions];
+  int cchSendMux_ = -1;  // Session the +CCHSEND payload in progress belongs to
+  std::string cchData_;
+  uint64_t upFreeAt_ = 0;
+  uint64_t serverFreeAt_ = 0;
+  uint64_t downFreeAt_ = 0;
+  uint64_t cchRadioUntil_ = 0;
+};
+
+SimModem* g_modem_dev = nullptr;
+
+SimModem& modem() {
+  if (!g_modem_dev) {
+    g_modem_dev = new SimModem();
+    g_modem_dev->restoreFromWorld();
+  }
+  return *g_modem_dev;
+}
+
+}  // namespace
+
+SimUartDevice* sim_modem_device() { return &modem(); }
+
+void sim_modem_on_pin(int pin, int level) { modem().onPin(pin, level); }
+
+double sim_modem_prepare_sleep(double sleepS) { return modem().prepareSleep(sim_gpio_held(kRailPin), sleepS); }
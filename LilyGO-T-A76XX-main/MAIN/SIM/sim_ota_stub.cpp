@@ -0,0 +1,14 @@
+// The OTA/Wi-Fi service mode needs a browser on the other end and is out of
+// scope for the simulation; entering it ends the run like a power cut.
+
+#include "../FINAL/ota_mode.h"
+#include "sim.h"
+
+WebServer otaServer(80);
+String ota_ssid = DEFAULT_OTA_SSID;
+String ota_password = DEFAULT_OTA_PASSWORD;
+
+void start_ota_mode() {
+  sim_log("OTA mode requested, not simulated");
+  sim_end_cycle(false, 0);
+}
@@ -0,0 +1,176 @@
+// Emulated Server_NODEJS device API: just enough of routes/devices.api.js to
+// account delivered records, catch duplicates and hand out device config.
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "sim.h"
+
+namespace {
+
+uint32_t fnv1a(const std::string& s) {
+  uint32_t h = 2166136261u;
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 16777619u;
+  }
+  return h ? h : 1;
+}
+
+// Returns true when the record was seen before.
+bool remember_record(JsonObjectConst record) {
+  std::string key;
+  key += record["device"] | "";
+  key += '|';
+  key += record["timestamp"] | "";
+  key += '|';
+  char coords[64];
+  snprintf(coords, sizeof(coords), "%.6f,%.6f", record["latitude"] | 0.0, record["longitude"] | 0.0);
+  key += coords;
+  uint32_t h = fnv1a(key);
+  SimWorld& w = sim_world();
+  const uint32_t n = sizeof(w.serverSeen) / sizeof(w.serverSeen[0]);
+  for (uint32_t i = 0; i < n; ++i) {
+    uint32_t& slot = w.serverSeen[(h + i) % n];
+    if (slot == h) return true;
+    if (slot == 0) {
+      slot = h;
+      return false;
+    }
+  }
+  return false;
+}
+
+// Scores a delivered fix against the simulated track at its timestamp.
+void score_position(JsonObjectConst record) {
+  const char* iso = record["timestamp"] | static_cast<const char*>(nullptr);
+  struct tm tmv = {};
+  if (!iso || !strptime(iso, "%Y-%m-%dT%H:%M:%SZ", &tmv)) return;
+  double lat, lon;
+  if (!sim_track_position(static_cast<double>(timegm(&tmv)), lat, lon)) return;
+  const double kEarthRadiusM = 6371000.0;
+  double dy = ((record["latitude"] | 0.0) - lat) * DEG_TO_RAD * kEarthRadiusM;
+  double dx = ((record["longitude"] | 0.0) - lon) * DEG_TO_RAD * kEarthRadiusM * cos(lat * DEG_TO_RAD);
+  double err = sqrt(dx * dx + dy * dy);
+  SimWorld& w = sim_world();
+  w.serverErrorSumSq += err * err;
+  w.serverErrorMax = std::max(w.serverErrorMax, err);
+  w.serverErrorCount++;
+}
+
+std::string config_json() {
+  char buf[320];
+  int n = snprintf(buf, sizeof(buf), "{\"interval_gps\":%d,\"interval_send\":%d,\"satellites\":%d,\"mode\":\"batch\"",
+                   g_sim.serverIntervalGps, g_sim.serverIntervalSend, g_sim.serverSatellites);
+  if (g_sim.serverMaxBatch > 0) {
+    n += snprintf(buf + n, sizeof(buf) - n, ",\"max_batch\":%d", g_sim.serverMaxBatch);
+  }
+  if (g_sim.serverAccuracyM >= 0) {
+    n += snprintf(buf + n, sizeof(buf) - n, ",\"accuracy_m\":%d", g_sim.serverAccuracyM);
+  }
+  if (g_sim.serverResolutionM >= 0) {
+    n += snprintf(buf + n, sizeof(buf) - n, ",\"resolution_m\":%d", g_sim.serverResolutionM);
+  }
+  if (g_sim.serverTrackToleranceM >= 0) {
+    n += snprintf(buf + n, sizeof(buf) - n, ",\"track_tolerance_m\":%d", g_sim.serverTrackToleranceM);
+  }
+  if (g_sim.serverIntervalMin >= 0) {
+    n += snprintf(buf + n, sizeof(buf) - n, ",\"interval_min\":%d", g_sim.serverIntervalMin);
+  }
+  if (g_sim.serverIntervalMax >= 0) {
+    n += snprintf(buf + n, sizeof(buf) - n, ",\"interval_max\":%d", g_sim.serverIntervalMax);
+  }
+  snprintf(buf + n, sizeof(buf) - n, "}");
+  return buf;
+}
+
+std::string handshake_json() {
+  return std::string("{\"registered\":true,\"config\":") + config_json() + ",\"power_instruction\":\"NONE\"}";
+}
+
+int accept_records(JsonVariantConst body, std::string& response) {
+  JsonArrayConst records = body.as<JsonArrayConst>();
+  size_t count = records.isNull() ? 1 : records.size();
+  if (count == 0) {
+    response = "{\"error\":\"Request body cannot be empty.\"}";
+    return 400;
+  }
+  if (g_sim.serverMaxBatch > 0 && static_cast<int>(count) > g_sim.serverMaxBatch) {
+    response = "{\"error\":\"Too many records in one request.\"}";
+    return 413;
+  }
+  SimWorld& w = sim_world();
+  auto take = [&w](JsonObjectConst record) {
+    if (remember_record(record)) {
+      w.serverDuplicateRecords++;
+    } else {
+      w.serverRecordsReceived++;
+      sim_stats().recordsDelivered++;
+      score_position(record);
+    }
+  };
+  if (records.isNull()) {
+    take(body.as<JsonObjectConst>());
+  } else {
+    for (JsonObjectConst record : records) take(record);
+  }
+  response = "{\"success\":true}";
+  return 200;
+}
+
+}  // namespace
+
+int sim_server_handle(const std::string& method, const std::string& url, const std::string& body,
+                      std::string& response) {
+  sim_world().serverRequests++;
+  std::string path = url;
+  size_t scheme = path.find("://");
+  if (scheme != std::string::npos) {
+    size_t slash = path.find('/', scheme + 3);
+    path = slash == std::string::npos ? "/" : path.substr(slash);
+  }
+
+  if (body.size() > g_sim.serverMaxBodyBytes) {
+    response = "<!DOCTYPE html><html><body><pre>PayloadTooLargeError: request entity too large</pre></body></html>";
+    return 413;
+  }
+
+  JsonDocument doc;
+  DeserializationError err = deserializeJson(doc, body.c_str(), body.size());
+  if (method == "POST" && path == "/api/devices/handshake") {
+    if (err) {
+      response = "{\"success\":false,\"error\":\"Missing device_id.\"}";
+      return 400;
+    }
+    response = handshake_json();
+    return 200;
+  }
+  if (method == "POST" && path == "/api/devices/input") {
+    if (err) {
+      response = "{\"error\":\"Invalid JSON payload.\"}";
+      return 400;
+    }
+    return accept_records(doc.as<JsonVariantConst>(), response);
+  }
+  if (method == "POST" && path == "/api/devices/sync" && g_sim.serverSupportsSync) {
+    if (err || doc["device_id"].isNull()) {
+      response = "{\"success\":false,\"error\":\"Missing device_id.\"}";
+      return 400;
+    }
+    JsonArrayConst records = doc["records"].as<JsonArrayConst>();
+    if (records.size() > 0) {
+      std::string accepted;
+      int status = accept_records(records, accepted);
+      if (status != 200) {
+        response = accepted;
+        return status;
+      }
+    }
+    response = std::string("{\"registered\":true,\"success\":true,\"accepted\":") +
+               std::to_string(records.size()) + ",\"config\":" + config_json() + ",\"power_instruction\":\"NONE\"}";
+    return 200;
+  }
+
+  response = std::string("<!DOCTYPE html><html><body><pre>Cannot ") + method + " " + path +
+             "</pre></body></html>";
+  return 404;
+}
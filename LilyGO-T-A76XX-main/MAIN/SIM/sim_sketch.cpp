@@ -0,0 +1,2 @@
+// Compiles the sketch the way the Arduino builder does: main.ino as C++.
+#include "../FINAL/main.ino"
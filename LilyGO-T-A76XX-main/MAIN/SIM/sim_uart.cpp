@@ -0,0 +1,204 @@
+// Line-rate accurate UART peer base shared by the modem and GNSS emulators.
+
+#include <Arduino.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "sim.h"
+
+size_t SimUartDevice::readBulk(uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (n < size) {
+    int c = read();
+    if (c < 0) break;
+    buffer[n++] = static_cast<uint8_t>(c);
+  }
+  return n;
+}
+
+namespace {
+// The ESP32 UART hardware FIFO sits in front of the driver's ring buffer.
+constexpr size_t kHwFifoBytes = 128;
+}  // namespace
+
+struct SimTimedUart::Impl {
+  struct Byte {
+    uint64_t at;
+    uint8_t value;
+  };
+  std::recursive_mutex m;
+  std::condition_variable_any cv;
+  std::deque<Byte> inFlight;  // emitted by the device, still on the wire
+  std::deque<uint8_t> ring;   // arrived, waiting for the MCU
+  HardwareSerial* listener = nullptr;
+  bool listenerThread = false;
+  bool attached = false;
+};
+
+SimTimedUart::SimTimedUart() : impl_(new Impl()) {}
+SimTimedUart::~SimTimedUart() {}
+
+uint64_t SimTimedUart::usPerByte() const {
+  unsigned long baud = baud_ ? baud_ : deviceBaud_;
+  return baud ? (10000000ULL / baud) : 1000ULL;
+}
+
+void SimTimedUart::attach(unsigned long baud) {
+  std::lock_guard<std::recursive_mutex> lock(impl_->m);
+  SimUartDevice::attach(baud);
+  impl_->attached = true;
+}
+
+void SimTimedUart::detach() {
+  std::lock_guard<std::recursive_mutex> lock(impl_->m);
+  impl_->attached = false;
+  impl_->listener = nullptr;
+  impl_->ring.clear();
+}
+
+void SimTimedUart::setRxCapacity(size_t bytes) {
+  std::lock_guard<std::recursive_mutex> lock(impl_->m);
+  rxCapacity_ = bytes + kHwFifoBytes;
+}
+
+void SimTimedUart::emit(const std::string& bytes, uint64_t startUs) {
+  std::lock_guard<std::recursive_mutex> lock(impl_->m);
+  uint64_t t = std::max(startUs, lastEmitAt_);
+  uint64_t step = usPerByte();
+  bool garbled = (baud_ != 0 && deviceBaud_ != 0 && baud_ != deviceBaud_) || (lineMaxBaud_ && deviceBaud_ > lineMaxBaud_);
+  for (unsigned char c : bytes) {
+    t += step;
+    // A baud mismatch turns every character into framing noise.
+    uint8_t value = garbled ? static_cast<uint8_t>(0x80 | ((c * 7u + 0x35u) & 0x7f)) : c;
+    impl_->inFlight.push_back({t, value});
+  }
+  lastEmitAt_ = t;
+  impl_->cv.notify_all();
+}
+
+void SimTimedUart::emitNow(const std::string& bytes) { emit(bytes, sim_now_us()); }
+
+void SimTimedUart::purgeRx() {
+  std::lock_guard<std::recursive_mutex> lock(impl_->m);
+  impl_->inFlight.clear();
+  impl_->ring.clear();
+  lastEmitAt_ = 0;
+}
+
+void SimTimedUart::pumpLocked(uint64_t nowUs) {
+  advance(nowUs);
+  while (!impl_->inFlight.empty() && impl_->inFlight.front().at <= nowUs) {
+    uint8_t value = impl_->inFlight.front().value;
+    impl_->inFlight.pop_front();
+    if (!impl_->attached) continue;  // nobody is listening on the pins
+    // With an onReceive() listener the driver's event task drains the FIFO within
+    // microseconds; here the listener thread is scheduled in real time and can wake
+    // late at high --scale, so its bytes are not counted as lost.
+    if (impl_->ring.size() >= rxCapacity_ && !impl_->listener) {
+      rxLost_++;
+      continue;
+    }
+    impl_->ring.push_back(value);
+  }
+}
+
+int SimTimedUart::available() {
+  std::lock_guard<std::recursive_mutex> lock(impl_->m);
+  pumpLocked(sim_now_us());
+  return static_cast<int>(impl_->ring.size());
+}
+
+int SimTimedUart::peek() {
+  std::lock_guard<std::recursive_mutex> lock(impl_->m);
+  pumpLocked(sim_now_us());
+  return impl_->ring.empty() ? -1 : impl_->ring.front();
+}
+
+int SimTimedUart::read() {
+  std::lock_guard<std::recursive_mutex> lock(impl_->m);
+  pumpLocked(sim_now_us());
+  if (impl_->ring.empty()) return -1;
+  uint8_t value = impl_->ring.front();
+  impl_->ring.pop_front();
+  rxDelivered_++;
+  return value;
+}
+
+size_t SimTimedUart::readBulk(uint8_t* buffer, size_t size) {
+  std::lock_guard<std::recursive_mutex> lock(impl_->m);
+  pumpLocked(sim_now_us());
+  size_t n = std::min(size, impl_->ring.size());
+  for (size_t i = 0; i < n; ++i) {
+    buffer[i] = impl_->ring.front();
+    impl_->ring.pop_front();
+  }
+  rxDelivered_ += static_cast<uint32_t>(n);
+  return n;
+}
+
+size_t SimTimedUart::write(const uint8_t* data, size_t len) {
+  uint64_t now = sim_now_us();
+  uint64_t step = usPerByte();
+  uint64_t start;
+  {
+    std::lock_guard<std::recursive_mutex> lock(impl_->m);
+    start = std::max(now, txBusyUntil_);
+    txBusyUntil_ = start + step * len;
+    if (!impl_->attached) return len;
+    // A mismatched baud rate means the device cannot decode anything.
+    if (baud_ == deviceBaud_ && !(lineMaxBaud_ && baud_ > lineMaxBaud_)) onHostBytes(data, len, txBusyUntil_);
+  }
+  // The driver has no TX ring by default: writes beyond the FIFO block.
+  uint64_t queued = txBusyUntil_ > now ? (txBusyUntil_ - now) / step : 0;
+  if (queued > kHwFifoBytes) sim_sleep_us((queued - kHwFifoBytes) * step);
+  return len;
+}
+
+void SimTimedUart::flushTx() {
+  uint64_t now = sim_now_us();
+  if (txBusyUntil_ > now) sim_sleep_us(txBusyUntil_ - now);
+}
+
+void SimTimedUart::setListener(HardwareSerial* listener) {
+  std::lock_guard<std::recursive_mutex> lock(impl_->m);
+  impl_->listener = listener;
+  if (listener && !impl_->listenerThread) {
+    impl_->listenerThread = true;
+    std::thread([this] { listenerLoop(); }).detach();
+  }
+}
+
+// Emulates the UART driver's RX event: the callback fires when the line has
+// been idle for a couple of symbols after a burst or when the FIFO fills.
+void SimTimedUart::listenerLoop() {
+  for (;;) {
+    HardwareSerial* listener = nullptr;
+    {
+      std::unique_lock<std::recursive_mutex> lock(impl_->m);
+      while (!impl_->listener || impl_->inFlight.empty()) {
+        impl_->cv.wait_for(lock, std::chrono::milliseconds(5));
+        advance(sim_now_us());
+      }
+      uint64_t now = sim_now_us();
+      uint64_t step = usPerByte();
+      // Find the end of the burst currently on the wire.
+      uint64_t burstEnd = impl_->inFlight.front().at;
+      size_t counted = 0;
+      for (const Impl::Byte& b : impl_->inFlight) {
+        if (b.at > burstEnd + 3 * step || counted >= 120) break;
+        burstEnd = b.at;
+        counted++;
+      }
+      uint64_t fireAt = burstEnd + 2 * step;
+      if (fireAt > now) {
+        lock.unlock();
+        sim_sleep_us(fireAt - now);
+        continue;
+      }
+      pumpLocked(now);
+      listener = impl_->listener;
+    }
+    if (listener) listener->simNotifyReceive(true);
+  }
+}
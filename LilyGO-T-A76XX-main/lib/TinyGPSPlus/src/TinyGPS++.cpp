@@ -47,6 +47,10 @@ TinyGPSPlus::TinyGPSPlus()
   ,  passedChecksumCount(0)
 {
   term[0] = '\0';
+#if _GPS_FAST_PARSER
+  customEnd = customCursor = 0;
+  buildSentenceTable();
+#endif
 }
 
 //
@@ -84,6 +88,9 @@ bool TinyGPSPlus::encode(char c)
     curSentenceType = GPS_SENTENCE_OTHER;
     isChecksumTerm = false;
     sentenceHasFix = false;
+#if _GPS_FAST_PARSER
+    customCursor = customCandidates;
+#endif
     return false;
 
   default: // ordinary characters
@@ -100,6 +107,27 @@ bool TinyGPSPlus::encode(char c)
 //
 // internal utilities
 //
+#if _GPS_FAST_PARSER
+static inline bool isNmeaDigit(char c)
+{
+  return (uint8_t)(c - '0') <= 9;
+}
+
+// atol() for NMEA fields: optional sign and digits, no locale or whitespace handling
+static long parseInteger(const char *term)
+{
+  bool negative = *term == '-';
+  if (negative || *term == '+') ++term;
+  long ret = 0;
+  for (; isNmeaDigit(*term); ++term)
+    ret = 10 * ret + (*term - '0');
+  return negative ? -ret : ret;
+}
+#define _GPS_ATOL(term) parseInteger(term)
+#else
+#define _GPS_ATOL(term) atol(term)
+#endif
+
 int TinyGPSPlus::fromHex(char a)
 {
   if (a >= 'A' && a <= 'F')
@@ -116,6 +144,19 @@ int32_t TinyGPSPlus::parseDecimal(const char *term)
 {
   bool negative = *term == '-';
   if (negative) ++term;
+#if _GPS_FAST_PARSER
+  // Integer part and hundredths in one pass
+  int32_t ret = 0;
+  for (; isNmeaDigit(*term); ++term)
+    ret = 10 * ret + (*term - '0');
+  ret *= 100;
+  if (*term == '.' && isNmeaDigit(term[1]))
+  {
+    ret += 10 * (term[1] - '0');
+    if (isNmeaDigit(term[2]))
+      ret += term[2] - '0';
+  }
+#else
   int32_t ret = 100 * (int32_t)atol(term);
   while (isdigit(*term)) ++term;
   if (*term == '.' && isdigit(term[1]))
@@ -124,6 +165,7 @@ int32_t TinyGPSPlus::parseDecimal(const char *term)
     if (isdigit(term[2]))
       ret += term[2] - '0';
   }
+#endif
   return negative ? -ret : ret;
 }
 
@@ -131,13 +173,27 @@ int32_t TinyGPSPlus::parseDecimal(const char *term)
 // Parse degrees in that funny NMEA format DDMM.MMMM
 void TinyGPSPlus::parseDegrees(const char *term, RawDegrees &deg)
 {
+#if _GPS_FAST_PARSER
+  uint32_t leftOfDecimal = 0;
+  for (; isNmeaDigit(*term); ++term)
+    leftOfDecimal = 10 * leftOfDecimal + (*term - '0');
+#else
   uint32_t leftOfDecimal = (uint32_t)atol(term);
+#endif
   uint16_t minutes = (uint16_t)(leftOfDecimal % 100);
   uint32_t multiplier = 10000000UL;
   uint32_t tenMillionthsOfMinutes = minutes * multiplier;
 
   deg.deg = (int16_t)(leftOfDecimal / 100);
 
+#if _GPS_FAST_PARSER
+  if (*term == '.')
+    while (isNmeaDigit(*++term))
+    {
+      multiplier /= 10;
+      tenMillionthsOfMinutes += (*term - '0') * multiplier;
+    }
+#else
   while (isdigit(*term))
     ++term;
 
@@ -147,6 +203,7 @@ void TinyGPSPlus::parseDegrees(const char *term, RawDegrees &deg)
       multiplier /= 10;
       tenMillionthsOfMinutes += (*term - '0') * multiplier;
     }
+#endif
 
   deg.billionths = (5 * tenMillionthsOfMinutes + 1) / 3;
   deg.negative = false;
@@ -190,11 +247,24 @@ bool TinyGPSPlus::endOfTermHandler()
         satellites.commit();
         hdop.commit();
         break;
+      case GPS_SENTENCE_GSA:
+        pdop.commit();
+        vdop.commit();
+        satellitesInView.commitGsa();
+        break;
+      case GPS_SENTENCE_GSV:
+        satellitesInView.commitGsv();
+        break;
       }
 
       // Commit all custom listeners of this sentence type
+#if _GPS_FAST_PARSER
+      for (TinyGPSCustom *p = customCandidates; p != customEnd; p = p->next)
+         p->commit();
+#else
       for (TinyGPSCustom *p = customCandidates; p != NULL && strcmp(p->sentenceName, customCandidates->sentenceName) == 0; p = p->next)
          p->commit();
+#endif
       return true;
     }
 
@@ -209,17 +279,33 @@ bool TinyGPSPlus::endOfTermHandler()
   // the first term determines the sentence type
   if (curTermNumber == 0)
   {
+#if _GPS_FAST_PARSER
+    const SentenceSlot *slot = findSentence(term);
+    if (slot != NULL || !sentenceTableFull)
+    {
+      curSentenceType = slot ? slot->type : (uint8_t)GPS_SENTENCE_OTHER;
+      if (curSentenceType == GPS_SENTENCE_OTHER)
+        curSentenceType = satelliteSentenceType(term);
+      customCandidates = customCursor = slot ? slot->first : NULL;
+      customEnd = slot ? slot->end : NULL;
+      return false;
+    }
+#endif
     if (!strcmp(term, _GPRMCterm) || !strcmp(term, _GNRMCterm))
       curSentenceType = GPS_SENTENCE_GPRMC;
     else if (!strcmp(term, _GPGGAterm) || !strcmp(term, _GNGGAterm))
       curSentenceType = GPS_SENTENCE_GPGGA;
     else
-      curSentenceType = GPS_SENTENCE_OTHER;
+      curSentenceType = satelliteSentenceType(term);
 
     // Any custom candidates of this sentence type?
     for (customCandidates = customElts; customCandidates != NULL && strcmp(customCandidates->sentenceName, term) < 0; customCandidates = customCandidates->next);
     if (customCandidates != NULL && strcmp(customCandidates->sentenceName, term) > 0)
        customCandidates = NULL;
+#if _GPS_FAST_PARSER
+    customCursor = customCandidates;
+    for (customEnd = customCandidates; customEnd != NULL && !strcmp(customEnd->sentenceName, term); customEnd = customEnd->next);
+#endif
 
     return false;
   }
@@ -271,16 +357,47 @@ bool TinyGPSPlus::endOfTermHandler()
     case COMBINE(GPS_SENTENCE_GPGGA, 9): // Altitude (GPGGA)
       altitude.set(term);
       break;
+    case COMBINE(GPS_SENTENCE_GSA, 15): // PDOP (GSA)
+      pdop.set(term);
+      break;
+    case COMBINE(GPS_SENTENCE_GSA, 17): // VDOP (GSA)
+      vdop.set(term);
+      break;
+    default:
+      if (curSentenceType == GPS_SENTENCE_GSA) // Used SVs, system ID
+        satellitesInView.setGsaTerm(curTermNumber, term);
+      else if (curSentenceType == GPS_SENTENCE_GSV) // Satellites in view with C/N0
+        satellitesInView.setGsvTerm(curTermNumber, term);
+      break;
   }
 
   // Set custom values as needed
+#if _GPS_FAST_PARSER
+  // The group is sorted by term number, so the cursor only moves forward
+  while (customCursor != customEnd && customCursor->termNumber < curTermNumber)
+    customCursor = customCursor->next;
+  for (; customCursor != customEnd && customCursor->termNumber == curTermNumber; customCursor = customCursor->next)
+    customCursor->set(term);
+#else
   for (TinyGPSCustom *p = customCandidates; p != NULL && strcmp(p->sentenceName, customCandidates->sentenceName) == 0 && p->termNumber <= curTermNumber; p = p->next)
     if (p->termNumber == curTermNumber)
          p->set(term);
+#endif
 
   return false;
 }
 
+// GSA and GSV from any talker ("GPGSV", "BDGSV", "GNGSA", ...); other sentences stay unparsed
+uint8_t TinyGPSPlus::satelliteSentenceType(const char *term)
+{
+  if (strlen(term) != 5 || term[2] != 'G' || term[3] != 'S')
+    return GPS_SENTENCE_OTHER;
+  if (term[4] != 'A' && term[4] != 'V')
+    return GPS_SENTENCE_OTHER;
+  satellitesInView.begin(term);
+  return term[4] == 'A' ? GPS_SENTENCE_GSA : GPS_SENTENCE_GSV;
+}
+
 /* static */
 double TinyGPSPlus::distanceBetween(double lat1, double long1, double lat2, double long2)
 {
@@ -387,7 +504,7 @@ void TinyGPSTime::setTime(const char *term)
 
 void TinyGPSDate::setDate(const char *term)
 {
-   newDate = atol(term);
+   newDate = _GPS_ATOL(term);
 }
 
 uint16_t TinyGPSDate::year()
@@ -454,7 +571,7 @@ void TinyGPSInteger::commit()
 
 void TinyGPSInteger::set(const char *term)
 {
-   newval = atol(term);
+   newval = _GPS_ATOL(term);
 }
 
 TinyGPSCustom::TinyGPSCustom(TinyGPSPlus &gps, const char *_sentenceName, int _termNumber)
@@ -500,4 +617,247 @@ void TinyGPSPlus::insertCustom(TinyGPSCustom *pElt, const char *sentenceName, in
 
    pElt->next = *ppelt;
    *ppelt = pElt;
+#if _GPS_FAST_PARSER
+   buildSentenceTable();
+#endif
+}
+
+#if _GPS_FAST_PARSER
+// static
+uint8_t TinyGPSPlus::sentenceHash(const char *name)
+{
+  uint16_t h = 0;
+  while (*name)
+    h = 5 * h + (uint8_t)*name++;
+  return (h ^ (h >> 6)) & (_GPS_SENTENCE_SLOTS - 1);
+}
+
+const TinyGPSPlus::SentenceSlot *TinyGPSPlus::findSentence(const char *name) const
+{
+  // Linear probing; an empty slot ends the search
+  for (uint8_t i = 0, slot = sentenceHash(name); i < _GPS_SENTENCE_SLOTS; ++i, slot = (slot + 1) & (_GPS_SENTENCE_SLOTS - 1))
+  {
+    const SentenceSlot &s = sentenceTable[slot];
+    if (s.name == NULL)
+      return NULL;
+    if (!strcmp(s.name, name))
+      return &s;
+  }
+  return NULL;
+}
+
+TinyGPSPlus::SentenceSlot *TinyGPSPlus::addSentence(const char *name, uint8_t type)
+{
+  for (uint8_t i = 0, slot = sentenceHash(name); i < _GPS_SENTENCE_SLOTS; ++i, slot = (slot + 1) & (_GPS_SENTENCE_SLOTS - 1))
+  {
+    SentenceSlot &s = sentenceTable[slot];
+    if (s.name == NULL)
+    {
+      s.name = name;
+      s.type = type;
+      return &s;
+    }
+    if (!strcmp(s.name, name))
+      return &s;
+  }
+  return NULL;
+}
+
+// Rebuilt whenever a custom element is inserted, so parsing never walks the list
+void TinyGPSPlus::buildSentenceTable()
+{
+  memset(sentenceTable, 0, sizeof(sentenceTable));
+  sentenceTableFull = false;
+  addSentence(_GPRMCterm, GPS_SENTENCE_GPRMC);
+  addSentence(_GNRMCterm, GPS_SENTENCE_GPRMC);
+  addSentence(_GPGGAterm, GPS_SENTENCE_GPGGA);
+  addSentence(_GNGGAterm, GPS_SENTENCE_GPGGA);
+
+  for (TinyGPSCustom *p = customElts; p != NULL; )
+  {
+    TinyGPSCustom *end = p->next;
+    while (end != NULL && !strcmp(end->sentenceName, p->sentenceName))
+      end = end->next;
+    SentenceSlot *slot = addSentence(p->sentenceName, GPS_SENTENCE_OTHER);
+    if (slot == NULL)
+    {
+      sentenceTableFull = true;
+    }
+    else
+    {
+      slot->first = p;
+      slot->end = end;
+    }
+    p = end;
+  }
+}
+#endif
+
+void TinyGPSSatellites::begin(const char *talker)
+{
+   if (talker[0] == 'G' && talker[1] == 'P')
+      talkerSystem = GPS_SYSTEM_GPS;
+   else if (talker[0] == 'G' && talker[1] == 'L')
+      talkerSystem = GPS_SYSTEM_GLONASS;
+   else if (talker[0] == 'G' && talker[1] == 'A')
+      talkerSystem = GPS_SYSTEM_GALILEO;
+   else if ((talker[0] == 'B' && talker[1] == 'D') || (talker[0] == 'G' && talker[1] == 'B'))
+      talkerSystem = GPS_SYSTEM_BEIDOU;
+   else
+      talkerSystem = GPS_SYSTEM_OTHER; // GN: mixed, decided per satellite
+   newSystem = GPS_SYSTEM_OTHER;
+   newMessage = newInView = newCount = 0;
+   memset(newSats, 0, sizeof(newSats));
+}
+
+void TinyGPSSatellites::setGsaTerm(uint8_t termNumber, const char *term)
+{
+   if (termNumber >= 3 && termNumber <= 14 && newCount < 12)
+   {
+      newSats[newCount++].prn = (uint8_t)_GPS_ATOL(term);
+   }
+   else if (termNumber == 18) // NMEA 4.10 system ID
+   {
+      static const uint8_t SYSTEMS[] = {GPS_SYSTEM_OTHER, GPS_SYSTEM_GPS, GPS_SYSTEM_GLONASS, GPS_SYSTEM_GALILEO, GPS_SYSTEM_BEIDOU};
+      long id = _GPS_ATOL(term);
+      newSystem = id > 0 && id < (long)sizeof(SYSTEMS) ? SYSTEMS[id] : (uint8_t)GPS_SYSTEM_OTHER;
+   }
+}
+
+void TinyGPSSatellites::setGsvTerm(uint8_t termNumber, const char *term)
+{
+   if (termNumber == 2)
+      newMessage = (uint8_t)_GPS_ATOL(term);
+   else if (termNumber == 3)
+      newInView = (uint8_t)_GPS_ATOL(term);
+   if (termNumber < 4)
+      return;
+   // Four terms per satellite; a shorter last message is followed by the signal ID
+   uint8_t group = (termNumber - 4) / 4;
+   int groups = newMessage > 0 ? (int)newInView - 4 * (newMessage - 1) : 4;
+   if (group >= 4 || group >= groups)
+      return;
+   TinyGPSSatellite &sat = newSats[group];
+   switch ((termNumber - 4) % 4)
+   {
+   case 0:
+      sat.prn = (uint8_t)_GPS_ATOL(term);
+      if (group >= newCount)
+         newCount = group + 1;
+      break;
+   case 1:
+      sat.elevation = (uint8_t)_GPS_ATOL(term);
+      break;
+   case 3:
+      sat.cn0 = (uint8_t)_GPS_ATOL(term);
+      break;
+   }
+}
+
+void TinyGPSSatellites::commitGsa()
+{
+   uint8_t fixedSystem = newSystem != GPS_SYSTEM_OTHER ? newSystem : talkerSystem;
+   if (fixedSystem != GPS_SYSTEM_OTHER)
+      usedMask[fixedSystem] = 0;
+   else // GN without system ID: replace the lists of the systems that appear
+      for (uint8_t i = 0; i < newCount; ++i)
+         usedMask[systemFromPrn(newSats[i].prn)] = 0;
+   for (uint8_t i = 0; i < newCount; ++i)
+   {
+      uint8_t system = fixedSystem != GPS_SYSTEM_OTHER ? fixedSystem : systemFromPrn(newSats[i].prn);
+      usedMask[system] |= 1ULL << (newSats[i].prn % 64);
+   }
+   touch();
+}
+
+void TinyGPSSatellites::commitGsv()
+{
+   // The first message of a sequence replaces the satellites of its constellation
+   if (newMessage == 1)
+   {
+      uint8_t kept = 0;
+      for (uint8_t i = 0; i < satCount; ++i)
+         if (talkerSystem != GPS_SYSTEM_OTHER && sats[i].system != talkerSystem)
+            sats[kept++] = sats[i];
+      satCount = kept;
+   }
+   for (uint8_t i = 0; i < newCount; ++i)
+   {
+      TinyGPSSatellite sat = newSats[i];
+      if (sat.prn == 0)
+         continue;
+      sat.system = talkerSystem != GPS_SYSTEM_OTHER ? talkerSystem : systemFromPrn(sat.prn);
+      uint8_t j = 0;
+      while (j < satCount && !(sats[j].system == sat.system && sats[j].prn == sat.prn))
+         ++j;
+      if (j < satCount)
+         sats[j] = sat;
+      else if (satCount < _GPS_MAX_SATELLITES)
+         sats[satCount++] = sat;
+   }
+   touch();
+}
+
+void TinyGPSSatellites::touch()
+{
+   lastCommitTime = millis();
+   valid = updated = true;
+}
+
+// Legacy NMEA PRN ranges, for the GN talker without a system ID
+uint8_t TinyGPSSatellites::systemFromPrn(uint8_t prn)
+{
+   if (prn >= 1 && prn <= 32)
+      return GPS_SYSTEM_GPS;
+   if (prn >= 65 && prn <= 96)
+      return GPS_SYSTEM_GLONASS;
+   if (prn >= 201)
+      return GPS_SYSTEM_BEIDOU;
+   return GPS_SYSTEM_OTHER;
+}
+
+bool TinyGPSSatellites::isUsed(const TinyGPSSatellite &sat) const
+{
+   return sat.system < GPS_SYSTEM_COUNT && ((usedMask[sat.system] >> (sat.prn % 64)) & 1);
+}
+
+uint8_t TinyGPSSatellites::inView(uint8_t system) const
+{
+   uint8_t n = 0;
+   for (uint8_t i = 0; i < satCount; ++i)
+      if (system == GPS_SYSTEM_ALL || sats[i].system == system)
+         ++n;
+   return n;
+}
+
+uint8_t TinyGPSSatellites::used(uint8_t system) const
+{
+   uint8_t n = 0;
+   for (uint8_t s = 0; s < GPS_SYSTEM_COUNT; ++s)
+      if (system == GPS_SYSTEM_ALL || s == system)
+         for (uint64_t m = usedMask[s]; m; m &= m - 1)
+            ++n;
+   return n;
+}
+
+uint8_t TinyGPSSatellites::usedWithCn0(uint8_t minCn0, uint8_t system) const
+{
+   uint8_t n = 0;
+   for (uint8_t i = 0; i < satCount; ++i)
+      if ((system == GPS_SYSTEM_ALL || sats[i].system == system) && sats[i].cn0 >= minCn0 && isUsed(sats[i]))
+         ++n;
+   return n;
+}
+
+uint8_t TinyGPSSatellites::meanUsedCn0() const
+{
+   unsigned sum = 0;
+   uint8_t n = 0;
+   for (uint8_t i = 0; i < satCount; ++i)
+      if (sats[i].cn0 > 0 && isUsed(sats[i]))
+      {
+         sum += sats[i].cn0;
+         ++n;
+      }
+   return n ? (uint8_t)(sum / n) : 0;
 }
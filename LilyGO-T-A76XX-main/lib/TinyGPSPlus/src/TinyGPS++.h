@@ -30,6 +30,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "WProgram.h"
 #endif
 #include <limits.h>
+#include <string.h>
 
 #define _GPS_VERSION "1.0.2" // software version of this library
 #define _GPS_MPH_PER_KNOT 1.15077945
@@ -40,6 +41,17 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define _GPS_FEET_PER_METER 3.2808399
 #define _GPS_MAX_FIELD_SIZE 15
 
+// Fast path: sentence IDs are looked up in a small hash table (collision-free
+// for the built-in GP/GN RMC and GGA), numeric fields are decoded in a single
+// pass without atol(), and custom terms are dispatched from a per-sentence
+// cursor instead of a strcmp() walk of the custom list on every term.
+// Define _GPS_FAST_PARSER to 0 for the original parser.
+#ifndef _GPS_FAST_PARSER
+#define _GPS_FAST_PARSER 1
+#endif
+#define _GPS_SENTENCE_SLOTS 16 // power of two; built-ins plus custom sentence names
+#define _GPS_MAX_SATELLITES 32 // satellites in view kept from GSV, all constellations
+
 struct RawDegrees
 {
    uint16_t deg;
@@ -189,6 +201,77 @@ struct TinyGPSHDOP : TinyGPSDecimal
    double hdop() { return value() / 100.0; }
 };
 
+struct TinyGPSDOP : TinyGPSDecimal
+{
+   double dop() { return value() / 100.0; }
+};
+
+// GNSS constellations as named by the talker ID or the NMEA 4.10 system ID
+enum TinyGPSSystem
+{
+   GPS_SYSTEM_GPS, GPS_SYSTEM_GLONASS, GPS_SYSTEM_GALILEO, GPS_SYSTEM_BEIDOU, GPS_SYSTEM_OTHER,
+   GPS_SYSTEM_COUNT,
+   GPS_SYSTEM_ALL = GPS_SYSTEM_COUNT
+};
+
+// One satellite in view (GSV), 4 bytes; azimuth is not kept
+struct TinyGPSSatellite
+{
+   uint8_t prn;
+   uint8_t system;     // TinyGPSSystem
+   uint8_t elevation;  // degrees
+   uint8_t cn0;        // dB-Hz, 0 = not tracked
+};
+
+// Satellites in view with C/N0 (GSV) and the ones used in the solution (GSA),
+// per constellation. Each GSV sequence replaces the satellites of its
+// constellation and each GSA replaces that constellation's used list.
+struct TinyGPSSatellites
+{
+   friend class TinyGPSPlus;
+public:
+   bool isValid() const    { return valid; }
+   bool isUpdated() const  { return updated; }
+   uint32_t age() const    { return valid ? millis() - lastCommitTime : (uint32_t)ULONG_MAX; }
+
+   uint8_t count()         { updated = false; return satCount; }
+   const TinyGPSSatellite &operator[](uint8_t i) const { return sats[i]; }
+   bool isUsed(const TinyGPSSatellite &sat) const;
+
+   uint8_t inView(uint8_t system = GPS_SYSTEM_ALL) const;
+   uint8_t used(uint8_t system = GPS_SYSTEM_ALL) const;
+   // Satellites used in the solution whose C/N0 is at least `minCn0` dB-Hz
+   uint8_t usedWithCn0(uint8_t minCn0, uint8_t system = GPS_SYSTEM_ALL) const;
+   // Mean C/N0 of the used satellites that are tracked, 0 if none
+   uint8_t meanUsedCn0() const;
+
+   TinyGPSSatellites() : valid(false), updated(false), satCount(0), newSystem(GPS_SYSTEM_OTHER)
+   { memset(usedMask, 0, sizeof(usedMask)); }
+
+private:
+   bool valid, updated;
+   uint32_t lastCommitTime;
+   TinyGPSSatellite sats[_GPS_MAX_SATELLITES];
+   uint8_t satCount;
+   uint64_t usedMask[GPS_SYSTEM_COUNT];  // bit (prn % 64) per constellation
+
+   // Staging for the sentence being parsed
+   uint8_t talkerSystem;  // from the talker ID; GPS_SYSTEM_OTHER for GN
+   uint8_t newSystem;     // NMEA 4.10 system ID (GSA), GPS_SYSTEM_OTHER if absent
+   uint8_t newMessage;    // GSV message number
+   uint8_t newInView;     // GSV satellites in view
+   uint8_t newCount;
+   TinyGPSSatellite newSats[12];  // GSA: used PRNs, GSV: up to 4 satellites
+
+   void begin(const char *talker);
+   void setGsaTerm(uint8_t termNumber, const char *term);
+   void setGsvTerm(uint8_t termNumber, const char *term);
+   void commitGsa();
+   void commitGsv();
+   void touch();
+   static uint8_t systemFromPrn(uint8_t prn);
+};
+
 class TinyGPSPlus;
 class TinyGPSCustom
 {
@@ -231,6 +314,9 @@ public:
   TinyGPSAltitude altitude;
   TinyGPSInteger satellites;
   TinyGPSHDOP hdop;
+  TinyGPSDOP pdop;             // GSA
+  TinyGPSDOP vdop;             // GSA
+  TinyGPSSatellites satellitesInView;  // GSA + GSV
 
   static const char *libraryVersion() { return _GPS_VERSION; }
 
@@ -247,7 +333,7 @@ public:
   uint32_t passedChecksum()   const { return passedChecksumCount; }
 
 private:
-  enum {GPS_SENTENCE_GPGGA, GPS_SENTENCE_GPRMC, GPS_SENTENCE_OTHER};
+  enum {GPS_SENTENCE_GPGGA, GPS_SENTENCE_GPRMC, GPS_SENTENCE_GSA, GPS_SENTENCE_GSV, GPS_SENTENCE_OTHER};
 
   // parsing state variables
   uint8_t parity;
@@ -264,6 +350,24 @@ private:
   TinyGPSCustom *customCandidates;
   void insertCustom(TinyGPSCustom *pElt, const char *sentenceName, int index);
 
+#if _GPS_FAST_PARSER
+  struct SentenceSlot
+  {
+    const char *name;      // NULL = empty slot
+    uint8_t type;
+    TinyGPSCustom *first;  // custom elements of this sentence, sorted by term number
+    TinyGPSCustom *end;    // first element past them
+  };
+  SentenceSlot sentenceTable[_GPS_SENTENCE_SLOTS];
+  bool sentenceTableFull;       // some custom names did not fit: fall back to the list walk
+  TinyGPSCustom *customEnd;     // end of the customCandidates group
+  TinyGPSCustom *customCursor;  // next custom element that may match curTermNumber
+  static uint8_t sentenceHash(const char *name);
+  const SentenceSlot *findSentence(const char *name) const;
+  SentenceSlot *addSentence(const char *name, uint8_t type);
+  void buildSentenceTable();
+#endif
+
   // statistics
   uint32_t encodedCharCount;
   uint32_t sentencesWithFixCount;
@@ -273,6 +377,7 @@ private:
   // internal utilities
   int fromHex(char a);
   bool endOfTermHandler();
+  uint8_t satelliteSentenceType(const char *term);
 };
 
 #endif // def(__TinyGPSPlus_h)
@@ -17,10 +17,17 @@
 #define TINY_GSM_BUFFER_READ_AND_CHECK_SIZE
 
 #include "TinyGsmClientA76xx.h"
+#include "TinyGsmResponseMatcher.h"
 #include "TinyGsmMqttA76xx.h"
 #include "TinyGsmHttpsA76xx.h"
 #include "TinyGsmTCP.tpp"
 
+// Socket URCs waitResponse() handles on its own while waiting for a response
+static const char A7670_URC_CIPRXGET[] TINY_GSM_PROGMEM = GSM_NL "+CIPRXGET:";
+static const char A7670_URC_RECEIVE[] TINY_GSM_PROGMEM  = GSM_NL "+RECEIVE:";
+static const char A7670_URC_IPCLOSE[] TINY_GSM_PROGMEM  = "+IPCLOSE:";
+static const char A7670_URC_CIPEVENT[] TINY_GSM_PROGMEM = "+CIPEVENT:";
+
 class TinyGsmA7670 :  public TinyGsmA76xx<TinyGsmA7670>,
                       public TinyGsmTCP<TinyGsmA7670, TINY_GSM_MUX_COUNT>,
                       public TinyGsmMqttA76xx<TinyGsmA7670, TINY_GSM_MQTT_CLI_COUNT>,
@@ -289,6 +296,14 @@ class TinyGsmA7670 :  public TinyGsmA76xx<TinyGsmA7670>,
    * Client related functions
    */
  protected:
+  void maintainImpl() {
+    TinyGsmTCP<TinyGsmA7670, TINY_GSM_MUX_COUNT>::maintainImpl();
+    if (networkErrorPending) {
+      networkErrorPending = false;
+      if (!isGprsConnected()) { gprsDisconnect(); }
+    }
+  }
+
   bool modemConnect(const char* host, uint16_t port, uint8_t mux,
                     bool ssl = false, int timeout_s = 15) {
     if (ssl) { DBG("SSL not yet supported on this module!"); }
@@ -356,9 +371,9 @@ class TinyGsmA7670 :  public TinyGsmA76xx<TinyGsmA7670>,
     //  ^^ Requested number of data bytes (1-1460 bytes)to be read
     int16_t len_confirmed = streamGetIntBefore('\n');
     // ^^ The data length which not read in the buffer
+#ifdef TINY_GSM_USE_HEX
     for (int i = 0; i < len_requested; i++) {
       uint32_t startMillis = millis();
-#ifdef TINY_GSM_USE_HEX
       while (stream.available() < 2 &&
              (millis() - startMillis < sockets[mux]->_timeout)) {
         TINY_GSM_YIELD();
@@ -369,15 +384,18 @@ class TinyGsmA7670 :  public TinyGsmA76xx<TinyGsmA7670>,
       buf[0] = stream.read();
       buf[1] = stream.read();
       char c = strtol(buf, NULL, 16);
-#else
-      while (!stream.available() &&
-             (millis() - startMillis < sockets[mux]->_timeout)) {
-        TINY_GSM_YIELD();
-      }
-      char c = stream.read();
-#endif
       sockets[mux]->rx.put(c);
     }
+#else
+    // Raw payload: copied in blocks rather than with a poll and a read per byte
+    for (int16_t left = len_requested; left > 0;) {
+      uint8_t block[64];
+      size_t  n = stream.readBytes(block, left < (int16_t)sizeof(block) ? left : sizeof(block));
+      if (n == 0) { break; }
+      sockets[mux]->rx.put(block, n);
+      left -= n;
+    }
+#endif
     // DBG("### READ:", len_requested, "from", mux);
     // sockets[mux]->sock_available = modemGetAvailable(mux);
     sockets[mux]->sock_available = len_confirmed;
@@ -420,7 +438,6 @@ class TinyGsmA7670 :  public TinyGsmA76xx<TinyGsmA7670>,
    * Utilities
    */
  public:
-  // TODO(vshymanskyy): Optimize this!
   int8_t waitResponse(uint32_t timeout_ms, String& data,
                       GsmConstStr r1 = GFP(GSM_OK),
                       GsmConstStr r2 = GFP(GSM_ERROR),
@@ -431,120 +448,149 @@ class TinyGsmA7670 :  public TinyGsmA76xx<TinyGsmA7670>,
                       GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
 #endif
                       GsmConstStr r5 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
     data.reserve(64);
-    uint8_t  index       = 0;
+    return waitResponseImpl(timeout_ms, &data, r1, r2, r3, r4, r5);
+  }
+
+  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
+                      GsmConstStr r2 = GFP(GSM_ERROR),
+#if defined TINY_GSM_DEBUG
+                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
+                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
+#else
+                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
+#endif
+                      GsmConstStr r5 = NULL) {
+    return waitResponseImpl(timeout_ms, NULL, r1, r2, r3, r4, r5);
+  }
+
+  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
+                      GsmConstStr r2 = GFP(GSM_ERROR),
+#if defined TINY_GSM_DEBUG
+                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
+                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
+#else
+                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
+#endif
+                      GsmConstStr r5 = NULL) {
+    return waitResponse(1000, r1, r2, r3, r4, r5);
+  }
+
+
+ protected:
+  /*
+   * Matches the expected responses (1-5) and the socket URCs (6-9) in one
+   * pass over the input. The response text is only collected when the caller
+   * asked for it (`data` != NULL); otherwise nothing is allocated.
+   */
+  int8_t waitResponseImpl(uint32_t timeout_ms, String* data, GsmConstStr r1,
+                          GsmConstStr r2, GsmConstStr r3, GsmConstStr r4,
+                          GsmConstStr r5) {
+    enum {
+      URC_CIPRXGET = 6,
+      URC_RECEIVE,
+      URC_IPCLOSE,
+      URC_CIPEVENT,
+    };
+    const GsmConstStr patterns[] = {
+        r1, r2, r3, r4, r5, GFP(A7670_URC_CIPRXGET), GFP(A7670_URC_RECEIVE),
+        GFP(A7670_URC_IPCLOSE), GFP(A7670_URC_CIPEVENT)};
+    if (!respMatcher.compile(patterns, sizeof(patterns) / sizeof(patterns[0]))) {
+      DBG("### Response patterns too long for the matcher");
+      return 0;
+    }
+    int8_t   index       = 0;
     uint32_t startMillis = millis();
     do {
       TINY_GSM_YIELD();
       while (stream.available() > 0) {
         TINY_GSM_YIELD();
         int8_t a = stream.read();
-        // putchar(a);
         if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
+        if (data) { *data += static_cast<char>(a); }
+        uint8_t hit = respMatcher.feed(static_cast<char>(a));
+        if (hit == 0) { continue; }
+        if (hit <= 5) {
 #if defined TINY_GSM_DEBUG
-          if (r3 == GFP(GSM_CME_ERROR)) {
+          if (hit == 3 && r3 == GFP(GSM_CME_ERROR)) {
             streamSkipUntil('\n');  // Read out the error
           }
 #endif
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
+          index = hit;
           goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        } else if (data.endsWith(GF(GSM_NL "+CIPRXGET:"))) {
+        } else if (hit == URC_CIPRXGET) {
           int8_t mode = streamGetIntBefore(',');
           if (mode == 1) {
             int8_t mux = streamGetIntBefore('\n');
             if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
               sockets[mux]->got_data = true;
             }
-            data = "";
+            if (data) { *data = ""; }
+            respMatcher.restart();
             // DBG("### Got Data:", mux);
           } else {
-            data += mode;
+            // Keep matching as if the mode digits were still in the input
+            char digits[5];
+            snprintf(digits, sizeof(digits), "%d", mode);
+            if (data) { *data += digits; }
+            for (const char* d = digits; *d; d++) { respMatcher.feed(*d); }
           }
-        } else if (data.endsWith(GF(GSM_NL "+RECEIVE:"))) {
+        } else if (hit == URC_RECEIVE) {
           int8_t  mux = streamGetIntBefore(',');
           int16_t len = streamGetIntBefore('\n');
           if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
             sockets[mux]->got_data = true;
             if (len >= 0 && len <= 1024) { sockets[mux]->sock_available = len; }
           }
-          data = "";
+          if (data) { *data = ""; }
+          respMatcher.restart();
           // DBG("### Got Data:", len, "on", mux);
-        } else if (data.endsWith(GF("+IPCLOSE:"))) {
+        } else if (hit == URC_IPCLOSE) {
           int8_t mux = streamGetIntBefore(',');
           streamSkipUntil('\n');  // Skip the reason code
           if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
             sockets[mux]->sock_connected = false;
           }
-          data = "";
+          if (data) { *data = ""; }
+          respMatcher.restart();
           DBG("### Closed: ", mux);
-        } else if (data.endsWith(GF("+CIPEVENT:"))) {
+        } else if (hit == URC_CIPEVENT) {
           // Need to close all open sockets and release the network library.
           // User will then need to reconnect.
+          // The check sends a command of its own: it would recompile
+          // respMatcher under this wait and eat the rest of the response the
+          // caller is about to read, so maintain() runs it later.
           DBG("### Network error!");
-          if (!isGprsConnected()) { gprsDisconnect(); }
-          data = "";
+          networkErrorPending = true;
+          if (data) { *data = ""; }
+          respMatcher.restart();
         }
       }
     } while (millis() - startMillis < timeout_ms);
   finish:
     if (!index) {
-      data.trim();
-      if (data.length()) { DBG("### Unhandled:", data); }
-      data = "";
-    }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
-  }
-
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
-  }
-
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
+      if (data) {
+        data->trim();
+        if (data->length()) { DBG("### Unhandled:", *data); }
+        *data = "";
+      }
 #if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
+      else {
+        char tail[65];
+        String unhandled(tail, respMatcher.tail(tail, sizeof(tail)));
+        unhandled.trim();
+        if (unhandled.length()) { DBG("### Unhandled:", unhandled); }
+      }
 #endif
-                      GsmConstStr r5 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5);
+    }
+    return index;
   }
 
-
- protected:
   GsmClientA7670* sockets[TINY_GSM_MUX_COUNT];
+  // Shared by every wait and not reentrant: a URC branch in waitResponseImpl()
+  // must not send a command (and so wait) before its own wait has returned
+  TinyGsmResponseMatcher<9, 200> respMatcher;
+  bool networkErrorPending = false;  // +CIPEVENT seen, checked by maintain()
 };
 
 #endif  // SRC_TINYGSMCLIENTA7670_H_
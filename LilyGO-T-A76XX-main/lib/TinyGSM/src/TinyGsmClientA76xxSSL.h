@@ -18,6 +18,7 @@
 #define TINY_GSM_BUFFER_READ_AND_CHECK_SIZE
 
 #include "TinyGsmClientA76xx.h"
+#include "TinyGsmResponseMatcher.h"
 #include "TinyGsmTCP.tpp"
 #include "TinyGsmSSL.tpp"
 #include "TinyGsmMqttA76xx.h"
@@ -26,6 +27,16 @@
 // Websocket callback function
 typedef void (*websocket_cb_t)(const uint8_t* buffer, size_t length);
 
+// URCs waitResponse() handles on its own while waiting for a response
+static const char A76XXSSL_URC_SMS_DONE[] TINY_GSM_PROGMEM        = "SMS DONE";
+static const char A76XXSSL_URC_ATREADY[] TINY_GSM_PROGMEM         = "*ATREADY:";
+static const char A76XXSSL_URC_PB_DONE[] TINY_GSM_PROGMEM         = "PB DONE";
+static const char A76XXSSL_URC_SIM_REMOVED[] TINY_GSM_PROGMEM     = "SIM REMOVED";
+static const char A76XXSSL_URC_CCHEVENT[] TINY_GSM_PROGMEM        = "+CCHEVENT:";
+static const char A76XXSSL_URC_CCH_PEER_CLOSED[] TINY_GSM_PROGMEM = "+CCH_PEER_CLOSED:";
+static const char A76XXSSL_URC_WSDISC[] TINY_GSM_PROGMEM          = "+WSDISC:";
+static const char A76XXSSL_URC_WSRECEIVE[] TINY_GSM_PROGMEM       = "+WSRECEIVE:";
+
 
 class TinyGsmA76xxSSL : public TinyGsmA76xx<TinyGsmA76xxSSL>,
                         public TinyGsmTCP<TinyGsmA76xxSSL, TINY_GSM_MUX_COUNT>,
@@ -66,7 +77,8 @@ class TinyGsmA76xxSSL : public TinyGsmA76xx<TinyGsmA76xxSSL>,
       }
       at->sockets[this->mux] = this;
 
-      stop();
+      // Nothing is open on a freshly bound client. stop() here sent +CCHCLOSE and
+      // +CCHSTOP from the constructor of every global client, before the UART was up.
 
       return true;
     }
@@ -140,8 +152,8 @@ class TinyGsmA76xxSSL : public TinyGsmA76xx<TinyGsmA76xxSSL>,
   explicit TinyGsmA76xxSSL(Stream& stream)
       : TinyGsmA76xx<TinyGsmA76xxSSL>(stream),
         certificates(),
-        client_certificate(),
         client_private_key(),
+        client_certificate(),
         client_private_key_password() {
     memset(sockets, 0, sizeof(sockets));
   }
@@ -191,17 +203,15 @@ class TinyGsmA76xxSSL : public TinyGsmA76xx<TinyGsmA76xxSSL>,
   void maintainImpl() {
     // Keep listening for modem URC's and proactively iterate through
     // sockets asking if any data is available
-    bool check_socks = false;
+    // modemGetAvailable() gives up before +CCHRECV? when the session it is asked
+    // about is closed, so ask about each flagged session rather than always mux 0
     for (int mux = 0; mux < TINY_GSM_MUX_COUNT; mux++) {
       GsmClientA76xxSSL* sock = sockets[mux];
       if (sock && sock->got_data) {
         sock->got_data = false;
-        check_socks    = true;
+        modemGetAvailable(mux);
       }
     }
-    // modemGetAvailable checks all socks, so we only want to do it once
-    // modemGetAvailable calls modemGetConnected(), which also checks allf
-    if (check_socks) { modemGetAvailable(0); }
     while (stream.available()) { waitResponse(15, NULL, NULL); }
   }
 
@@ -549,9 +559,8 @@ class TinyGsmA76xxSSL : public TinyGsmA76xx<TinyGsmA76xxSSL>,
     //+CCHSEND: 0,0
     if (waitResponse(GF(GSM_NL "+CCHSEND:")) != 1) { return 0; }
     streamSkipUntil(',');  // Skip mux
-    // if (streamGetIntBefore(',') != 0) { return 0; }  // If result != success
-    int write_bytes = streamGetIntBefore('\n') == 0 ? len : write_bytes;
-    return write_bytes;
+    // +CCHSEND: <session_id>,<err>; nothing counts as written unless err is 0
+    return streamGetIntBefore('\n') == 0 ? len : 0;
   }
 
   size_t sslRead(size_t size, uint8_t mux) {
@@ -577,13 +586,14 @@ class TinyGsmA76xxSSL : public TinyGsmA76xx<TinyGsmA76xxSSL>,
       return 0;
     }
 
-    for (int i = 0; i < len_confirmed; i++) {
-      uint32_t startMillis = millis();
-      while (!stream.available() && (millis() - startMillis < sockets[mux]->_timeout)) {
-        TINY_GSM_YIELD();
-      }
-      char c = stream.read();
-      sockets[mux]->rx.put(c);
+    // The payload follows in one piece: copy it in blocks (readBytes waits up to the
+    // stream timeout for each) rather than with a poll and a read per byte
+    for (int16_t left = len_confirmed; left > 0;) {
+      uint8_t block[64];
+      size_t  n = stream.readBytes(block, left < (int16_t)sizeof(block) ? left : sizeof(block));
+      if (n == 0) { break; }
+      sockets[mux]->rx.put(block, n);
+      left -= n;
     }
 
     if (waitResponse("+CCHRECV:") == 1) {
@@ -615,17 +625,13 @@ class TinyGsmA76xxSSL : public TinyGsmA76xx<TinyGsmA76xxSSL>,
     // if we get the +CCHRECV: response, read the mux number and the number of
     // characters available
     if (res == 1) {
-      // +CCHRECV: LEN,2048,0
-      size_t result  = streamGetIntBefore(',');
-      int    ret_mux = streamGetIntBefore('\n');
-      if (ret_mux == -9999) {
-        // DBG("ERROR: mux = -9999");
-        return 0;
+      // +CCHRECV: LEN,<cache_len_0>,<cache_len_1>: one length per session, the
+      // second number is not a session id
+      for (uint8_t i = 0; i < TINY_GSM_MUX_COUNT; i++) {
+        int len = streamGetIntBefore(i + 1 < TINY_GSM_MUX_COUNT ? ',' : '\n');
+        if (len >= 0 && sockets[i]) { sockets[i]->sock_available = len; }
       }
-      GsmClientA76xxSSL* sock = sockets[ret_mux];
       waitResponse();
-      // DBG("---- available:", result, "ret_mux", ret_mux);
-      if (sock) { sock->sock_available = result; }
     }
     if (!sockets[mux]) { return 0; }
     // DBG("sockets[mux]->sock_available=", sockets[mux]->sock_available);
@@ -697,9 +703,12 @@ class TinyGsmA76xxSSL : public TinyGsmA76xx<TinyGsmA76xxSSL>,
 
   bool sslDisconnect(uint8_t mux) {
     sendAT(GF("+CCHCLOSE="), mux);
-    waitResponse(3000);
-    waitResponse(3000UL,GF("+CCHCLOSE:"),GF("ERROR"));
-    streamSkipUntil('\n');
+    // A session that is not open is refused at once; only an accepted close
+    // is followed by +CCHCLOSE: <session_id>,<err>
+    if (waitResponse(3000) == 1) {
+      waitResponse(3000UL, GF("+CCHCLOSE:"), GF("ERROR"));
+      streamSkipUntil('\n');
+    }
     sendAT(GF("+CCHSTOP"));
     waitResponse(3000UL,GF("+CCHSTOP:"),GF("ERROR"));
     streamSkipUntil('\n');
@@ -875,14 +884,62 @@ class TinyGsmA76xxSSL : public TinyGsmA76xx<TinyGsmA76xxSSL>,
                       GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
 #endif
                       GsmConstStr r5 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
     data.reserve(64);
-    uint8_t  index       = 0;
+    return waitResponseImpl(timeout_ms, &data, r1, r2, r3, r4, r5);
+  }
+
+  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
+                      GsmConstStr r2 = GFP(GSM_ERROR),
+#if defined TINY_GSM_DEBUG
+                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
+                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
+#else
+                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
+#endif
+                      GsmConstStr r5 = NULL) {
+    return waitResponseImpl(timeout_ms, NULL, r1, r2, r3, r4, r5);
+  }
+
+  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK), GsmConstStr r2 = GFP(GSM_ERROR),
+#if defined TINY_GSM_DEBUG
+                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
+                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
+#else
+                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
+#endif
+                      GsmConstStr r5 = NULL) {
+    return waitResponse(1000, r1, r2, r3, r4, r5);
+  }
+
+ protected:
+  /*
+   * Same single-pass matcher as TinyGsmA7670::waitResponseImpl(): the expected
+   * responses (1-5) and the URCs below are fed byte by byte through one
+   * automaton, and the response text is only collected on request.
+   */
+  int8_t waitResponseImpl(uint32_t timeout_ms, String* data, GsmConstStr r1,
+                          GsmConstStr r2, GsmConstStr r3, GsmConstStr r4,
+                          GsmConstStr r5) {
+    enum {
+      URC_SMS_DONE = 6,
+      URC_ATREADY,
+      URC_PB_DONE,
+      URC_SIM_REMOVED,
+      URC_CCHEVENT,
+      URC_CCH_PEER_CLOSED,
+      URC_WSDISC,
+      URC_WSRECEIVE,
+    };
+    const GsmConstStr patterns[] = {
+        r1, r2, r3, r4, r5, GFP(A76XXSSL_URC_SMS_DONE), GFP(A76XXSSL_URC_ATREADY),
+        GFP(A76XXSSL_URC_PB_DONE), GFP(A76XXSSL_URC_SIM_REMOVED), GFP(A76XXSSL_URC_CCHEVENT),
+        GFP(A76XXSSL_URC_CCH_PEER_CLOSED), GFP(A76XXSSL_URC_WSDISC),
+        GFP(A76XXSSL_URC_WSRECEIVE)};
+    if (!respMatcher.compile(patterns, sizeof(patterns) / sizeof(patterns[0]))) {
+      DBG("### Response patterns too long for the matcher");
+      return 0;
+    }
+    int8_t   index       = 0;
     uint32_t startMillis = millis();
     do {
       TINY_GSM_YIELD();
@@ -890,60 +947,38 @@ class TinyGsmA76xxSSL : public TinyGsmA76xx<TinyGsmA76xxSSL>,
         TINY_GSM_YIELD();
         int8_t a = stream.read();
         if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
+        if (data) { *data += static_cast<char>(a); }
+        uint8_t hit = respMatcher.feed(static_cast<char>(a));
+        if (hit == 0) { continue; }
+        if (hit <= 5) {
 #if defined TINY_GSM_DEBUG
-          if (r3 == GFP(GSM_CME_ERROR)) {
+          if (hit == 3 && r3 == GFP(GSM_CME_ERROR)) {
             streamSkipUntil('\n');  // Read out the error
           }
 #endif
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
+          index = hit;
           goto finish;
-        } else if (data.endsWith(GF("SMS DONE"))) {
-          data = "";
-          // TODO:
-        } else if (data.endsWith(GF("*ATREADY:"))) {
+        } else if (hit == URC_ATREADY) {
           streamSkipUntil('\n');
-          data = "";
-          // TODO:
-        } else if (data.endsWith(GF("PB DONE"))) {
-          data = "";
-          // TODO:
-        } else if (data.endsWith(GF("SIM REMOVED"))) {
-          data = "";
-          // TODO:
-        } else if (data.endsWith(GF("+CCHEVENT: 0,RECV EVENT"))) {
-          data = "";
-          // TODO:
-        } else if (data.endsWith(GF("+CCH_PEER_CLOSED:"))) {
+        } else if (hit == URC_CCHEVENT) {
+          // +CCHEVENT: <session_id>,RECV EVENT: data is waiting in the modem
+          // (+CCHSET=1,1), maintain() asks for its length
+          int8_t mux = streamGetIntBefore(',');
+          streamSkipUntil('\n');
+          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+            sockets[mux]->got_data = true;
+          }
+        } else if (hit == URC_CCH_PEER_CLOSED) {
           int8_t mux = streamGetIntBefore('\n');
           if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
             sockets[mux]->sock_connected = false;
             DBG("### Closed: ", mux);
           }
-          data = "";
-        } else if (data.endsWith(GF("+WSDISC:"))) {
-          data = "";
+        } else if (hit == URC_WSDISC) {
           DBG("## Websocket Disconnected!");
-          // TODO:
           int res = streamGetIntBefore('\n');
           DBG("Error code:", res);
-
-        } else if (data.endsWith(GF("+WSRECEIVE:"))) {
-          data = "";
-          // TODO:
+        } else if (hit == URC_WSRECEIVE) {
           DBG("## Websocket get message receive!");
           int len_confirmed = streamGetIntBefore('\n');
           DBG("Recv length:", len_confirmed);
@@ -965,41 +1000,28 @@ class TinyGsmA76xxSSL : public TinyGsmA76xx<TinyGsmA76xxSSL>,
             // TODO: WEBSOCKET
           }
         }
+        // SMS DONE, PB DONE, SIM REMOVED need nothing beyond being dropped
+        if (data) { *data = ""; }
+        respMatcher.restart();
       }
     } while (millis() - startMillis < timeout_ms);
   finish:
     if (!index) {
-      data.trim();
-      if (data.length()) { DBG("### Unhandled:", data); }
-      data = "";
-    }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
-  }
-
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
-  }
-
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK), GsmConstStr r2 = GFP(GSM_ERROR),
+      if (data) {
+        data->trim();
+        if (data->length()) { DBG("### Unhandled:", *data); }
+        *data = "";
+      }
 #if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
+      else {
+        char tail[65];
+        String unhandled(tail, respMatcher.tail(tail, sizeof(tail)));
+        unhandled.trim();
+        if (unhandled.length()) { DBG("### Unhandled:", unhandled); }
+      }
 #endif
-                      GsmConstStr r5 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5);
+    }
+    return index;
   }
 
  protected:
@@ -1011,6 +1033,9 @@ class TinyGsmA76xxSSL : public TinyGsmA76xx<TinyGsmA76xxSSL>,
   GsmClientConnType  connType[TINY_GSM_MUX_COUNT];
   size_t             websocket_available_bytes;
   websocket_cb_t     _websocket_cb;
+  // Shared by every wait and not reentrant: the URC branches in
+  // waitResponseImpl() only read the stream, none of them sends a command
+  TinyGsmResponseMatcher<13, 200> respMatcher;
 };
 
 #endif  // SRC_TINYGSMCLIENTA76XXSSL_H_
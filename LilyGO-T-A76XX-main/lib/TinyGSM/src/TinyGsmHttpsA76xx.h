@@ -26,6 +26,18 @@ enum HttpMethod {
     TINYGSM_HTTP_PATCH,
 };
 
+/**
+ * @brief Produces a request body directly into the modem UART.
+ * @param out      Destination stream; bytes beyond the announced size are discarded
+ * @param context  User pointer passed through unchanged
+ * @return false if the body did not come out at exactly the announced size; the
+ * request is then not sent
+ */
+typedef bool (*HttpsBodyWriter)(Print &out, void *context);
+
+// https_post_stream(): the writer did not produce the announced body, nothing was sent
+#define TINYGSM_HTTP_BODY_INCOMPLETE (-2)
+
 template <class modemType>
 class TinyGsmHttpsA76xx
 {
@@ -143,6 +155,7 @@ public:
 
     int https_get(size_t *bodyLength = NULL)
     {
+        body_length = 0;
         thisModem().sendAT("+HTTPACTION=0");
         if (thisModem().waitResponse(3000) != 1) {
             return false;
@@ -150,10 +163,15 @@ public:
         if (thisModem().waitResponse(60000UL, "+HTTPACTION: ") == 1) {
             int action = thisModem().streamGetIntBefore(',');
             int status = thisModem().streamGetIntBefore(',');
-            size_t length = thisModem().streamGetLongLongBefore('\r');
+            size_t length = 0;
+            bool lengthValid = https_read_length(length);
             DBG("action:"); DBG(action);
             DBG("status:"); DBG(status);
             DBG("length:"); DBG(length);
+            if (!lengthValid) {
+                return -1;
+            }
+            body_length = length;
             if (bodyLength) {
                 *bodyLength = length;
             }
@@ -217,43 +235,162 @@ public:
     }
 
 
+    /**
+     * @brief Reads the body of the last response into a String.
+     *
+     * The size is the one +HTTPACTION reported, so the body is fetched with a single
+     * +HTTPREAD and appended straight into the String (see HttpsBodyStream).
+     *
+     * @return The body, or an empty String if it could not be read completely.
+     */
     String https_body()
     {
-        int offset = 0;
-        size_t total =  https_get_size();
-        if (total == 0) {
-            return "";
+        String body;
+        if (body_length == 0 || !body.reserve(body_length)) {
+            return body;
+        }
+        HttpsBodyStream stream(thisModem());
+        char buffer[64];
+        size_t n;
+        while ((n = stream.readBytes(buffer, sizeof(buffer))) > 0) {
+            body.concat(buffer, n);
         }
+        return stream.failed() ? String() : body;
+    }
 
-        uint8_t *buffer =  (uint8_t *)TINY_GSM_MALLOC(total + 1);
-        if (!buffer) {
-            thisModem().stream.flush();
-            return "";
+    /**
+     * @brief Body size of the last response, as reported by +HTTPACTION.
+     */
+    size_t https_body_length() const
+    {
+        return body_length;
+    }
+
+    /**
+     * @brief The body of the last response as a Stream, read with +HTTPREAD.
+     *
+     * The modem is asked for the whole body (its size is known from +HTTPACTION, so no
+     * +HTTPREAD? is needed) and the +HTTPREAD: <n> chunks are passed on to the reader as
+     * they come out of the UART, e.g. deserializeJson(doc, stream) parses the response
+     * without it ever being buffered. Whatever is not read is discarded when the stream
+     * is destroyed, so the next command finds the UART clean. Create at most one at a
+     * time and do not send other commands while it is alive.
+     */
+    class HttpsBodyStream : public Stream
+    {
+    public:
+        explicit HttpsBodyStream(modemType &modem) : modem_(modem), remaining_(modem.https_body_length()) {}
+        HttpsBodyStream(const HttpsBodyStream &) = delete;
+        HttpsBodyStream &operator=(const HttpsBodyStream &) = delete;
+
+        ~HttpsBodyStream()
+        {
+            char scrap[32];
+            while (readBytes(scrap, sizeof(scrap)) > 0) {
+            }
         }
 
-        thisModem().sendAT("+HTTPREAD=0,", total);
-        if (thisModem().waitResponse(3000) != 1) {
-            free(buffer);
-            return "";
+        // Bytes of the body not read yet (not all of them are necessarily received)
+        int available() override
+        {
+            return failed_ ? 0 : remaining_;
+        }
+
+        int read() override
+        {
+            char c;
+            return readBytes(&c, 1) == 1 ? static_cast<uint8_t>(c) : -1;
         }
-        do {
-            if (thisModem().waitResponse(30000UL, "+HTTPREAD: ") != 1) {
-                free(buffer);
-                return "";
+
+        int peek() override
+        {
+            if (!nextChunk()) {
+                return -1;
             }
-            int length = thisModem().streamGetIntBefore('\n');
-            if (thisModem().stream.readBytes(buffer + offset, length) != length) {
-                free(buffer);
-                return "";
+            uint32_t start = millis();
+            while (!modem_.stream.available() && millis() - start < modem_.stream.getTimeout()) {
+                TINY_GSM_YIELD();
             }
-            offset += length;
-        } while (total != offset);
-        thisModem().waitResponse(5000UL, "+HTTPREAD: 0");
-        buffer[total] = '\0';
-        String body = String((const char *)buffer);
-        free(buffer);
-        return body;
-    }
+            return modem_.stream.peek();
+        }
+
+        size_t readBytes(char *buffer, size_t length) override
+        {
+            size_t done = 0;
+            while (done < length && nextChunk()) {
+                size_t n = length - done;
+                if (n > chunk_) {
+                    n = chunk_;
+                }
+                size_t got = modem_.stream.readBytes(buffer + done, n);
+                done += got;
+                chunk_ -= got;
+                remaining_ -= got;
+                if (got < n) {
+                    failed_ = true;
+                }
+            }
+            if (requested_ && remaining_ == 0 && !failed_) {
+                // Trailer of the read, once
+                modem_.waitResponse(5000UL, "+HTTPREAD: 0");
+                requested_ = false;
+            }
+            return done;
+        }
+
+        size_t readBytes(uint8_t *buffer, size_t length)
+        {
+            return readBytes(reinterpret_cast<char *>(buffer), length);
+        }
+
+        size_t write(uint8_t) override
+        {
+            return 0;
+        }
+
+        // True if the body could not be read completely
+        bool failed() const
+        {
+            return failed_;
+        }
+
+    private:
+        // Makes sure some bytes of the current +HTTPREAD: <n> chunk are left
+        bool nextChunk()
+        {
+            if (chunk_ > 0) {
+                return true;
+            }
+            if (remaining_ == 0 || failed_) {
+                return false;
+            }
+            if (!requested_) {
+                modem_.sendAT("+HTTPREAD=0,", remaining_);
+                if (modem_.waitResponse(3000) != 1) {
+                    failed_ = true;
+                    return false;
+                }
+                requested_ = true;
+            }
+            if (modem_.waitResponse(30000UL, "+HTTPREAD: ") != 1) {
+                failed_ = true;
+                return false;
+            }
+            int length = modem_.streamGetIntBefore('\n');
+            if (length <= 0) {
+                failed_ = true;
+                return false;
+            }
+            chunk_ = length;
+            return true;
+        }
+
+        modemType &modem_;
+        size_t remaining_;
+        size_t chunk_ = 0;
+        bool requested_ = false;
+        bool failed_ = false;
+    };
 
     size_t https_get_size(void)
     {
@@ -261,7 +398,10 @@ public:
         if (thisModem().waitResponse(120000UL, "+HTTPREAD: LEN,") != 1) {
             return 0;
         }
-        size_t length = thisModem().streamGetLongLongBefore('\r');
+        size_t length = 0;
+        if (!https_read_length(length)) {
+            length = 0;
+        }
         thisModem().stream.flush();
         return length;
     }
@@ -313,6 +453,26 @@ public:
         return https_method(TINYGSM_HTTP_POST, json.c_str(), json.length());
     }
 
+    /**
+     * @brief  Sends a POST request whose body is generated on the fly by a writer callback.
+     *
+     * The body never has to exist in RAM as a whole: after the DOWNLOAD prompt the
+     * writer prints straight into the modem stream. The size announced in +HTTPDATA
+     * must be known up front. If the writer reports a failure or stops short, the
+     * request is not sent: the data phase is only completed so the modem leaves it
+     * at once, and the body is dropped with the next +HTTPDATA.
+     *
+     * @param size    Exact body length in bytes
+     * @param writer  Callback producing the body
+     * @param context User pointer handed to the writer
+     * @return The HTTP status code of the response if the request is successful,
+     * TINYGSM_HTTP_BODY_INCOMPLETE if the body did not match `size`, -1 otherwise.
+     */
+    int https_post_stream(size_t size, HttpsBodyWriter writer, void *context)
+    {
+        return https_method_stream(TINYGSM_HTTP_POST, size, writer, context);
+    }
+
     /**
     * @brief Perform an HTTP PUT request with a C-style string payload.
     *
@@ -402,6 +562,63 @@ public:
         return -1;
     }
 private:
+    // Body size from the last +HTTPACTION; the modem keeps the body until the next one
+    size_t body_length = 0;
+
+    // Print adapter that lets through at most `remaining` bytes
+    class HttpsBodyPrint : public Print
+    {
+    public:
+        HttpsBodyPrint(Stream &stream, size_t remaining) : stream_(stream), remaining_(remaining) {}
+
+        size_t write(uint8_t c) override
+        {
+            return write(&c, 1);
+        }
+
+        size_t write(const uint8_t *buffer, size_t size) override
+        {
+            if (size > remaining_) {
+                size = remaining_;
+            }
+            size_t written = stream_.write(buffer, size);
+            remaining_ -= written;
+            return written;
+        }
+
+        size_t remaining() const
+        {
+            return remaining_;
+        }
+
+    private:
+        Stream &stream_;
+        size_t remaining_;
+    };
+
+    int https_method_stream(HttpMethod method, size_t size, HttpsBodyWriter writer, void *context,
+                            uint32_t inputTimeout = 10000)
+    {
+        thisModem().sendAT("+HTTPDATA=", size, ",", inputTimeout);
+        if (thisModem().waitResponse(30000UL, "DOWNLOAD") != 1) {
+            return -1;
+        }
+        HttpsBodyPrint body(thisModem().stream, size);
+        bool complete = writer(body, context) && body.remaining() == 0;
+        // The modem waits for every announced byte (or inputTimeout) before it answers
+        while (body.remaining() > 0) {
+            body.write(' ');
+        }
+        if (thisModem().waitResponse(30000UL) != 1) {
+            return -1;
+        }
+        if (!complete) {
+            DBG("### Body does not match its announced size; request not sent");
+            return TINYGSM_HTTP_BODY_INCOMPLETE;
+        }
+        return https_method(method, nullptr, 0);
+    }
+
     int https_method(HttpMethod method, const char *payload, size_t size, uint32_t inputTimeout = 10000)
     {
         if (payload) {
@@ -414,6 +631,7 @@ private:
                 return -1;
             }
         }
+        body_length = 0;
         thisModem().sendAT("+HTTPACTION=", method);
         if (thisModem().waitResponse(3000) != 1) {
             return -1;
@@ -421,10 +639,15 @@ private:
         if (thisModem().waitResponse(60000UL, "+HTTPACTION:") == 1) {
             int action = thisModem().streamGetIntBefore(',');
             int status = thisModem().streamGetIntBefore(',');
-            int length = thisModem().streamGetIntBefore('\r');
+            size_t length = 0;
+            bool lengthValid = https_read_length(length);
             DBG("action:"); DBG(action);
             DBG("status:"); DBG(status);
             DBG("length:"); DBG(length);
+            if (!lengthValid) {
+                return -1;
+            }
+            body_length = length;
             return status;
         }
         return -1;
@@ -433,6 +656,21 @@ private:
      * CRTP Helper
      */
 protected:
+    // Reads the body length that ends a +HTTPACTION / +HTTPREAD: LEN line. The
+    // modem reports failures as negative values (-9999); those are rejected here
+    // so they never turn into a huge unsigned length.
+    bool https_read_length(size_t &length)
+    {
+        int64_t value = static_cast<int64_t>(thisModem().streamGetLongLongBefore('\r'));
+        if (value < 0) {
+            DBG("invalid length:"); DBG(static_cast<long>(value));
+            return false;
+        }
+        length = static_cast<size_t>(value);
+        return true;
+    }
+
+
     inline const modemType &thisModem() const
     {
         return static_cast<const modemType &>(*this);
@@ -0,0 +1,188 @@
+/**
+ * @file       TinyGsmResponseMatcher.h
+ * @license    LGPL-3.0
+ * @date       Oct 2026
+ */
+
+#ifndef SRC_TINYGSMRESPONSEMATCHER_H_
+#define SRC_TINYGSMRESPONSEMATCHER_H_
+
+#include "TinyGsmCommon.h"
+
+/*
+ * Streaming multi-pattern matcher for waitResponse().
+ *
+ * The expected responses and URCs are compiled into an Aho-Corasick automaton
+ * (trie with failure links) held in fixed arrays; feeding a byte then costs
+ * amortized O(1) instead of one endsWith() per pattern, and nothing is
+ * allocated. The last bytes seen are kept in a small ring buffer so the
+ * unhandled tail can still be logged when no pattern matched.
+ *
+ * Pattern indices are 1-based; when several patterns end on the same byte the
+ * lowest index wins, as with the old if/else-if chain of endsWith() calls.
+ */
+template <uint8_t MaxPatterns, uint8_t MaxNodes, uint8_t TailSize = 64>
+class TinyGsmResponseMatcher {
+  static_assert(MaxNodes >= 2 && MaxNodes < 0xFF, "node index must fit in uint8_t");
+
+ public:
+  TinyGsmResponseMatcher() : _count(0), _nodes(0), _state(0), _tailPos(0), _tailLen(0) {}
+
+  /*
+   * Builds the automaton unless the same patterns (by address) are already
+   * compiled. Patterns must have static storage (literals, GF()), since the
+   * cache compares addresses only. NULL entries never match. Returns false
+   * when the patterns do not fit into MaxNodes trie nodes.
+   */
+  bool compile(const GsmConstStr* patterns, uint8_t count) {
+    if (count > MaxPatterns) { return false; }
+    if (_nodes && count == _count && samePatterns(patterns)) {
+      reset();
+      return true;
+    }
+    _count = count;
+    for (uint8_t i = 0; i < count; i++) { _patterns[i] = patterns[i]; }
+    if (!build()) {
+      _nodes = 0;
+      return false;
+    }
+    reset();
+    return true;
+  }
+
+  // Forgets the input seen so far (after a URC has been consumed)
+  void restart() {
+    _state = 0;
+  }
+
+  void reset() {
+    _state   = 0;
+    _tailPos = 0;
+    _tailLen = 0;
+  }
+
+  // Consumes one byte; returns the index of the pattern ending here, 0 if none
+  uint8_t feed(char c) {
+    _tail[_tailPos] = c;
+    _tailPos        = (_tailPos + 1) % TailSize;
+    if (_tailLen < TailSize) { _tailLen++; }
+
+    uint8_t s = _state;
+    for (;;) {
+      uint8_t next = findChild(s, c);
+      if (next != NONE) {
+        s = next;
+        break;
+      }
+      if (s == 0) { break; }
+      s = _fail[s];
+    }
+    _state = s;
+    return _out[s] == NONE ? 0 : _out[s];
+  }
+
+  // Copies the most recent input (at most TailSize bytes) as a C string
+  size_t tail(char* out, size_t size) const {
+    if (size == 0) { return 0; }
+    size_t n = _tailLen < size - 1 ? _tailLen : size - 1;
+    size_t start = (_tailPos + TailSize - n) % TailSize;
+    for (size_t i = 0; i < n; i++) { out[i] = _tail[(start + i) % TailSize]; }
+    out[n] = '\0';
+    return n;
+  }
+
+ private:
+  static const uint8_t NONE = 0xFF;
+
+  bool samePatterns(const GsmConstStr* patterns) const {
+    for (uint8_t i = 0; i < _count; i++) {
+      if (_patterns[i] != patterns[i]) { return false; }
+    }
+    return true;
+  }
+
+  uint8_t findChild(uint8_t node, char c) const {
+    for (uint8_t n = _child[node]; n != NONE; n = _sibling[n]) {
+      if (_char[n] == c) { return n; }
+    }
+    return NONE;
+  }
+
+  uint8_t addNode(uint8_t parent, char c) {
+    if (_nodes >= MaxNodes) { return NONE; }
+    uint8_t n   = _nodes++;
+    _char[n]    = c;
+    _child[n]   = NONE;
+    _sibling[n] = _child[parent];
+    _fail[n]    = 0;
+    _out[n]     = NONE;
+    _child[parent] = n;
+    return n;
+  }
+
+  bool build() {
+    _nodes    = 1;
+    _child[0] = NONE;
+    _fail[0]  = 0;
+    _out[0]   = NONE;
+
+    // Trie of all patterns; a node keeps the lowest index of the pattern ending there
+    for (uint8_t i = 0; i < _count; i++) {
+      const char* p = reinterpret_cast<const char*>(_patterns[i]);
+      if (p == NULL || pgm_read_byte(p) == 0) { continue; }
+      uint8_t node = 0;
+      for (char c; (c = static_cast<char>(pgm_read_byte(p))) != 0; p++) {
+        uint8_t next = findChild(node, c);
+        if (next == NONE) { next = addNode(node, c); }
+        if (next == NONE) { return false; }
+        node = next;
+      }
+      if (_out[node] == NONE) { _out[node] = i + 1; }
+    }
+
+    // Failure links in breadth-first order, so every link points to a finished node
+    uint8_t queue[MaxNodes];
+    uint8_t head = 0, tailIdx = 0;
+    for (uint8_t n = _child[0]; n != NONE; n = _sibling[n]) {
+      _fail[n]         = 0;
+      queue[tailIdx++] = n;
+    }
+    while (head < tailIdx) {
+      uint8_t node = queue[head++];
+      for (uint8_t n = _child[node]; n != NONE; n = _sibling[n]) {
+        uint8_t f = _fail[node];
+        uint8_t target;
+        for (;;) {
+          target = findChild(f, _char[n]);
+          if (target != NONE || f == 0) { break; }
+          f = _fail[f];
+        }
+        _fail[n] = (target == NONE || target == n) ? 0 : target;
+        // A pattern that is a suffix of this node's string also ends here
+        uint8_t inherited = _out[_fail[n]];
+        if (inherited != NONE && (_out[n] == NONE || inherited < _out[n])) {
+          _out[n] = inherited;
+        }
+        queue[tailIdx++] = n;
+      }
+    }
+    return true;
+  }
+
+  GsmConstStr _patterns[MaxPatterns];
+  uint8_t     _count;
+  uint8_t     _nodes;
+  uint8_t     _state;
+
+  char    _char[MaxNodes];
+  uint8_t _child[MaxNodes];
+  uint8_t _sibling[MaxNodes];
+  uint8_t _fail[MaxNodes];
+  uint8_t _out[MaxNodes];
+
+  char    _tail[TailSize];
+  uint8_t _tailPos;
+  uint8_t _tailLen;
+};
+
+#endif  // SRC_TINYGSMRESPONSEMATCHER_H_
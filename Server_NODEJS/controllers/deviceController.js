@@ -36,12 +36,14 @@ const updateDeviceSettings = async (req, res) => {
       log.warn('Device settings validation failed', { errors: errors.array() });
       return res.status(400).json({ success: false, error: 'Validation failed', details: errors.array() });
     }
-    const { deviceId, interval_gps, interval_send, satellites, mode } = req.body;
+    const { deviceId, interval_gps, interval_send, satellites, mode,
+            max_batch, accuracy_m, track_tolerance_m, dwell_radius_m, resolution_m, interval_min, interval_max } = req.body;
     log.info('Updating device settings', { deviceId, mode });
 
     try {
         const result = await deviceService.updateSettings(deviceId, req.session.user.id, {
-            interval_gps, interval_send, satellites, mode
+            interval_gps, interval_send, satellites, mode,
+            max_batch, accuracy_m, track_tolerance_m, dwell_radius_m, resolution_m, interval_min, interval_max
         });
         
         if (!result.updated) {
@@ -66,6 +68,30 @@ const updateDeviceSettings = async (req, res) => {
   }
 };
 
+/**
+ * Returns the device set by the authenticateDevice middleware, or answers the
+ * request and returns null when the context is missing or any device ID in the
+ * payload names another device. Shared by /input and /sync.
+ */
+const getAuthenticatedDevice = (req, res, log, payloadDeviceIds) => {
+  const device = req.device; // Set by authenticateDevice middleware
+
+  if (!device || !req.user) {
+    log.error('Device authentication context missing', { deviceIds: payloadDeviceIds });
+    res.status(500).json({ error: 'Device context not available after authentication.' });
+    return null;
+  }
+
+  const mismatch = payloadDeviceIds.find(id => id !== undefined && id !== device.device_id);
+  if (mismatch !== undefined) {
+    log.warn('Payload deviceId mismatch', { deviceId: mismatch, authenticatedDevice: device.device_id });
+    res.status(400).json({ error: 'Payload device ID does not match authenticated device.' });
+    return null;
+  }
+
+  return device;
+};
+
 const handleDeviceInput = async (req, res) => {
   try {
     const log = getRequestLogger(req, { controller: 'device', action: 'handleDeviceInput' });
@@ -87,16 +113,9 @@ const handleDeviceInput = async (req, res) => {
       return res.status(400).json({ error: 'Device ID is missing in the payload.' });
     }
 
-    const device = req.device; // Set by authenticateDevice middleware
-
-    if (!device || !req.user) {
-      log.error('Device authentication context missing', { deviceId });
-      return res.status(500).json({ error: 'Device context not available after authentication.' });
-    }
-
-    if (device.device_id !== deviceId) {
-      log.warn('Payload deviceId mismatch', { deviceId, authenticatedDevice: device.device_id });
-      return res.status(400).json({ error: 'Payload device ID does not match authenticated device.' });
+    const device = getAuthenticatedDevice(req, res, log, [deviceId]);
+    if (!device) {
+      return;
     }
 
     const reportedPowerStatus = deviceService.normalizePowerStatus(
@@ -172,6 +191,41 @@ const updatePowerInstruction = async (req, res) => {
   }
 };
 
+/**
+ * Applies the handshake part of a device request (client type, power status,
+ * last_seen) and saves the device. Shared by /handshake and /sync.
+ */
+const applyDeviceHandshake = async (device, body) => {
+  const clientType = deviceService.normalizeClientType(body.client_type || body.clientType) || device.device_type || null;
+  const reportedPowerStatus = deviceService.normalizePowerStatus(body.power_status || body.powerStatus);
+
+  let shouldSave = false;
+
+  if (!device.device_type && clientType) {
+    device.device_type = clientType;
+    shouldSave = true;
+  }
+
+  if (reportedPowerStatus && device.power_status !== reportedPowerStatus) {
+    device.power_status = reportedPowerStatus;
+    shouldSave = true;
+  }
+
+  const resolvedPowerStatus = reportedPowerStatus || device.power_status;
+
+  if (deviceService.shouldClearPowerInstruction(device.power_instruction, resolvedPowerStatus)) {
+    device.power_instruction = 'NONE';
+    shouldSave = true;
+  }
+
+  device.last_seen = new Date();
+  shouldSave = true;
+
+  if (shouldSave) {
+    await device.save();
+  }
+};
+
 const handleDeviceHandshake = async (req, res) => {
     try {
       const log = getRequestLogger(req, { controller: 'device', action: 'handleDeviceHandshake' });
@@ -190,44 +244,64 @@ const handleDeviceHandshake = async (req, res) => {
         return res.status(200).json({ registered: false });
       }
 
-      const clientType = deviceService.normalizeClientType(req.body.client_type || req.body.clientType) || device.device_type || null;
-      const reportedPowerStatus = deviceService.normalizePowerStatus(req.body.power_status || req.body.powerStatus);
+      await applyDeviceHandshake(device, req.body);
 
-      let shouldSave = false;
+      log.info('Handshake successful', { deviceId });
+      return res.status(200).json({
+        registered: true,
+        config: deviceService.buildDeviceConfigPayload(device),
+        power_instruction: device.power_instruction
+      });
+    } catch (error) {
+      const log = getRequestLogger(req, { controller: 'device', action: 'handleDeviceHandshake' });
+      log.error('Error during device handshake', error);
+      return res.status(500).json({ success: false, error: 'Internal server error.' });
+    }
+};
 
-      if (!device.device_type && clientType) {
-        device.device_type = clientType;
-        shouldSave = true;
-      }
+const handleDeviceSync = async (req, res) => {
+    try {
+      const log = getRequestLogger(req, { controller: 'device', action: 'handleDeviceSync' });
+      const deviceId = req.body.device_id || req.body.deviceId;
 
-      if (reportedPowerStatus && device.power_status !== reportedPowerStatus) {
-        device.power_status = reportedPowerStatus;
-        shouldSave = true;
+      if (!deviceId) {
+        log.warn('Sync missing device ID');
+        return res.status(400).json({ success: false, error: 'Missing device_id.' });
       }
 
-      const resolvedPowerStatus = reportedPowerStatus || device.power_status;
-
-      if (deviceService.shouldClearPowerInstruction(device.power_instruction, resolvedPowerStatus)) {
-        device.power_instruction = 'NONE';
-        shouldSave = true;
+      const records = Array.isArray(req.body.records) ? req.body.records : [];
+      const device = getAuthenticatedDevice(req, res, log, [deviceId, ...records.map(record => record.device)]);
+      if (!device) {
+        return;
       }
 
-      device.last_seen = new Date();
-      shouldSave = true;
-
-      if (shouldSave) {
-        await device.save();
+      await applyDeviceHandshake(device, req.body);
+
+      if (records.length > 0) {
+        const clientType = deviceService.normalizeClientType(req.body.client_type || req.body.clientType);
+        const powerStatus = deviceService.normalizePowerStatus(req.body.power_status || req.body.powerStatus);
+        try {
+          await locationService.processLocationData(device, records, clientType, powerStatus);
+        } catch (err) {
+          log.error('Error processing sync records', err);
+          if (err.message && err.message.includes('latitude and longitude')) {
+            return res.status(400).json({ success: false, error: err.message });
+          }
+          return res.status(500).json({ success: false, error: 'An error occurred during data processing.' });
+        }
       }
 
-      log.info('Handshake successful', { deviceId });
+      log.info('Sync successful', { deviceId, points: records.length });
       return res.status(200).json({
         registered: true,
+        success: true,
+        accepted: records.length,
         config: deviceService.buildDeviceConfigPayload(device),
         power_instruction: device.power_instruction
       });
     } catch (error) {
-      const log = getRequestLogger(req, { controller: 'device', action: 'handleDeviceHandshake' });
-      log.error('Error during device handshake', error);
+      const log = getRequestLogger(req, { controller: 'device', action: 'handleDeviceSync' });
+      log.error('Error during device sync', error);
       return res.status(500).json({ success: false, error: 'Internal server error.' });
     }
 };
@@ -697,6 +771,7 @@ module.exports = {
   removeDeviceFromUser,
   registerDeviceUnified,
   handleDeviceHandshake,
+  handleDeviceSync,
   getUnreadAlertsForDevice,
   exportDeviceDataAsGpx,
   updatePowerInstruction
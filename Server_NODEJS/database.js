@@ -46,7 +46,7 @@ Object.keys(db).forEach(modelName => {
 db.sequelize = sequelize;
 db.Sequelize = Sequelize;
 
-// Sync database schema
+// Sync database schema; production leaves existing tables alone, see migrations/
 const syncOptions = process.env.NODE_ENV === 'production' ? {} : { alter: true };
 sequelize.sync(syncOptions).then(() => {
   logger.info('Database schema synchronized', { env: process.env.NODE_ENV, options: syncOptions });
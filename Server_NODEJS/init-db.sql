@@ -30,6 +30,13 @@ CREATE TABLE IF NOT EXISTS devices (
     interval_gps INT DEFAULT 60,
     interval_send INT DEFAULT 1,
     satellites INT DEFAULT 7,
+    max_batch INT DEFAULT 500,
+    accuracy_m INT DEFAULT 10,
+    track_tolerance_m INT DEFAULT 10,
+    dwell_radius_m INT DEFAULT 25,
+    resolution_m INT DEFAULT 0,
+    interval_min INT DEFAULT 15,
+    interval_max INT DEFAULT 900,
     mode ENUM('simple', 'batch') DEFAULT 'simple',
     geofence JSON NULL,
     geofence_alert_active BOOLEAN DEFAULT FALSE,
@@ -48,6 +55,7 @@ CREATE TABLE IF NOT EXISTS locations (
     altitude DECIMAL(7, 2),
     accuracy DECIMAL(5, 2),
     satellites INT,
+    dwell_s INT,
     FOREIGN KEY (device_id) REFERENCES devices(id) ON DELETE CASCADE,
     FOREIGN KEY (user_id) REFERENCES users(id) ON DELETE CASCADE
 );
@@ -10,24 +10,7 @@ function normalizePoints(bodyPayload) {
   return null;
 }
 
-const validateDeviceInputPayload = (req, res, next) => {
-  const points = normalizePoints(req.body);
-
-  if (!points || points.length === 0) {
-    return res.status(400).json({
-      success: false,
-      error: 'Request body must contain at least one device data point.'
-    });
-  }
-
-  const errors = [];
-  const firstPoint = points[0];
-  const deviceId = firstPoint && (firstPoint.device || firstPoint.device_id || firstPoint.deviceId);
-
-  if (!deviceId || typeof deviceId !== 'string' || !deviceId.trim()) {
-    errors.push({ index: 0, field: 'device', message: 'Device ID is required on the first data point.' });
-  }
-
+function collectPointErrors(points, errors) {
   points.forEach((point, index) => {
     if (!point || typeof point !== 'object') {
       errors.push({ index, field: 'point', message: 'Each data point must be an object.' });
@@ -73,8 +56,59 @@ const validateDeviceInputPayload = (req, res, next) => {
         errors.push({ index, field: 'satellites', message: 'Satellites must be an integer between 0 and 50.' });
       }
     }
+
+    if (point.dwell_s !== undefined) {
+      const dwell = toNumber(point.dwell_s);
+      if (!Number.isInteger(dwell) || dwell < 0) {
+        errors.push({ index, field: 'dwell_s', message: 'dwell_s must be a non-negative integer of seconds.' });
+      }
+    }
   });
+  return errors;
+}
+
+const validateDeviceInputPayload = (req, res, next) => {
+  const points = normalizePoints(req.body);
+
+  if (!points || points.length === 0) {
+    return res.status(400).json({
+      success: false,
+      error: 'Request body must contain at least one device data point.'
+    });
+  }
+
+  const errors = [];
+  const firstPoint = points[0];
+  const deviceId = firstPoint && (firstPoint.device || firstPoint.device_id || firstPoint.deviceId);
+
+  if (!deviceId || typeof deviceId !== 'string' || !deviceId.trim()) {
+    errors.push({ index: 0, field: 'device', message: 'Device ID is required on the first data point.' });
+  }
+
+  collectPointErrors(points, errors);
+
+  if (errors.length > 0) {
+    return res.status(400).json({
+      success: false,
+      error: 'Invalid device payload.',
+      details: errors
+    });
+  }
+
+  next();
+};
+
+// Sync requests carry the handshake fields at the top level and the data points in `records`.
+const validateDeviceSyncPayload = (req, res, next) => {
+  const payload = req.body;
+  if (!payload || typeof payload !== 'object' || Array.isArray(payload)) {
+    return res.status(400).json({ success: false, error: 'Request body must be an object.' });
+  }
+  if (payload.records !== undefined && !Array.isArray(payload.records)) {
+    return res.status(400).json({ success: false, error: 'records must be an array.' });
+  }
 
+  const errors = collectPointErrors(payload.records || [], []);
   if (errors.length > 0) {
     return res.status(400).json({
       success: false,
@@ -101,11 +135,22 @@ const validateSettings = [
   body('interval_gps').isInt({ min: 1, max: 3600 * 24 * 30 }).withMessage('GPS interval must be a valid integer of seconds (min 1s, max 30 days).'),
   body('interval_send').isInt({ min: 1, max: 3600 * 24 * 30 }).withMessage('Send interval must be a valid integer of seconds (min 1s, max 30 days).'),
   body('satellites').isInt({ min: 1, max: 50 }).withMessage('Satellites must be a valid integer (min 1, max 50).'),
-  body('mode').isIn(['simple', 'batch']).withMessage('Mode must be either "simple" or "batch".')
+  body('mode').isIn(['simple', 'batch']).withMessage('Mode must be either "simple" or "batch".'),
+  // Optional HW tuning; the firmware applies these as sent
+  body('max_batch').optional().isInt({ min: 1, max: 500 }).withMessage('Max batch must be an integer between 1 and 500 records.'),
+  body('accuracy_m').optional().isInt({ min: 0, max: 100 }).withMessage('Accuracy target must be an integer between 0 and 100 m.'),
+  body('track_tolerance_m').optional().isInt({ min: 0, max: 1000 }).withMessage('Track tolerance must be an integer between 0 and 1000 m.'),
+  body('dwell_radius_m').optional().isInt({ min: 0, max: 1000 }).withMessage('Dwell radius must be an integer between 0 and 1000 m.'),
+  body('resolution_m').optional().isInt({ min: 0, max: 10000 }).withMessage('Resolution must be an integer between 0 and 10000 m.'),
+  body('interval_min').optional().isInt({ min: 1, max: 3600 * 24 }).withMessage('Shortest GPS interval must be an integer of seconds (min 1s, max 1 day).'),
+  body('interval_max').optional().isInt({ min: 1, max: 3600 * 24 * 30 }).withMessage('Longest GPS interval must be an integer of seconds (min 1s, max 30 days).')
+    .custom((value, { req }) => req.body.interval_min === undefined || Number(value) >= Number(req.body.interval_min))
+    .withMessage('Longest GPS interval must not be shorter than the shortest one.')
 ];
 
 module.exports = {
     validateCoordinates,
   validateSettings,
-  validateDeviceInputPayload
+  validateDeviceInputPayload,
+  validateDeviceSyncPayload
 }; 
\ No newline at end of file
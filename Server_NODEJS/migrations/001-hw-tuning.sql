@@ -0,0 +1,18 @@
+-- Upgrade of a database created before the HW tuning keys and dwell records.
+-- init-db.sql drops the database, and sequelize.sync() in production does not
+-- alter existing tables, so an existing installation needs these columns added
+-- once. A second run fails with "Duplicate column name" and changes nothing.
+--
+--   mysql -u <user> -p gps_tracking < migrations/001-hw-tuning.sql
+
+ALTER TABLE devices
+    ADD COLUMN max_batch INT NOT NULL DEFAULT 500 AFTER satellites,
+    ADD COLUMN accuracy_m INT NOT NULL DEFAULT 10 AFTER max_batch,
+    ADD COLUMN track_tolerance_m INT NOT NULL DEFAULT 10 AFTER accuracy_m,
+    ADD COLUMN dwell_radius_m INT NOT NULL DEFAULT 25 AFTER track_tolerance_m,
+    ADD COLUMN resolution_m INT NOT NULL DEFAULT 0 AFTER dwell_radius_m,
+    ADD COLUMN interval_min INT NOT NULL DEFAULT 15 AFTER resolution_m,
+    ADD COLUMN interval_max INT NOT NULL DEFAULT 900 AFTER interval_min;
+
+ALTER TABLE locations
+    ADD COLUMN dwell_s INT NULL AFTER satellites;
@@ -56,6 +56,42 @@ module.exports = (sequelize, DataTypes) => {
       allowNull: false,
       defaultValue: 7
     },
+    // HW tuning sent in the handshake config; defaults match the firmware's config.h
+    max_batch: {
+      type: DataTypes.INTEGER,
+      allowNull: false,
+      defaultValue: 500 // Records per upload request (firmware MAX_BATCH_SIZE)
+    },
+    accuracy_m: {
+      type: DataTypes.INTEGER,
+      allowNull: false,
+      defaultValue: 10 // Fix accuracy target in meters, 0 = first valid fix
+    },
+    track_tolerance_m: {
+      type: DataTypes.INTEGER,
+      allowNull: false,
+      defaultValue: 10 // Track simplification tolerance in meters, 0 = every fix
+    },
+    dwell_radius_m: {
+      type: DataTypes.INTEGER,
+      allowNull: false,
+      defaultValue: 25
+    },
+    resolution_m: {
+      type: DataTypes.INTEGER,
+      allowNull: false,
+      defaultValue: 0 // Adaptive sampling resolution in meters, 0 = fixed interval_gps
+    },
+    interval_min: {
+      type: DataTypes.INTEGER,
+      allowNull: false,
+      defaultValue: 15
+    },
+    interval_max: {
+      type: DataTypes.INTEGER,
+      allowNull: false,
+      defaultValue: 900
+    },
     geofence: {
       type: DataTypes.JSON,
       allowNull: true
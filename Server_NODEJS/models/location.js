@@ -32,7 +32,9 @@ module.exports = (sequelize, DataTypes) => {
     speed: DataTypes.DECIMAL(5, 2),
     altitude: DataTypes.DECIMAL(7, 2),
     accuracy: DataTypes.DECIMAL(5, 2),
-    satellites: DataTypes.INTEGER
+    satellites: DataTypes.INTEGER,
+    // Seconds the device stood at this position up to timestamp (dwell record)
+    dwell_s: DataTypes.INTEGER
   }, {
     timestamps: true,
     createdAt: 'timestamp',
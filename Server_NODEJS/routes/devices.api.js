@@ -1,7 +1,7 @@
 const express = require('express');
 const router = express.Router();
 const deviceController = require('../controllers/deviceController');
-const { validateSettings, validateDeviceInputPayload } = require('../middleware/validators');
+const { validateSettings, validateDeviceInputPayload, validateDeviceSyncPayload } = require('../middleware/validators');
 const { isAuthenticated, isUser, authenticateDevice, isNotRootApi } = require('../middleware/authorization');
 
 /**
@@ -49,6 +49,10 @@ const { isAuthenticated, isUser, authenticateDevice, isNotRootApi } = require('.
  *           type: integer
  *           description: Number of satellites.
  *           example: 8
+ *         dwell_s:
+ *           type: integer
+ *           description: Dwell records only. Seconds the device stood at this position up to the timestamp.
+ *           example: 1800
  *         timestamp:
  *           type: string
  *           format: date-time
@@ -95,6 +99,34 @@ const { isAuthenticated, isUser, authenticateDevice, isNotRootApi } = require('.
  *            type: integer
  *            description: The new number of satellites.
  *            example: 7
+ *          max_batch:
+ *            type: integer
+ *            description: Optional. Most records per upload request (1-500).
+ *            example: 500
+ *          accuracy_m:
+ *            type: integer
+ *            description: Optional. Fix accuracy target in meters, 0 = first valid fix.
+ *            example: 10
+ *          track_tolerance_m:
+ *            type: integer
+ *            description: Optional. Track simplification tolerance in meters, 0 = keep every fix.
+ *            example: 10
+ *          dwell_radius_m:
+ *            type: integer
+ *            description: Optional. Radius in meters within which the device counts as standing.
+ *            example: 25
+ *          resolution_m:
+ *            type: integer
+ *            description: Optional. Adaptive sampling resolution in meters, 0 = fixed interval_gps.
+ *            example: 0
+ *          interval_min:
+ *            type: integer
+ *            description: Optional. Shortest adaptive GPS interval in seconds.
+ *            example: 15
+ *          interval_max:
+ *            type: integer
+ *            description: Optional. Longest adaptive GPS interval in seconds.
+ *            example: 900
  *     DeviceRegister:
  *       type: object
  *       required:
@@ -216,6 +248,27 @@ router.post('/register', deviceController.registerDeviceUnified);
  *                     mode:
  *                       type: string
  *                       example: "simple"
+ *                     max_batch:
+ *                       type: integer
+ *                       example: 500
+ *                     accuracy_m:
+ *                       type: integer
+ *                       example: 10
+ *                     track_tolerance_m:
+ *                       type: integer
+ *                       example: 10
+ *                     dwell_radius_m:
+ *                       type: integer
+ *                       example: 25
+ *                     resolution_m:
+ *                       type: integer
+ *                       example: 0
+ *                     interval_min:
+ *                       type: integer
+ *                       example: 15
+ *                     interval_max:
+ *                       type: integer
+ *                       example: 900
  *                 power_instruction:
  *                   type: string
  *                   example: "NONE"
@@ -256,6 +309,38 @@ router.post('/handshake', deviceController.handleDeviceHandshake);
  */
 router.post('/input', authenticateDevice, validateDeviceInputPayload, deviceController.handleDeviceInput);
 
+/**
+ * @swagger
+ * /api/devices/sync:
+ *   post:
+ *     summary: Handshake and data upload in a single request
+ *     description: Accepts the handshake fields together with a `records` array of data points. Saves one TLS round trip per session on cellular devices.
+ *     tags: [Devices API]
+ *     requestBody:
+ *       required: true
+ *       content:
+ *         application/json:
+ *           schema:
+ *             allOf:
+ *               - $ref: '#/components/schemas/DeviceHandshake'
+ *               - type: object
+ *                 properties:
+ *                   records:
+ *                     type: array
+ *                     items:
+ *                       $ref: '#/components/schemas/DeviceInput'
+ *     responses:
+ *       '200':
+ *         description: Same payload as /api/devices/handshake plus `success` and the number of `accepted` records.
+ *       '400':
+ *         description: Bad request (e.g., missing device_id, invalid coordinates, records of another device).
+ *       '404':
+ *         description: Device not found or not registered.
+ *       '500':
+ *         description: Server error.
+ */
+router.post('/sync', authenticateDevice, validateDeviceSyncPayload, deviceController.handleDeviceSync);
+
 /**
  * @swagger
  * /api/devices/coordinates:
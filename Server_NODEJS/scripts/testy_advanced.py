@@ -152,6 +152,41 @@ def send_clustered_location_data(state: DeviceState, include_extra_data: bool =
     return response.status_code == 200
 
 
+def send_dwell_via_sync(state: DeviceState) -> bool:
+    """Send a dwell record (dwell_s) through /sync; a negative dwell_s must be rejected."""
+    url = f"{BASE_URL}/api/devices/sync"
+    timestamp = time.strftime('%Y-%m-%dT%H:%M:%SZ', time.gmtime())
+
+    dwell_point = {
+        "device": DEVICE_ID,
+        "latitude": 50.08804,
+        "longitude": 14.42076,
+        "speed": 0,
+        "altitude": 200,
+        "accuracy": 3.0,
+        "satellites": 10,
+        "timestamp": timestamp,
+        "dwell_s": 1800
+    }
+
+    payload = build_handshake_payload(state)
+    payload["records"] = [dwell_point]
+    print(f"\n--- Sync se záznamem stání (dwell_s={dwell_point['dwell_s']}) ---")
+    response = json_request("POST", url, payload)
+    if response is None or response.status_code != 200 or response.json().get("accepted") != 1:
+        print("Záznam stání nebyl přijat.")
+        return False
+
+    payload["records"] = [dict(dwell_point, dwell_s=-5)]
+    print("\n--- Sync se záporným dwell_s (očekáváno 400) ---")
+    response = json_request("POST", url, payload)
+    if response is None or response.status_code != 400:
+        print("Server přijal neplatné dwell_s.")
+        return False
+
+    return True
+
+
 def main() -> int:
     print("Spouštím testovací skript podle HW_comm_requirements...")
 
@@ -174,6 +209,10 @@ def main() -> int:
         print("Odeslání dat se nezdařilo.")
         return 1
 
+    if not send_dwell_via_sync(state):
+        print("Test záznamu stání selhal.")
+        return 1
+
 
     follow_up = perform_handshake(state)
     if follow_up:
@@ -18,6 +18,8 @@ app.set('views', path.join(__dirname, 'views'));
 
 // Middleware (order is important)
 app.use(express.json({
+  // Devices upload batches up to SERVER_MAX_BODY_BYTES (100 kB, firmware config.h); keep headroom above it
+  limit: process.env.JSON_BODY_LIMIT || '256kb',
   verify: (req, res, buf) => {
     if (!req.rawBody && buf && buf.length) {
       req.rawBody = buf.toString('utf8');
@@ -1,6 +1,12 @@
 const db = require('../database');
 const bcrypt = require('bcryptjs');
 
+// HW tuning keys stored per device and sent in the handshake config; bounds are in validators.js
+const TUNING_FIELDS = ['max_batch', 'accuracy_m', 'track_tolerance_m', 'dwell_radius_m',
+  'resolution_m', 'interval_min', 'interval_max'];
+
+const pickTuning = device => Object.fromEntries(TUNING_FIELDS.map(field => [field, Number(device[field])]));
+
 class DeviceService {
   /**
    * Centralized logic to register a device for a user.
@@ -101,6 +107,7 @@ class DeviceService {
           interval_gps: device.interval_gps,
           interval_send: device.interval_send,
           satellites: device.satellites,
+          ...pickTuning(device),
           geofence: device.geofence,
           created_at: device.created_at,
           device_type: device.device_type,
@@ -114,7 +121,8 @@ class DeviceService {
    * Updates settings for a device.
    * @param {string} deviceId 
    * @param {number} userId 
-   * @param {object} settings - { interval_gps, interval_send, satellites, mode }
+   * @param {object} settings - { interval_gps, interval_send, satellites, mode } and optionally
+   *   any of TUNING_FIELDS
    */
   async updateSettings(deviceId, userId, settings) {
       const device = await db.Device.findOne({
@@ -127,12 +135,19 @@ class DeviceService {
       const nextIntervalSend = Number(settings.interval_send);
       const nextSatellites = Number(settings.satellites);
       const nextMode = settings.mode;
+      const nextTuning = {};
+      TUNING_FIELDS.forEach(field => {
+          if (settings[field] !== undefined && settings[field] !== null) {
+              nextTuning[field] = Number(settings[field]);
+          }
+      });
 
       const noChanges = (
           Number(device.interval_gps) === nextIntervalGps &&
           Number(device.interval_send) === nextIntervalSend &&
           Number(device.satellites) === nextSatellites &&
-          device.mode === nextMode
+          device.mode === nextMode &&
+          Object.keys(nextTuning).every(field => Number(device[field]) === nextTuning[field])
       );
 
       if (noChanges) return { updated: false };
@@ -142,7 +157,8 @@ class DeviceService {
               interval_gps: nextIntervalGps, 
               interval_send: nextIntervalSend, 
               satellites: nextSatellites, 
-              mode: nextMode 
+              mode: nextMode,
+              ...nextTuning
           },
           { where: { id: device.id } }
       );
@@ -159,7 +175,8 @@ class DeviceService {
       interval_gps: Number(device.interval_gps),
       interval_send: Number(device.interval_send),
       satellites: Number(device.satellites),
-      mode: device.mode
+      mode: device.mode,
+      ...pickTuning(device)
     };
   }
 
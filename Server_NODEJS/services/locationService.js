@@ -35,6 +35,7 @@ class LocationService {
           altitude: point.altitude !== undefined ? point.altitude : null,
           accuracy: point.accuracy !== undefined ? point.accuracy : null,
           satellites: point.satellites !== undefined ? point.satellites : null,
+          dwell_s: point.dwell_s !== undefined ? point.dwell_s : null,
           timestamp: point.timestamp && new Date(point.timestamp).getTime() > 0 ? new Date(point.timestamp) : new Date() 
         };
       });